@@ -58,33 +58,170 @@
 #if defined( HAVE_ACESFILE )
 #include <aces_Writer.h>
 #include <stdexcept>
+#include <string>
 #include <half.h>
+#include <Iex.h>
+#include <IlmThreadPool.h>
+#include "half_convert.hh"
 
-void aces_write(const char *name, float scale, 
-               uint32_t width, uint32_t height, uint32_t channels,
-               const float *pixels,
-               format_t *format) {
+// Converts each strip to half on the worker threads, then hands its rows to
+// the writer from a task of its own, so that they are stored while the
+// next strip is transformed. At most two strips of half samples are held.
+class aces_writer: public image_writer {
+	public:
+		aces_writer(float scale) : scale(scale) {
+			current = 0;
+			row = 0;
+			pending = NULL;
+		}
+
+		virtual ~aces_writer() {
+			delete pending;
+		}
+
+		virtual void write(const ctl::dpx::fb<float> &pixels);
+		virtual void close(void);
+
+		// Stores the rows of 'strip', the first of which is 'first_row'.
+		// Run by a worker thread.
+		void store(const ctl::dpx::fb<half> *strip, uint32 first_row);
+
+		aces_Writer x;
+
+	private:
+		void wait(void);
+
+		float scale;
+		ctl::dpx::fb<half> strips[2];
+		uint32 current; // the strip being stored
+		uint32 row;
+		IlmThread::TaskGroup *pending; // the store of strips[current]
+		std::string error;
+};
+
+namespace {
+
+class convert_task: public IlmThread::Task {
+	public:
+		convert_task(IlmThread::TaskGroup *group, half *out, const float *in,
+		             float scale, uint64_t count) :
+			IlmThread::Task(group), out(out), in(in), scale(scale),
+			count(count) {
+		}
+
+		virtual void execute() {
+			float_to_half(out, in, scale, count);
+		}
+
+	private:
+		half *out;
+		const float *in;
+		float scale;
+		uint64_t count;
+};
+
+class store_task: public IlmThread::Task {
+	public:
+		store_task(IlmThread::TaskGroup *group, aces_writer *writer,
+		           const ctl::dpx::fb<half> *strip, uint32 first_row) :
+			IlmThread::Task(group), writer(writer), strip(strip),
+			first_row(first_row) {
+		}
+
+		virtual void execute() {
+			writer->store(strip, first_row);
+		}
+
+	private:
+		aces_writer *writer;
+		const ctl::dpx::fb<half> *strip;
+		uint32 first_row;
+};
+
+}
+
+void aces_writer::write(const ctl::dpx::fb<float> &pixels) {
+	ctl::dpx::fb<half> *next = &(strips[current ^ 1]);
+	uint64_t row_samples = (uint64_t)pixels.width() * pixels.depth();
+	uint32 slices;
+	uint32 slice_rows;
+	uint32 r;
+
+	// The previous strip may still be being stored from the other buffer,
+	// so this one is converted into 'next'.
+	next->init(pixels.width(), pixels.height(), pixels.depth());
+
+	slices = IlmThread::ThreadPool::globalThreadPool().numThreads();
+	if (slices < 1) {
+		slices = 1;
+	}
+	slice_rows = (pixels.height() + slices - 1) / slices;
+	if (slice_rows < 1) {
+		slice_rows = 1;
+	}
+	{
+		IlmThread::TaskGroup group;
+
+		for (r = 0; r < pixels.height(); r += slice_rows) {
+			uint32 rows = pixels.height() - r;
+
+			if (rows > slice_rows) {
+				rows = slice_rows;
+			}
+			IlmThread::ThreadPool::addGlobalTask(
+				new convert_task(&group, next->ptr() + r * row_samples,
+				                 pixels.ptr() + r * row_samples, scale,
+				                 rows * row_samples));
+		}
+	}
+
+	wait();
+	current = current ^ 1;
+	pending = new IlmThread::TaskGroup;
+	IlmThread::ThreadPool::addGlobalTask(
+		new store_task(pending, this, next, row));
+	row = row + pixels.height();
+}
+
+void aces_writer::store(const ctl::dpx::fb<half> *strip, uint32 first_row) {
+	uint64_t row_samples = (uint64_t)strip->width() * strip->depth();
+	uint32 r;
+
+	try {
+		for (r = 0; r < strip->height(); r++) {
+			// halfBytes are the bits of a half.
+			x.storeHalfRow((halfBytes *)(strip->ptr() + r * row_samples),
+			               first_row + r);
+		}
+	} catch (std::exception &e) {
+		error = e.what();
+	}
+}
+
+// Waits for the rows of the previous strip to be stored.
+void aces_writer::wait(void) {
+	delete pending;
+	pending = NULL;
+	if (!error.empty()) {
+		THROW(Iex::IoExc, "unable to store the rows of the ACES file ("
+		      << error << ").");
+	}
+}
+
+void aces_writer::close(void) {
+	wait();
+	x.saveImageObject ( );
+}
+
+image_writer *aces_create(const char *name, float scale, 
+                          uint32_t width, uint32_t height, uint32_t channels,
+                          format_t *format) {
 
-	std::vector<halfBytes> scaled_pixels;
-	
-    {
-        float const *in = pixels;
-        if (scale == 0.0f) scale = 1.0f;
-        
-        scaled_pixels.resize(height*width*channels);
-        halfBytes *out = &scaled_pixels[0];
-        for(size_t i=0; i<scaled_pixels.size(); i++) {
-			half tmpV( *(in++) / scale );
-            *(out++)=tmpV.bits();
-        }
-    }
-
-    halfBytes *in = &scaled_pixels[0];
-	
     std::vector<std::string> filenames;
 	filenames.push_back( name );
 	
-	aces_Writer x;
+	aces_writer *writer = new aces_writer(scale);
+	aces_Writer &x = writer->x;
 	
 	MetaWriteClip writeParams;
 	
@@ -115,6 +252,7 @@ void aces_write(const char *name, float scale,
 			writeParams.hi.channels[3].name = "R";
 			break;
 		case 6:
+			delete writer;
 			throw std::invalid_argument("Stereo RGB support not yet implemented");
 //			writeParams.hi.channels.resize(6);
 //			writeParams.hi.channels[0].name = "B";
@@ -125,6 +263,7 @@ void aces_write(const char *name, float scale,
 //			writeParams.hi.channels[5].name = "left.R";
 //			break;
 		case 8:
+			delete writer;
 			throw std::invalid_argument("Stereo RGB support not yet implemented");
 //			writeParams.hi.channels.resize(8);
 //			writeParams.hi.channels[0].name = "A";
@@ -137,6 +276,7 @@ void aces_write(const char *name, float scale,
 //			writeParams.hi.channels[7].name = "left.R";
 //			break;
 		default:
+			delete writer;
 			throw std::invalid_argument("Only RGB, RGBA or stereo RGB[A] file supported");
 			break;
 	}
@@ -148,11 +288,6 @@ void aces_write(const char *name, float scale,
 	x.configure ( writeParams );
 	x.newImageObject ( dynamicMeta );		
 
-	for ( uint32 row = 0; row < height; row++) {
-		halfBytes *rgbData = in + width*channels*row;
-		x.storeHalfRow ( rgbData, row ); 
-	}
-
 #if 0
 	std::cout << "saving aces file" << std::endl;
 	std::cout << "size " << width << "x" << height << "x" << channels << std::endl;
@@ -168,17 +303,17 @@ void aces_write(const char *name, float scale,
 	std::cout << "uuid " << dynamicMeta.uuid << std::endl;
 #endif
 
-	x.saveImageObject ( );	
+	return writer;
 }
 
 #else 
 
-void aces_write(const char *name, float scale,
-                uint32_t width, uint32_t height, uint32_t channels,
-                const float *pixels,
-                format_t *format)
+image_writer *aces_create(const char *name, float scale,
+                          uint32_t width, uint32_t height, uint32_t channels,
+                          format_t *format)
 {
 	std::cerr << "AcesContainer library not found" << std::endl;
+	return NULL;
 }
 
 #endif
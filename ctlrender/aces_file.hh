@@ -56,10 +56,10 @@
 #define CTL_UTIL_CTLRENDER_ACESFILE_INCLUDE
 
 #include <format.hh>
+#include "image_io.hh"
 
-void aces_write(const char *name, float scale,
-                uint32_t width, uint32_t height, uint32_t channels,
-                const float *pixels,
-                format_t *format);
+image_writer *aces_create(const char *name, float scale,
+                          uint32_t width, uint32_t height, uint32_t channels,
+                          format_t *format);
 
 #endif
@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include "ctld.hh"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <Iex.h>
+
+ctld_message::ctld_message() {
+	pos=0;
+}
+
+void ctld_message::put_u32(uint32_t v) {
+	data.insert(data.end(), (const char *)&v, (const char *)&v+sizeof(v));
+}
+
+void ctld_message::put_float(float v) {
+	data.insert(data.end(), (const char *)&v, (const char *)&v+sizeof(v));
+}
+
+void ctld_message::put_double(double v) {
+	data.insert(data.end(), (const char *)&v, (const char *)&v+sizeof(v));
+}
+
+void ctld_message::put_string(const std::string &v) {
+	put_u32(v.size());
+	data.insert(data.end(), v.begin(), v.end());
+}
+
+void ctld_message::get(void *v, size_t size) {
+	if(size>data.size()-pos) {
+		THROW(Iex::InputExc, "truncated ctld message.");
+	}
+	memcpy(v, &data[pos], size);
+	pos=pos+size;
+}
+
+uint32_t ctld_message::get_u32(void) {
+	uint32_t v;
+
+	get(&v, sizeof(v));
+	return v;
+}
+
+float ctld_message::get_float(void) {
+	float v;
+
+	get(&v, sizeof(v));
+	return v;
+}
+
+double ctld_message::get_double(void) {
+	double v;
+
+	get(&v, sizeof(v));
+	return v;
+}
+
+std::string ctld_message::get_string(void) {
+	uint32_t size=get_u32();
+	std::string v;
+
+	if(size>data.size()-pos) {
+		THROW(Iex::InputExc, "truncated ctld message.");
+	}
+	v.assign(&data[0]+pos, size);
+	pos=pos+size;
+	return v;
+}
+
+namespace {
+
+bool send_fully(int fd, const void *buf, size_t size) {
+	size_t done=0;
+	ssize_t w;
+
+	while(done<size) {
+		w=send(fd, (const char *)buf+done, size-done, MSG_NOSIGNAL);
+		if(w<0 && errno==EINTR) {
+			continue;
+		}
+		if(w<=0) {
+			return false;
+		}
+		done=done+w;
+	}
+	return true;
+}
+
+bool receive_fully(int fd, void *buf, size_t size) {
+	size_t done=0;
+	ssize_t r;
+
+	while(done<size) {
+		r=recv(fd, (char *)buf+done, size-done, 0);
+		if(r<0 && errno==EINTR) {
+			continue;
+		}
+		if(r<=0) {
+			return false;
+		}
+		done=done+r;
+	}
+	return true;
+}
+
+}
+
+bool ctld_message::send(int fd) const {
+	uint32_t size=data.size();
+
+	return send_fully(fd, &size, sizeof(size)) &&
+	       (size==0 || send_fully(fd, &data[0], size));
+}
+
+bool ctld_message::receive(int fd) {
+	uint32_t size;
+
+	pos=0;
+	data.clear();
+	if(!receive_fully(fd, &size, sizeof(size))) {
+		return false;
+	}
+	data.resize(size);
+	return size==0 || receive_fully(fd, &data[0], size);
+}
+
+std::string ctld_default_socket(void) {
+	const char *env=getenv("CTLD_SOCKET");
+	char path[64];
+
+	if(env!=NULL && *env!=0) {
+		return env;
+	}
+	snprintf(path, sizeof(path), "/tmp/ctld-%d", (int)getuid());
+	return path;
+}
+
+int ctld_connect(const char *path) {
+	struct sockaddr_un address;
+	int fd;
+
+	if(strlen(path)>=sizeof(address.sun_path)) {
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family=AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	fd=socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd<0) {
+		return -1;
+	}
+	if(connect(fd, (struct sockaddr *)&address, sizeof(address))<0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+namespace {
+
+void put_parameters(ctld_message *message, const CTLParameters &parameters) {
+	CTLParameters::const_iterator i;
+	uint8_t v;
+
+	message->put_u32(parameters.size());
+	for(i=parameters.begin(); i!=parameters.end(); i++) {
+		message->put_string(i->name);
+		message->put_u32(i->count);
+		for(v=0; v<i->count; v++) {
+			message->put_float(i->value[v]);
+		}
+	}
+}
+
+void get_parameters(ctld_message *message, std::deque<std::string> *strings,
+                    CTLParameters *parameters) {
+	uint32_t count, values, u, v;
+
+	count=message->get_u32();
+	for(u=0; u<count; u++) {
+		ctl_parameter_t parameter;
+
+		strings->push_back(message->get_string());
+		parameter.name=strings->back().c_str();
+		values=message->get_u32();
+		if(values>4) {
+			THROW(Iex::InputExc, "CTL parameter " << parameter.name
+			      << " has more than 4 values.");
+		}
+		parameter.count=values;
+		for(v=0; v<values; v++) {
+			parameter.value[v]=message->get_float();
+		}
+		parameters->push_back(parameter);
+	}
+}
+
+}
+
+void ctld_put_operations(ctld_message *message, const CTLOperations &ops,
+                         const CTLParameters &global) {
+	CTLOperations::const_iterator i;
+	char *path;
+
+	message->put_u32(ops.size());
+	for(i=ops.begin(); i!=ops.end(); i++) {
+		// The daemon has a working directory of its own.
+		path=realpath(i->filename, NULL);
+		message->put_string(path!=NULL ? path : i->filename);
+		free(path);
+		put_parameters(message, i->local);
+	}
+	put_parameters(message, global);
+}
+
+void ctld_get_operations(ctld_message *message,
+                         std::deque<std::string> *strings,
+                         CTLOperations *ops, CTLParameters *global) {
+	uint32_t count, u;
+
+	count=message->get_u32();
+	for(u=0; u<count; u++) {
+		ctl_operation_t operation;
+
+		strings->push_back(message->get_string());
+		operation.filename=strings->back().c_str();
+		get_parameters(message, strings, &(operation.local));
+		ops->push_back(operation);
+	}
+	get_parameters(message, strings, global);
+}
+
+void ctld_put_module_paths(ctld_message *message,
+                           const std::vector<std::string> &paths) {
+	std::vector<std::string>::const_iterator i;
+	char *path;
+
+	message->put_u32(paths.size());
+	for(i=paths.begin(); i!=paths.end(); i++) {
+		// Relative directories are relative to the working directory of
+		// the client, not to that of the daemon.
+		path=realpath(i->c_str(), NULL);
+		message->put_string(path!=NULL ? std::string(path) : *i);
+		free(path);
+	}
+}
+
+std::vector<std::string> ctld_get_module_paths(ctld_message *message) {
+	std::vector<std::string> paths(message->get_u32());
+	size_t u;
+
+	for(u=0; u<paths.size(); u++) {
+		paths[u]=message->get_string();
+	}
+	return paths;
+}
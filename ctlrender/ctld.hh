@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#if !defined(CTL_UTIL_CTLRENDER_CTLD_INCLUDE)
+#define CTL_UTIL_CTLRENDER_CTLD_INCLUDE
+
+// ctld keeps the ctl operations of the jobs it has run loaded, so that
+// ctlrender (with -daemon, or CTLD_SOCKET set) does not have to load and
+// compile the CTL scripts for every image. They talk over a Unix domain
+// socket; the pixels go both ways in POSIX shared memory segments that hold
+// raw frames (see raw_file.hh), so only the names of the segments and the
+// ctl operations are sent.
+//
+// Each message is a 32 bit length followed by that many bytes: the magic
+// number, the kind of request, and the fields of that request, in the byte
+// order of the machine. Strings are a 32 bit length and the characters.
+//
+//   transform request: input segment, output segment, strip rows, module
+//                      paths, ctl operations, global parameters
+//   transform reply:   status (0 for success), error message, DPX
+//                      descriptor of the result, TRUE if the loaded
+//                      operations were used, and the milliseconds spent
+//                      loading, transforming and in total
+//   stats request:     nothing; the reply is a string with the latencies
+//                      of the requests served so far
+//   quit request:      nothing; the daemon exits after replying
+
+#include "transform.hh"
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define CTLD_MAGIC 0x444c5443 // "CTLD"
+
+enum ctld_request_e {
+	ctld_transform_request=1,
+	ctld_stats_request=2,
+	ctld_quit_request=3
+};
+
+class ctld_message {
+	public:
+		ctld_message();
+
+		void put_u32(uint32_t v);
+		void put_float(float v);
+		void put_double(double v);
+		void put_string(const std::string &v);
+
+		// These throw an Iex::InputExc if the message is too short.
+		uint32_t get_u32(void);
+		float get_float(void);
+		double get_double(void);
+		std::string get_string(void);
+
+		// Both return FALSE if the other end has gone away.
+		bool send(int fd) const;
+		bool receive(int fd);
+
+		// The fields, without the length.
+		std::vector<char> data;
+
+	private:
+		void get(void *v, size_t size);
+
+		size_t pos;
+};
+
+// $CTLD_SOCKET, or /tmp/ctld-<user id> if it is not set.
+std::string ctld_default_socket(void);
+
+// Returns the connected socket, or -1 if no daemon listens on 'path'.
+int ctld_connect(const char *path);
+
+// The module paths of a transform request, with the directories made
+// absolute on the way out.
+void ctld_put_module_paths(ctld_message *message,
+                           const std::vector<std::string> &paths);
+std::vector<std::string> ctld_get_module_paths(ctld_message *message);
+
+// The ctl operations and parameters of a transform request. The names read
+// back are kept in 'strings', which has to outlive the lists.
+void ctld_put_operations(ctld_message *message, const CTLOperations &ops,
+                         const CTLParameters &global);
+void ctld_get_operations(ctld_message *message,
+                         std::deque<std::string> *strings,
+                         CTLOperations *ops, CTLParameters *global);
+
+#endif
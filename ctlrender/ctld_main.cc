@@ -0,0 +1,688 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+// ctld - keeps the CTL transforms that ctlrender has it run loaded, so that
+// running the same transforms on a sequence of images does not load and
+// compile the CTL scripts for each of them. See ctld.hh for the protocol.
+
+#include "ctld.hh"
+#include "raw_file.hh"
+#include "main.hh"
+#include <CtlInterpreter.h>
+#include <CtlMessage.h>
+#include <Iex.h>
+#include <IlmThreadPool.h>
+#if defined(HAVE_OPENEXR)
+#include <ImfThreading.h>
+#endif
+#include <algorithm>
+#include <list>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+int verbosity = 1;
+
+namespace
+{
+
+// The ctl operations of a job, loaded. The operations and parameters
+// point into strings, and the loaded transform into them. modules is the
+// file_stamps() of the modules the transform has loaded.
+struct cache_entry_t
+{
+	std::string key;
+	std::deque<std::string> strings;
+	CTLOperations ops;
+	CTLParameters global;
+	loaded_transform *transform;
+	std::string modules;
+	uint64_t last_used;
+
+	cache_entry_t() : transform(NULL), last_used(0)
+	{
+	}
+
+	~cache_entry_t()
+	{
+		delete transform;
+	}
+};
+
+// The latencies of the last 1024 transform requests.
+#define LATENCIES 1024
+
+struct stats_t
+{
+	uint64_t requests;
+	uint64_t warm;
+	uint64_t failed;
+	double latencies[LATENCIES];
+
+	stats_t() : requests(0), warm(0), failed(0)
+	{
+	}
+};
+
+std::list<cache_entry_t *> cache;
+size_t cache_size = 8;
+uint64_t requests_served = 0;
+stats_t stats;
+std::vector<std::string> module_paths;
+const char *socket_path = NULL;
+
+// What the CTL interpreter reported (a module it could not find, syntax
+// errors and so on) while the current request was served. It is sent back
+// with the error, as the client does not see the output of the daemon.
+std::string ctl_messages;
+
+void collect_message(const std::string &message)
+{
+	fputs(message.c_str(), stderr);
+	ctl_messages += message;
+}
+
+double now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// The operations and parameters as they were sent, the module paths, and
+// the modification time and size of each CTL file, so that a job runs
+// again if one of its scripts has been edited (the modules they import are
+// checked with file_stamps()).
+std::string cache_key(const CTLOperations &ops, const CTLParameters &global)
+{
+	ctld_message key;
+	ctld_put_operations(&key, ops, global);
+	key.put_u32(module_paths.size());
+	for (size_t i = 0; i < module_paths.size(); i++)
+	{
+		key.put_string(module_paths[i]);
+	}
+	for (CTLOperations::const_iterator i = ops.begin(); i != ops.end(); i++)
+	{
+		struct stat st;
+		if (stat(i->filename, &st) == 0)
+		{
+			key.put_double((double) st.st_mtime);
+			key.put_double((double) st.st_size);
+		}
+	}
+	return std::string(key.data.begin(), key.data.end());
+}
+
+// The names, modification times and sizes of files, so that the modules
+// loaded for a job (including the ones the scripts import) are loaded
+// again if one of them has been edited.
+std::string file_stamps(const std::vector<std::string> &files)
+{
+	ctld_message stamps;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		struct stat st;
+		stamps.put_string(files[i]);
+		if (stat(files[i].c_str(), &st) == 0)
+		{
+			stamps.put_double((double) st.st_mtime);
+			stamps.put_double((double) st.st_size);
+		}
+	}
+	return std::string(stamps.data.begin(), stamps.data.end());
+}
+
+// TRUE for the name of a shared memory segment. Requests may only name
+// those, so that clients can not have the daemon read or write their
+// files (or anyone's) with its privileges.
+bool is_segment(const std::string &name)
+{
+	return name.compare(0, 4, "shm:") == 0;
+}
+
+void forget(cache_entry_t *entry)
+{
+	cache.remove(entry);
+	delete entry;
+}
+
+// Finds the loaded ctl operations of a job, or makes an entry for them,
+// dropping the one used least recently if the cache is full. The entry
+// takes the strings that the operations point into.
+cache_entry_t *lookup(std::deque<std::string> *strings, const CTLOperations &ops, const CTLParameters &global,
+		              bool *warm)
+{
+	std::string key = cache_key(ops, global);
+	std::list<cache_entry_t *>::iterator i;
+
+	for (i = cache.begin(); i != cache.end(); i++)
+	{
+		if ((*i)->key == key)
+		{
+			*warm = true;
+			(*i)->last_used = requests_served;
+			return *i;
+		}
+	}
+
+	if (cache_size > 0 && cache.size() >= cache_size)
+	{
+		std::list<cache_entry_t *>::iterator oldest = cache.begin();
+		for (i = cache.begin(); i != cache.end(); i++)
+		{
+			if ((*i)->last_used < (*oldest)->last_used)
+			{
+				oldest = i;
+			}
+		}
+		forget(*oldest);
+	}
+
+	// The operations are copied, so the names they point to are moved
+	// over with them (a deque does not move its elements when it grows).
+	cache_entry_t *entry = new cache_entry_t;
+	entry->key = key;
+	entry->strings.swap(*strings);
+	entry->ops = ops;
+	entry->global = global;
+	entry->last_used = requests_served;
+	cache.push_back(entry);
+	*warm = false;
+	return entry;
+}
+
+void serve_transform(ctld_message *request, ctld_message *reply)
+{
+	double start = now_ms();
+	cache_entry_t *entry = NULL;
+	image_reader *reader = NULL;
+	format_t format("raw", 32);
+	bool warm = false;
+	double load_ms = 0.0;
+	double run_ms = 0.0;
+
+	ctl_messages.clear();
+	try
+	{
+		std::string input = request->get_string();
+		std::string output = request->get_string();
+		uint32_t strip_rows = request->get_u32();
+		if (!is_segment(input) || !is_segment(output))
+		{
+			THROW(Iex::ArgExc, "only shared memory segments (shm:<name>) are accepted, not '"
+					<< (is_segment(input) ? output : input) << "'.");
+		}
+		std::vector<std::string> paths = ctld_get_module_paths(request);
+		if (paths != module_paths)
+		{
+			module_paths = paths;
+			Ctl::Interpreter::setModulePaths(module_paths);
+		}
+
+		std::deque<std::string> strings;
+		CTLOperations ops;
+		CTLParameters global;
+		ctld_get_operations(request, &strings, &ops, &global);
+
+		format_t input_format;
+		reader = raw_open(input.c_str(), 0.0, &input_format);
+		if (reader == NULL)
+		{
+			THROW(Iex::ArgExc, "'" << input << "' is not a raw frame.");
+		}
+
+		entry = lookup(&strings, ops, global, &warm);
+		if (entry->transform != NULL &&
+			(!entry->transform->reusable(reader) || file_stamps(entry->transform->module_files()) != entry->modules))
+		{
+			delete entry->transform;
+			entry->transform = NULL;
+			warm = false;
+		}
+		if (entry->transform == NULL)
+		{
+			entry->transform = new loaded_transform(entry->ops, entry->global);
+		}
+
+		Compression compression = Compression::compressionNamed("PIZ");
+		double load_start = entry->transform->load_time();
+		double run_start = now_ms();
+		entry->transform->run(reader, output.c_str(), 0.0, &format, &compression, strip_rows);
+		entry->modules = file_stamps(entry->transform->module_files());
+		run_ms = now_ms() - run_start;
+		load_ms = (entry->transform->load_time() - load_start) * 1000.0;
+		run_ms -= load_ms;
+		delete reader;
+		reader = NULL;
+	}
+	catch (std::exception &e)
+	{
+		delete reader;
+		if (entry != NULL)
+		{
+			forget(entry);
+		}
+		stats.failed++;
+		if (verbosity > 0)
+		{
+			fprintf(stderr, "ctld: %s\n", e.what());
+		}
+		reply->put_u32(1);
+		if (ctl_messages.empty())
+		{
+			reply->put_string(e.what());
+		}
+		else
+		{
+			std::string messages = ctl_messages;
+			if (messages[messages.size() - 1] != '\n')
+			{
+				messages += '\n';
+			}
+			reply->put_string(messages + e.what());
+		}
+		reply->put_u32(0);
+		reply->put_u32(false);
+		reply->put_double(0.0);
+		reply->put_double(0.0);
+		reply->put_double(now_ms() - start);
+		return;
+	}
+
+	double total_ms = now_ms() - start;
+	stats.latencies[stats.requests % LATENCIES] = total_ms;
+	stats.requests++;
+	if (warm)
+	{
+		stats.warm++;
+	}
+	if (verbosity > 1)
+	{
+		fprintf(stderr, "ctld: %s, %.1f ms loading, %.1f ms transforming, %.1f ms in all\n", warm ? "warm" : "cold",
+				load_ms, run_ms, total_ms);
+	}
+
+	reply->put_u32(0);
+	reply->put_string("");
+	reply->put_u32(format.descriptor);
+	reply->put_u32(warm);
+	reply->put_double(load_ms);
+	reply->put_double(run_ms);
+	reply->put_double(total_ms);
+}
+
+std::string stats_report(void)
+{
+	char line[256];
+	std::string report;
+
+	snprintf(line, sizeof(line), "%llu transforms (%llu with loaded operations), %llu failed, %lu of %lu cached\n",
+			 (unsigned long long) stats.requests, (unsigned long long) stats.warm,
+			 (unsigned long long) stats.failed, (unsigned long) cache.size(), (unsigned long) cache_size);
+	report = line;
+
+	size_t count = stats.requests < LATENCIES ? stats.requests : LATENCIES;
+	if (count > 0)
+	{
+		std::vector<double> latencies(stats.latencies, stats.latencies + count);
+		std::sort(latencies.begin(), latencies.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			sum += latencies[i];
+		}
+		snprintf(line, sizeof(line),
+				 "latency of the last %lu (ms): min %.1f, mean %.1f, p50 %.1f, p95 %.1f, max %.1f\n",
+				 (unsigned long) count, latencies[0], sum / count, latencies[count / 2],
+				 latencies[(count * 95) / 100 < count ? (count * 95) / 100 : count - 1], latencies[count - 1]);
+		report += line;
+	}
+	return report;
+}
+
+// Serves the requests sent on a connection until the client closes it.
+// Returns false if the daemon was asked to quit.
+bool serve(int fd)
+{
+	ctld_message request;
+
+	while (request.receive(fd))
+	{
+		ctld_message reply;
+		uint32_t kind = 0;
+
+		try
+		{
+			if (request.get_u32() != CTLD_MAGIC)
+			{
+				THROW(Iex::InputExc, "not a ctld request.");
+			}
+			kind = request.get_u32();
+		}
+		catch (std::exception &e)
+		{
+			if (verbosity > 0)
+			{
+				fprintf(stderr, "ctld: %s\n", e.what());
+			}
+			return true;
+		}
+
+		requests_served++;
+		if (kind == ctld_transform_request)
+		{
+			serve_transform(&request, &reply);
+		}
+		else if (kind == ctld_stats_request)
+		{
+			reply.put_string(stats_report());
+		}
+		else if (kind == ctld_quit_request)
+		{
+			reply.put_string("ctld exiting.\n");
+			reply.send(fd);
+			return false;
+		}
+		else
+		{
+			if (verbosity > 0)
+			{
+				fprintf(stderr, "ctld: unknown request %u.\n", kind);
+			}
+			return true;
+		}
+
+		if (!reply.send(fd))
+		{
+			return true;
+		}
+	}
+	return true;
+}
+
+void stop(int)
+{
+	unlink(socket_path);
+	_exit(0);
+}
+
+int listen_on(const char *path)
+{
+	struct sockaddr_un addr;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "the socket name %s is too long.\n", path);
+		exit(1);
+	}
+
+	int fd = ctld_connect(path);
+	if (fd >= 0)
+	{
+		close(fd);
+		fprintf(stderr, "a ctld daemon is already listening on %s.\n", path);
+		exit(1);
+	}
+	// A socket left behind by a daemon that did not exit cleanly.
+	unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		fprintf(stderr, "unable to create a socket: %s\n", strerror(errno));
+		exit(1);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	// Only the user the daemon runs as may connect to it.
+	mode_t mask = umask(0077);
+	int bound = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+	umask(mask);
+	if (bound < 0 || listen(fd, 16) < 0)
+	{
+		fprintf(stderr, "unable to listen on %s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	return fd;
+}
+
+// Sends a request without fields to the daemon and prints its reply.
+int query(const char *path, ctld_request_e kind)
+{
+	int fd = ctld_connect(path);
+	if (fd < 0)
+	{
+		fprintf(stderr, "no ctld daemon listens on %s.\n", path);
+		return 1;
+	}
+
+	ctld_message message;
+	message.put_u32(CTLD_MAGIC);
+	message.put_u32(kind);
+	if (!message.send(fd) || !message.receive(fd))
+	{
+		fprintf(stderr, "the ctld daemon at %s went away.\n", path);
+		close(fd);
+		return 1;
+	}
+	fputs(message.get_string().c_str(), stdout);
+	close(fd);
+	return 0;
+}
+
+void help(void)
+{
+	fprintf(stdout, ""
+"ctld - keeps the CTL transforms run by ctlrender loaded between images\n"
+"\nusage:\n"
+"    ctld [<options> ...]\n"
+"\n"
+"options:\n"
+"\n"
+"    -socket <path>        The Unix domain socket to listen on. Defaults to\n"
+"                          $CTLD_SOCKET, or /tmp/ctld-<user id>. Run\n"
+"                          ctlrender with '-daemon <path>' (or with\n"
+"                          CTLD_SOCKET set) to have its transforms run here.\n"
+"\n"
+"    -cache <n>            Number of sets of ctl operations kept loaded.\n"
+"                          The one used least recently is dropped to make\n"
+"                          room for another. Defaults to 8.\n"
+"\n"
+"    -threads <n>          Number of worker threads used to read and write\n"
+"                          images. Defaults to one per processor.\n"
+"\n"
+"    -stats                Prints the number and latency of the transforms\n"
+"                          the running daemon has served, and exits.\n"
+"\n"
+"    -quit                 Has the running daemon exit.\n"
+"\n"
+"    -verbose              Increases the level of output verbosity.\n"
+"    -quiet                Decreases the level of output verbosity.\n"
+"");
+}
+
+} // namespace
+
+int main(int argc, const char **argv)
+{
+	std::string path = ctld_default_socket();
+	int threads = -1;
+	int command = 0;
+
+	argc--;
+	argv++;
+	while (argc > 0)
+	{
+		if ((!strcmp(argv[0], "-socket") || !strcmp(argv[0], "-cache") || !strcmp(argv[0], "-threads")) &&
+			argc == 1)
+		{
+			fprintf(stderr, "the %s option requires an additional argument.\n", argv[0]);
+			exit(1);
+		}
+
+		if (!strcmp(argv[0], "-socket"))
+		{
+			path = argv[1];
+			argv++;
+			argc--;
+		}
+		else if (!strcmp(argv[0], "-cache"))
+		{
+			cache_size = (size_t) atoi(argv[1]);
+			argv++;
+			argc--;
+		}
+		else if (!strcmp(argv[0], "-threads"))
+		{
+			threads = atoi(argv[1]);
+			argv++;
+			argc--;
+		}
+		else if (!strcmp(argv[0], "-stats"))
+		{
+			command = ctld_stats_request;
+		}
+		else if (!strcmp(argv[0], "-quit"))
+		{
+			command = ctld_quit_request;
+		}
+		else if (!strncmp(argv[0], "-verbose", 2))
+		{
+			verbosity++;
+		}
+		else if (!strncmp(argv[0], "-quiet", 2))
+		{
+			verbosity--;
+		}
+		else if (!strncmp(argv[0], "-help", 2))
+		{
+			help();
+			exit(0);
+		}
+		else
+		{
+			fprintf(stderr, "unrecognized option %s. see 'ctld -help'.\n", argv[0]);
+			exit(1);
+		}
+		argv++;
+		argc--;
+	}
+
+	if (command != 0)
+	{
+		return query(path.c_str(), (ctld_request_e) command);
+	}
+
+	if (threads < 0)
+	{
+		threads = 0;
+#if defined(_SC_NPROCESSORS_ONLN)
+		threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if (threads < 0)
+		{
+			threads = 0;
+		}
+	}
+#if defined(HAVE_OPENEXR)
+	Imf::setGlobalThreadCount(threads);
+#else
+	IlmThread::ThreadPool::globalThreadPool().setNumThreads(threads);
+#endif
+
+	socket_path = path.c_str();
+	int listener = listen_on(socket_path);
+	Ctl::setMessageOutputFunction(collect_message);
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	if (verbosity > 0)
+	{
+		fprintf(stderr, "ctld: listening on %s\n", socket_path);
+	}
+
+	bool running = true;
+	while (running)
+	{
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			fprintf(stderr, "ctld: accept failed: %s\n", strerror(errno));
+			break;
+		}
+		running = serve(fd);
+		close(fd);
+	}
+
+	close(listener);
+	unlink(socket_path);
+	while (!cache.empty())
+	{
+		forget(cache.front());
+	}
+	return 0;
+}
@@ -57,36 +57,117 @@
 #include <dpx.hh>
 #include <fstream>
 
-bool dpx_read(const char *name, float scale, ctl::dpx::fb<float> *pixels,
-              format_t *format) {
+// Decodes the rows of a mapped DPX file.
+class dpx_reader: public image_reader {
+	public:
+		virtual uint32_t width(void) const { return strips.width(); }
+		virtual uint32_t height(void) const { return strips.height(); }
+		virtual uint32_t depth(void) const { return strips.depth(); }
+
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *strip) {
+			strips.read(first_row, rows, strip);
+			strip->swizzle(descriptor, FALSE);
+		}
+
+		ctl::dpx::strip_reader strips;
+		uint8_t descriptor;
+};
+
+image_reader *dpx_open(const char *name, float scale, format_t *format) {
 	std::ifstream file;
 	ctl::dpx dpxheader;
+	dpx_reader *reader;
+	frame_reader *frame;
 
 	file.open(name);
 
 	if(!ctl::dpx::check_magic(&file)) {
-		return 0;
+		return NULL;
 	}
 	
 	dpxheader.read(&file);	
-	dpxheader.read(&file, 0, pixels, scale);
-
 	format->src_bps=dpxheader.elements[0].bits_per_sample;
-	pixels->swizzle(dpxheader.elements[0].descriptor, FALSE);
 
-	return 1;
+	reader=new dpx_reader;
+	reader->descriptor=dpxheader.elements[0].descriptor;
+	if(reader->strips.open(&dpxheader, name, 0, scale)) {
+		return reader;
+	}
+	delete reader;
+
+	// Not mappable (or an unusual layout), read it in one go.
+	frame=new frame_reader;
+	dpxheader.read(&file, 0, &(frame->frame), scale);
+	frame->frame.swizzle(dpxheader.elements[0].descriptor, FALSE);
+
+	return frame;
 }
 
-void dpx_write(const char *name, float scale, const ctl::dpx::fb<float> &pixels,
-               format_t *format) {
-	std::ofstream file;
-	ctl::dpx dpxheader;
+class dpx_strip_writer: public image_writer {
+	public:
+		virtual void write(const ctl::dpx::fb<float> &strip) {
+			strips.write(strip);
+		}
 
-	file.open(name);
+		virtual void close(void) {
+			strips.close();
+			dpxheader.write(&file);
+		}
 
-	dpxheader.elements[0].data_sign=0;
-	dpxheader.elements[0].bits_per_sample=format->bps;
-	dpxheader.write(&file, 0, pixels, scale);
-	dpxheader.write(&file);	
-}
+		std::ofstream file;
+		ctl::dpx dpxheader;
+		ctl::dpx::strip_writer strips;
+};
 
+// For the packings that can only be written from a whole image.
+class dpx_frame_writer: public frame_writer {
+	public:
+		dpx_frame_writer(uint32_t width, uint32_t height, uint32_t depth) :
+			frame_writer(width, height, depth) {
+		}
+
+		std::string name;
+		float scale;
+		uint8_t bps;
+		uint8_t dither;
+
+	protected:
+		virtual void write_frame(const ctl::dpx::fb<float> &pixels) {
+			std::ofstream file;
+			ctl::dpx dpxheader;
+
+			file.open(name.c_str());
+
+			dpxheader.elements[0].data_sign=0;
+			dpxheader.elements[0].bits_per_sample=bps;
+			dpxheader.write(&file, 0, pixels, scale,
+			                (ctl::dpx::dither_e)dither);
+			dpxheader.write(&file);	
+		}
+};
+
+image_writer *dpx_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format) {
+	dpx_strip_writer *writer;
+	dpx_frame_writer *frame;
+
+	writer=new dpx_strip_writer;
+	writer->file.open(name);
+	writer->dpxheader.elements[0].data_sign=0;
+	writer->dpxheader.elements[0].bits_per_sample=format->bps;
+	if(writer->strips.open(&(writer->dpxheader), &(writer->file), 0,
+	                       width, height, depth, scale,
+	                       (ctl::dpx::dither_e)format->dither)) {
+		return writer;
+	}
+	delete writer;
+
+	frame=new dpx_frame_writer(width, height, depth);
+	frame->name=name;
+	frame->scale=scale;
+	frame->bps=format->bps;
+	frame->dither=format->dither;
+	return frame;
+}
@@ -57,12 +57,12 @@
 
 #include <dpx.hh>
 #include "main.hh"
+#include "image_io.hh"
 
-bool dpx_read(const char *name, float scale,
-              ctl::dpx::fb<float> *pixels,
-              format_t *format);
-void dpx_write(const char *name, float scale,
-               const ctl::dpx::fb<float> &pixels,
-               format_t *format);
+// Returns NULL if the file is not a DPX file.
+image_reader *dpx_open(const char *name, float scale, format_t *format);
+image_writer *dpx_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format);
 
 #endif
@@ -55,16 +55,112 @@
 #include "exr_file.hh"
 
 #if defined(HAVE_OPENEXR)
+#include "half_convert.hh"
 #include <ImfInputFile.h>
 #include <ImfOutputFile.h>
-#include <ImfRgbaFile.h>
-#include <ImfArray.h>
 #include <ImfHeader.h>
 #include <ImfChannelList.h>
+#include <ImfThreading.h>
 #include <Iex.h>
+#include <fstream>
 
-bool exr_read(const char *name, float scale, ctl::dpx::fb<float> *pixels,
-              format_t *format) {
+// Reads the R, G, B and A channels of a scanline file a strip at a time,
+// or those of them that are selected. Files whose channels are all half
+// are decoded as half and widened to float, with the scale applied, in a
+// single pass afterwards.
+class exr_reader: public image_reader {
+	public:
+		exr_reader(const char *name, float scale) :
+			file(name, Imf::globalThreadCount()), scale(scale), channels(0xf) {
+			dw=file.header().dataWindow();
+			check_half();
+		}
+
+		virtual uint32_t width(void) const { return dw.max.x-dw.min.x+1; }
+		virtual uint32_t height(void) const { return dw.max.y-dw.min.y+1; }
+		virtual uint32_t depth(void) const { return selected_channels(channels); }
+
+		virtual bool select_channels(uint32_t mask) {
+			channels=mask&0xf;
+			check_half();
+			return true;
+		}
+
+		const Imf::Header &header(void) const { return file.header(); }
+
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *pixels) {
+			pixels->init(width(), rows, depth());
+
+			if(all_half) {
+				half_pixels.init(width(), rows, depth());
+				read_pixels(Imf::HALF, (char *)half_pixels.ptr(), sizeof(half), first_row, rows);
+				half_to_float(pixels->ptr(), half_pixels.ptr(), scale, pixels->count());
+			} else {
+				read_pixels(Imf::FLOAT, (char *)pixels->ptr(), sizeof(float), first_row, rows);
+				scale_float(pixels->ptr(), pixels->ptr(), scale, pixels->count());
+			}
+		}
+
+	private:
+		// Sets all_half if all of the selected channels the file has are
+		// half.
+		void check_half(void) {
+			all_half=true;
+			for(int c=0; c<4; c++) {
+				const Imf::Channel *channel=file.header().channels().findChannel(channel_names[c]);
+
+				if((channels&(1<<c)) && channel!=NULL && channel->type!=Imf::HALF) {
+					all_half=false;
+				}
+			}
+		}
+
+		// Reads the rows into 'strip', depth() interleaved samples of
+		// type 'pixelType' per pixel. Channels that are not selected are
+		// left out of the frame buffer, so IlmImf does not convert them.
+		void read_pixels(Imf::PixelType pixelType, char *strip, size_t size,
+		                 uint32_t first_row, uint32_t rows) {
+			size_t xstride = size * depth();
+			size_t ystride = size * depth() * width();
+
+			// The slices are addressed with data window coordinates, the
+			// strip starts at row dw.min.y+first_row.
+			int y = dw.min.y + first_row;
+			char *base = strip - (ptrdiff_t) dw.min.x * xstride - (ptrdiff_t) y * ystride;
+
+			Imf::FrameBuffer frameBuffer;
+			size_t offset = 0;
+			for(int c=0; c<4; c++) {
+				if(!(channels&(1<<c))) {
+					continue;
+				}
+				frameBuffer.insert (channel_names[c],
+				                    Imf::Slice (pixelType,
+				                                base + offset,
+				                                xstride, ystride,
+				                                1, 1,
+				                                c==3 ? 1.0 : 0.0));
+				offset = offset + size;
+			}
+
+			file.setFrameBuffer(frameBuffer);
+			file.readPixels(y, y + rows - 1);
+		}
+
+		static const char *const channel_names[4];
+
+		Imf::InputFile file;
+		Imath::Box2i dw;
+		float scale;
+		bool all_half;
+		uint32_t channels;
+		ctl::dpx::fb<half> half_pixels;
+};
+
+const char *const exr_reader::channel_names[4]={ "R", "G", "B", "A" };
+
+image_reader *exr_open(const char *name, float scale, format_t *format) {
 	std::ifstream ins;
 	unsigned int magic, endian;
 
@@ -74,103 +170,105 @@ bool exr_read(const char *name, float scale, ctl::dpx::fb<float> *pixels,
 	endian=0x01020304;
 	if(((unsigned char *)(&endian))[0]==0x01) {
 		if(magic!=0x762f3101) {
-			return 0;
+			return NULL;
 		}
 	} else {
 		if(magic!=0x01312f76) {
-			return 0;
+			return NULL;
 		}
 	}
 	//////////////////////////
     
-    Imf::InputFile file(name);
-    Imath::Box2i dw = file.header().dataWindow();
+    exr_reader *reader = new exr_reader(name, scale);
     
-    if (file.header().channels().begin().channel().type == Imf::HALF)
+    if (reader->header().channels().begin().channel().type == Imf::HALF)
         format->src_bps=16;
     else
         format->src_bps=32;
         
-    int width = dw.max.x - dw.min.x + 1;
-    int height = dw.max.y - dw.min.y + 1;
-    
-    pixels->init(width, height, 4);
-    Imf::PixelType pixelType = Imf::FLOAT;
-    
-    int xstride = sizeof (*pixels->ptr()) * pixels->depth();
-    int ystride = sizeof (*pixels->ptr()) * pixels->depth() * pixels->width();
-    
-    Imf::FrameBuffer frameBuffer;
-    frameBuffer.insert ("R",
-                        Imf::Slice (pixelType,
-                                    (char *) pixels->ptr(),
-                                    xstride, ystride,
-                                    1, 1,
-                                    0.0));
-    
-    frameBuffer.insert ("G",
-                        Imf::Slice (pixelType,
-                                    (char *) (pixels->ptr()+1),
-                                    xstride, ystride,
-                                    1, 1,
-                                    0.0));
-    
-    frameBuffer.insert ("B",
-                        Imf::Slice (pixelType,
-                                    (char *) (pixels->ptr()+2),
-                                    xstride, ystride,
-                                    1, 1,
-                                    0.0));
-    
-    frameBuffer.insert ("A",
-                        Imf::Slice (pixelType,
-                                    (char *) (pixels->ptr()+3),
-                                    xstride, ystride,
-                                    1, 1,
-                                    1.0));
-    
-    file.setFrameBuffer(frameBuffer);
-    file.readPixels(dw.min.y, dw.max.y);
-    
-	if(scale==0.0 || scale==1.0) {
-		return 1;
-	}
-
-	float *p=pixels->ptr();
-	for(uint64_t i=0; i<pixels->count(); i++) {
-		*p=*p*scale;
-		p++;
-	}
-	return 1;
+    return reader;
 }
 
-void exr_write32(const char *name, float scale, const ctl::dpx::fb<float> &pixels, Compression *compression)
+// Writes float or half R, G, B (and A) channels a strip at a time. Float
+// strips are scaled in a buffer of their own; for half files the scaling
+// is done as the samples are converted.
+class exr_writer: public image_writer {
+	public:
+		exr_writer(const char *name, const Imf::Header &header,
+		           Imf::PixelType pixelType, float scale, int depth) :
+			file(name, header, Imf::globalThreadCount()),
+			pixelType(pixelType), scale(scale), depth(depth) {
+		}
+
+		virtual void write(const ctl::dpx::fb<float> &pixels) {
+			const char *pixelPtr;
+			size_t size;
+
+			if (pixelType == Imf::HALF) {
+				half_pixels.init(pixels.width(), pixels.height(), pixels.depth());
+				float_to_half(half_pixels.ptr(), pixels.ptr(), scale, pixels.count());
+				pixelPtr = (const char *) half_pixels.ptr();
+				size = sizeof (half);
+			} else if (scale != 0.0 && scale != 1.0) {
+				scaled_pixels.init(pixels.width(), pixels.height(), pixels.depth());
+				unscale_float(scaled_pixels.ptr(), pixels.ptr(), scale, pixels.count());
+				pixelPtr = (const char *) scaled_pixels.ptr();
+				size = sizeof (float);
+			} else {
+				pixelPtr = (const char *) pixels.ptr();
+				size = sizeof (float);
+			}
+
+			size_t xstride = size * depth;
+			size_t ystride = size * depth * pixels.width();
+
+			// The frame buffer is addressed with image coordinates; the
+			// strip holds the rows starting at the current scanline.
+			pixelPtr = pixelPtr - (ptrdiff_t) file.currentScanLine() * ystride;
+
+			Imf::FrameBuffer frameBuffer;
+
+			frameBuffer.insert ("R",
+			                    Imf::Slice (pixelType,
+			                                (char *) pixelPtr,
+			                                xstride, ystride));
+
+			frameBuffer.insert ("G",
+			                    Imf::Slice (pixelType,
+			                                (char *) (pixelPtr + size),
+			                                xstride, ystride));
+
+			frameBuffer.insert ("B",
+			                    Imf::Slice (pixelType,
+			                                (char *) (pixelPtr + 2 * size),
+			                                xstride, ystride));
+
+			if (depth == 4)
+				frameBuffer.insert ("A",
+				                    Imf::Slice (pixelType,
+				                                (char *) (pixelPtr + 3 * size),
+				                                xstride, ystride));
+
+			file.setFrameBuffer (frameBuffer);
+			file.writePixels (pixels.height());
+		}
+
+		virtual void close(void) {
+		}
+
+	private:
+		Imf::OutputFile file;
+		Imf::PixelType pixelType;
+		float scale;
+		int depth;
+		ctl::dpx::fb<float> scaled_pixels;
+		ctl::dpx::fb<half> half_pixels;
+};
+
+image_writer *exr_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         Imf::PixelType pixelType, Compression *compression)
 {
-    int depth = pixels.depth();
-    float width = pixels.width();
-    float height = pixels.height();
-    float const *pixelPtr = pixels.ptr();
-    
-	ctl::dpx::fb<float> scaled_pixels;
-    if (scale != 0.0 && scale != 1.0) {
-        scaled_pixels.init(pixels.height(), pixels.width(), pixels.depth());
-        scaled_pixels.alpha(1.0);
-        
-        const float *fIn=pixels.ptr();
-        float *out=scaled_pixels.ptr();
-        
-        for(uint64_t i=0; i<pixels.count(); i++) {
-            *(out++)=*(fIn++)/scale;
-        }
-        
-        depth = scaled_pixels.depth();
-        width = scaled_pixels.width();
-        height = scaled_pixels.height();
-        pixelPtr = scaled_pixels.ptr();
-    }
-    
-    Imf::PixelType pixelType = Imf::FLOAT;
-    
     Imf::Header header(width, height);
     header.compression() = (Imf::Compression)compression->exrCompressionScheme;
     
@@ -181,72 +279,21 @@ void exr_write32(const char *name, float scale, const ctl::dpx::fb<float> &pixel
     if (depth == 4)
         header.channels().insert("A", Imf::Channel(pixelType));
     
-    Imf::OutputFile file (name, header);
-    
-    Imf::FrameBuffer frameBuffer;
-    
-    int xstride = sizeof (*pixelPtr) * depth;
-    int ystride = sizeof (*pixelPtr) * depth * width;
-    
-    frameBuffer.insert ("R",
-                        Imf::Slice (pixelType,
-                                    (char *) pixelPtr,
-                                    xstride, ystride));
-    
-    frameBuffer.insert ("G",
-                        Imf::Slice (pixelType,
-                                    (char *) (pixelPtr+1),
-                                    xstride, ystride));
-    
-    frameBuffer.insert ("B",
-                        Imf::Slice (pixelType,
-                                    (char *) (pixelPtr+2),
-                                    xstride, ystride));
-    
-    if (depth == 4)
-        frameBuffer.insert ("A",
-                            Imf::Slice (pixelType,
-                                        (char *) (pixelPtr+3),
-                                        xstride, ystride));
-    
-    file.setFrameBuffer (frameBuffer);
-    file.writePixels (height);
-}
-
-void exr_write16(const char *name, float scale, const ctl::dpx::fb<float> &pixels, Compression *compression) {
-	if (scale == 0.0) scale = 1.0;
-
-    ctl::dpx::fb<half> scaled_pixels;
-    scaled_pixels.init(pixels.height(), pixels.width(), pixels.depth());
-    scaled_pixels.alpha(1.0);
-    
-    const float *fIn=pixels.ptr();
-    half *out=scaled_pixels.ptr();
-    
-    // Yes... I should lookup table this. I *know*!
-    for(uint64_t i=0; i<pixels.count(); i++) {
-        *(out++)=*(fIn++)/scale;
-    }
-    
-	uint8_t channels=scaled_pixels.depth();
-    const half *in=scaled_pixels.ptr();
-    
-	Imf::RgbaOutputFile file(name, pixels.width(), pixels.height(),
-	                         channels==4 ? Imf::WRITE_RGBA : Imf::WRITE_RGB, 1, Imath::V2f (0, 0), 1,
-	                         Imf::INCREASING_Y, (Imf::Compression)compression->exrCompressionScheme);
-    
-	file.setFrameBuffer((Imf::Rgba *)in, 1, pixels.width());
-	file.writePixels(pixels.height());
+    return new exr_writer(name, header, pixelType, scale, depth);
 }
 
-void exr_write(const char *name, float scale, const ctl::dpx::fb<float> &pixels,
-               format_t *format, Compression *compression)
+image_writer *exr_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format, Compression *compression)
 {
+    if (depth != 3 && depth != 4) {
+        THROW(Iex::ArgExc, "EXR files can only be written from RGB or RGBA images.");
+    }
     if(format->bps == 32) {
-        exr_write32(name, scale, pixels, compression);
+        return exr_create(name, scale, width, height, depth, Imf::FLOAT, compression);
     }
     else if(format->bps == 16) {
-        exr_write16(name, scale, pixels, compression);
+        return exr_create(name, scale, width, height, depth, Imf::HALF, compression);
     }
     else {
         THROW(Iex::ArgExc, "EXR files only support 16 or 32 bps at the moment.");
@@ -255,17 +302,14 @@ void exr_write(const char *name, float scale, const ctl::dpx::fb<float> &pixels,
 
 #else
 
-bool exr_read(const char *name, float scale,
-              ctl::dpx::fb<float> *pixels,
-              format_t *bpp) {
-	return FALSE;
+image_reader *exr_open(const char *name, float scale, format_t *format) {
+	return NULL;
 }
 
-void exr_write(const char *name, float scale,
-               const ctl::dpx::fb<float> &pixels,
-               format_t *format) {
+image_writer *exr_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format, Compression *compression) {
+	return NULL;
 }
 
 #endif
-
-
@@ -56,14 +56,13 @@
 #define CTL_UTIL_CTLRENDER_EXR_INCLUDE
 
 #include "main.hh"
+#include "image_io.hh"
 #include <dpx.hh>
 
-bool exr_read(const char *name, float scale,
-              ctl::dpx::fb<float> *pixels,
-              format_t *bpp);
-void exr_write(const char *name, float scale,
-               const ctl::dpx::fb<float> &pixels,
-               format_t *format,
-               Compression *compression);
+// Returns NULL if the file is not an OpenEXR file.
+image_reader *exr_open(const char *name, float scale, format_t *format);
+image_writer *exr_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format, Compression *compression);
 
 #endif
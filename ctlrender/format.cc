@@ -59,11 +59,15 @@ format_t::format_t() {
 	bps=0;
 	squish=0;
 	descriptor=0;
+	dither=0;
+	planar=0;
 };
 
-format_t::format_t(const char *_ext, uint8_t _bps) {
+format_t::format_t(const char *_ext, uint8_t _bps, bool _planar) {
 	ext=_ext;
 	bps=_bps;
 	squish=0;
 	descriptor=0;
+	dither=0;
+	planar=_planar;
 };
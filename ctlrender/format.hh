@@ -61,7 +61,7 @@
 // into the file writers.
 struct format_t {
 	format_t();
-	format_t(const char *_ext, uint8_t _bps);
+	format_t(const char *_ext, uint8_t _bps, bool _planar=false);
 
 	const char *driver;
 	const char *ext;
@@ -75,6 +75,8 @@ struct format_t {
 	                    // 160 - RA
 	                    // 161 - GA
 	                    // 162 - BA
+	uint8_t dither; // ctl::dpx::dither_e, for integer samples
+	bool planar; // raw files: one plane per channel
 };
 
 #endif
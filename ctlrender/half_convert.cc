@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+
+#include "half_convert.hh"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool scaled(float scale) {
+	return scale!=0.0 && scale!=1.0;
+}
+
+#if defined(HALF_CONVERT_X86)
+
+bool have_f16c(void) {
+	static const bool f16c=(__builtin_cpu_init(),
+	                        __builtin_cpu_supports("avx") &&
+	                        __builtin_cpu_supports("f16c"));
+
+	return f16c;
+}
+
+bool have_avx(void) {
+	static const bool avx=(__builtin_cpu_init(),
+	                       __builtin_cpu_supports("avx"));
+
+	return avx;
+}
+
+// Each of these converts the samples eight at a time and returns how many
+// it did; the callers finish off the rest.
+
+__attribute__((target("avx,f16c")))
+uint64_t f16c_float_to_half(half *out, const float *in, float scale,
+                            uint64_t count) {
+	const __m256 s=_mm256_set1_ps(scale);
+	const bool divide=scaled(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+
+		if(divide) {
+			x=_mm256_div_ps(x, s);
+		}
+		_mm_storeu_si128((__m128i *)(out+u),
+		                 _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+	}
+	_mm256_zeroupper();
+	return u;
+}
+
+__attribute__((target("avx,f16c")))
+uint64_t f16c_half_to_float(float *out, const half *in, float scale,
+                            uint64_t count) {
+	const __m256 s=_mm256_set1_ps(scale);
+	const bool multiply=scaled(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(in+u)));
+
+		if(multiply) {
+			x=_mm256_mul_ps(x, s);
+		}
+		_mm256_storeu_ps(out+u, x);
+	}
+	_mm256_zeroupper();
+	return u;
+}
+
+__attribute__((target("avx")))
+uint64_t avx_scale_float(float *out, const float *in, float scale,
+                         bool divide, uint64_t count) {
+	const __m256 s=_mm256_set1_ps(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+
+		_mm256_storeu_ps(out+u, divide ? _mm256_div_ps(x, s) :
+		                                 _mm256_mul_ps(x, s));
+	}
+	_mm256_zeroupper();
+	return u;
+}
+
+#endif
+
+}
+
+void float_to_half(half *out, const float *in, float scale, uint64_t count) {
+	uint64_t u=0;
+
+#if defined(HALF_CONVERT_X86)
+	if(have_f16c()) {
+		u=f16c_float_to_half(out, in, scale, count);
+	}
+#endif
+	if(scaled(scale)) {
+		for(; u<count; u++) {
+			out[u]=in[u]/scale;
+		}
+	} else {
+		for(; u<count; u++) {
+			out[u]=in[u];
+		}
+	}
+}
+
+void half_to_float(float *out, const half *in, float scale, uint64_t count) {
+	uint64_t u=0;
+
+#if defined(HALF_CONVERT_X86)
+	if(have_f16c()) {
+		u=f16c_half_to_float(out, in, scale, count);
+	}
+#endif
+	if(scaled(scale)) {
+		for(; u<count; u++) {
+			out[u]=(float)in[u]*scale;
+		}
+	} else {
+		for(; u<count; u++) {
+			out[u]=in[u];
+		}
+	}
+}
+
+void scale_float(float *out, const float *in, float scale, uint64_t count) {
+	uint64_t u=0;
+
+	if(!scaled(scale)) {
+		if(out!=in) {
+			memcpy(out, in, count*sizeof(float));
+		}
+		return;
+	}
+#if defined(HALF_CONVERT_X86)
+	if(have_avx()) {
+		u=avx_scale_float(out, in, scale, false, count);
+	}
+#endif
+	for(; u<count; u++) {
+		out[u]=in[u]*scale;
+	}
+}
+
+void unscale_float(float *out, const float *in, float scale, uint64_t count) {
+	uint64_t u=0;
+
+	if(!scaled(scale)) {
+		if(out!=in) {
+			memcpy(out, in, count*sizeof(float));
+		}
+		return;
+	}
+#if defined(HALF_CONVERT_X86)
+	if(have_avx()) {
+		u=avx_scale_float(out, in, scale, true, count);
+	}
+#endif
+	for(; u<count; u++) {
+		out[u]=in[u]/scale;
+	}
+}
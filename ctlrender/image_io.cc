@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include "image_io.hh"
+#include <string.h>
+#include <Iex.h>
+
+image_reader::~image_reader() {
+}
+
+bool image_reader::select_channels(uint32_t mask) {
+	return FALSE;
+}
+
+uint32_t selected_channels(uint32_t mask) {
+	uint32_t count=0;
+
+	for(; mask!=0; mask=mask>>1) {
+		count=count+(mask&1);
+	}
+	return count;
+}
+
+image_writer::~image_writer() {
+}
+
+frame_reader::frame_reader() {
+	_channels=0;
+}
+
+uint32_t frame_reader::width(void) const {
+	return frame.width();
+}
+
+uint32_t frame_reader::height(void) const {
+	return frame.height();
+}
+
+uint32_t frame_reader::depth(void) const {
+	if(_channels!=0) {
+		return selected_channels(_channels);
+	}
+	return frame.depth();
+}
+
+bool frame_reader::select_channels(uint32_t mask) {
+	if(frame.depth()>32) {
+		return FALSE;
+	}
+	_channels=mask;
+	return TRUE;
+}
+
+void frame_reader::read(uint32_t first_row, uint32_t rows,
+                        ctl::dpx::fb<float> *strip) {
+	uint64_t row_samples;
+
+	if(first_row>=frame.height()) {
+		THROW(Iex::ArgExc, "row " << first_row << " is past the bottom of "
+		      "the image.");
+	}
+	if(rows>frame.height()-first_row) {
+		rows=frame.height()-first_row;
+	}
+
+	row_samples=(uint64_t)frame.width()*frame.depth();
+	strip->init(frame.width(), rows, depth());
+	if(_channels==0) {
+		memcpy(strip->ptr(), frame.ptr()+first_row*row_samples,
+		       sizeof(float)*rows*row_samples);
+		return;
+	}
+
+	// Only the selected channels go into the strip.
+	const float *in=frame.ptr()+first_row*row_samples;
+	float *out=strip->ptr();
+	uint64_t u;
+	uint32_t c;
+
+	for(u=0; u<strip->pixels(); u++) {
+		for(c=0; c<frame.depth(); c++) {
+			if(_channels&(1<<c)) {
+				*(out++)=in[c];
+			}
+		}
+		in=in+frame.depth();
+	}
+}
+
+frame_writer::frame_writer(uint32_t width, uint32_t height, uint32_t depth) {
+	_frame.init(width, height, depth);
+	_next_row=0;
+}
+
+void frame_writer::write(const ctl::dpx::fb<float> &strip) {
+	uint64_t row_samples;
+
+	if(strip.width()!=_frame.width() || strip.depth()!=_frame.depth() ||
+	   strip.height()>_frame.height()-_next_row) {
+		THROW(Iex::ArgExc, "strip does not fit in the output image.");
+	}
+
+	row_samples=(uint64_t)_frame.width()*_frame.depth();
+	memcpy(_frame.ptr()+_next_row*row_samples, strip.ptr(),
+	       sizeof(float)*strip.count());
+	_next_row=_next_row+strip.height();
+}
+
+void frame_writer::close(void) {
+	write_frame(_frame);
+}
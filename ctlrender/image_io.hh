@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#if !defined(CTL_UTIL_CTLRENDER_IMAGE_IO_INCLUDE)
+#define CTL_UTIL_CTLRENDER_IMAGE_IO_INCLUDE
+
+#include <dpx.hh>
+#include "main.hh"
+
+// The file format readers and writers hand images over a strip of rows at
+// a time, so that only a few strips of a (possibly huge) image are held in
+// memory at once. A strip holds interleaved float samples, laid out just
+// like a whole image read into a ctl::dpx::fb<float>.
+
+// Produces the rows of an input image.
+class image_reader {
+	public:
+		virtual ~image_reader();
+
+		virtual uint32_t width(void) const=0;
+		virtual uint32_t height(void) const=0;
+		virtual uint32_t depth(void) const=0;
+
+		// Fills the strip (which is initialised to hold them) with 'rows'
+		// rows starting at 'first_row'. Strips are requested from the top
+		// of the image to the bottom.
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *strip)=0;
+
+		// Asks for strips that hold only the channels whose bit is set in
+		// 'mask' (bit 0 for the first channel), in order, so the others
+		// need not be decoded or stored; depth() is then the number of
+		// those channels. Called before the first read(). Returns FALSE
+		// (the default) if the reader can not do that, and its strips
+		// keep all of the channels.
+		virtual bool select_channels(uint32_t mask);
+};
+
+// The number of channels set in a select_channels() mask.
+uint32_t selected_channels(uint32_t mask);
+
+// Consumes the rows of an output image.
+class image_writer {
+	public:
+		virtual ~image_writer();
+
+		// Writes the next rows of the image, from the top to the bottom.
+		virtual void write(const ctl::dpx::fb<float> &strip)=0;
+
+		// Finishes the file once all of the rows have been written.
+		virtual void close(void)=0;
+};
+
+// Hands out the rows of an image that has been read as a whole, for the
+// files that can not be read a strip at a time.
+class frame_reader: public image_reader {
+	public:
+		frame_reader();
+
+		virtual uint32_t width(void) const;
+		virtual uint32_t height(void) const;
+		virtual uint32_t depth(void) const;
+
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *strip);
+		virtual bool select_channels(uint32_t mask);
+
+		// The image to hand out; filled in by the format's reader.
+		ctl::dpx::fb<float> frame;
+
+	private:
+		uint32_t _channels; // 0 for all of them
+};
+
+// Collects the rows of an image that can only be written as a whole.
+// close() calls write_frame() once the frame is complete.
+class frame_writer: public image_writer {
+	public:
+		frame_writer(uint32_t width, uint32_t height, uint32_t depth);
+
+		virtual void write(const ctl::dpx::fb<float> &strip);
+		virtual void close(void);
+
+	protected:
+		virtual void write_frame(const ctl::dpx::fb<float> &frame)=0;
+
+	private:
+		ctl::dpx::fb<float> _frame;
+		uint32_t _next_row;
+};
+
+#endif
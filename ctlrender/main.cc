@@ -59,7 +59,14 @@
 #include <sys/param.h>
 #include <errno.h>
 #include "transform.hh"
+#include "raw_file.hh"
+#include <dpx.hh>
 #include <Iex.h>
+#include <IlmThreadPool.h>
+#if defined(HAVE_OPENEXR)
+#include <ImfThreading.h>
+#endif
+#include <unistd.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
@@ -147,6 +154,11 @@ file_format_t allowed_formats[] =
 	{ "tif32",  format_t("tif",  32) },
 	{ "tif16",  format_t("tif",  16) },
 	{ "tif8",   format_t("tif",   8) },
+	{ "raw",    format_t("raw",   0) },
+	{ "raw16",  format_t("raw",  16) },
+	{ "raw32",  format_t("raw",  32) },
+	{ "raw16p", format_t("raw",  16, true) },
+	{ "raw32p", format_t("raw",  32, true) },
 	{ NULL,     format_t()           }
 };
 
@@ -189,6 +201,11 @@ int main(int argc, const char **argv)
 		float output_scale = 0.0;
 		bool force_overwrite_output_file = FALSE;
 		bool noalpha = FALSE;
+		bake_options_t bake_options;
+		int threads = -1;
+		int strip_rows = 0;
+		uint8_t dither = ctl::dpx::no_dither;
+		const char *daemon_socket = getenv("CTLD_SOCKET");
 
 		int start_argc = argc;
 
@@ -409,6 +426,198 @@ int main(int argc, const char **argv)
 				}
 				global_ctl_parameters.push_back(get_ctl_parameter(&argv, &argc, start_argc, "global", 2));
 			}
+			else if (!strcmp(argv[0], "-bake"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -bake option requires an additional "
+							"argument specifying the type of lookup\ntable, "
+							"either '1d' or '3d'.\nSee '-help bake' for more "
+							"details.\n");
+					exit(1);
+				}
+				if (!strcasecmp(argv[1], "1d"))
+				{
+					bake_options.dimensions = 1;
+				}
+				else if (!strcasecmp(argv[1], "3d"))
+				{
+					bake_options.dimensions = 3;
+				}
+				else
+				{
+					fprintf(stderr, "Unrecognized lookup table type '%s' for parameter "
+							"'-bake'.\nSee '-help bake' for more details.\n", argv[1]);
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-bake_size"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -bake_size option requires an additional "
+							"argument specifying the number of\nlookup table "
+							"entries per dimension.\nSee '-help bake' for more "
+							"details.\n");
+					exit(1);
+				}
+				bake_options.size = (int) getfloat(argv[1], "the '-bake_size' argument\n");
+				if (bake_options.size < 2)
+				{
+					fprintf(stderr, "the -bake_size option requires at least 2 entries.\n");
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-bake_shaper"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -bake_shaper option requires an additional "
+							"argument specifying the shaper,\neither 'linear' "
+							"or 'log2'.\nSee '-help bake' for more details.\n");
+					exit(1);
+				}
+				if (!strcasecmp(argv[1], "linear"))
+				{
+					bake_options.log2_shaper = FALSE;
+				}
+				else if (!strcasecmp(argv[1], "log2"))
+				{
+					bake_options.log2_shaper = TRUE;
+				}
+				else
+				{
+					fprintf(stderr, "Unrecognized shaper '%s' for parameter "
+							"'-bake_shaper'.\nSee '-help bake' for more details.\n", argv[1]);
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-bake_domain"))
+			{
+				if (argc < 3)
+				{
+					fprintf(stderr,
+							"the -bake_domain option requires two additional "
+							"arguments specifying the\nsmallest and largest "
+							"input value.\nSee '-help bake' for more details.\n");
+					exit(1);
+				}
+				bake_options.domain_min = getfloat(argv[1], "the minimum of the '-bake_domain' argument\n");
+				bake_options.domain_max = getfloat(argv[2], "the maximum of the '-bake_domain' argument\n");
+				argv += 2;
+				argc -= 2;
+			}
+			else if (!strcmp(argv[0], "-bake_tolerance"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -bake_tolerance option requires an additional "
+							"argument specifying the\nlargest acceptable error.\n"
+							"See '-help bake' for more details.\n");
+					exit(1);
+				}
+				bake_options.tolerance = getfloat(argv[1], "the '-bake_tolerance' argument\n");
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-threads"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -threads option requires an additional "
+							"argument specifying the number of\nworker "
+							"threads.\n");
+					exit(1);
+				}
+				threads = (int) getfloat(argv[1], "the '-threads' argument\n");
+				if (threads < 0)
+				{
+					fprintf(stderr, "the -threads option requires a number "
+							"of threads of 0 or more.\n");
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-strip_rows"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -strip_rows option requires an additional "
+							"argument specifying the number of\nrows "
+							"processed at a time.\n");
+					exit(1);
+				}
+				strip_rows = (int) getfloat(argv[1], "the '-strip_rows' argument\n");
+				if (strip_rows < 0)
+				{
+					fprintf(stderr, "the -strip_rows option requires a number "
+							"of rows of 0 or more.\n");
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-dither"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -dither option requires an additional "
+							"argument: none, ordered or bluenoise.\n");
+					exit(1);
+				}
+				if (!strcmp(argv[1], "none"))
+				{
+					dither = ctl::dpx::no_dither;
+				}
+				else if (!strcmp(argv[1], "ordered"))
+				{
+					dither = ctl::dpx::ordered_dither;
+				}
+				else if (!strcmp(argv[1], "bluenoise"))
+				{
+					dither = ctl::dpx::blue_noise_dither;
+				}
+				else
+				{
+					fprintf(stderr, "unrecognized dither '%s'. the -dither "
+							"option takes none, ordered or bluenoise.\n", argv[1]);
+					exit(1);
+				}
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-daemon"))
+			{
+				if (argc == 1)
+				{
+					fprintf(stderr,
+							"the -daemon option requires an additional "
+							"argument specifying the socket of a ctld\n"
+							"daemon. see '-help daemon' for more details.\n");
+					exit(1);
+				}
+				daemon_socket = argv[1];
+				argv++;
+				argc--;
+			}
+			else if (!strcmp(argv[0], "-nodaemon"))
+			{
+				daemon_socket = NULL;
+			}
 			else if (!strncmp(argv[0], "-verbose", 2))
 			{
 				verbosity++;
@@ -425,6 +634,11 @@ int main(int argc, const char **argv)
 			{
 				noalpha = TRUE;
 			}
+			else if (!strcmp(argv[0], "-"))
+			{
+				// stdin or stdout (see '-help format').
+				input_image_files.push_back(argv[0]);
+			}
 			else if (!strncmp(argv[0], "-", 1))
 			{
 				fprintf(stderr,
@@ -446,6 +660,40 @@ int main(int argc, const char **argv)
 			ctl_operations.push_back(new_ctl_operation);
 		}
 
+		if (bake_options.dimensions != 0 && !(bake_options.domain_min < bake_options.domain_max))
+		{
+			fprintf(stderr, "the -bake_domain minimum must be less than the maximum.\n");
+			exit(1);
+		}
+		if (bake_options.dimensions != 0 && bake_options.log2_shaper && bake_options.domain_min <= 0.0)
+		{
+			fprintf(stderr,
+					"the 'log2' shaper requires a -bake_domain minimum "
+					"greater than 0.\nSee '-help bake' for more details.\n");
+			exit(1);
+		}
+
+		// Image file reads and writes spread their work across the global
+		// thread pool. By default there is one thread per processor.
+		if (threads < 0)
+		{
+			threads = 0;
+#if defined(_SC_NPROCESSORS_ONLN)
+			threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+			if (threads < 0)
+			{
+				threads = 0;
+			}
+		}
+#if defined(HAVE_OPENEXR)
+		// The same pool; this also has IlmImf compress and uncompress
+		// blocks of lines in parallel.
+		Imf::setGlobalThreadCount(threads);
+#else
+		IlmThread::ThreadPool::globalThreadPool().setNumThreads(threads);
+#endif
+
 		if (input_image_files.size() < 2)
 		{
 			fprintf(stderr,
@@ -544,7 +792,12 @@ int main(int argc, const char **argv)
 						"output format.\n");
 				exit(1);
 			}
-			else if (dot != NULL)
+			else if (dot == NULL)
+			{
+				// Such as '-' or 'shm:<name>'.
+				actual_format = desired_format;
+			}
+			else
 			{
 				if (desired_format.ext == NULL)
 				{
@@ -600,6 +853,8 @@ int main(int argc, const char **argv)
 			fprintf(stderr, "\n");
 		}
 
+		baked_transform baked(bake_options, ctl_operations, global_ctl_parameters);
+
 		while (input_image_files.size() > 0)
 		{
 			const char *inputFile = input_image_files.front();
@@ -655,7 +910,21 @@ int main(int argc, const char **argv)
 				exit(1);
 			}
 			actual_format.squish = noalpha;
-			transform(inputFile, outputFile, input_scale, output_scale, &actual_format, &compression, ctl_operations, global_ctl_parameters);
+			actual_format.dither = dither;
+			if (raw_stream(inputFile))
+			{
+				// The frames of a stream go through one after the other.
+				while (raw_next_frame(inputFile))
+				{
+					transform(inputFile, outputFile, input_scale, output_scale, &actual_format, &compression, ctl_operations,
+					          global_ctl_parameters, &baked, strip_rows, daemon_socket);
+				}
+			}
+			else
+			{
+				transform(inputFile, outputFile, input_scale, output_scale, &actual_format, &compression, ctl_operations,
+				          global_ctl_parameters, &baked, strip_rows, daemon_socket);
+			}
 			input_image_files.pop_front();
 		}
 
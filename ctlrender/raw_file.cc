@@ -0,0 +1,565 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include "raw_file.hh"
+#include "half_convert.hh"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <Iex.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Starts every frame. The numbers are in the byte order of the machine
+// that wrote them; frames are not meant to leave it.
+struct raw_header {
+	char magic[4];    // "CTLR"
+	uint32_t width;
+	uint32_t height;
+	uint16_t channels;
+	uint8_t bits;     // 16 for half samples, 32 for float
+	uint8_t planar;   // 0 for interleaved samples, 1 for planes
+};
+
+const char raw_magic[4]={ 'C', 'T', 'L', 'R' };
+const char shm_prefix[]="shm:";
+
+bool is_stdio(const char *name) {
+	return !strcmp(name, "-");
+}
+
+bool is_shm(const char *name) {
+	return !strncmp(name, shm_prefix, sizeof(shm_prefix)-1);
+}
+
+// shm_open() wants a name that starts with a slash.
+std::string shm_name(const char *name) {
+	std::string s(name+sizeof(shm_prefix)-1);
+
+	if(s.empty() || s[0]!='/') {
+		s="/"+s;
+	}
+	return s;
+}
+
+uint64_t sample_bytes(const raw_header &h) {
+	return (uint64_t)h.width*h.height*h.channels*(h.bits/8);
+}
+
+void check_header(const raw_header &h, const char *name) {
+	if(memcmp(h.magic, raw_magic, sizeof(raw_magic))) {
+		THROW(Iex::InputExc, name << " does not hold raw frames.");
+	}
+	if((h.bits!=16 && h.bits!=32) || h.planar>1 || h.channels==0) {
+		THROW(Iex::InputExc, "unsupported raw frame in " << name << " ("
+		      << (int)h.channels << " channels of " << (int)h.bits
+		      << " bits, planar " << (int)h.planar << ").");
+	}
+}
+
+// Reads until 'size' bytes are read or the end of the file; returns the
+// number of bytes read.
+size_t read_fully(int fd, void *buf, size_t size, const char *name) {
+	size_t done=0;
+	ssize_t r;
+
+	while(done<size) {
+		r=read(fd, (char *)buf+done, size-done);
+		if(r<0 && errno==EINTR) {
+			continue;
+		}
+		if(r<0) {
+			THROW(Iex::InputExc, "unable to read from " << name << " ("
+			      << strerror(errno) << ").");
+		}
+		if(r==0) {
+			break;
+		}
+		done=done+r;
+	}
+	return done;
+}
+
+void read_exactly(int fd, void *buf, size_t size, const char *name) {
+	if(read_fully(fd, buf, size, name)!=size) {
+		THROW(Iex::InputExc, "unexpected end of the frame in " << name
+		      << ".");
+	}
+}
+
+void write_fully(int fd, const void *buf, size_t size, const char *name) {
+	size_t done=0;
+	ssize_t w;
+
+	while(done<size) {
+		w=write(fd, (const char *)buf+done, size-done);
+		if(w<0 && errno==EINTR) {
+			continue;
+		}
+		if(w<0) {
+			THROW(Iex::IoExc, "unable to write to " << name << " ("
+			      << strerror(errno) << ").");
+		}
+		done=done+w;
+	}
+}
+
+// Converts between the float samples of a strip and those of a frame,
+// with the scale applied (as for EXR files).
+void load_samples(float *out, const char *in, uint8_t bits, float scale,
+                  uint64_t count) {
+	if(bits==16) {
+		half_to_float(out, (const half *)in, scale, count);
+	} else {
+		scale_float(out, (const float *)in, scale, count);
+	}
+}
+
+void store_samples(char *out, const float *in, uint8_t bits, float scale,
+                   uint64_t count) {
+	if(bits==16) {
+		float_to_half((half *)out, in, scale, count);
+	} else {
+		unscale_float((float *)out, in, scale, count);
+	}
+}
+
+// The header read ahead by raw_next_frame().
+raw_header next_header;
+bool have_next_header=FALSE;
+
+// The number of frames of the stream on stdin opened so far.
+uint64_t stream_frames=0;
+
+}
+
+// Hands out the rows of a frame, either straight from the samples (of a
+// file or shared memory segment mapped into memory, or of a planar frame
+// read from a stream as a whole), or, for interleaved frames on a stream,
+// read strip by strip.
+class raw_reader: public image_reader {
+	public:
+		raw_reader(const raw_header &h, const char *name, float scale) :
+			h(h), name(name), scale(scale) {
+			fd=-1;
+			data=NULL;
+			mapping=NULL;
+			mapped_size=0;
+			next_row=0;
+		}
+
+		virtual ~raw_reader() {
+			if(mapping!=NULL) {
+				munmap(mapping, mapped_size);
+			}
+		}
+
+		virtual uint32_t width(void) const { return h.width; }
+		virtual uint32_t height(void) const { return h.height; }
+		virtual uint32_t depth(void) const { return h.channels; }
+
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *pixels);
+
+		raw_header h;
+		std::string name;
+		float scale;
+		int fd;                 // the stream, if data is NULL
+		const char *data;       // the samples
+		void *mapping;
+		size_t mapped_size;
+		std::vector<char> frame;
+		ctl::dpx::fb<half> half_rows;
+		uint32_t next_row;
+};
+
+void raw_reader::read(uint32_t first_row, uint32_t rows,
+                      ctl::dpx::fb<float> *pixels) {
+	const uint64_t row_samples=(uint64_t)h.width*h.channels;
+	const uint32_t bytes=h.bits/8;
+	std::vector<float> row;
+	uint32_t y, c, x;
+
+	if(first_row>=h.height) {
+		THROW(Iex::ArgExc, "row " << first_row << " is past the bottom of "
+		      "the image.");
+	}
+	if(rows>h.height-first_row) {
+		rows=h.height-first_row;
+	}
+	pixels->init(h.width, rows, h.channels);
+
+	if(data==NULL && h.planar) {
+		// The planes have to be all there before the first row is.
+		frame.resize(sample_bytes(h));
+		read_exactly(fd, &frame[0], frame.size(), name.c_str());
+		data=&frame[0];
+	}
+
+	if(data==NULL) {
+		if(first_row!=next_row) {
+			THROW(Iex::ArgExc, "the rows of " << name << " can only be read "
+			      "in order.");
+		}
+		if(h.bits==32) {
+			read_exactly(fd, pixels->ptr(), rows*row_samples*bytes,
+			             name.c_str());
+			scale_float(pixels->ptr(), pixels->ptr(), scale,
+			            pixels->count());
+		} else {
+			half_rows.init(h.width, rows, h.channels);
+			read_exactly(fd, half_rows.ptr(), rows*row_samples*bytes,
+			             name.c_str());
+			half_to_float(pixels->ptr(), half_rows.ptr(), scale,
+			              pixels->count());
+		}
+		next_row=first_row+rows;
+		return;
+	}
+
+	if(!h.planar) {
+		load_samples(pixels->ptr(), data+first_row*row_samples*bytes, h.bits,
+		             scale, pixels->count());
+		return;
+	}
+
+	row.resize(h.width);
+	for(c=0; c<h.channels; c++) {
+		const char *plane=data+(uint64_t)c*h.height*h.width*bytes;
+
+		for(y=0; y<rows; y++) {
+			float *out=pixels->ptr()+y*row_samples+c;
+
+			load_samples(&row[0],
+			             plane+(uint64_t)(first_row+y)*h.width*bytes,
+			             h.bits, scale, h.width);
+			for(x=0; x<h.width; x++) {
+				out[x*h.channels]=row[x];
+			}
+		}
+	}
+}
+
+// Writes the rows of a frame, straight into a shared memory segment, or to
+// a stream or file (as they come if they are interleaved, or as a whole
+// once they are all there if they are planar).
+class raw_writer: public image_writer {
+	public:
+		raw_writer(const raw_header &h, const char *name, float scale) :
+			h(h), name(name), scale(scale) {
+			fd=-1;
+			close_fd=FALSE;
+			data=NULL;
+			mapping=NULL;
+			mapped_size=0;
+			next_row=0;
+		}
+
+		virtual ~raw_writer() {
+			if(mapping!=NULL) {
+				munmap(mapping, mapped_size);
+			}
+			if(close_fd) {
+				::close(fd);
+			}
+		}
+
+		virtual void write(const ctl::dpx::fb<float> &pixels);
+		virtual void close(void);
+
+		raw_header h;
+		std::string name;
+		float scale;
+		int fd;
+		bool close_fd;
+		char *data;             // the samples, if they are not streamed
+		void *mapping;
+		size_t mapped_size;
+		std::vector<char> frame;
+		std::vector<char> rows_buffer;
+		uint32_t next_row;
+};
+
+void raw_writer::write(const ctl::dpx::fb<float> &pixels) {
+	const uint64_t row_samples=(uint64_t)h.width*h.channels;
+	const uint32_t bytes=h.bits/8;
+	std::vector<float> row;
+	uint32_t rows, y, c, x;
+
+	if(pixels.width()!=h.width || pixels.depth()!=h.channels) {
+		THROW(Iex::ArgExc, "strip does not match the frame of " << name
+		      << ".");
+	}
+	rows=pixels.height();
+	if(rows>h.height-next_row) {
+		rows=h.height-next_row;
+	}
+
+	if(data==NULL) {
+		rows_buffer.resize(rows*row_samples*bytes);
+		if(!rows_buffer.empty()) {
+			store_samples(&rows_buffer[0], pixels.ptr(), h.bits, scale,
+			              rows*row_samples);
+			write_fully(fd, &rows_buffer[0], rows_buffer.size(),
+			            name.c_str());
+		}
+	} else if(!h.planar) {
+		store_samples(data+next_row*row_samples*bytes, pixels.ptr(), h.bits,
+		              scale, rows*row_samples);
+	} else {
+		row.resize(h.width);
+		for(c=0; c<h.channels; c++) {
+			char *plane=data+(uint64_t)c*h.height*h.width*bytes;
+
+			for(y=0; y<rows; y++) {
+				const float *in=pixels.ptr()+y*row_samples+c;
+
+				for(x=0; x<h.width; x++) {
+					row[x]=in[x*h.channels];
+				}
+				store_samples(plane+(uint64_t)(next_row+y)*h.width*bytes,
+				              &row[0], h.bits, scale, h.width);
+			}
+		}
+	}
+	next_row=next_row+rows;
+}
+
+void raw_writer::close(void) {
+	if(!frame.empty()) {
+		write_fully(fd, &frame[0], frame.size(), name.c_str());
+		frame.clear();
+	}
+}
+
+bool raw_stream(const char *name) {
+	return is_stdio(name);
+}
+
+bool raw_next_frame(const char *name) {
+	size_t got;
+
+	if(have_next_header) {
+		return TRUE;
+	}
+	got=read_fully(0, &next_header, sizeof(next_header), "stdin");
+	if(got==0) {
+		return FALSE;
+	}
+	if(got!=sizeof(next_header)) {
+		THROW(Iex::InputExc, "unexpected end of the frame header on "
+		      "stdin.");
+	}
+	check_header(next_header, "stdin");
+	have_next_header=TRUE;
+	return TRUE;
+}
+
+void raw_remove(const char *name) {
+	if(is_shm(name)) {
+		shm_unlink(shm_name(name).c_str());
+	} else if(!is_stdio(name)) {
+		unlink(name);
+	}
+}
+
+image_reader *raw_open(const char *name, float scale, format_t *format) {
+	raw_reader *reader;
+	raw_header h;
+	struct stat st;
+	int fd;
+
+	if(is_stdio(name)) {
+		if(!raw_next_frame(name)) {
+			THROW(Iex::InputExc, "no frame to read on stdin.");
+		}
+		have_next_header=FALSE;
+		stream_frames++;
+		reader=new raw_reader(next_header, "stdin", scale);
+		reader->fd=0;
+		format->src_bps=next_header.bits;
+		return reader;
+	}
+
+	if(is_shm(name)) {
+		fd=shm_open(shm_name(name).c_str(), O_RDONLY, 0);
+	} else {
+		fd=open(name, O_RDONLY);
+	}
+	if(fd<0) {
+		if(is_shm(name)) {
+			THROW(Iex::InputExc, "unable to open the shared memory segment "
+			      << name << " (" << strerror(errno) << ").");
+		}
+		return NULL;
+	}
+
+	memset(&h, 0, sizeof(h));
+	if(read_fully(fd, &h, sizeof(h), name)!=sizeof(h) ||
+	   memcmp(h.magic, raw_magic, sizeof(raw_magic))) {
+		::close(fd);
+		if(is_shm(name)) {
+			THROW(Iex::InputExc, name << " does not hold a raw frame.");
+		}
+		return NULL;
+	}
+
+	try {
+		check_header(h, name);
+		if(fstat(fd, &st)<0) {
+			THROW(Iex::InputExc, "unable to get the size of " << name
+			      << " (" << strerror(errno) << ").");
+		}
+		if((uint64_t)st.st_size<sizeof(h)+sample_bytes(h)) {
+			THROW(Iex::InputExc, name << " is too short for its "
+			      << h.width << "x" << h.height << " frame.");
+		}
+	} catch(...) {
+		::close(fd);
+		throw;
+	}
+
+	reader=new raw_reader(h, name, scale);
+	reader->mapped_size=sizeof(h)+sample_bytes(h);
+	reader->mapping=mmap(NULL, reader->mapped_size, PROT_READ, MAP_SHARED,
+	                     fd, 0);
+	::close(fd);
+	if(reader->mapping==MAP_FAILED) {
+		reader->mapping=NULL;
+		delete reader;
+		THROW(Iex::InputExc, "unable to map " << name << " ("
+		      << strerror(errno) << ").");
+	}
+	reader->data=(const char *)reader->mapping+sizeof(h);
+	format->src_bps=h.bits;
+	return reader;
+}
+
+image_writer *raw_create(const char *name, float scale,
+                         uint32_t width, uint32_t height, uint32_t depth,
+                         format_t *format) {
+	raw_writer *writer;
+	raw_header h;
+	int fd;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, raw_magic, sizeof(raw_magic));
+	h.width=width;
+	h.height=height;
+	h.channels=depth;
+	h.bits= format->bps==16 ? 16 : 32;
+	h.planar= format->planar ? 1 : 0;
+
+	writer=new raw_writer(h, is_stdio(name) ? "stdout" : name, scale);
+
+	if(is_shm(name)) {
+		fd=shm_open(shm_name(name).c_str(), O_RDWR|O_CREAT, 0600);
+		if(fd<0) {
+			delete writer;
+			THROW(Iex::IoExc, "unable to create the shared memory segment "
+			      << name << " (" << strerror(errno) << ").");
+		}
+		writer->mapped_size=sizeof(h)+sample_bytes(h);
+		if(ftruncate(fd, writer->mapped_size)<0) {
+			::close(fd);
+			delete writer;
+			THROW(Iex::IoExc, "unable to size the shared memory segment "
+			      << name << " (" << strerror(errno) << ").");
+		}
+		writer->mapping=mmap(NULL, writer->mapped_size,
+		                     PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(writer->mapping==MAP_FAILED) {
+			writer->mapping=NULL;
+			delete writer;
+			THROW(Iex::IoExc, "unable to map the shared memory segment "
+			      << name << " (" << strerror(errno) << ").");
+		}
+		memcpy(writer->mapping, &h, sizeof(h));
+		writer->data=(char *)writer->mapping+sizeof(h);
+		return writer;
+	}
+
+	if(is_stdio(name)) {
+		writer->fd=1;
+	} else {
+		// The frames of a stream after the first are appended, so that
+		// they follow each other; anything else replaces the file.
+		writer->fd=open(name, O_WRONLY|O_CREAT|
+		                (stream_frames>1 ? O_APPEND : O_TRUNC), 0666);
+		if(writer->fd<0) {
+			delete writer;
+			THROW(Iex::IoExc, "unable to create " << name << " ("
+			      << strerror(errno) << ").");
+		}
+		writer->close_fd=TRUE;
+	}
+	try {
+		write_fully(writer->fd, &h, sizeof(h), writer->name.c_str());
+	} catch(...) {
+		delete writer;
+		throw;
+	}
+	if(h.planar) {
+		writer->frame.resize(sample_bytes(h));
+		writer->data=writer->frame.empty() ? NULL : &writer->frame[0];
+	}
+	return writer;
+}
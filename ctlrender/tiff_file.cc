@@ -60,27 +60,26 @@
 #include <tiffio.h>
 #include <sys/param.h>
 #include <math.h>
+#include <string.h>
 #include <Iex.h>
+#include <IlmThreadPool.h>
+#include <IlmThreadMutex.h>
 #include <alloca.h>
+#include <string>
+#include <vector>
+#include "half_convert.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIFF_FILE_X86 1
+#include <immintrin.h>
+#endif
 
-void tiff_read_multiplane(TIFF *t, float scale, ctl::dpx::fb<float> * pixels);
-void tiff_read_interleaved(TIFF *t, float scale, ctl::dpx::fb<float> * pixels);
 void tiff_read_failsafe(TIFF *t, float scale, ctl::dpx::fb<float> * pixels);
 
 void tiff_interleave_int8(float *row, int offset, float scale,
                           uint8_t *r, int r_stride, uint8_t *g, int g_stride,
                           uint8_t *b, int b_stride, uint8_t *a, int a_stride,
                           uint32_t width);
-                           
-void tiff_interleave_int16(float *row, int offset, float scale,
-                           uint16_t *r, int r_stride, uint16_t *g, int g_stride,
-                           uint16_t *b, int b_stride, uint16_t *a, int a_stride,
-                           uint32_t width);
-
-void tiff_interleave_float(float *row, float scale,
-                           float *r, int r_stride, float *g, int g_stride,
-                           float *b, int b_stride, float *a, int a_stride,
-                           uint32_t width);
 
 void ErrorHandler(const char *module, const char *fmt, va_list ap) {
 	fprintf(stderr, "Unable to read tiff file: ");
@@ -92,381 +91,592 @@ void WarningHandler(const char *module, const char *fmt, va_list ap) {
 //	vfprintf(stderr, fmt, ap);
 }
 
-bool tiff_read(const char *name, float scale, ctl::dpx::fb<float> *pixels,
-               format_t *format) {
-	TIFF *t;
-	uint16_t samples_per_pixel;
-	uint16_t bits_per_sample;
-	uint16_t sample_format;
-	uint16_t planar_config;
-	uint16_t photometric;
-	uint16_t orientation;
+namespace {
 
-	TIFFSetErrorHandler(ErrorHandler);
-	TIFFSetWarningHandler(WarningHandler);
+#if defined(TIFF_FILE_X86)
 
-	t=TIFFOpen(name, "r");
-	if(t==NULL) {
-		// This is set if the file is not a tiff, we just sort of punt.
-		return FALSE;
-	}
+bool have_avx2(void) {
+	static const bool avx2=(__builtin_cpu_init(),
+	                        __builtin_cpu_supports("avx2"));
 
-	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
-	TIFFGetFieldDefaulted(t, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
-	format->src_bps=bits_per_sample;
-	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLEFORMAT, &sample_format);
-	TIFFGetFieldDefaulted(t, TIFFTAG_PHOTOMETRIC, &photometric);
-	TIFFGetFieldDefaulted(t, TIFFTAG_ORIENTATION, &orientation);
+	return avx2;
+}
 
-//	tiff_read_failsafe(t, scale, pixels);
-//	return TRUE;
+// Each of these converts the samples eight at a time and returns how many
+// it did; the callers finish off the rest.
 
-	if(!(bits_per_sample==16 && sample_format<3) &&
-	   !(bits_per_sample==32 && sample_format==3) &&
-	   photometric!=PHOTOMETRIC_RGB &&
-	   orientation!=ORIENTATION_TOPLEFT &&
-	   orientation!=ORIENTATION_BOTLEFT) {
+__attribute__((target("avx2")))
+uint64_t avx2_uint8_to_float(float *out, const uint8_t *in, uint32_t flip,
+                             float scale, uint64_t count) {
+	const __m256i f=_mm256_set1_epi32(flip);
+	const __m256 s=_mm256_set1_ps(scale);
+	uint64_t u;
 
-		if(bits_per_sample!=8) {
-			fprintf(stderr, "falling back to failsafe TIFF reader. Reading "
-			        "as \n8 bits per sample RGBA.\n");
-		}
-		tiff_read_failsafe(t, scale, pixels);
-		TIFFClose(t);
-		return TRUE;
+	for(u=0; u+8<=count; u+=8) {
+		__m256i x=_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in+u)));
+
+		x=_mm256_xor_si256(x, f);
+		_mm256_storeu_ps(out+u, _mm256_div_ps(_mm256_cvtepi32_ps(x), s));
 	}
+	_mm256_zeroupper();
+	return u;
+}
+
+__attribute__((target("avx2")))
+uint64_t avx2_uint16_to_float(float *out, const uint16_t *in, uint32_t flip,
+                              float scale, uint64_t count) {
+	const __m256i f=_mm256_set1_epi32(flip);
+	const __m256 s=_mm256_set1_ps(scale);
+	uint64_t u;
 
-	TIFFGetField(t, TIFFTAG_PLANARCONFIG, &planar_config);
-	if(planar_config==PLANARCONFIG_CONTIG) {
-		tiff_read_interleaved(t, scale, pixels);
-	} else if(planar_config==PLANARCONFIG_SEPARATE) {
-		tiff_read_multiplane(t, scale, pixels);
+	for(u=0; u+8<=count; u+=8) {
+		__m256i x=_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in+u)));
+
+		x=_mm256_xor_si256(x, f);
+		_mm256_storeu_ps(out+u, _mm256_div_ps(_mm256_cvtepi32_ps(x), s));
 	}
+	_mm256_zeroupper();
+	return u;
+}
 
-	TIFFClose(t);
+#endif
 
-	return TRUE;
+// out[i]=(in[i]^flip)/scale. 'flip' is the sign bit of signed samples,
+// which moves them to the unsigned range (-128 reads as 0.0, 127 as 1.0).
+void uint8_to_float(float *out, const uint8_t *in, uint32_t flip,
+                    float scale, uint64_t count) {
+	uint64_t u=0;
+
+#if defined(TIFF_FILE_X86)
+	if(have_avx2()) {
+		u=avx2_uint8_to_float(out, in, flip, scale, count);
+	}
+#endif
+	for(; u<count; u++) {
+		out[u]=(float)(in[u]^flip)/scale;
+	}
 }
 
-void tiff_interleave_int8(float *o, int offset, float scale,
-                          uint8_t *r, int r_stride, uint8_t *g, int g_stride,
-                          uint8_t *b, int b_stride, uint8_t *a, int a_stride,
-                          uint32_t width) {
-	uint32_t i;
-	float f;
+void uint16_to_float(float *out, const uint16_t *in, uint32_t flip,
+                     float scale, uint64_t count) {
+	uint64_t u=0;
 
-	if(scale==0) {
-		scale=255.0;
+#if defined(TIFF_FILE_X86)
+	if(have_avx2()) {
+		u=avx2_uint16_to_float(out, in, flip, scale, count);
 	}
+#endif
+	for(; u<count; u++) {
+		out[u]=(float)(in[u]^flip)/scale;
+	}
+}
 
-	for(i=0; i<width; i++) {
-		if(r!=NULL) {
-			f=*r+offset;
-			r=r+r_stride;
-			*(o++)=f/scale;
-		}
-		if(g!=NULL) {
-			f=*g+offset;
-			g=g+g_stride;
-			*(o++)=f/scale;
-		}
-		if(b!=NULL) {
-			f=*b+offset;
-			b=b+b_stride;
-			*(o++)=f/scale;
+}
+
+// Reads files with 8 or 16 bit integer or 16 or 32 bit floating point
+// samples, in strips or tiles, with the planes contiguous or separate and
+// in any orientation. The strips (or tiles) that hold the rows asked for
+// are decoded in parallel, each worker with a TIFF handle of its own, and
+// converted straight into a band of float rows. The band is kept for the
+// next read(), so a strip that spans two of them is decoded once.
+class tiff_reader: public image_reader {
+	public:
+		tiff_reader(TIFF *t, const char *name, float scale);
+		virtual ~tiff_reader();
+
+		virtual uint32_t width(void) const;
+		virtual uint32_t height(void) const;
+		virtual uint32_t depth(void) const;
+
+		virtual void read(uint32_t first_row, uint32_t rows,
+		                  ctl::dpx::fb<float> *pixels);
+		virtual bool select_channels(uint32_t mask);
+
+		// Decodes the strip or tile of 'plane' at (column, row) into
+		// 'band', whose first row is 'band_row'. Run by the worker threads.
+		void decode_chunk(ctl::dpx::fb<float> *band, uint32_t band_row,
+		                  uint32_t column, uint32_t row, uint16_t plane);
+
+	private:
+		TIFF *acquire(void);
+		void release(TIFF *t);
+		void fail(void);
+		bool transposed(void) const;
+		void load_band(uint32_t first_row, uint32_t last_row);
+		void convert(float *out, const uint8_t *in, uint64_t count);
+
+		std::string name;
+		IlmThread::Mutex mutex;
+		std::vector<TIFF *> handles; // all of them, to close
+		std::vector<TIFF *> idle;
+		bool failed;
+
+		float scale;
+		uint32_t w;
+		uint32_t h;
+		uint16_t samples_per_pixel;
+		uint16_t bits_per_sample;
+		uint16_t sample_format;
+		uint16_t planar_config;
+		uint16_t orientation;
+		uint32_t flip;
+		bool tiled;
+		uint32_t chunk_w;
+		uint32_t chunk_h;
+		tsize_t chunk_size;
+
+		uint32_t channels; // the select_channels() mask, 0 for all
+		std::vector<int> slot; // each sample's channel in the band, or -1
+
+		ctl::dpx::fb<float> bands[2];
+		uint32_t current; // the band that holds the rows
+		uint32_t band_first;
+		uint32_t band_rows;
+};
+
+namespace {
+
+class chunk_task: public IlmThread::Task {
+	public:
+		chunk_task(IlmThread::TaskGroup *group, tiff_reader *reader,
+		           ctl::dpx::fb<float> *band, uint32_t band_row,
+		           uint32_t column, uint32_t row, uint16_t plane) :
+			IlmThread::Task(group), reader(reader), band(band),
+			band_row(band_row), column(column), row(row), plane(plane) {
 		}
-		if(a!=NULL) {
-			f=*a+offset;
-			a=a+a_stride;
-			*(o++)=f/scale;
+
+		virtual void execute() {
+			reader->decode_chunk(band, band_row, column, row, plane);
 		}
-	}
+
+	private:
+		tiff_reader *reader;
+		ctl::dpx::fb<float> *band;
+		uint32_t band_row;
+		uint32_t column;
+		uint32_t row;
+		uint16_t plane;
+};
+
 }
 
-                           
-void tiff_interleave_int16(float *o, uint16_t offset, float scale,
-                           uint16_t *r, int r_stride, uint16_t *g, int g_stride,
-                           uint16_t *b, int b_stride, uint16_t *a, int a_stride,
-                           uint32_t width) {
-	uint32_t i;
-	float f;
+tiff_reader::tiff_reader(TIFF *t, const char *name, float scale) :
+	name(name) {
+	uint16_t i;
 
-	if(scale==0) {
-		scale=65535.0;
+	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGEWIDTH, &w);
+	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGELENGTH, &h);
+	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+	TIFFGetFieldDefaulted(t, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLEFORMAT, &sample_format);
+	TIFFGetFieldDefaulted(t, TIFFTAG_PLANARCONFIG, &planar_config);
+	TIFFGetFieldDefaulted(t, TIFFTAG_ORIENTATION, &orientation);
+	if(orientation<ORIENTATION_TOPLEFT || orientation>ORIENTATION_LEFTBOT) {
+		orientation=ORIENTATION_TOPLEFT;
 	}
 
-	for(i=0; i<width; i++) {
-		if(r!=NULL) {
-			f=*r+offset;
-			r=r+r_stride;
-			*(o++)=f/scale;
-		}
-		if(g!=NULL) {
-			f=*g+offset;
-			g=g+g_stride;
-			*(o++)=f/scale;
-		}
-		if(b!=NULL) {
-			f=*b+offset;
-			b=b+b_stride;
-			*(o++)=f/scale;
+	tiled=TIFFIsTiled(t);
+	if(tiled) {
+		TIFFGetField(t, TIFFTAG_TILEWIDTH, &chunk_w);
+		TIFFGetField(t, TIFFTAG_TILELENGTH, &chunk_h);
+		chunk_size=TIFFTileSize(t);
+	} else {
+		chunk_w=w;
+		TIFFGetFieldDefaulted(t, TIFFTAG_ROWSPERSTRIP, &chunk_h);
+		if(chunk_h>h) {
+			chunk_h=h;
 		}
-		if(a!=NULL) {
-			f=*a+offset;
-			a=a+a_stride;
-			*(o++)=f/scale;
+		chunk_size=TIFFStripSize(t);
+	}
+
+	flip=0;
+	if(sample_format==SAMPLEFORMAT_INT) {
+		flip=1<<(bits_per_sample-1);
+	}
+	if(scale==0.0) {
+		if(sample_format==SAMPLEFORMAT_IEEEFP) {
+			scale=1.0;
+		} else {
+			scale=(1<<bits_per_sample)-1;
 		}
 	}
+	this->scale=scale;
+
+	channels=0;
+	for(i=0; i<samples_per_pixel; i++) {
+		slot.push_back(i);
+	}
+
+	handles.push_back(t);
+	idle.push_back(t);
+	failed=FALSE;
+	current=0;
+	band_first=0;
+	band_rows=0;
 }
 
-void tiff_interleave_float(float *o, float scale,
-                           float *r, int r_stride, float *g, int g_stride,
-                           float *b, int b_stride, float *a, int a_stride,
-                           uint32_t width) {
-	uint32_t i;
-	float f;
+tiff_reader::~tiff_reader() {
+	std::vector<TIFF *>::iterator i;
 
-	if(scale==0) {
-		scale=1.0;
+	for(i=handles.begin(); i!=handles.end(); i++) {
+		TIFFClose(*i);
 	}
+}
 
-	for(i=0; i<width; i++) {
-		if(r!=NULL) {
-			f=*r;
-			r=r+r_stride;
-			*(o++)=f/scale;
-		}
-		if(g!=NULL) {
-			f=*g;
-			g=g+g_stride;
-			*(o++)=f/scale;
-		}
-		if(b!=NULL) {
-			f=*b;
-			b=b+b_stride;
-			*(o++)=f/scale;
-		}
-		if(a!=NULL) {
-			f=*a;
-			a=a+a_stride;
-			*(o++)=f/scale;
-		}
+uint32_t tiff_reader::width(void) const {
+	return transposed() ? h : w;
+}
+
+uint32_t tiff_reader::height(void) const {
+	return transposed() ? w : h;
+}
+
+uint32_t tiff_reader::depth(void) const {
+	if(channels!=0) {
+		return selected_channels(channels);
 	}
+	return samples_per_pixel;
 }
 
-void tiff_read_multiplane(TIFF *t, float scale, ctl::dpx::fb<float> * pixels) {
-	uint8_t *scanline_buffer_uint8[4];
-	uint16_t *scanline_buffer_uint16[4];
-	float *scanline_buffer_float[4];
-	uint16_t samples_per_pixel;
-	uint16_t bits_per_sample;
-	uint32_t w;
-	uint32_t h;
-	uint16_t sample_format;
-	uint16_t offset;
-	uint16_t orientation;
-	tsize_t scanline_size;
-	float *row_ptr;
-	uint32_t row;
-	uint32_t orientation_offset;
-	uint16_t d;
+bool tiff_reader::select_channels(uint32_t mask) {
+	uint16_t i;
+	int next;
 
-	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGEWIDTH, &w);
-	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGELENGTH, &h);
-	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
-	TIFFGetFieldDefaulted(t, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
-	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLEFORMAT, &sample_format);
-	TIFFGetFieldDefaulted(t, TIFFTAG_ORIENTATION, &orientation);
+	if(samples_per_pixel>32) {
+		return FALSE;
+	}
+	channels=mask;
+	next=0;
+	for(i=0; i<samples_per_pixel; i++) {
+		slot[i]= mask==0 || (mask&((uint32_t)1<<i)) ? next++ : -1;
+	}
+	return TRUE;
+}
+
+// Rows 0..3 keep the rows of the file (possibly mirrored), 5..8 turn its
+// columns into rows.
+bool tiff_reader::transposed(void) const {
+	return orientation>ORIENTATION_BOTLEFT;
+}
 
-	pixels->init(w, h, samples_per_pixel);
+// Hands out an idle handle, opening another one if the other workers hold
+// all of them.
+TIFF *tiff_reader::acquire(void) {
+	IlmThread::Lock lock(mutex);
+	TIFF *t;
 
-	orientation_offset=0;
-	if(orientation==ORIENTATION_LEFTTOP) {
-		// We only deal with the bottom->top flip, not the other orientation
-		// modes (the actual check for this is in tiff_read).
-		orientation_offset=(uint32_t)-h;
+	if(!idle.empty()) {
+		t=idle.back();
+		idle.pop_back();
+		return t;
+	}
+	t=TIFFOpen(name.c_str(), "r");
+	if(t!=NULL) {
+		handles.push_back(t);
 	}
+	return t;
+}
 
-	scanline_size=TIFFScanlineSize(t);
-	if(bits_per_sample==8) {
-		for(row=0; row<4; row++) {
-			if(row<samples_per_pixel) {
-				scanline_buffer_uint8[row]=(uint8_t *)alloca(scanline_size);
-				for(d=0; d<w; d++) {
-					scanline_buffer_uint8[row][d]= row==3 ? 255 : 0;
-				}
-			} else {
-				scanline_buffer_uint8[row]=NULL;
-			}
-		}
-		for(;row<4; row++) {
+void tiff_reader::release(TIFF *t) {
+	IlmThread::Lock lock(mutex);
+
+	idle.push_back(t);
+}
+
+void tiff_reader::fail(void) {
+	IlmThread::Lock lock(mutex);
+
+	failed=TRUE;
+}
+
+void tiff_reader::convert(float *out, const uint8_t *in, uint64_t count) {
+	if(sample_format==SAMPLEFORMAT_IEEEFP) {
+		if(bits_per_sample==16) {
+			half_to_float(out, (const half *)in, 1.0, count);
+			unscale_float(out, out, scale, count);
+		} else {
+			unscale_float(out, (const float *)in, scale, count);
 		}
-		offset=0;
-		if(sample_format==2) {
-			offset=1<<7;
+	} else if(bits_per_sample==8) {
+		uint8_to_float(out, in, flip, scale, count);
+	} else {
+		uint16_to_float(out, (const uint16_t *)in, flip, scale, count);
+	}
+}
+
+void tiff_reader::decode_chunk(ctl::dpx::fb<float> *band, uint32_t band_row,
+                               uint32_t column, uint32_t row, uint16_t plane) {
+	std::vector<uint8_t> buffer(chunk_size); // a short chunk reads as 0
+	std::vector<float> samples;
+	uint32_t chunk_samples;
+	uint32_t first_sample;
+	uint32_t columns;
+	uint32_t rows;
+	uint32_t d;
+	uint64_t row_bytes;
+	uint32_t r, c, s;
+	tsize_t n;
+	float *out;
+	TIFF *t;
+
+	t=acquire();
+	if(t==NULL) {
+		fail();
+		return;
+	}
+	if(tiled) {
+		n=TIFFReadEncodedTile(t, TIFFComputeTile(t, column, row, 0, plane),
+		                      &buffer[0], chunk_size);
+	} else {
+		n=TIFFReadEncodedStrip(t, TIFFComputeStrip(t, row, plane),
+		                       &buffer[0], chunk_size);
+	}
+	release(t);
+	if(n<0) {
+		fail();
+		return;
+	}
+
+	chunk_samples=samples_per_pixel;
+	first_sample=0;
+	if(planar_config==PLANARCONFIG_SEPARATE) {
+		chunk_samples=1;
+		first_sample=plane;
+	}
+	row_bytes=(uint64_t)chunk_w*chunk_samples*(bits_per_sample/8);
+	columns=MIN(chunk_w, w-column);
+	rows=MIN(chunk_h, h-row);
+	d=band->depth();
+
+	if(channels!=0 || chunk_samples!=d) {
+		samples.resize((uint64_t)columns*chunk_samples);
+	}
+	for(r=0; r<rows; r++) {
+		out=band->ptr()+((uint64_t)(row+r-band_row)*w+column)*d;
+		if(samples.empty()) {
+			convert(out, &buffer[r*row_bytes], (uint64_t)columns*d);
+			continue;
 		}
-		for(row=0; row<h; row++) {
-			for(d=0; d<samples_per_pixel; d++) {
-				TIFFReadScanline(t, scanline_buffer_uint8[d],
-				                 row+orientation_offset, d);
+		convert(&samples[0], &buffer[r*row_bytes],
+		        (uint64_t)columns*chunk_samples);
+		for(s=0; s<chunk_samples; s++) {
+			if(slot[first_sample+s]<0) {
+				continue;
 			}
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			tiff_interleave_int8(row_ptr, offset, scale,
-			                     scanline_buffer_uint8[0], 1,
-			                     scanline_buffer_uint8[1], 1,
-			                     scanline_buffer_uint8[2], 1,
-			                     scanline_buffer_uint8[3], 1,
-			                     w);
-		}
-	} else if(bits_per_sample==16) {
-		for(row=0; row<4; row++) {
-			if(row<samples_per_pixel) {
-				scanline_buffer_uint16[row]=(uint16_t *)alloca(scanline_size);
-				for(d=0; d<w; d++) {
-					scanline_buffer_uint16[row][d]= row==3 ? 65535 : 0;
-				}
-			} else {
-				scanline_buffer_uint16[row]=NULL;
+			for(c=0; c<columns; c++) {
+				out[c*d+slot[first_sample+s]]=samples[c*chunk_samples+s];
 			}
 		}
-		offset=0;
-		if(sample_format==2) {
-			offset=1<<15;
-		}
-		for(row=0; row<h; row++) {
-			for(d=0; d<samples_per_pixel; d++) {
-				TIFFReadScanline(t, scanline_buffer_uint16[d],
-				                 row+orientation_offset, d);
+	}
+}
+
+// Makes the band hold (at least) the rows first_row..last_row-1 of the
+// file. Whole strips (or rows of tiles) are kept; those that the last band
+// already had are copied over, the others are decoded.
+void tiff_reader::load_band(uint32_t first_row, uint32_t last_row) {
+	ctl::dpx::fb<float> *next;
+	const ctl::dpx::fb<float> &last=bands[current];
+	uint64_t row_samples;
+	uint32_t first;
+	uint32_t end;
+	uint32_t row;
+	uint32_t rows;
+	uint32_t column;
+	uint16_t plane;
+	uint16_t planes;
+
+	first=first_row-first_row%chunk_h;
+	end=MIN(h, (last_row+chunk_h-1)/chunk_h*chunk_h);
+	if(band_rows!=0 && first>=band_first && end<=band_first+band_rows) {
+		return;
+	}
+
+	next=&(bands[current^1]);
+	next->init(w, end-first, depth());
+	row_samples=(uint64_t)w*depth();
+	planes= planar_config==PLANARCONFIG_SEPARATE ? samples_per_pixel : 1;
+	{
+		IlmThread::TaskGroup group;
+
+		for(row=first; row<end; row+=chunk_h) {
+			rows=MIN(chunk_h, h-row);
+			if(band_rows!=0 && row>=band_first &&
+			   row+rows<=band_first+band_rows) {
+				memcpy(next->ptr()+(row-first)*row_samples,
+				       last.ptr()+(row-band_first)*row_samples,
+				       sizeof(float)*rows*row_samples);
+				continue;
 			}
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			tiff_interleave_int16(row_ptr, offset, scale,
-			                      scanline_buffer_uint16[0], 1,
-			                      scanline_buffer_uint16[1], 1,
-			                      scanline_buffer_uint16[2], 1,
-			                      scanline_buffer_uint16[3], 1,
-			                      w);
-		}
-	} else if(sample_format==3) {
-		for(row=0; row<4; row++) {
-			if(row<samples_per_pixel) {
-				scanline_buffer_float[row]=(float *)alloca(scanline_size);
-				for(d=0; d<w; d++) {
-					scanline_buffer_float[row][d]= row==3 ? 1.0 : 0.0;
+			for(plane=0; plane<planes; plane++) {
+				if(planes>1 && slot[plane]<0) {
+					continue;
+				}
+				for(column=0; column<w; column+=chunk_w) {
+					IlmThread::ThreadPool::addGlobalTask(
+						new chunk_task(&group, this, next, first,
+						               column, row, plane));
 				}
-			} else {
-				scanline_buffer_float[row]=NULL;
 			}
 		}
-		for(row=0; row<h; row++) {
-			for(d=0; d<samples_per_pixel; d++) {
-				TIFFReadScanline(t, scanline_buffer_float[d],
-				                 row+orientation_offset, d);
+	}
+
+	current=current^1;
+	band_first=first;
+	band_rows=end-first;
+	if(failed) {
+		THROW(Iex::InputExc, "unable to decode the TIFF file " << name
+		      << ".");
+	}
+}
+
+void tiff_reader::read(uint32_t first_row, uint32_t rows,
+                       ctl::dpx::fb<float> *pixels) {
+	const float *src;
+	float *dst;
+	uint32_t d;
+	uint32_t x, y;
+	uint32_t src_x, src_y;
+	bool mirror_x, mirror_y;
+
+	if(first_row>=height()) {
+		THROW(Iex::ArgExc, "row " << first_row << " is past the bottom of "
+		      "the image.");
+	}
+	if(rows>height()-first_row) {
+		rows=height()-first_row;
+	}
+
+	d=depth();
+	pixels->init(width(), rows, d);
+	dst=pixels->ptr();
+
+	if(transposed()) {
+		// The rows of the image are columns of the file, so every strip
+		// needs all of its rows.
+		mirror_x= orientation==ORIENTATION_RIGHTTOP ||
+		          orientation==ORIENTATION_RIGHTBOT;
+		mirror_y= orientation==ORIENTATION_RIGHTBOT ||
+		          orientation==ORIENTATION_LEFTBOT;
+		load_band(0, h);
+		for(y=first_row; y<first_row+rows; y++) {
+			src_x= mirror_y ? w-1-y : y;
+			for(x=0; x<h; x++) {
+				src_y= mirror_x ? h-1-x : x;
+				src=bands[current].ptr()+((uint64_t)src_y*w+src_x)*d;
+				memcpy(dst, src, sizeof(float)*d);
+				dst=dst+d;
 			}
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			tiff_interleave_float(row_ptr, scale,
-			                      scanline_buffer_float[0], 1,
-			                      scanline_buffer_float[1], 1,
-			                      scanline_buffer_float[2], 1,
-			                      scanline_buffer_float[3], 1,
-			                      w);
+		}
+		return;
+	}
+
+	mirror_x= orientation==ORIENTATION_TOPRIGHT ||
+	          orientation==ORIENTATION_BOTRIGHT;
+	mirror_y= orientation==ORIENTATION_BOTRIGHT ||
+	          orientation==ORIENTATION_BOTLEFT;
+	if(mirror_y) {
+		load_band(h-first_row-rows, h-first_row);
+	} else {
+		load_band(first_row, first_row+rows);
+	}
+	for(y=first_row; y<first_row+rows; y++) {
+		src_y= mirror_y ? h-1-y : y;
+		src=bands[current].ptr()+(uint64_t)(src_y-band_first)*w*d;
+		if(!mirror_x) {
+			memcpy(dst, src, sizeof(float)*w*d);
+			dst=dst+(uint64_t)w*d;
+			continue;
+		}
+		for(x=0; x<w; x++) {
+			memcpy(dst, src+(uint64_t)(w-1-x)*d, sizeof(float)*d);
+			dst=dst+d;
 		}
 	}
 }
 
-void tiff_read_interleaved(TIFF *t, float scale, ctl::dpx::fb<float> * pixels) {
-	uint8_t *scanline_buffer_uint8;
-	uint16_t *scanline_buffer_uint16;
-	float *scanline_buffer_float;
-	uint16_t samples_per_pixel;
+image_reader *tiff_open(const char *name, float scale, format_t *format) {
+	TIFF *t;
 	uint16_t bits_per_sample;
-	uint32_t w;
-	uint32_t h;
 	uint16_t sample_format;
-	uint16_t offset;
-	uint32_t row;
-	float *row_ptr;
+	uint16_t photometric;
+	bool integer;
+	bool floating;
+	frame_reader *frame;
+
+	TIFFSetErrorHandler(ErrorHandler);
+	TIFFSetWarningHandler(WarningHandler);
+
+	t=TIFFOpen(name, "r");
+	if(t==NULL) {
+		// This is set if the file is not a tiff, we just sort of punt.
+		return NULL;
+	}
 
-	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGEWIDTH, &w);
-	TIFFGetFieldDefaulted(t, TIFFTAG_IMAGELENGTH, &h);
-	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
 	TIFFGetFieldDefaulted(t, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+	format->src_bps=bits_per_sample;
 	TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLEFORMAT, &sample_format);
-	pixels->init(w, h, samples_per_pixel);
+	TIFFGetFieldDefaulted(t, TIFFTAG_PHOTOMETRIC, &photometric);
 
-	if(bits_per_sample==8) {
-		scanline_buffer_uint8=(uint8_t *)alloca(TIFFScanlineSize(t));
-		offset=0;
-		if(sample_format==2) {
-			offset=127;
+	integer=(bits_per_sample==8 || bits_per_sample==16) &&
+	        (sample_format==SAMPLEFORMAT_UINT ||
+	         sample_format==SAMPLEFORMAT_INT ||
+	         sample_format==SAMPLEFORMAT_VOID);
+	floating=(bits_per_sample==16 || bits_per_sample==32) &&
+	         sample_format==SAMPLEFORMAT_IEEEFP;
+
+	if((!integer && !floating) ||
+	   (photometric!=PHOTOMETRIC_RGB && photometric!=PHOTOMETRIC_MINISBLACK)) {
+		// Palettes, YCbCr, CMYK, odd sample sizes and so on are left to
+		// libtiff's RGBA reader.
+		if(bits_per_sample!=8) {
+			fprintf(stderr, "falling back to failsafe TIFF reader. Reading "
+			        "as \n8 bits per sample RGBA.\n");
 		}
-		for(row=0; row<h; row++) {
-			TIFFReadScanline(t, scanline_buffer_uint8, row, 0);
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			if(samples_per_pixel==3) {
-				tiff_interleave_int8(row_ptr, offset, scale,
-				                     scanline_buffer_uint8+0, 3,
-				                     scanline_buffer_uint8+1, 3,
-				                     scanline_buffer_uint8+2, 3,
-				                     NULL, 0,
-				                     w);
-			} else {
-				tiff_interleave_int8(row_ptr, offset, scale,
-				                     scanline_buffer_uint8+0, 4,
-				                     scanline_buffer_uint8+1, 4,
-				                     scanline_buffer_uint8+2, 4,
-				                     scanline_buffer_uint8+3, 4,
-				                     w);
-			}
+		frame=new frame_reader;
+		tiff_read_failsafe(t, scale, &(frame->frame));
+		TIFFClose(t);
+		return frame;
+	}
+
+	return new tiff_reader(t, name, scale);
+}
+
+void tiff_interleave_int8(float *o, int offset, float scale,
+                          uint8_t *r, int r_stride, uint8_t *g, int g_stride,
+                          uint8_t *b, int b_stride, uint8_t *a, int a_stride,
+                          uint32_t width) {
+	uint32_t i;
+	float f;
+
+	if(scale==0) {
+		scale=255.0;
+	}
+
+	for(i=0; i<width; i++) {
+		if(r!=NULL) {
+			f=*r+offset;
+			r=r+r_stride;
+			*(o++)=f/scale;
 		}
-	} else if(bits_per_sample==16) {
-		scanline_buffer_uint16=(uint16_t *)alloca(TIFFScanlineSize(t));
-		offset=0;
-		if(sample_format==2) {
-			offset=32767;
+		if(g!=NULL) {
+			f=*g+offset;
+			g=g+g_stride;
+			*(o++)=f/scale;
 		}
-		for(row=0; row<h; row++) {
-			TIFFReadScanline(t, scanline_buffer_uint16, row, 0);
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			if(samples_per_pixel==3) {
-				tiff_interleave_int16(row_ptr, offset, scale,
-				                      scanline_buffer_uint16+0, 3,
-				                      scanline_buffer_uint16+1, 3,
-				                      scanline_buffer_uint16+2, 3,
-				                      NULL, 0,
-				                      w);
-			} else {
-				tiff_interleave_int16(row_ptr, offset, scale,
-				                      scanline_buffer_uint16+0, 4,
-				                      scanline_buffer_uint16+1, 4,
-				                      scanline_buffer_uint16+2, 4,
-				                      scanline_buffer_uint16+3, 4,
-				                      w);
-			}
+		if(b!=NULL) {
+			f=*b+offset;
+			b=b+b_stride;
+			*(o++)=f/scale;
 		}
-	} else if(sample_format==3) {
-		scanline_buffer_float=(float *)alloca(TIFFScanlineSize(t));
-		for(row=0; row<h; row++) {
-			TIFFReadScanline(t, scanline_buffer_float, row, 0);
-			row_ptr=pixels->ptr()+row*pixels->width()*pixels->depth();
-			if(samples_per_pixel==3) {
-				tiff_interleave_float(row_ptr, scale,
-				                      scanline_buffer_float+0, 3,
-				                      scanline_buffer_float+1, 3,
-				                      scanline_buffer_float+2, 3,
-				                      NULL, 0,
-				                      w);
-			} else {
-				tiff_interleave_float(row_ptr, scale,
-				                      scanline_buffer_float+0, 4,
-				                      scanline_buffer_float+1, 4,
-				                      scanline_buffer_float+2, 4,
-				                      scanline_buffer_float+3, 4,
-				                      w);
-			}
+		if(a!=NULL) {
+			f=*a+offset;
+			a=a+a_stride;
+			*(o++)=f/scale;
 		}
 	}
 }
 
+
 void tiff_read_failsafe(TIFF *t, float scale, ctl::dpx::fb<float> *pixels) {
 	uint8_t *temp_buffer;
 	uint8_t *flip;
@@ -487,54 +697,6 @@ void tiff_read_failsafe(TIFF *t, float scale, ctl::dpx::fb<float> *pixels) {
 	}
 }
 
-void tiff_convert_uint8(uint8_t *data, const float *in,
-                        float scale, uint32_t width) {
-#if 1
-	ctl::dpx::convert(data, in, 0.0, width);
-#else
-	uint32_t i;
-	float f;
-
-	if(scale==0.0) {
-		scale=1ULL<<15;
-	}
-
-	for(i=0; i<width; i++) {
-		f=*in;
-		f=f*scale;
-		if(f<0.0) { f=0.0; }
-		if(f>254.999) { f=254.999; }
-		*(data++)=lrint(f);
-		in++;
-	}
-#endif
-}
-
-void tiff_convert_uint16(uint16_t *data, const float *in,
-                         float scale, uint32_t width) {
-#if 1
-	ctl::dpx::convert(data, in, 0.0, width);
-#else
-	uint32_t i;
-	float f;
-
-	if(scale==0.0) {
-		scale=1ULL<<15;
-	}
-
-	// Yes... I know... You can do this with a lookup table...
-	// And it would be much faster... And you should round these...
-	for(i=0; i<width; i++) {
-		f=*in;
-		f=f*scale;
-		if(f<0.0) { f=0.0; }
-		if(f>65534.999) { f=65534.999; }
-		*(data++)=lrint(f);
-		in++;
-	}
-#endif
-}
-
 void tiff_convert_float(float *out, const float *in,
                         float scale, uint32_t width) {
 #if 1
@@ -552,15 +714,69 @@ void tiff_convert_float(float *out, const float *in,
 #endif
 }
 
-void tiff_write(const char *name, float scale,
-                const ctl::dpx::fb<float> &pixels,
-                format_t *format) {
+// Converts and writes the rows of a contiguous scanline file. Integer
+// samples are quantised (and dithered) by the same code as DPX files.
+class tiff_writer: public image_writer {
+	public:
+		tiff_writer(TIFF *t, uint16_t bits_per_sample, float scale,
+		            ctl::dpx::dither_e dither) :
+			t(t), bits_per_sample(bits_per_sample), scale(scale),
+			dither(dither) {
+			y=0;
+		}
+
+		virtual ~tiff_writer() {
+			if(t!=NULL) {
+				TIFFClose(t);
+			}
+		}
+
+		virtual void write(const ctl::dpx::fb<float> &pixels) {
+			tdata_t scanline_buffer;
+			uint32_t row_samples;
+			uint32_t r;
+			const float *row;
+
+			row_samples=pixels.depth()*pixels.width();
+			// Worst case...
+			scanline_buffer=alloca(sizeof(float)*row_samples);
+
+			for(r=0; r<pixels.height(); r++, y++) {
+				row=pixels.ptr()+(uint64_t)r*row_samples;
+				if(bits_per_sample==8) {
+					ctl::dpx::dither((uint8_t *)scanline_buffer, 8, row, 0.0,
+					                 pixels.width(), pixels.depth(), y,
+					                 dither);
+				} else if(bits_per_sample==16) {
+					ctl::dpx::dither((uint16_t *)scanline_buffer, 16, row, 0.0,
+					                 pixels.width(), pixels.depth(), y,
+					                 dither);
+				} else {
+					tiff_convert_float((float *)scanline_buffer, row,
+					                   scale, row_samples);
+				}
+				TIFFWriteScanline(t, scanline_buffer, y, 0);
+			}
+		}
+
+		virtual void close(void) {
+			TIFFClose(t);
+			t=NULL;
+		}
+
+	private:
+		TIFF *t;
+		uint16_t bits_per_sample;
+		float scale;
+		ctl::dpx::dither_e dither;
+		uint32_t y;
+};
+
+image_writer *tiff_create(const char *name, float scale,
+                          uint32_t width, uint32_t height, uint32_t depth,
+                          format_t *format) {
 	TIFF *t;
 	uint16_t bits_per_sample;
-	tdata_t scanline_buffer;
-	uint32_t y;
-	uint8_t channel;
-	const float *row;
 
 	TIFFSetErrorHandler(ErrorHandler);
 	TIFFSetWarningHandler(WarningHandler);
@@ -577,55 +793,31 @@ void tiff_write(const char *name, float scale,
 
 	t=TIFFOpen(name, "w");
 	if(t==NULL) {
-		// What went wrong
+		THROW(Iex::ArgExc, "unable to create the TIFF file " << name << ".");
 	}
 
-	TIFFSetField(t, TIFFTAG_SAMPLESPERPIXEL, pixels.depth());
+	TIFFSetField(t, TIFFTAG_SAMPLESPERPIXEL, depth);
 	TIFFSetField(t, TIFFTAG_BITSPERSAMPLE, bits_per_sample);
 	TIFFSetField(t, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-	TIFFSetField(t, TIFFTAG_IMAGEWIDTH, pixels.width());
-	TIFFSetField(t, TIFFTAG_IMAGELENGTH, pixels.height());
+	TIFFSetField(t, TIFFTAG_IMAGEWIDTH, width);
+	TIFFSetField(t, TIFFTAG_IMAGELENGTH, height);
 	TIFFSetField(t, TIFFTAG_ROWSPERSTRIP, 1);
 	TIFFSetField(t, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-	// Worst case...
-	scanline_buffer=alloca(sizeof(float)*pixels.depth()*pixels.width());
-
-	if(bits_per_sample==8) {
-		TIFFSetField(t, TIFFTAG_SAMPLEFORMAT, 1);
-		for(y=0; y<pixels.height(); y++) {
-			row=pixels.ptr()+y*pixels.width()*pixels.depth();
-			tiff_convert_uint8((uint8_t *)scanline_buffer, row,
-			                   scale, pixels.depth()*pixels.width());
-			TIFFWriteScanline(t, scanline_buffer, y, 0);
-		}
-	} else if(bits_per_sample==16) {
-		TIFFSetField(t, TIFFTAG_SAMPLEFORMAT, 1);
-		for(y=0; y<pixels.height(); y++) {
-			row=pixels.ptr()+y*pixels.width()*pixels.depth();
-			tiff_convert_uint16((uint16_t *)scanline_buffer, row,
-			                    scale, pixels.depth()*pixels.width());
-			TIFFWriteScanline(t, scanline_buffer, y, channel);
-		}
-	} else if(bits_per_sample==32) {
-		TIFFSetField(t, TIFFTAG_SAMPLEFORMAT, 3);
-		for(y=0; y<pixels.height(); y++) {
-			row=pixels.ptr()+y*pixels.width()*pixels.depth();
-			tiff_convert_float((float *)scanline_buffer, row,
-			                   scale, pixels.depth()*pixels.width());
-			TIFFWriteScanline(t, scanline_buffer, y, channel);
-		}
-	}
+	TIFFSetField(t, TIFFTAG_SAMPLEFORMAT, bits_per_sample==32 ? 3 : 1);
 
-	TIFFClose(t);
+	return new tiff_writer(t, bits_per_sample, scale,
+	                       (ctl::dpx::dither_e)format->dither);
 }
 
 #else
-bool tiff_read(const char *name, float scale, ctl::dpx::fb<float> *pixels,
-               format_t *bps) {
-	return FALSE;
+image_reader *tiff_open(const char *name, float scale, format_t *format) {
+	return NULL;
 }
-void tiff_write(const char *name, float scale,
-                const ctl::dpx::fb<float> &pixels, format_t *format) {
+
+image_writer *tiff_create(const char *name, float scale,
+                          uint32_t width, uint32_t height, uint32_t depth,
+                          format_t *format) {
 	// thow tiff is unsupported message.
+	return NULL;
 }
 #endif
@@ -56,13 +56,13 @@
 #define CTL_UTIL_CTLRENDER_TIFF_INCLUDE
 
 #include "main.hh"
+#include "image_io.hh"
 #include <dpx.hh>
 
-bool tiff_read(const char *name, float scale,
-               ctl::dpx::fb<float> *pixels,
-               format_t *format);
-void tiff_write(const char *name, float scale,
-                const ctl::dpx::fb<float> &pixels,
-                format_t *format);
+// Returns NULL if the file is not a TIFF file.
+image_reader *tiff_open(const char *name, float scale, format_t *format);
+image_writer *tiff_create(const char *name, float scale,
+                          uint32_t width, uint32_t height, uint32_t depth,
+                          format_t *format);
 
 #endif
@@ -57,280 +57,175 @@
 #include "tiff_file.hh"
 #include "exr_file.hh"
 #include "aces_file.hh"
+#include "raw_file.hh"
+#include "ctld.hh"
 #include <dpx.hh>
 #include <CtlRcPtr.h>
 #include <CtlFunctionCall.h>
 #include <CtlSimdInterpreter.h>
 #include <CtlStdType.h>
+#include <CtlBakedLut.h>
 #include <exception>
+#include <vector>
+#include <iterator>
 #include <Iex.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/time.h>
 
-class CTLResult;
-typedef Ctl::RcPtr<CTLResult> CTLResultPtr;
-
-// class which holds the data resulting from a CTL transform
-class CTLResult: public Ctl::RcObject
+// A value that the input arguments of a CTL function can be bound to: a
+// channel of the image, an output argument of the function that runs
+// before it, or a parameter given on the command line.
+struct ctl_source_t
 {
-public:
-	CTLResult();
-	virtual ~CTLResult();
+	ctl_source_t() :
+			external(FALSE), channel(-1)
+	{
+	}
 
-	Ctl::TypeStoragePtr data;
-	bool external;
+	std::string name;
 	std::string alt_name;
-};
-
-CTLResult::CTLResult() :
-		Ctl::RcObject()
-{
-	external = FALSE;
-}
 
-CTLResult::~CTLResult()
-{
-}
+	// TRUE for parameters given on the command line.
+	bool external;
 
-typedef std::list<CTLResultPtr> CTLResults;
+	// The channel of the image, or -1 if the value is held by data.
+	int channel;
+	Ctl::TypeStoragePtr data;
+};
 
+typedef std::vector<ctl_source_t> CTLSources;
 
-// This function is used to add to the result list parameters that
+// This function is used to add to the source list parameters that
 // are specified on the command line. A parameter that has been returned
 // by a CTL function takes precedence
-void add_parameter_value_to_ctl_results(CTLResults *ctl_results, const ctl_parameter_t &ctl_parameter)
+void add_parameter_value_to_ctl_sources(CTLSources *ctl_sources, const ctl_parameter_t &ctl_parameter)
 {
-	CTLResults::iterator results_iter;
-	Ctl::ArrayTypePtr array;
+	CTLSources::iterator sources_iter;
 	Ctl::DataTypePtr type;
-	CTLResultPtr ctl_result;
+	Ctl::TypeStoragePtr data;
 
 	// lookup a named data element that matches the parameter name.
-	for (results_iter = ctl_results->begin(); results_iter != ctl_results->end(); results_iter++)
+	for (sources_iter = ctl_sources->begin(); sources_iter != ctl_sources->end(); sources_iter++)
 	{
-		if ((*results_iter)->data->name() == ctl_parameter.name)
+		if (sources_iter->name == ctl_parameter.name)
 		{
 			break;
 		}
 	}
 
-	if (results_iter != ctl_results->end())
+	// if the value was set by a CTL function (i.e. external == false), we preserve it
+	if (sources_iter != ctl_sources->end() && !sources_iter->external)
 	{
-		// result data found
-		ctl_result = *results_iter;
-
-		// if result data was set by a CTL function (i.e. external == false), we preserve its value
-		if (!ctl_result->external)
-		{
-			// Set by a CTL function. No way are we over writing this...
-			return;
-		}
-		// It's a command line argument, so we (re)set it (this happens
-		// if the user has specified the same parameter more than once
-		// (either due to user error or by overriding a global value with
-		// a local one).
-	}
-	else
-	{
-		// ctl result data not found, so we create a new ctl result and add it to the list (the ctl data value is added below)
-		ctl_result = CTLResultPtr(new CTLResult);
-		ctl_result->external = TRUE;
-		ctl_results->push_back(ctl_result);
+		// Set by a CTL function. No way are we over writing this...
+		return;
 	}
 
 	if (ctl_parameter.count == 1)
 	{
-		ctl_result->data = new Ctl::DataArg(ctl_parameter.name, new Ctl::StdFloatType(), 1);
-		ctl_result->data->set(&(ctl_parameter.value[0]));
+		data = new Ctl::DataArg(ctl_parameter.name, new Ctl::StdFloatType(), 1);
+		data->set(&(ctl_parameter.value[0]));
 	}
 	else
 	{
 		type = new Ctl::StdArrayType(new Ctl::StdFloatType(), ctl_parameter.count);
-		ctl_result->data = new Ctl::DataArg(ctl_parameter.name, type, 1);
+		data = new Ctl::DataArg(ctl_parameter.name, type, 1);
 		for (uint8_t i = 0; i < ctl_parameter.count; i++)
 		{
-			ctl_result->data->set(&(ctl_parameter.value[i]), 0, 0, 1, "%d", i);
-		}
-	}
-	ctl_results->push_back(ctl_result);
-}
-
-void set_ctl_function_argument_from_ctl_results(Ctl::FunctionArgPtr *arg, const CTLResults &ctl_results, size_t offset, size_t count)
-{
-	CTLResults::const_iterator results_iter;
-	Ctl::TypeStoragePtr src;
-	Ctl::FunctionArgPtr dst;
-
-	dst = *arg;
-
-	for (results_iter = ctl_results.begin(); results_iter != ctl_results.end(); results_iter++)
-	{
-		if ((*results_iter)->data->name() == dst->name() || (*results_iter)->alt_name == dst->name())
-		{
-			break;
+			data->set(&(ctl_parameter.value[i]), 0, 0, 1, "%d", i);
 		}
 	}
 
-	if (results_iter == ctl_results.end())
+	if (sources_iter != ctl_sources->end())
 	{
-		if (dst->hasDefaultValue())
-		{
-			dst->setDefaultValue();
-		}
-		else
-		{
-			THROW(Iex::ArgExc, "CTL parameter '" << dst->name() << "' not specified on the command line and does not have a default value.");
-			throw(std::exception());
-		}
+		// It's a command line argument, so we (re)set it (this happens
+		// if the user has specified the same parameter more than once
+		// (either due to user error or by overriding a global value with
+		// a local one).
+		sources_iter->data = data;
 		return;
 	}
 
-	src = (*results_iter)->data;
-	if (!dst->isVarying())
-	{
-		if (offset == 0)
-		{
-			dst->copy(src, 0, 0, 1);
-		}
-		return;
-	}
-	else
-	{
-		if (!src->isVarying())
-		{
-			for (size_t i = 0; i < dst->elements(); i++)
-			{
-				dst->copy(src, 0, i, 1);
-			}
-		}
-		else
-		{
-			dst->copy(src, offset, 0, count);
-		}
-	}
+	ctl_source_t ctl_source;
+	ctl_source.name = ctl_parameter.name;
+	ctl_source.external = TRUE;
+	ctl_source.data = data;
+	ctl_sources->push_back(ctl_source);
 }
 
-void set_ctl_results_from_ctl_function_argument(CTLResults *ctl_results, const Ctl::FunctionArgPtr &arg, size_t offset, size_t count, size_t total)
+// Adds an output argument of a CTL function to the sources of the function
+// that runs after it. rOut, gOut, bOut and aOut are also passed on as rIn,
+// gIn, bIn and aIn.
+void add_output_to_ctl_sources(CTLSources *ctl_sources, const Ctl::FunctionArgPtr &arg)
 {
-	CTLResults::iterator results_iter;
-	CTLResultPtr ctl_result;
+	std::string names[2];
 
-	for (results_iter = ctl_results->begin(); results_iter != ctl_results->end(); results_iter++)
+	names[0] = arg->name();
+	if (arg->name() == "rOut")
 	{
-		if ((*results_iter)->data->name() == arg->name())
-		{
-			break;
-		}
+		names[1] = "rIn";
 	}
-
-//	fprintf(stderr, "copying %d@%d (total %d) of %s\n", count, offset, total, arg->name().c_str());
-	if (!arg->isVarying())
+	else if (arg->name() == "gOut")
 	{
-		// For constant return arguments we only do this the first time
-		// through
-		if (offset != 0)
-		{
-			return;
-		}
-		total = 1;
-		count = 1;
+		names[1] = "gIn";
 	}
-
-	// Since the ctl_results list gets rebuilt after the end of ctl_run_transform
-	// we don't have to worry about having this function getting called
-	// twice with the FunctionArgPtr having different types (for a given
-	// output argument name).
-	if (results_iter != ctl_results->end())
+	else if (arg->name() == "bOut")
 	{
-		ctl_result = *results_iter;
-
-		std::string inputName;
-		if (arg->name() == "rOut")
-		{
-			inputName = "rIn";
-		}
-		else if (arg->name() == "gOut")
-		{
-			inputName = "gIn";
-		}
-		else if (arg->name() == "bOut")
-		{
-			inputName = "bIn";
-		}
-		else if (arg->name() == "aOut")
-		{
-			inputName = "aIn";
-		}
+		names[1] = "bIn";
+	}
+	else if (arg->name() == "aOut")
+	{
+		names[1] = "aIn";
+	}
 
-		if (!inputName.empty())
+	for (int n = 0; n < 2 && !names[n].empty(); n++)
+	{
+		// An output argument replaces a value of the same name, the
+		// input name is always added after it.
+		CTLSources::iterator sources_iter = ctl_sources->end();
+		if (n == 0)
 		{
-			for (results_iter = ctl_results->begin(); results_iter != ctl_results->end(); results_iter++)
+			for (sources_iter = ctl_sources->begin(); sources_iter != ctl_sources->end(); sources_iter++)
 			{
-				if ((*results_iter)->data->name() == inputName)
+				if (sources_iter->name == names[n])
 				{
 					break;
 				}
 			}
-
-			if (results_iter != ctl_results->end())
-			{
-				CTLResultPtr ctl_result_output_to_input;
-				ctl_result_output_to_input = *results_iter;
-				ctl_result_output_to_input->data->copy(arg, 0, offset, count);
-			}
-
-		}
-	}
-	else
-	{
-		ctl_result = CTLResultPtr(new CTLResult());
-		ctl_result->data = new Ctl::DataArg(arg->name(), arg->type(), total);
-		ctl_results->push_back(ctl_result);
-
-		std::string inputName;
-		if (arg->name() == "rOut")
-		{
-			inputName = "rIn";
-		}
-		else if (arg->name() == "gOut")
-		{
-			inputName = "gIn";
-		}
-		else if (arg->name() == "bOut")
-		{
-			inputName = "bIn";
-		}
-		else if (arg->name() == "aOut")
-		{
-			inputName = "aIn";
 		}
 
-		if (!inputName.empty())
+		if (sources_iter == ctl_sources->end())
 		{
-			CTLResultPtr ctl_result_input;
-
-			ctl_result_input = CTLResultPtr(new CTLResult());
-			ctl_result_input->data = new Ctl::DataArg(inputName, arg->type(), total);
-			ctl_results->push_back(ctl_result_input);
-			ctl_result_input->data->copy(arg, 0, offset, count);
+			ctl_sources->push_back(ctl_source_t());
+			sources_iter = ctl_sources->end() - 1;
+			sources_iter->name = names[n];
 		}
+		sources_iter->data = arg;
 	}
+}
 
-	ctl_result->data->copy(arg, 0, offset, count);
+// Returns true if mkimage() looks for an output argument with the given name.
+bool is_image_channel_output(const std::string &name)
+{
+	return !strcasecmp("rOut", name.c_str()) || !strcasecmp("gOut", name.c_str()) || !strcasecmp("bOut", name.c_str())
+			|| !strcasecmp("aOut", name.c_str());
 }
 
-void run_ctl_transform(const ctl_operation_t &ctl_operation, CTLResults *ctl_results, size_t count)
+// Loads the script of a ctl operation into the interpreter and returns the
+// function to call, specialized for the values in ctl_sources that are the
+// same for every pixel. If last_operation is true, the outputs of
+// the transform are only used by mkimage(); other outputs are not computed.
+Ctl::FunctionCallPtr load_ctl_function(Ctl::SimdInterpreter &interpreter, const ctl_operation_t &ctl_operation,
+		                               const CTLSources &ctl_sources, bool last_operation)
 {
-	Ctl::SimdInterpreter interpreter;
 	Ctl::FunctionCallPtr fn;
 	Ctl::FunctionArgPtr arg;
-	CTLResults::iterator results_iter;
+	CTLSources::const_iterator sources_iter;
 	char *name = NULL;
 	char *module;
 	char *slash;
 	char *dot;
-	CTLResults new_ctl_results;
 
 	try
 	{
@@ -356,7 +251,24 @@ void run_ctl_transform(const ctl_operation_t &ctl_operation, CTLResults *ctl_res
 			*dot = 0;
 		}
         
-        
+        // Only the entry point and the functions it calls are used,
+        // so there is no point in generating code for everything else
+        // in the module (and the modules it imports).
+        interpreter.setLazyCodeGeneration(true);
+
+        // The function is specialized below if some of its parameters
+        // have the same value for every pixel, or if mkimage() ignores
+        // some of its outputs. Otherwise, the interpreter need not keep
+        // the syntax trees around after generating code.
+        bool may_specialize = last_operation;
+        for (sources_iter = ctl_sources.begin(); sources_iter != ctl_sources.end(); sources_iter++)
+        {
+            if (sources_iter->channel < 0 && !sources_iter->data->isVarying())
+            {
+                may_specialize = true;
+            }
+        }
+        interpreter.setFunctionSpecialization(may_specialize);
         interpreter.loadFile(ctl_operation.filename);
         try
         {
@@ -382,13 +294,54 @@ void run_ctl_transform(const ctl_operation_t &ctl_operation, CTLResults *ctl_res
             }
         } catch (...) {
             
-        }		
+        }
 
+		if (fn.refcount() == 0)
+		{
+			THROW(Iex::ArgExc, "CTL file '" << ctl_operation.filename << "' has neither a 'main' function nor one named '"
+					<< module << "'");
+		}
 		if (fn->returnValue()->type().cast<Ctl::VoidType>().refcount() == 0)
 		{
 			THROW(Iex::ArgExc, "CTL main (or <module_name>) function must return a 'void'");
 		}
 
+		// Parameters given on the command line (and the uniform outputs of
+		// the previous script) have the same value for every pixel. Bind
+		// them as constants so that the interpreter can fold them into a
+		// specialized copy of the function.
+		std::vector<Ctl::TypeStoragePtr> uniforms;
+		for (size_t i = 0; i < fn->numInputArgs(); i++)
+		{
+			arg = fn->inputArg(i);
+			for (sources_iter = ctl_sources.begin(); sources_iter != ctl_sources.end(); sources_iter++)
+			{
+				if (sources_iter->name == arg->name() && sources_iter->channel < 0 && !sources_iter->data->isVarying())
+				{
+					Ctl::TypeStoragePtr value = new Ctl::DataArg(sources_iter->name, sources_iter->data->type(), 1);
+					value->copy(sources_iter->data, 0, 0, 1);
+					uniforms.push_back(value);
+					break;
+				}
+			}
+		}
+
+		// The output arguments of the last transform that mkimage() does
+		// not save do not need to be computed.
+		std::vector<std::string> live_outputs;
+		for (size_t i = 0; i < fn->numOutputArgs(); i++)
+		{
+			if (!last_operation || is_image_channel_output(fn->outputArg(i)->name()))
+			{
+				live_outputs.push_back(fn->outputArg(i)->name());
+			}
+		}
+
+		if (!uniforms.empty() || live_outputs.size() != fn->numOutputArgs())
+		{
+			fn = interpreter.specializeFunctionCall(fn->name(), uniforms, live_outputs);
+		}
+
 		if (verbosity > 1)
 		{
 			fprintf(stderr, "   ctl script file: %s\n", ctl_operation.filename);
@@ -440,35 +393,6 @@ void run_ctl_transform(const ctl_operation_t &ctl_operation, CTLResults *ctl_res
 			}
 			fprintf(stderr, "\n");
 		}
-
-		//	fprintf(stderr, "%d samples to go.\n", count);
-
-		size_t offset = 0;
-		while (offset < count)
-		{
-			size_t pass = interpreter.maxSamples();
-			if (pass > (count - offset))
-			{
-				pass = (count - offset);
-			}
-//		fprintf(stderr, "at offset %d doing %d samples\n", offset, pass);
-			for (size_t i = 0; i < fn->numInputArgs(); i++)
-			{
-				arg = fn->inputArg(i);
-				set_ctl_function_argument_from_ctl_results(&arg, *ctl_results, offset, pass);
-			}
-
-			fn->callFunction(pass);
-
-			for (size_t i = 0; i < fn->numOutputArgs(); i++)
-			{
-				//printf("setting results from function argument\n");
-				set_ctl_results_from_ctl_function_argument(&new_ctl_results, fn->outputArg(i), offset, pass, count);
-			}
-
-			offset = offset + pass;
-		}
-		*ctl_results = new_ctl_results;
 	}
 	catch (...)
 	{
@@ -477,30 +401,18 @@ void run_ctl_transform(const ctl_operation_t &ctl_operation, CTLResults *ctl_res
 //		}
 		throw;
 	}
-}
-
-
-// Creates a new ctl result object from the image buffer (fb parameter) passed in
-// Copies a new CTL result (block of data) from the framebuffer fb.
-CTLResultPtr mkresult(const char *name, const char *alt_name, const ctl::dpx::fb<float> &fb, size_t offset)
-{
-	CTLResultPtr new_result = CTLResultPtr(new CTLResult());
-
-	// DataArg represents a raw block of data
-	// XXX - seems like last argument to Ctl::DataArg should be (fb.pixels() + offset) because the argument represents the data size (i.e. number of bytes)
-	new_result->data = Ctl::DataArgPtr(new Ctl::DataArg(name, Ctl::DataTypePtr(new Ctl::StdFloatType()), fb.pixels()));
-
-	if (alt_name != NULL)
-	{
-		new_result->alt_name = alt_name;
-	}
-
-	new_result->data->set(fb.ptr() + offset, sizeof(float) * fb.depth(), 0, fb.pixels());
 
-	return new_result;
+	return fn;
 }
 
-void mkimage(ctl::dpx::fb<float> *image_buffer, const CTLResults &ctl_results, format_t *image_format)
+// The number of bits of an image_channels() mask that stand for channels;
+// the bits above them hold the DPX colorimetric.
+static const uint8_t channel_bits = 24;
+
+// Picks the output arguments of the last CTL function that are saved in the
+// image. Returns the channels found (in the order they are saved in the
+// file) with the DPX colorimetric of the result in the top 8 bits.
+int image_channels(const Ctl::FunctionCallPtr &fn, uint64_t image_pixels, Ctl::FunctionArgPtr channels[channel_bits])
 {
 	enum have_channel_e
 	{
@@ -536,15 +448,11 @@ void mkimage(ctl::dpx::fb<float> *image_buffer, const CTLResults &ctl_results, f
 		have_none = 33,
 	};
 
-	CTLResults::const_iterator results_iter;
-	CTLResultPtr channels[16];
+	Ctl::FunctionArgPtr arg;
 	int channels_mask;
 	have_channel_e channel;
 	const char *channel_name;
-	uint8_t on_channel;
-	uint8_t channel_count;
 	uint8_t c;
-	CTLResultPtr ctl_result;
 
 	// These need to be in the order for preferred output formats...
 	// The DPX colorimetric is in the top 8 bits
@@ -572,15 +480,15 @@ void mkimage(ctl::dpx::fb<float> *image_buffer, const CTLResults &ctl_results, f
 	};
 
 	channels_mask = 0;
-	for (results_iter = ctl_results.begin(); results_iter != ctl_results.end(); results_iter++)
+	for (size_t i = 0; fn.refcount() != 0 && i < fn->numOutputArgs(); i++)
 	{
-		ctl_result = *results_iter;
-		if (!ctl_result->data->isVarying() && ctl_result->data->elements() != image_buffer->pixels())
+		arg = fn->outputArg(i);
+		if (!arg->isVarying() && image_pixels != 1)
 		{
 			continue;
 		}
 		channel = have_none;
-		channel_name = ctl_result->data->name().c_str();
+		channel_name = arg->name().c_str();
 		if (0)
 		{
 		}
@@ -616,12 +524,12 @@ void mkimage(ctl::dpx::fb<float> *image_buffer, const CTLResults &ctl_results, f
 			continue;
 		}
 
-		if (ctl_result->data->type().cast<Ctl::HalfType>().refcount() == 0
-				&& ctl_result->data->type().cast<Ctl::FloatType>().refcount() == 0)
+		if (arg->type().cast<Ctl::HalfType>().refcount() == 0
+				&& arg->type().cast<Ctl::FloatType>().refcount() == 0)
 		{
 			THROW(Iex::ArgExc, "CTL script not providing half or float as the output data type.");
 		}
-		channels[channel] = ctl_result;
+		channels[channel] = arg;
 		channels_mask = channels_mask | (1 << channel);
 	}
 
@@ -629,102 +537,938 @@ void mkimage(ctl::dpx::fb<float> *image_buffer, const CTLResults &ctl_results, f
 	{
 		if ((channels_mask & tests[c] & 0x00ffffff) == (tests[c] & 0x00ffffff))
 		{
-			channels_mask = tests[c];
-			break;
+			return tests[c];
 		}
 	}
 
-	if (tests[c] == 0)
+	THROW(Iex::ArgExc, "Unable to determine what channels from the CTL script output should be saved.");
+}
+
+// Makes the next call of dst read its values straight from the varying
+// output argument src of the function before it. Returns false if the
+// values have to be copied instead.
+bool bind_buffer(const Ctl::FunctionArgPtr &dst, const Ctl::TypeStoragePtr &src, size_t count)
+{
+	size_t stride = src->type()->alignedObjectSize();
+
+	switch (src->type()->cDataType())
 	{
-		THROW(Iex::ArgExc, "Unable to determine what channels from the CTL script output should be saved.");
+		case Ctl::FloatTypeEnum:
+			return dst->bindBuffer((float *) src->data(), stride, count);
+		case Ctl::HalfTypeEnum:
+			return dst->bindBuffer((half *) src->data(), stride, count);
+		default:
+			return FALSE;
 	}
+}
+
+// Runs the ctl operations over an image a strip of pixels at a time. The
+// scripts are loaded (and their functions specialized for the parameters
+// given on the command line) for the first strip, and the same function
+// calls are used for all of the strips after it.
+//
+// Each packet of pixels (as many as the interpreters take in one call)
+// goes through all of the functions while it is in the cache: the input
+// arguments of a function are bound, by name, to the output arguments of
+// the function before it (or to the channels of the strip for the first
+// function), and are copied straight from them (or, where the layout of
+// the values allows it, use them in place).
+class ctl_chain
+{
+public:
+	ctl_chain(const CTLOperations &ctl_operations, const CTLParameters &global_parameters);
+	~ctl_chain();
+
+	// Runs the ctl operations on the pixels in strip, and stores the
+	// channels of the result that are saved in result. image_pixels is the
+	// number of pixels in the whole image, first_pixel the index in the
+	// image of the first pixel of the strip.
+	void run(const ctl::dpx::fb<float> &strip, ctl::dpx::fb<float> *result, format_t *image_format,
+			 uint64_t image_pixels, uint64_t first_pixel);
+
+	// Loads the first function ahead of the first strip, and has the
+	// reader leave out the channels of the image that it does not read.
+	void select_channels(image_reader *reader, uint64_t image_pixels);
+
+	// TRUE once the first function has been loaded.
+	bool loaded() const;
+
+	// FALSE if a function was specialized for the value of a uniform
+	// input argument that is taken from the first pixel of the image.
+	bool image_independent() const;
+
+	// Seconds spent loading the functions so far.
+	double load_time() const { return load_seconds; }
 
-	channel_count = 0;
-	for (c = 0; c < 24; c++)
+	// Appends the files of the CTL modules loaded so far (the scripts and
+	// the modules they import) to files.
+	void module_files(std::vector<std::string> *files) const;
+
+private:
+	// Where an input argument of a function gets its value from.
+	struct binding_t
 	{
-		if (channels_mask & (1 << c))
+		Ctl::FunctionArgPtr arg;
+
+		// The channel of the strip, or -1 for data (or for the default
+		// value of the argument if data is NULL).
+		int channel;
+		Ctl::TypeStoragePtr data;
+	};
+
+	struct step_t
+	{
+		Ctl::SimdInterpreter interpreter;
+		Ctl::FunctionCallPtr fn;
+		std::vector<binding_t> bindings;
+	};
+
+	void load(size_t step, uint32_t depth, uint64_t image_pixels);
+	void bind(const step_t &step, const ctl::dpx::fb<float> &strip, size_t offset, size_t count,
+			  uint64_t pixel);
+	uint8_t prepare_result(const ctl::dpx::fb<float> &strip, ctl::dpx::fb<float> *result);
+
+	const CTLOperations &ctl_operations;
+	const CTLParameters &global_parameters;
+	std::vector<step_t *> steps;
+	Ctl::FunctionArgPtr channels[channel_bits];
+	int channels_mask;
+	size_t max_samples;
+	double load_seconds;
+};
+
+ctl_chain::ctl_chain(const CTLOperations &ctl_operations, const CTLParameters &global_parameters) :
+		ctl_operations(ctl_operations), global_parameters(global_parameters), channels_mask(0), max_samples(0),
+		load_seconds(0.0)
+{
+	for (size_t i = 0; i < ctl_operations.size(); i++)
+	{
+		steps.push_back(new step_t);
+		if (max_samples == 0 || steps[i]->interpreter.maxSamples() < max_samples)
 		{
-			channel_count++;
+			max_samples = steps[i]->interpreter.maxSamples();
 		}
 	}
-
-	if (image_buffer->depth() != channel_count)
+	if (max_samples == 0)
 	{
-		image_buffer->init(image_buffer->width(), image_buffer->height(), channel_count);
+		max_samples = 1;
 	}
+}
 
-	on_channel = 0;
-	for (c = 0; c < 24; c++)
+ctl_chain::~ctl_chain()
+{
+	for (size_t i = 0; i < steps.size(); i++)
 	{
-		if (channels_mask & (1 << c))
-		{
-			channels[c]->data->get(image_buffer->ptr() + on_channel, sizeof(float) * channel_count, 0, image_buffer->pixels());
-			on_channel++;
-		}
+		delete steps[i];
 	}
+}
 
-	if (image_format->descriptor == 0)
+void ctl_chain::module_files(std::vector<std::string> *files) const
+{
+	for (size_t i = 0; i < steps.size(); i++)
 	{
-		image_format->descriptor = (channels_mask & 0xff000000) >> 24;
+		std::vector<std::string> names = steps[i]->interpreter.moduleFileNames();
+		files->insert(files->end(), names.begin(), names.end());
 	}
 }
 
-// Currently we have no thread support. This would be nice but we will
-// deal with it on a per-input-file basis. The format is passed in as 
-// a pointer since there are fields in it that may be filled out by the
-// reader / writer and those will probably want to migrate back to the
-// calling function.
-void transform(const char *inputFile, const char *outputFile,
-		       float input_scale, float output_scale,
-		       format_t *image_format,
-               Compression *compression,
-		       const CTLOperations &ctl_operations,
-		       const CTLParameters &global_parameters)
+// Loads the function of a step and binds its input arguments. This is done
+// while the first packet of the image goes through the chain, after the
+// step before it has run (so that its uniform outputs have their values).
+// depth is the number of channels of the image.
+void ctl_chain::load(size_t step, uint32_t depth, uint64_t image_pixels)
 {
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
 	CTLOperations::const_iterator operations_iter;
-	ctl_operation_t ctl_operation;
 	CTLParameters::const_iterator parameters_iter;
-	uint8_t i;
-	std::string error;
-	ctl::dpx::fb<float> image_buffer;
+	CTLSources::const_iterator sources_iter;
+	CTLSources ctl_sources;
+	step_t *s = steps[step];
 
-	if (verbosity > 1)
+	if (step == 0)
 	{
-		fprintf(stdout, "       source file: %s\n", inputFile);
-		fprintf(stdout, "  destination file: %s\n", outputFile);
-		fprintf(stderr, "destination format: %s\n", image_format->ext);
-		fprintf(stderr, "       input scale: ");
-		if (input_scale == 0.0)
+		static const char *names[] = { "rIn", "gIn", "bIn", "aIn" };
+		char name[16];
+
+		for (uint8_t i = 0; i < depth; i++)
 		{
-			fprintf(stderr, "default\n");
+			memset(name, 0, sizeof(name));
+			snprintf(name, sizeof(name) - 1, "c%02dIn", i);
+
+			ctl_source_t ctl_source;
+			ctl_source.channel = i;
+			if (i < 4)
+			{
+				ctl_source.name = names[i];
+				ctl_source.alt_name = name;
+			}
+			else
+			{
+				ctl_source.name = name;
+			}
+			ctl_sources.push_back(ctl_source);
 		}
-		else
+	}
+	else
+	{
+		const Ctl::FunctionCallPtr &previous = steps[step - 1]->fn;
+		for (size_t i = 0; i < previous->numOutputArgs(); i++)
 		{
-			fprintf(stderr, "%f\n", input_scale);
+			add_output_to_ctl_sources(&ctl_sources, previous->outputArg(i));
 		}
-		fprintf(stderr, "      output scale: ");
-		if (output_scale == 0.0)
+	}
+
+	operations_iter = ctl_operations.begin();
+	std::advance(operations_iter, step);
+
+	for (parameters_iter = global_parameters.begin(); parameters_iter != global_parameters.end(); parameters_iter++)
+	{
+		add_parameter_value_to_ctl_sources(&ctl_sources, *parameters_iter);
+	}
+	for (parameters_iter = operations_iter->local.begin(); parameters_iter != operations_iter->local.end(); parameters_iter++)
+	{
+		add_parameter_value_to_ctl_sources(&ctl_sources, *parameters_iter);
+	}
+
+	s->fn = load_ctl_function(s->interpreter, *operations_iter, ctl_sources, step + 1 == steps.size());
+
+	for (size_t i = 0; i < s->fn->numInputArgs(); i++)
+	{
+		binding_t binding;
+		binding.arg = s->fn->inputArg(i);
+		binding.channel = -1;
+
+		for (sources_iter = ctl_sources.begin(); sources_iter != ctl_sources.end(); sources_iter++)
 		{
-			fprintf(stderr, "default\n");
+			if (sources_iter->name == binding.arg->name() || sources_iter->alt_name == binding.arg->name())
+			{
+				break;
+			}
 		}
-		else
+
+		if (sources_iter != ctl_sources.end())
 		{
-			fprintf(stderr, "%f\n", output_scale);
+			binding.channel = sources_iter->channel;
+			binding.data = sources_iter->data;
 		}
-		if (verbosity > 2)
+		else if (!binding.arg->hasDefaultValue())
 		{
-			i = 0;
-			for (parameters_iter = global_parameters.begin(); parameters_iter != global_parameters.end(); parameters_iter++)
-			{
-				if (i == 0)
-				{
-					fprintf(stderr, " global parameters:\n");
-					i++;
-				}
-				fprintf(stderr, "%18s:", parameters_iter->name);
-				for (i = 0; i < parameters_iter->count; i++)
-				{
-					fprintf(stderr, " %f", parameters_iter->value[i]);
+			THROW(Iex::ArgExc, "CTL parameter '" << binding.arg->name() << "' not specified on the command line and does not have a default value.");
+		}
+		s->bindings.push_back(binding);
+	}
+
+	if (step + 1 == steps.size())
+	{
+		channels_mask = image_channels(s->fn, image_pixels, channels);
+	}
+
+	gettimeofday(&end, NULL);
+	load_seconds += (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+void ctl_chain::select_channels(image_reader *reader, uint64_t image_pixels)
+{
+	uint32_t mask = 0;
+	size_t i;
+
+	if (steps.empty() || reader->depth() > 32)
+	{
+		return;
+	}
+
+	load(0, reader->depth(), image_pixels);
+
+	std::vector<binding_t> &bindings = steps[0]->bindings;
+	for (i = 0; i < bindings.size(); i++)
+	{
+		if (bindings[i].channel >= 0)
+		{
+			mask = mask | ((uint32_t) 1 << bindings[i].channel);
+		}
+	}
+
+	// A function that reads none of the channels still gets strips with
+	// the right number of pixels.
+	if (mask == 0 || mask == (uint32_t) (((uint64_t) 1 << reader->depth()) - 1) ||
+		!reader->select_channels(mask))
+	{
+		return;
+	}
+
+	// The channels are renumbered to their places in the smaller strips.
+	for (i = 0; i < bindings.size(); i++)
+	{
+		if (bindings[i].channel >= 0)
+		{
+			bindings[i].channel = selected_channels(mask & (((uint32_t) 1 << bindings[i].channel) - 1));
+		}
+	}
+}
+
+bool ctl_chain::loaded() const
+{
+	return !steps.empty() && steps[0]->fn.refcount() != 0;
+}
+
+bool ctl_chain::image_independent() const
+{
+	for (size_t step = 0; step < steps.size(); step++)
+	{
+		const std::vector<binding_t> &bindings = steps[step]->bindings;
+		for (size_t i = 0; i < bindings.size(); i++)
+		{
+			if (!bindings[i].arg->isVarying() &&
+				(bindings[i].channel >= 0 || (bindings[i].data.refcount() != 0 && bindings[i].data->isVarying())))
+			{
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+// Sets the input arguments of a step for count pixels from offset in the
+// strip. pixel is the index in the image of the first of them; arguments
+// that are not varying get the value for the first pixel of the image.
+void ctl_chain::bind(const step_t &step, const ctl::dpx::fb<float> &strip, size_t offset, size_t count,
+		             uint64_t pixel)
+{
+	for (size_t i = 0; i < step.bindings.size(); i++)
+	{
+		const binding_t &binding = step.bindings[i];
+		const Ctl::FunctionArgPtr &dst = binding.arg;
+
+		if (binding.channel >= 0)
+		{
+			// The function only reads its input arguments, so the strip
+			// can be used in place (if it has a single channel).
+			float *base = const_cast<float *>(strip.ptr()) + offset * strip.depth() + binding.channel;
+			if (dst->isVarying())
+			{
+				if (!dst->bindBuffer(base, sizeof(float) * strip.depth(), count))
+				{
+					dst->set(base, sizeof(float) * strip.depth(), 0, count);
+				}
+			}
+			else if (pixel == 0)
+			{
+				dst->set(base, sizeof(float) * strip.depth(), 0, 1);
+			}
+		}
+		else if (binding.data.refcount() == 0)
+		{
+			dst->setDefaultValue();
+		}
+		else if (!dst->isVarying())
+		{
+			if (pixel == 0)
+			{
+				dst->copy(binding.data, 0, 0, 1);
+			}
+		}
+		else if (!binding.data->isVarying())
+		{
+			for (size_t j = 0; j < count; j++)
+			{
+				dst->copy(binding.data, 0, j, 1);
+			}
+		}
+		else if (!bind_buffer(dst, binding.data, count))
+		{
+			dst->copy(binding.data, 0, 0, count);
+		}
+	}
+}
+
+void ctl_chain::run(const ctl::dpx::fb<float> &strip, ctl::dpx::fb<float> *result, format_t *image_format,
+		            uint64_t image_pixels, uint64_t first_pixel)
+{
+	uint8_t channel_count = 0;
+	uint8_t on_channel;
+	uint8_t c;
+	bool bound[channel_bits] = {};
+
+	size_t offset = 0;
+	while (offset < strip.pixels())
+	{
+		size_t pass = max_samples;
+		if (pass > (strip.pixels() - offset))
+		{
+			pass = (strip.pixels() - offset);
+		}
+
+		for (size_t step = 0; step < steps.size(); step++)
+		{
+			if (steps[step]->fn.refcount() == 0)
+			{
+				load(step, strip.depth(), image_pixels);
+			}
+			bind(*steps[step], strip, offset, pass, first_pixel + offset);
+
+			if (step + 1 == steps.size())
+			{
+				channel_count = prepare_result(strip, result);
+
+				// The outputs that are saved go straight into the result
+				// where its layout allows it (if it has a single channel).
+				on_channel = 0;
+				for (c = 0; c < channel_bits; c++)
+				{
+					if (channels_mask & (1 << c))
+					{
+						bound[c] = channels[c]->bindBuffer(result->ptr() + offset * channel_count + on_channel,
+								                           sizeof(float) * channel_count, pass);
+						on_channel++;
+					}
+				}
+			}
+			steps[step]->fn->callFunction(pass);
+		}
+
+		if (steps.empty())
+		{
+			// Without ctl operations there is nothing to save.
+			image_channels(Ctl::FunctionCallPtr(), image_pixels, channels);
+		}
+
+		on_channel = 0;
+		for (c = 0; c < channel_bits; c++)
+		{
+			if (channels_mask & (1 << c))
+			{
+				if (!bound[c])
+				{
+					channels[c]->get(result->ptr() + offset * channel_count + on_channel,
+							         sizeof(float) * channel_count, 0, pass);
+				}
+				on_channel++;
+			}
+		}
+
+		offset = offset + pass;
+	}
+
+	if (image_format->descriptor == 0)
+	{
+		image_format->descriptor = (channels_mask & 0xff000000) >> 24;
+	}
+}
+
+// Makes result the size of strip, with a channel for each output that is
+// saved. Returns the number of channels.
+uint8_t ctl_chain::prepare_result(const ctl::dpx::fb<float> &strip, ctl::dpx::fb<float> *result)
+{
+	uint8_t channel_count = 0;
+
+	for (uint8_t c = 0; c < channel_bits; c++)
+	{
+		if (channels_mask & (1 << c))
+		{
+			channel_count++;
+		}
+	}
+
+	if (result->width() != strip.width() || result->height() != strip.height() || result->depth() != channel_count)
+	{
+		result->init(strip.width(), strip.height(), channel_count);
+	}
+	return channel_count;
+}
+
+// Evaluates the ctl operations for the samples of a baked lookup table.
+class ctl_lut_source: public Ctl::LutSource
+{
+public:
+	ctl_lut_source(const CTLOperations &ctl_operations, const CTLParameters &global_parameters) :
+			descriptor(0), chain(ctl_operations, global_parameters)
+	{
+	}
+
+	virtual void evaluate(size_t n, const float in[], float out[])
+	{
+		ctl::dpx::fb<float> samples;
+		ctl::dpx::fb<float> buffer;
+		format_t format;
+
+		samples.init(n, 1, 3);
+		memcpy(samples.ptr(), in, sizeof(float) * 3 * n);
+
+		chain.run(samples, &buffer, &format, samples.pixels(), 0);
+
+		if (buffer.depth() != 3)
+		{
+			THROW(Iex::ArgExc, "the CTL scripts produce " << buffer.depth() << " channels, only "
+					"transforms from rIn, gIn and bIn to rOut, gOut and bOut can be baked.");
+		}
+		memcpy(out, buffer.ptr(), sizeof(float) * 3 * n);
+		descriptor = format.descriptor;
+	}
+
+	// The DPX descriptor of the channels the ctl operations produce.
+	uint8_t descriptor;
+
+private:
+	ctl_chain chain;
+};
+
+baked_transform::baked_transform(const bake_options_t &bake, const CTLOperations &ops,
+		                         const CTLParameters &global) :
+		bake(bake), ops(ops), global(global), table(NULL), rejected(FALSE), table_descriptor(0)
+{
+}
+
+baked_transform::~baked_transform()
+{
+	delete table;
+}
+
+uint8_t baked_transform::descriptor() const
+{
+	return table_descriptor;
+}
+
+const Ctl::BakedLut *baked_transform::lut(const image_reader *reader)
+{
+	// Files with an alpha channel (which the table ignores) still go
+	// through the interpreter.
+	if (bake.dimensions == 0 || reader->depth() != 3)
+	{
+		return NULL;
+	}
+
+	if (table != NULL || rejected)
+	{
+		return table;
+	}
+
+	Ctl::BakedLut::Type type = bake.dimensions == 1 ? Ctl::BakedLut::LUT_1D : Ctl::BakedLut::LUT_3D;
+	int size = bake.size;
+	if (size == 0)
+	{
+		size = bake.dimensions == 1 ? 4096 : 33;
+	}
+
+	Ctl::BakedLut *new_lut = new Ctl::BakedLut(type, size,
+			bake.log2_shaper ? Ctl::BakedLut::SHAPER_LOG2 : Ctl::BakedLut::SHAPER_LINEAR,
+			bake.domain_min, bake.domain_max);
+	ctl_lut_source source(ops, global);
+
+	try
+	{
+		new_lut->bake(source);
+		new_lut->validate(source, bake.samples);
+	}
+	catch (const Iex::ArgExc &e)
+	{
+		if (verbosity > 0)
+		{
+			fprintf(stderr, "unable to bake a lookup table (%s), using the CTL interpreter.\n", e.what());
+		}
+		delete new_lut;
+		rejected = TRUE;
+		return NULL;
+	}
+
+	if (verbosity > 1)
+	{
+		fprintf(stderr, "baked %dD lookup table with %d entries per dimension:\n", bake.dimensions, size);
+		fprintf(stderr, "         max error: %g\n", new_lut->maxError());
+		fprintf(stderr, "        mean error: %g\n\n", new_lut->meanError());
+	}
+
+	if (!(new_lut->maxError() <= bake.tolerance))
+	{
+		if (verbosity > 0)
+		{
+			fprintf(stderr, "the error of the baked lookup table (%g) exceeds the tolerance (%g), "
+					"using the CTL interpreter.\n", new_lut->maxError(), bake.tolerance);
+		}
+		delete new_lut;
+		rejected = TRUE;
+		return NULL;
+	}
+
+	table = new_lut;
+	table_descriptor = source.descriptor;
+	return table;
+}
+
+// Images are processed in strips of about this many pixels (unless the
+// number of rows is given with -strip_rows).
+static const uint32_t default_strip_pixels = 1 << 18;
+
+// Creates the output file in the requested format.
+image_writer *create_image(const char *outputFile, float output_scale,
+		                   uint32_t width, uint32_t height, uint32_t depth,
+		                   format_t *image_format, Compression *compression)
+{
+	image_writer *writer;
+
+//    std::cout << image_format->ext << std::endl;
+	if (!strncmp(image_format->ext, "aces", 3))
+	{
+		writer = aces_create(outputFile, output_scale, width, height, depth, image_format);
+	}
+	else if (!strncmp(image_format->ext, "exr", 3))
+	{
+		writer = exr_create(outputFile, output_scale, width, height, depth, image_format, compression);
+	}
+	else if (!strncmp(image_format->ext, "adx", 3))
+	{
+		writer = dpx_create(outputFile, output_scale, width, height, depth, image_format);
+	}
+	else if (!strncmp(image_format->ext, "dpx", 3))
+	{
+		writer = dpx_create(outputFile, output_scale, width, height, depth, image_format);
+	}
+	else if (!strncmp(image_format->ext, "tiff", 3))
+	{
+		writer = tiff_create(outputFile, output_scale, width, height, depth, image_format);
+	}
+	else if (!strncmp(image_format->ext, "raw", 3))
+	{
+		writer = raw_create(outputFile, output_scale, width, height, depth, image_format);
+	}
+	else
+	{
+		fprintf(stderr, "unable to write a %s file (unknown format).\n", image_format->ext);
+		exit(1);
+	}
+
+	if (writer == NULL)
+	{
+		fprintf(stderr, "unable to write a %s file (not supported by this build).\n", image_format->ext);
+		exit(1);
+	}
+	return writer;
+}
+
+// The number of rows in each strip of the image of reader.
+static uint32_t strip_rows_for(const image_reader *reader, uint32_t strip_rows)
+{
+	if (strip_rows == 0)
+	{
+		strip_rows = default_strip_pixels / (reader->width() > 0 ? reader->width() : 1);
+	}
+	if (strip_rows == 0)
+	{
+		strip_rows = 1;
+	}
+	return strip_rows;
+}
+
+// Replaces the pixels of strip with the results of lut. The table clamps
+// its input to its domain, so the pixels with a value outside of it (or
+// NaN) go through the ctl operations of chain instead. done_pixels counts
+// the pixels that have been through chain so far.
+static void apply_lut(const Ctl::BakedLut &lut, ctl_chain &chain, ctl::dpx::fb<float> *strip,
+		              format_t *image_format, uint64_t image_pixels, uint64_t *done_pixels)
+{
+	std::vector<size_t> outside;
+	float *pixels = strip->ptr();
+
+	for (size_t i = 0; i < strip->pixels(); i++)
+	{
+		for (uint8_t c = 0; c < 3; c++)
+		{
+			float v = pixels[i * 3 + c];
+			if (!(v >= lut.domainMin() && v <= lut.domainMax()))
+			{
+				outside.push_back(i);
+				break;
+			}
+		}
+	}
+
+	ctl::dpx::fb<float> outside_pixels;
+	ctl::dpx::fb<float> outside_results;
+	if (!outside.empty())
+	{
+		outside_pixels.init(outside.size(), 1, 3);
+		for (size_t i = 0; i < outside.size(); i++)
+		{
+			memcpy(outside_pixels.ptr() + i * 3, pixels + outside[i] * 3, sizeof(float) * 3);
+		}
+	}
+
+	lut.apply(strip->pixels(), pixels, 3, pixels, 3);
+
+	if (!outside.empty())
+	{
+		chain.run(outside_pixels, &outside_results, image_format, image_pixels, *done_pixels);
+		*done_pixels = *done_pixels + outside.size();
+		for (size_t i = 0; i < outside.size(); i++)
+		{
+			memcpy(pixels + outside[i] * 3, outside_results.ptr() + i * 3, sizeof(float) * 3);
+		}
+	}
+}
+
+// Sends the image of reader through the ctl operations of chain (or the
+// baked lookup table) and into the output file.
+static void transform_strips(ctl_chain &chain, const baked_transform *baked, const Ctl::BakedLut *lut,
+		                     image_reader *reader,
+		                     const char *outputFile, float output_scale, format_t *image_format,
+		                     Compression *compression, uint32_t strip_rows)
+{
+	ctl::dpx::fb<float> image_buffer;
+	ctl::dpx::fb<float> result_buffer;
+
+	// The image goes through a strip of rows at a time; only the strip
+	// being worked on (and the result made from it) is in memory.
+	uint64_t image_pixels = (uint64_t) reader->width() * reader->height();
+	strip_rows = strip_rows_for(reader, strip_rows);
+
+	image_writer *writer = NULL;
+	uint32_t first_row;
+	uint64_t lut_fallback_pixels = 0;
+
+	if (lut == NULL && !chain.loaded())
+	{
+		chain.select_channels(reader, image_pixels);
+	}
+
+	try
+	{
+		for (first_row = 0; first_row < reader->height(); first_row += strip_rows)
+		{
+			uint32_t rows = strip_rows;
+			if (rows > reader->height() - first_row)
+			{
+				rows = reader->height() - first_row;
+			}
+
+			reader->read(first_row, rows, &image_buffer);
+
+			ctl::dpx::fb<float> *strip = &image_buffer;
+			if (lut != NULL)
+			{
+				apply_lut(*lut, chain, &image_buffer, image_format, image_pixels, &lut_fallback_pixels);
+				if (image_format->descriptor == 0)
+				{
+					image_format->descriptor = baked->descriptor();
+				}
+			}
+			else
+			{
+				chain.run(image_buffer, &result_buffer, image_format, image_pixels, (uint64_t) first_row * reader->width());
+				strip = &result_buffer;
+			}
+
+			if (image_format->squish)
+			{
+				strip->swizzle(0, TRUE);
+			}
+
+			// The channels that are saved are only known once the ctl
+			// operations have run on the first strip.
+			if (writer == NULL)
+			{
+				writer = create_image(outputFile, output_scale, reader->width(), reader->height(),
+						              strip->depth(), image_format, compression);
+			}
+			writer->write(*strip);
+		}
+	}
+	catch (...)
+	{
+		delete writer;
+		throw;
+	}
+
+	if (writer != NULL)
+	{
+		writer->close();
+		delete writer;
+	}
+}
+
+// Copies the image of reader, a strip at a time, into writer, without the
+// alpha channel if squish is set.
+static void copy_strips(image_reader *reader, image_writer *writer, uint32_t strip_rows, bool squish)
+{
+	ctl::dpx::fb<float> strip;
+	uint32_t first_row;
+
+	strip_rows = strip_rows_for(reader, strip_rows);
+	for (first_row = 0; first_row < reader->height(); first_row += strip_rows)
+	{
+		uint32_t rows = strip_rows;
+		if (rows > reader->height() - first_row)
+		{
+			rows = reader->height() - first_row;
+		}
+
+		reader->read(first_row, rows, &strip);
+		if (squish)
+		{
+			strip.swizzle(0, TRUE);
+		}
+		writer->write(strip);
+	}
+	writer->close();
+}
+
+// Has the ctld daemon listening on daemon_socket run the ctl operations.
+// The image goes there, and the result comes back, in shared memory
+// segments holding raw frames. Returns FALSE if there is no daemon.
+static bool transform_remote(const char *daemon_socket, image_reader *reader, const char *outputFile,
+		                     float output_scale, format_t *image_format, Compression *compression,
+		                     const CTLOperations &ctl_operations, const CTLParameters &global_parameters,
+		                     uint32_t strip_rows)
+{
+	static unsigned int requests = 0;
+	int fd = ctld_connect(daemon_socket);
+	if (fd < 0)
+	{
+		if (verbosity > 0)
+		{
+			fprintf(stderr, "no ctld daemon at %s, running the CTL scripts here.\n", daemon_socket);
+		}
+		return FALSE;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "shm:/ctlrender-%d-%u", (int) getpid(), requests++);
+	std::string input = std::string(name) + "-in";
+	std::string output = std::string(name) + "-out";
+	image_writer *writer = NULL;
+	image_reader *result = NULL;
+
+	try
+	{
+		format_t raw_format("raw", 32);
+		writer = raw_create(input.c_str(), 0.0, reader->width(), reader->height(), reader->depth(), &raw_format);
+		copy_strips(reader, writer, strip_rows, FALSE);
+		delete writer;
+		writer = NULL;
+
+		ctld_message message;
+		message.put_u32(CTLD_MAGIC);
+		message.put_u32(ctld_transform_request);
+		message.put_string(input);
+		message.put_string(output);
+		message.put_u32(strip_rows);
+		ctld_put_module_paths(&message, Ctl::Interpreter::modulePaths());
+		ctld_put_operations(&message, ctl_operations, global_parameters);
+
+		if (!message.send(fd) || !message.receive(fd))
+		{
+			THROW(Iex::IoExc, "the ctld daemon at " << daemon_socket << " went away.");
+		}
+		uint32_t status = message.get_u32();
+		std::string error = message.get_string();
+		uint32_t descriptor = message.get_u32();
+		uint32_t warm = message.get_u32();
+		double load_ms = message.get_double();
+		double run_ms = message.get_double();
+		double total_ms = message.get_double();
+		if (status != 0)
+		{
+			THROW(Iex::ArgExc, error);
+		}
+		if (verbosity > 1)
+		{
+			fprintf(stderr, "ctld: %s, %.1f ms loading, %.1f ms transforming, %.1f ms in all\n",
+					warm ? "warm" : "cold", load_ms, run_ms, total_ms);
+		}
+
+		format_t result_format;
+		result = raw_open(output.c_str(), 0.0, &result_format);
+		if (image_format->descriptor == 0)
+		{
+			image_format->descriptor = descriptor;
+		}
+		uint32_t depth = result->depth();
+		if (image_format->squish && (depth == 2 || depth == 4))
+		{
+			depth--;
+		}
+		writer = create_image(outputFile, output_scale, result->width(), result->height(), depth, image_format,
+				              compression);
+		copy_strips(result, writer, strip_rows, image_format->squish);
+	}
+	catch (...)
+	{
+		delete writer;
+		delete result;
+		raw_remove(input.c_str());
+		raw_remove(output.c_str());
+		close(fd);
+		throw;
+	}
+
+	delete writer;
+	delete result;
+	raw_remove(input.c_str());
+	raw_remove(output.c_str());
+	close(fd);
+	return TRUE;
+}
+
+// Currently we have no thread support. This would be nice but we will
+// deal with it on a per-input-file basis. The format is passed in as 
+// a pointer since there are fields in it that may be filled out by the
+// reader / writer and those will probably want to migrate back to the
+// calling function.
+void transform(const char *inputFile, const char *outputFile,
+		       float input_scale, float output_scale,
+		       format_t *image_format,
+               Compression *compression,
+		       const CTLOperations &ctl_operations,
+		       const CTLParameters &global_parameters,
+		       baked_transform *baked,
+		       uint32_t strip_rows,
+		       const char *daemon_socket)
+{
+	CTLOperations::const_iterator operations_iter;
+	ctl_operation_t ctl_operation;
+	CTLParameters::const_iterator parameters_iter;
+	uint8_t i;
+	std::string error;
+	ctl::dpx::fb<float> image_buffer;
+	ctl::dpx::fb<float> result_buffer;
+
+	if (verbosity > 1)
+	{
+		fprintf(stderr, "       source file: %s\n", inputFile);
+		fprintf(stderr, "  destination file: %s\n", outputFile);
+		fprintf(stderr, "destination format: %s\n", image_format->ext);
+		fprintf(stderr, "       input scale: ");
+		if (input_scale == 0.0)
+		{
+			fprintf(stderr, "default\n");
+		}
+		else
+		{
+			fprintf(stderr, "%f\n", input_scale);
+		}
+		fprintf(stderr, "      output scale: ");
+		if (output_scale == 0.0)
+		{
+			fprintf(stderr, "default\n");
+		}
+		else
+		{
+			fprintf(stderr, "%f\n", output_scale);
+		}
+		if (verbosity > 2)
+		{
+			i = 0;
+			for (parameters_iter = global_parameters.begin(); parameters_iter != global_parameters.end(); parameters_iter++)
+			{
+				if (i == 0)
+				{
+					fprintf(stderr, " global parameters:\n");
+					i++;
+				}
+				fprintf(stderr, "%18s:", parameters_iter->name);
+				for (i = 0; i < parameters_iter->count; i++)
+				{
+					fprintf(stderr, " %f", parameters_iter->value[i]);
 				}
 				fprintf(stderr, "\n");
 			}
@@ -755,9 +1499,20 @@ void transform(const char *inputFile, const char *outputFile,
 		fprintf(stderr, "\n");
 	}
 
-	if (!dpx_read(inputFile, input_scale, &image_buffer, image_format) &&
-		!exr_read(inputFile, input_scale, &image_buffer, image_format) &&
-		!tiff_read(inputFile, input_scale, &image_buffer, image_format))
+	image_reader *reader = raw_open(inputFile, input_scale, image_format);
+	if (reader == NULL)
+	{
+		reader = dpx_open(inputFile, input_scale, image_format);
+	}
+	if (reader == NULL)
+	{
+		reader = exr_open(inputFile, input_scale, image_format);
+	}
+	if (reader == NULL)
+	{
+		reader = tiff_open(inputFile, input_scale, image_format);
+	}
+	if (reader == NULL)
 	{
 		fprintf(stderr, "unable to read file %s (unknown format).\n", inputFile);
 		exit(1);
@@ -772,87 +1527,74 @@ void transform(const char *inputFile, const char *outputFile,
 		image_format->bps = image_format->src_bps;
 	}
 
-	CTLResults ctl_results;
-
-	if (image_buffer.depth() > 0)
+	const Ctl::BakedLut *lut = NULL;
+	if (baked != NULL)
 	{
-		ctl_results.push_back(mkresult("rIn", "c00In", image_buffer, 0));
+		lut = baked->lut(reader);
 	}
-	if (image_buffer.depth() > 1)
+
+	if (lut == NULL && daemon_socket != NULL &&
+		transform_remote(daemon_socket, reader, outputFile, output_scale, image_format, compression, ctl_operations,
+				         global_parameters, strip_rows))
 	{
-		ctl_results.push_back(mkresult("gIn", "c01In", image_buffer, 1));
+		delete reader;
+		return;
 	}
-	if (image_buffer.depth() > 2)
+
+	try
 	{
-		ctl_results.push_back(mkresult("bIn", "c02In", image_buffer, 2));
+		ctl_chain chain(ctl_operations, global_parameters);
+		transform_strips(chain, baked, lut, reader, outputFile, output_scale, image_format, compression, strip_rows);
 	}
-	if (image_buffer.depth() > 3)
+	catch (...)
 	{
-		ctl_results.push_back(mkresult("aIn", "c03In", image_buffer, 3));
+		delete reader;
+		throw;
 	}
+	delete reader;
+}
 
-	char name[16];
+loaded_transform::loaded_transform(const CTLOperations &ops, const CTLParameters &global) :
+		chain(new ctl_chain(ops, global)), used(FALSE), depth(0), single_pixel(FALSE)
+{
+}
 
-	for (i = 4; i < image_buffer.depth(); i++)
-	{
-		memset(name, 0, sizeof(name));
-		snprintf(name, sizeof(name) - 1, "c%02dIn", i);
-		ctl_results.push_back(mkresult(name, NULL, image_buffer, i));
-	}
+loaded_transform::~loaded_transform()
+{
+	delete chain;
+}
 
-	for (operations_iter = ctl_operations.begin(); operations_iter != ctl_operations.end(); operations_iter++)
+void loaded_transform::run(image_reader *reader, const char *outputFile, float output_scale, format_t *format,
+		                   Compression *compression, uint32_t strip_rows)
+{
+	if (format->bps == 0)
 	{
-		ctl_operation = *operations_iter;
-		for (parameters_iter = global_parameters.begin(); parameters_iter != global_parameters.end(); parameters_iter++)
-		{
-			add_parameter_value_to_ctl_results(&ctl_results, *parameters_iter);
-		}
-		for (parameters_iter = ctl_operation.local.begin(); parameters_iter != ctl_operation.local.end(); parameters_iter++)
-		{
-			add_parameter_value_to_ctl_results(&ctl_results, *parameters_iter);
-		}
-
-		// Output is used to pass output parameters from script to the next.
-		run_ctl_transform(*operations_iter, &ctl_results, image_buffer.pixels());
+		format->bps = format->src_bps;
 	}
+	used = TRUE;
+	depth = reader->depth();
+	single_pixel = (uint64_t) reader->width() * reader->height() == 1;
+	transform_strips(*chain, NULL, NULL, reader, outputFile, output_scale, format, compression, strip_rows);
+}
 
-	mkimage(&image_buffer, ctl_results, image_format);
-
-	if (output_scale != 0.0)
-	{
-		output_scale = output_scale / 1.0;
-	}
-	if (image_format->squish)
+bool loaded_transform::reusable(const image_reader *reader) const
+{
+	if (!used)
 	{
-		image_buffer.swizzle(0, TRUE);
+		return TRUE;
 	}
+	return reader->depth() == depth && ((uint64_t) reader->width() * reader->height() == 1) == single_pixel &&
+			chain->image_independent();
+}
 
-//    std::cout << image_format->ext << std::endl;
-  if (!strncmp(image_format->ext, "aces", 3))
-  {
-      aces_write(outputFile, output_scale,
-                 image_buffer.width(), image_buffer.height(), image_buffer.depth(),
-                 image_buffer.ptr(), image_format);
-  }
-  else if (!strncmp(image_format->ext, "exr", 3))
-	{
-		exr_write(outputFile, output_scale, image_buffer, image_format, compression);
-	}
-	else if (!strncmp(image_format->ext, "adx", 3))
-	{
-		dpx_write(outputFile, output_scale, image_buffer, image_format);
-	}
-	else if (!strncmp(image_format->ext, "dpx", 3))
-	{
-		dpx_write(outputFile, output_scale, image_buffer, image_format);
-	}
-	else if (!strncmp(image_format->ext, "tiff", 3))
-	{
-		tiff_write(outputFile, output_scale, image_buffer, image_format);
-	}
-	else
-	{
-		fprintf(stderr, "unable to write a %s file (unknown format).\n", image_format->ext);
-		exit(1);
-	}
+double loaded_transform::load_time() const
+{
+	return chain->load_time();
+}
+
+std::vector<std::string> loaded_transform::module_files() const
+{
+	std::vector<std::string> files;
+	chain->module_files(&files);
+	return files;
 }
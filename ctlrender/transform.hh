@@ -56,6 +56,8 @@
 #define CTLRENDER_TRANSFORM_INCLUDE
 
 #include <list>
+#include <string>
+#include <vector>
 #include <cstring>
 #include "main.hh"
 
@@ -92,10 +94,114 @@ struct ctl_operation_t
 
 typedef std::list<ctl_operation_t> CTLOperations;
 
+// structure to capture the options for replacing the CTL operations with
+// a baked lookup table (see '-help bake').
+struct bake_options_t
+{
+	bake_options_t()
+	{
+		dimensions = 0;
+		size = 0;
+		log2_shaper = false;
+		domain_min = 0.0;
+		domain_max = 1.0;
+		tolerance = 0.0005;
+		samples = 10000;
+	}
+
+	uint8_t dimensions; // 0 (do not bake), 1 or 3
+	int size;           // entries per dimension, 0 for the default
+	bool log2_shaper;
+	float domain_min;
+	float domain_max;
+	float tolerance;    // largest acceptable absolute error
+	size_t samples;     // number of random samples to validate the table
+};
+
+namespace Ctl
+{
+class BakedLut;
+}
+
+class image_reader;
+class ctl_chain;
+
+// The lookup table baked for the ctl operations of a job. Every file of
+// the job goes through the same operations, so the table is baked (and
+// validated) once, for the first file that can use it, and kept for the
+// others. The options, operations and parameters must outlive it.
+class baked_transform
+{
+public:
+	baked_transform(const bake_options_t &bake, const CTLOperations &ops, const CTLParameters &global);
+	~baked_transform();
+
+	// The table to use in place of the ctl operations for the image of
+	// reader, or NULL if the image must go through the operations: no
+	// table was asked for, it is not accurate enough, or the image has
+	// an alpha channel. Pixels with values outside of the domain of the
+	// table still go through the operations.
+	const Ctl::BakedLut *lut(const image_reader *reader);
+
+	// The DPX descriptor of the results of the table.
+	uint8_t descriptor() const;
+
+private:
+	const bake_options_t &bake;
+	const CTLOperations &ops;
+	const CTLParameters &global;
+	Ctl::BakedLut *table;
+	bool rejected;
+	uint8_t table_descriptor;
+};
+
+// Transforms one image file (or one frame of a stream). If baked is given,
+// its lookup table is used in place of the ctl operations where it can be.
+// If daemon_socket is given, the ctl operations are run by the ctld
+// daemon listening on it (see ctld.hh); the image is run locally if there
+// is no daemon there.
 void transform(const char *inputFile, const char *outputFile,
 		       float input_scale, float output_scale,
 		       format_t *format,
                Compression *compression,
-		       const CTLOperations &ops, const CTLParameters &global);
+		       const CTLOperations &ops, const CTLParameters &global,
+		       baked_transform *baked,
+		       uint32_t strip_rows,
+		       const char *daemon_socket = NULL);
+
+// The ctl operations of a job, loaded once and kept so that any number of
+// images can go through them without the scripts being loaded and
+// compiled again (this is what ctld does). The operations and parameters
+// must outlive it.
+class loaded_transform
+{
+public:
+	loaded_transform(const CTLOperations &ops, const CTLParameters &global);
+	~loaded_transform();
+
+	// Transforms the image of reader into outputFile, like transform().
+	void run(image_reader *reader, const char *outputFile, float output_scale,
+			 format_t *format, Compression *compression, uint32_t strip_rows);
+
+	// FALSE if the functions loaded for the images before can not be used
+	// for the image of reader: it has a different number of channels, or
+	// they were specialized for a value of the first pixel of the image
+	// (a uniform input argument bound to a channel or to a varying output).
+	bool reusable(const image_reader *reader) const;
+
+	// Seconds spent loading the CTL functions, which is only done by the
+	// first run (and by none if the functions were reusable).
+	double load_time() const;
+
+	// The files of the CTL modules loaded for the images run so far: the
+	// scripts, and the modules they import.
+	std::vector<std::string> module_files() const;
+
+private:
+	ctl_chain *chain;
+	bool used;
+	uint32_t depth;
+	bool single_pixel;
+};
 
 #endif
@@ -108,8 +108,60 @@ void usage(const char *section) {
 "    -param2 ...           Details on this and similar options are provided\n"
 "    -param3 ...           with '-help param'\n"
 "\n"
+"    -bake <1d|3d>         Replaces the CTL scripts with a lookup table\n"
+"                          sampled from them, if the lookup table is\n"
+"                          accurate enough. Details on this and the related\n"
+"                          '-bake_...' options are provided with '-help bake'\n"
+"\n"
+"    -threads <n>          Number of worker threads used to read and write\n"
+"                          images. Defaults to one per processor, 0 does\n"
+"                          everything in the main thread.\n"
+"\n"
+"    -strip_rows <n>       Number of image rows read, transformed and written\n"
+"                          at a time. Only a few strips are held in memory, so\n"
+"                          the memory used does not grow with the image size.\n"
+"                          Defaults to 0, which picks strips of about 256K\n"
+"                          pixels.\n"
+"\n"
+"    -dither <type>        Dithers the samples of DPX and TIFF files with\n"
+"                          16 or fewer bits per sample, so that smooth\n"
+"                          gradients do not band: 'ordered' (an 8x8 Bayer\n"
+"                          matrix), 'bluenoise' (a 64x64 blue noise mask)\n"
+"                          or 'none' (the default).\n"
+"\n"
+"    -daemon <socket>      Has the ctld daemon listening on the Unix domain\n"
+"                          socket run the CTL scripts, so that they are\n"
+"                          loaded once for a sequence of images instead of\n"
+"                          for each image. Defaults to $CTLD_SOCKET if that\n"
+"                          is set; '-nodaemon' runs them here regardless.\n"
+"                          Details are provided with '-help daemon'.\n"
+"\n"
 "    -verbose              Increases the level of output verbosity.\n"
 "    -quiet                Decreases the level of output verbosity.\n"
+"");
+	} else if(!strncmp(section, "daemon", 1)) {
+		fprintf(stdout, ""
+"ctld daemon:\n"
+"\n"
+"    Loading a CTL script compiles it, which can take longer than running\n"
+"    it on an image. ctld keeps the scripts of the jobs it has run loaded:\n"
+"\n"
+"        ctld -socket /tmp/ctld.sock &\n"
+"        ctlrender -daemon /tmp/ctld.sock -ctl a.ctl in.0001.dpx out.0001.dpx\n"
+"        ctlrender -daemon /tmp/ctld.sock -ctl a.ctl in.0002.dpx out.0002.dpx\n"
+"\n"
+"    ctlrender still reads and writes the files; the pixels are passed to\n"
+"    the daemon in shared memory. The same scripts (with the same\n"
+"    parameters and module path) are only loaded again if one of the files\n"
+"    has changed, or if a script takes a uniform input from the first pixel\n"
+"    of the image. If no daemon listens on the socket the scripts are run by\n"
+"    ctlrender itself. Baked lookup tables ('-bake') are always applied by\n"
+"    ctlrender.\n"
+"\n"
+"    With two '-verbose' options ctlrender prints whether the loaded scripts\n"
+"    were used and how long the daemon took. 'ctld -stats' prints the\n"
+"    latencies of the requests served so far, 'ctld -quit' stops it, and\n"
+"    'ctld -help' lists the other options.\n"
 "");
 	} else if(!strncmp(section, "format", 1)) {
 		fprintf(stdout, ""
@@ -146,6 +198,27 @@ void usage(const char *section) {
 "\n"
 "        aces    Produces an aces compliant exr file\n"
 "\n"
+"        raw16   Produces a raw frame of interleaved half samples\n"
+"\n"
+"        raw32   Produces a raw frame of interleaved float samples\n"
+"\n"
+"        raw16p  Produces a raw frame of half samples, one plane per channel\n"
+"\n"
+"        raw32p  Produces a raw frame of float samples, one plane per channel\n"
+"\n"
+"        raw     Produces a raw frame of half samples for half sources,\n"
+"                and of float samples for all others\n"
+"\n"
+"    A raw frame is a 16 byte header (the characters 'CTLR', the width and\n"
+"    height as 32 bit integers, the number of channels as a 16 bit integer,\n"
+"    8 bit integers for the bits per sample (16 or 32) and for planar (1)\n"
+"    or interleaved (0) samples, all in the byte order of the machine)\n"
+"    followed by the samples, without any encoding. Raw frames are read\n"
+"    and written from and to files, from and to stdin and stdout if the\n"
+"    file name is '-' (every frame on stdin goes through in turn), and from\n"
+"    and to POSIX shared memory segments named 'shm:<name>', which hold\n"
+"    one frame.\n"
+"\n"
 "    When only one source file is specified with a destination file name,\n"
 "    the extension is interpreted the same way as an argument to '-format',\n"
 "    and will not be changed.\n"
@@ -200,6 +273,52 @@ void usage(const char *section) {
 "    meaningful. Please see build documentation for details.\n"
 "");
 #endif
+	} else if(!strncmp(section, "bake", 1)) {
+		fprintf(stdout, ""
+"lookup table baking:\n"
+"\n"
+"    For inputs with a limited range, such as 8, 10 or 12-bit DPX or TIFF\n"
+"    files, the CTL scripts can be sampled once into a lookup table, which is\n"
+"    then used for every pixel instead of running the scripts. This is much\n"
+"    faster, but only approximates the scripts. The table is baked from the\n"
+"    CTL scripts and parameters for the first source file, and compared to\n"
+"    the CTL scripts on a set of random input values. If the largest error is\n"
+"    above the tolerance the table is discarded and the CTL scripts are run\n"
+"    as usual.\n"
+"\n"
+"    Only scripts that produce 'rOut', 'gOut' and 'bOut' from 'rIn', 'gIn'\n"
+"    and 'bIn' can be baked. Source files with an alpha channel are always\n"
+"    processed with the CTL scripts, and so are the pixels with a value\n"
+"    outside of the domain of the table.\n"
+"\n"
+"        -bake 1d                  Bakes a 1D table per channel, sampled\n"
+"                                  along the neutral axis. This is only\n"
+"                                  accurate for scripts that process every\n"
+"                                  channel independently.\n"
+"\n"
+"        -bake 3d                  Bakes a 3D table, interpolated\n"
+"                                  trilinearly.\n"
+"\n"
+"        -bake_size <n>            Number of entries per dimension. The\n"
+"                                  default is 4096 for 1D tables and 33 for\n"
+"                                  3D tables. A 1D table with 1024 entries is\n"
+"                                  exact for every code value of a 10-bit\n"
+"                                  file.\n"
+"\n"
+"        -bake_shaper <shaper>     How input values are distributed over the\n"
+"                                  entries: 'linear' (the default), or\n"
+"                                  'log2' for scene-linear input.\n"
+"\n"
+"        -bake_domain <min> <max>  Range of input values covered by the\n"
+"                                  table. The default is 0 to 1, the range\n"
+"                                  of integer source files with the default\n"
+"                                  input scale. The minimum must be greater\n"
+"                                  than 0 for the 'log2' shaper.\n"
+"\n"
+"        -bake_tolerance <value>   Largest acceptable difference between the\n"
+"                                  table and the CTL scripts. The default is\n"
+"                                  0.0005.\n"
+"");
 	} else if(!strncmp(section, "ctl", 1)) {
 		fprintf(stdout, ""
 "ctl file interpretation:\n"
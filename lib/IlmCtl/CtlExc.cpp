@@ -57,6 +57,7 @@
 #include <stdio.h>
 #include <alloca.h>
 #include <string.h>
+#include <sstream>
 
 namespace Ctl {
 
@@ -67,7 +68,7 @@ void CtlExc::_explain(const char *text, va_list _ap) {
 	va_list ap;
 
 	if(text==NULL) {
-		operator=("no explanation given.");
+		text="no explanation given.";
 	}
 	while(1) {
 		va_copy(ap, _ap);
@@ -84,7 +85,12 @@ void CtlExc::_explain(const char *text, va_list _ap) {
 		}
 	}
 
-	operator=(ptr);
+	// Note: a plain operator=(ptr) would resolve to the implicit
+	// CtlExc::operator=, constructing a new CtlExc from ptr (which
+	// calls _explain() again, and so on).
+	std::stringstream s;
+	s << ptr;
+	assign(s);
 }
 
 CtlExc::CtlExc(const char *format, ...) throw() {
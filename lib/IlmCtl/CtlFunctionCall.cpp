@@ -140,9 +140,35 @@ FunctionArg::FunctionArg
     // empty
 }
 
+
 FunctionArg::~FunctionArg ()
 {
     // empty
 }
 
+
+bool
+FunctionArg::bindBuffer (half *base, size_t stride, size_t count)
+{
+    return bindBufferInternal ((char *) base, HalfTypeEnum, stride, count);
+}
+
+
+bool
+FunctionArg::bindBuffer (float *base, size_t stride, size_t count)
+{
+    return bindBufferInternal ((char *) base, FloatTypeEnum, stride, count);
+}
+
+
+bool
+FunctionArg::bindBufferInternal
+    (char *base,
+     CDataType_e baseType,
+     size_t stride,
+     size_t count)
+{
+    return false;
+}
+
 } // namespace Ctl
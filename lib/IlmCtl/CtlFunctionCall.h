@@ -229,6 +229,46 @@ class FunctionArg: public TypeStorage {
     virtual bool		hasDefaultValue () = 0;
     virtual void		setDefaultValue () = 0;
 
+
+    //----------------------------------------------------------------
+    // bindBuffer() lets the next call to the function use a buffer
+    // owned by the application for the argument's values, in place
+    // of the argument's own buffer: sample i is at base + i * stride
+    // bytes, and the buffer holds count samples.  The function reads
+    // the values of an input argument from, and stores the values of
+    // an output argument in, the application's buffer; nothing is
+    // copied.  The binding ends when callFunction() returns (or
+    // throws); callFunction() must not be asked for more than count
+    // samples.
+    //
+    // bindBuffer() returns false, and leaves the argument unchanged,
+    // if the buffer cannot be used in place, for example because the
+    // argument is uniform, or because the type or the layout of the
+    // buffer differs from the interpreter's.  The application must
+    // then copy the values with set() or get(), as usual.
+    //----------------------------------------------------------------
+
+    bool			bindBuffer (half *base,
+					    size_t stride,
+					    size_t count);
+
+    bool			bindBuffer (float *base,
+					    size_t stride,
+					    size_t count);
+
+  protected:
+
+    //----------------------------------------------------------------
+    // Binds a buffer of samples of type baseType; see bindBuffer().
+    // Interpreters that cannot use external buffers keep this default
+    // implementation, which returns false.
+    //----------------------------------------------------------------
+
+    virtual bool		bindBufferInternal (char *base,
+						    CDataType_e baseType,
+						    size_t stride,
+						    size_t count);
+
   private:
     FunctionCall*		_func;
     bool                _varying;
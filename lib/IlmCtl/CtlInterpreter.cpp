@@ -66,6 +66,7 @@
 #include <CtlSymbolTable.h>
 #include <CtlParser.h>
 #include <CtlExc.h>
+#include <CtlStdType.h>
 #include <IlmThreadMutex.h>
 #include <Iex.h>
 #include <fstream>
@@ -460,12 +461,20 @@ Interpreter::moduleIsLoadedInternal (const std::string &moduleName) const
 }
 
 
-
-FunctionCallPtr
-Interpreter::newFunctionCall (const std::string &functionName)
+vector<string>
+Interpreter::moduleFileNames () const
 {
     Lock lock (_data->mutex);
-    
+    vector<string> fileNames;
+    _data->moduleSet.fileNames (fileNames);
+    return fileNames;
+}
+
+
+
+SymbolInfoPtr
+Interpreter::lookupFunction (const std::string &functionName)
+{
     //
     // Calling a CTL function with variable-size array arguments
     // from C++ is not supported.
@@ -503,7 +512,145 @@ Interpreter::newFunctionCall (const std::string &functionName)
             }
         }
     }
-    
+
+    return info;
+}
+
+
+FunctionCallPtr
+Interpreter::newFunctionCall (const std::string &functionName)
+{
+    Lock lock (_data->mutex);
+    return newFunctionCallInternal (lookupFunction (functionName), functionName);
+}
+
+
+FunctionCallPtr
+Interpreter::specializeFunctionCall
+    (const std::string &functionName,
+     const std::vector<TypeStoragePtr> &uniforms)
+{
+    Lock lock (_data->mutex);
+    return specializeFunctionCallLocked (functionName, uniforms, 0);
+}
+
+
+FunctionCallPtr
+Interpreter::specializeFunctionCall
+    (const std::string &functionName,
+     const std::vector<TypeStoragePtr> &uniforms,
+     const std::vector<std::string> &liveOutputs)
+{
+    Lock lock (_data->mutex);
+    return specializeFunctionCallLocked (functionName, uniforms, &liveOutputs);
+}
+
+
+FunctionCallPtr
+Interpreter::specializeFunctionCallLocked
+    (const std::string &functionName,
+     const std::vector<TypeStoragePtr> &uniforms,
+     const std::vector<std::string> *liveOutputs)
+{
+    const SymbolInfoPtr info = lookupFunction (functionName);
+    const FunctionTypePtr fType = info->type();
+    const ParamVector &parameters = fType->parameters();
+
+    //
+    // Convert each bound value to the type of the
+    // corresponding parameter.
+    //
+
+    vector<TypeStoragePtr> bound (parameters.size());
+
+    for (size_t i = 0; i < uniforms.size(); ++i)
+    {
+	const TypeStoragePtr &src = uniforms[i];
+	size_t j = 0;
+
+	while (j < parameters.size() && parameters[j].name != src->name())
+	    ++j;
+
+	if (j >= parameters.size() || parameters[j].isWritable())
+	    THROW (ArgExc, "CTL function " << functionName << " has no "
+			   "input parameter called " << src->name() << ".");
+
+	if (src->isVarying())
+	    THROW (ArgExc, "Cannot bind parameter " << src->name() << " of "
+			   "CTL function " << functionName << " to a "
+			   "varying value.");
+
+	bound[j] = new DataArg (src->name(), parameters[j].type, 1);
+	bound[j]->copy (src, 0, 0, 1);
+    }
+
+    //
+    // Find the output parameters that the caller does not read.
+    //
+
+    vector<bool> live (parameters.size(), true);
+
+    if (liveOutputs)
+    {
+	for (size_t j = 0; j < parameters.size(); ++j)
+	{
+	    if (parameters[j].isWritable())
+	    {
+		live[j] = find (liveOutputs->begin(), liveOutputs->end(),
+				parameters[j].name) != liveOutputs->end();
+	    }
+	}
+
+	for (size_t i = 0; i < liveOutputs->size(); ++i)
+	{
+	    size_t j = 0;
+
+	    while (j < parameters.size() &&
+		   parameters[j].name != (*liveOutputs)[i])
+	    {
+		++j;
+	    }
+
+	    if (j >= parameters.size() || !parameters[j].isWritable())
+		THROW (ArgExc, "CTL function " << functionName << " has no "
+			       "output parameter called " <<
+			       (*liveOutputs)[i] << ".");
+	}
+    }
+
+    FunctionCallPtr call =
+	specializeFunctionCallInternal (info, functionName, bound, live);
+
+    //
+    // Even if the function was specialized, the caller can still
+    // see the bound input arguments; set them to the bound values.
+    //
+
+    for (size_t i = 0; i < call->numInputArgs(); ++i)
+    {
+	FunctionArgPtr arg = call->inputArg (i);
+
+	for (size_t j = 0; j < parameters.size(); ++j)
+	{
+	    if (bound[j] && parameters[j].name == arg->name())
+	    {
+		arg->setVarying (false);
+		arg->copy (bound[j], 0, 0, 1);
+	    }
+	}
+    }
+
+    return call;
+}
+
+
+FunctionCallPtr
+Interpreter::specializeFunctionCallInternal
+    (const SymbolInfoPtr info,
+     const std::string &functionName,
+     const std::vector<TypeStoragePtr> &uniforms,
+     const std::vector<bool> &liveParameters)
+{
     return newFunctionCallInternal (info, functionName);
 }
 
@@ -100,6 +100,15 @@ class Interpreter
 	void        loadFile(const std::string &fileName,
 	                     const std::string &moduleName=std::string());
     bool		moduleIsLoaded (const std::string &moduleName) const;
+
+
+    //-----------------------------------------------------------
+    // The names of the files that the loaded modules were read
+    // from, including the modules they import (directly or not);
+    // for example, to tell if a module has changed since loading
+    //-----------------------------------------------------------
+
+    std::vector<std::string>	moduleFileNames () const;
     
     void setUserModulePath(const std::vector<std::string> path, const bool set);
 
@@ -111,6 +120,41 @@ class Interpreter
    FunctionCallPtr	newFunctionCall (const std::string &functionName);
 
 
+    //---------------------------------------------------------------------
+    // Create a function call object for a specialized copy of a CTL
+    // function:
+    //
+    // specializeFunctionCall(name,uniforms) binds some of the function's
+    // input parameters to fixed values.  Each element of uniforms must be
+    // uniform (not varying), and its name must match the name of one of
+    // the function's input parameters.  The interpreter may substitute
+    // the values for the parameters in the function's body, fold the
+    // resulting constant expressions and remove code that can no longer
+    // be reached, so that the returned function call executes fewer
+    // instructions per data sample than one returned by newFunctionCall().
+    //
+    // The input arguments of the returned function call that correspond
+    // to bound parameters are set to the bound values; changing them has
+    // no effect.  Specializations are cached; specializing a function
+    // twice with the same values reuses the code generated the first time.
+    //
+    // specializeFunctionCall(name,uniforms,liveOutputs) additionally
+    // tells the interpreter that the caller reads only the output
+    // arguments whose names are listed in liveOutputs.  Computations
+    // that feed only the other output arguments may be skipped; after
+    // the call, the values of those arguments are undefined.
+    //---------------------------------------------------------------------
+
+    FunctionCallPtr	specializeFunctionCall
+			    (const std::string &functionName,
+			     const std::vector<TypeStoragePtr> &uniforms);
+
+    FunctionCallPtr	specializeFunctionCall
+			    (const std::string &functionName,
+			     const std::vector<TypeStoragePtr> &uniforms,
+			     const std::vector<std::string> &liveOutputs);
+
+
     //----------------------------------------------------------
     // Get the maximum number of data samples a function call
     // can process in parallel.  Varying arguments to a function
@@ -179,10 +223,34 @@ class Interpreter
     bool			moduleIsLoadedInternal
 				    (const std::string &moduleName) const;
 
+    SymbolInfoPtr		lookupFunction
+				    (const std::string &functionName);
+
+    FunctionCallPtr		specializeFunctionCallLocked
+				    (const std::string &functionName,
+				     const std::vector<TypeStoragePtr> &uniforms,
+				     const std::vector<std::string> *liveOutputs);
+
     virtual FunctionCallPtr	newFunctionCallInternal 
                                     (const SymbolInfoPtr info,
                                      const std::string &functionName) = 0;
 
+    //------------------------------------------------------------------
+    // specializeFunctionCallInternal(info,name,uniforms) creates a call
+    // for a copy of the function with some parameters bound to fixed
+    // values; uniforms[i] is either 0 or the value of the i-th parameter,
+    // converted to the parameter's type.  If liveParameters[i] is false,
+    // the caller does not read output parameter i.  The default
+    // implementation does not specialize the function; it returns an
+    // ordinary call.
+    //------------------------------------------------------------------
+
+    virtual FunctionCallPtr	specializeFunctionCallInternal
+				    (const SymbolInfoPtr info,
+				     const std::string &functionName,
+				     const std::vector<TypeStoragePtr> &uniforms,
+				     const std::vector<bool> &liveParameters);
+
     virtual Module *		newModule
 				    (const std::string &moduleName,
 				     const std::string &fileName) = 0;
@@ -109,4 +109,17 @@ ModuleSet::containsModule (const string &name) const
 }
 
 
+void
+ModuleSet::fileNames (vector<string> &fileNames) const
+{
+    for (ModuleMap::const_iterator i = _modules.begin();
+	 i != _modules.end();
+	 ++i)
+    {
+	if (!i->second->fileName().empty())
+	    fileNames.push_back (i->second->fileName());
+    }
+}
+
+
 } // namespace Ctl
@@ -64,6 +64,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace Ctl {
 
@@ -104,6 +105,14 @@ class ModuleSet
 
     bool	containsModule (const std::string &name) const;
 
+
+    //----------------------------------------------------------------
+    // Append the names of the files that the modules in the set were
+    // read from to fileNames; modules without a file name are skipped
+    //----------------------------------------------------------------
+
+    void	fileNames (std::vector<std::string> &fileNames) const;
+
   private:
     
     struct Compare
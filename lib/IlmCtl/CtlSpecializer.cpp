@@ -0,0 +1,872 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+//-----------------------------------------------------------------------------
+//
+//	class Specializer
+//
+//-----------------------------------------------------------------------------
+
+#include <CtlSpecializer.h>
+#include <CtlSymbolTable.h>
+#include <CtlLContext.h>
+#include <CtlAddr.h>
+#include <cassert>
+#include <set>
+
+using namespace std;
+
+namespace Ctl {
+namespace {
+
+typedef std::set <const Addr *> AddrSet;
+
+
+const Addr *
+addrOf (const NameNodePtr &name)
+{
+    if (name && name->info && name->info->addr())
+	return name->info->addr().pointer();
+
+    return 0;
+}
+
+
+NameNodePtr
+lhsVariable (const ExprNodePtr &lhs)
+{
+    //
+    // Find the variable that is modified by an assignment
+    // to lhs, which may be an array element or a struct member.
+    //
+
+    if (ArrayIndexNodePtr index = lhs.cast<ArrayIndexNode>())
+	return lhsVariable (index->array);
+
+    if (MemberNodePtr member = lhs.cast<MemberNode>())
+	return lhsVariable (member->obj);
+
+    return lhs.cast<NameNode>();
+}
+
+
+void
+collectReads (const ExprNodePtr &expr, AddrSet &reads)
+{
+    if (!expr)
+	return;
+
+    if (BinaryOpNodePtr binOp = expr.cast<BinaryOpNode>())
+    {
+	collectReads (binOp->leftOperand, reads);
+	collectReads (binOp->rightOperand, reads);
+    }
+    else if (UnaryOpNodePtr unOp = expr.cast<UnaryOpNode>())
+    {
+	collectReads (unOp->operand, reads);
+    }
+    else if (ArrayIndexNodePtr index = expr.cast<ArrayIndexNode>())
+    {
+	collectReads (index->array, reads);
+	collectReads (index->index, reads);
+    }
+    else if (MemberNodePtr member = expr.cast<MemberNode>())
+    {
+	collectReads (member->obj, reads);
+    }
+    else if (SizeNodePtr size = expr.cast<SizeNode>())
+    {
+	collectReads (size->obj, reads);
+    }
+    else if (NameNodePtr name = expr.cast<NameNode>())
+    {
+	if (const Addr *addr = addrOf (name))
+	    reads.insert (addr);
+    }
+    else if (CallNodePtr call = expr.cast<CallNode>())
+    {
+	//
+	// Arguments that are passed to output parameters are
+	// counted as reads, too.  This is conservative, but it
+	// keeps the variables' declarations and earlier stores.
+	//
+
+	for (int i = 0; i < (int)call->arguments.size(); ++i)
+	    collectReads (call->arguments[i], reads);
+    }
+    else if (ValueNodePtr value = expr.cast<ValueNode>())
+    {
+	for (int i = 0; i < (int)value->elements.size(); ++i)
+	    collectReads (value->elements[i], reads);
+    }
+}
+
+
+void
+collectLhsReads (const ExprNodePtr &lhs, AddrSet &reads)
+{
+    //
+    // An assignment to an array element reads the element's index.
+    //
+
+    if (ArrayIndexNodePtr index = lhs.cast<ArrayIndexNode>())
+    {
+	collectLhsReads (index->array, reads);
+	collectReads (index->index, reads);
+    }
+    else if (MemberNodePtr member = lhs.cast<MemberNode>())
+    {
+	collectLhsReads (member->obj, reads);
+    }
+}
+
+
+void
+collectReads (const StatementNodePtr &statements,
+	      AddrSet &reads,
+	      AddrSet &locals)
+{
+    for (StatementNodePtr node = statements; node; node = node->next)
+    {
+	if (VariableNodePtr var = node.cast<VariableNode>())
+	{
+	    if (var->info && var->info->addr())
+		locals.insert (var->info->addr().pointer());
+
+	    collectReads (var->initialValue, reads);
+	}
+	else if (AssignmentNodePtr assignment = node.cast<AssignmentNode>())
+	{
+	    collectLhsReads (assignment->lhs, reads);
+	    collectReads (assignment->rhs, reads);
+	}
+	else if (ExprStatementNodePtr statement =
+		     node.cast<ExprStatementNode>())
+	{
+	    collectReads (statement->expr, reads);
+	}
+	else if (IfNodePtr ifNode = node.cast<IfNode>())
+	{
+	    collectReads (ifNode->condition, reads);
+	    collectReads (ifNode->truePath, reads, locals);
+	    collectReads (ifNode->falsePath, reads, locals);
+	}
+	else if (ReturnNodePtr ret = node.cast<ReturnNode>())
+	{
+	    collectReads (ret->returnedValue, reads);
+	}
+	else if (WhileNodePtr loop = node.cast<WhileNode>())
+	{
+	    collectReads (loop->condition, reads);
+	    collectReads (loop->loopBody, reads, locals);
+	}
+    }
+}
+
+
+} // namespace
+
+
+
+Specializer::Specializer (LContext &lcontext):
+    _lcontext (lcontext)
+{
+    // empty
+}
+
+
+Specializer::~Specializer ()
+{
+    // empty
+}
+
+
+bool
+Specializer::isCFunction (const SymbolInfoPtr &) const
+{
+    return false;
+}
+
+
+FunctionNodePtr
+Specializer::functionDefinition (const SymbolInfoPtr &) const
+{
+    return 0;
+}
+
+
+void
+Specializer::bindConstant (const AddrPtr &addr, const ExprNodePtr &value)
+{
+    assert (addr && value);
+    _constants[addr.pointer()] = value;
+}
+
+
+StatementNodePtr
+Specializer::specialize (const StatementNodePtr &statements)
+{
+    StatementNodePtr first = 0;
+    StatementNodePtr last = 0;
+
+    for (StatementNodePtr node = statements; node; node = node->next)
+    {
+	StatementNodePtr copy = specializeStatement (node);
+
+	if (!copy)
+	    continue;
+
+	if (last)
+	    last->next = copy;
+	else
+	    first = copy;
+
+	last = copy;
+
+	while (last->next)
+	    last = last->next;
+
+	//
+	// Statements that follow a return statement are unreachable.
+	//
+
+	if (last.cast<ReturnNode>())
+	    break;
+    }
+
+    return first;
+}
+
+
+void
+Specializer::discardStores (const AddrPtr &addr)
+{
+    assert (addr);
+    _discarded.insert (addr.pointer());
+}
+
+
+StatementNodePtr
+Specializer::eliminateDeadStores (const StatementNodePtr &statements)
+{
+    //
+    // Removing a store can make the variables it reads dead,
+    // so we repeat until nothing changes.
+    //
+
+    StatementNodePtr result = statements;
+    bool changed = true;
+
+    while (changed)
+    {
+	AddrSet reads;
+	AddrSet candidates = _discarded;
+	collectReads (result, reads, candidates);
+
+	changed = false;
+	result = removeDeadStores (result, candidates, reads, changed);
+    }
+
+    return result;
+}
+
+
+StatementNodePtr
+Specializer::removeDeadStores
+    (const StatementNodePtr &statements,
+     const AddrSet &candidates,
+     const AddrSet &reads,
+     bool &changed)
+{
+    StatementNodePtr first = 0;
+    StatementNodePtr last = 0;
+    StatementNodePtr node = statements;
+
+    while (node)
+    {
+	StatementNodePtr next = node->next;
+	bool keep = true;
+
+	if (VariableNodePtr var = node.cast<VariableNode>())
+	{
+	    const Addr *addr = var->info? var->info->addr().pointer(): 0;
+
+	    if (var->initialValue &&
+		candidates.count (addr) && !reads.count (addr) &&
+		!hasSideEffects (var->initialValue))
+	    {
+		var->initialValue = 0;
+		var->assignInitialValue = false;
+		changed = true;
+	    }
+	}
+	else if (AssignmentNodePtr assignment = node.cast<AssignmentNode>())
+	{
+	    const Addr *addr = addrOf (lhsVariable (assignment->lhs));
+
+	    if (addr && candidates.count (addr) && !reads.count (addr) &&
+		!hasSideEffects (assignment->lhs) &&
+		!hasSideEffects (assignment->rhs))
+	    {
+		keep = false;
+	    }
+	}
+	else if (ExprStatementNodePtr statement =
+		     node.cast<ExprStatementNode>())
+	{
+	    keep = hasSideEffects (statement->expr);
+	}
+	else if (IfNodePtr ifNode = node.cast<IfNode>())
+	{
+	    ifNode->truePath = removeDeadStores
+		(ifNode->truePath, candidates, reads, changed);
+
+	    ifNode->falsePath = removeDeadStores
+		(ifNode->falsePath, candidates, reads, changed);
+
+	    keep = ifNode->truePath || ifNode->falsePath ||
+		   hasSideEffects (ifNode->condition);
+	}
+	else if (WhileNodePtr loop = node.cast<WhileNode>())
+	{
+	    //
+	    // Loops are never removed; an empty loop with
+	    // a condition that is always true does not terminate.
+	    //
+
+	    loop->loopBody = removeDeadStores
+		(loop->loopBody, candidates, reads, changed);
+	}
+
+	if (keep)
+	{
+	    if (last)
+		last->next = node;
+	    else
+		first = node;
+
+	    last = node;
+	}
+	else
+	{
+	    changed = true;
+	}
+
+	node = next;
+    }
+
+    if (last)
+	last->next = 0;
+
+    return first;
+}
+
+
+StatementNodePtr
+Specializer::specializeStatement (const StatementNodePtr &node)
+{
+    if (VariableNodePtr var = node.cast<VariableNode>())
+    {
+	ExprNodePtr initialValue = 0;
+
+	if (var->initialValue)
+	    initialValue = specializeExpr (var->initialValue);
+
+	//
+	// If the variable is a local constant, and its initial value
+	// is now a literal, replace references to the variable with
+	// the literal.
+	//
+
+	if (initialValue &&
+	    initialValue.cast<LiteralNode>() &&
+	    var->assignInitialValue &&
+	    !var->info->isWritable() &&
+	    var->info->addr())
+	{
+	    DataTypePtr varType = var->info->dataType();
+	    ExprNodePtr value = initialValue;
+
+	    if (varType && !varType->isSameTypeAs (value->type))
+		value = varType->castValue (_lcontext, value);
+
+	    if (varType && value.cast<LiteralNode>() &&
+		varType->isSameTypeAs (value->type))
+	    {
+		bindConstant (var->info->addr(), value);
+	    }
+	}
+
+	return _lcontext.newVariableNode (var->lineNumber,
+					  var->name,
+					  var->info,
+					  initialValue,
+					  var->assignInitialValue);
+    }
+
+    if (AssignmentNodePtr assignment = node.cast<AssignmentNode>())
+    {
+	return _lcontext.newAssignmentNode (assignment->lineNumber,
+					    specializeExpr (assignment->lhs),
+					    specializeExpr (assignment->rhs));
+    }
+
+    if (ExprStatementNodePtr statement = node.cast<ExprStatementNode>())
+    {
+	return _lcontext.newExprStatementNode (statement->lineNumber,
+					       specializeExpr (statement->expr));
+    }
+
+    if (IfNodePtr ifNode = node.cast<IfNode>())
+    {
+	ExprNodePtr condition = specializeExpr (ifNode->condition);
+
+	if (BoolLiteralNodePtr literal = condition.cast<BoolLiteralNode>())
+	{
+	    //
+	    // Only one of the two paths can ever be taken.
+	    //
+
+	    return specialize (literal->value? ifNode->truePath:
+					       ifNode->falsePath);
+	}
+
+	return _lcontext.newIfNode (ifNode->lineNumber,
+				    condition,
+				    specialize (ifNode->truePath),
+				    specialize (ifNode->falsePath));
+    }
+
+    if (ReturnNodePtr ret = node.cast<ReturnNode>())
+    {
+	ExprNodePtr returnedValue = 0;
+
+	if (ret->returnedValue)
+	    returnedValue = specializeExpr (ret->returnedValue);
+
+	return _lcontext.newReturnNode (ret->lineNumber,
+					ret->info,
+					returnedValue);
+    }
+
+    if (WhileNodePtr loop = node.cast<WhileNode>())
+    {
+	ExprNodePtr condition = specializeExpr (loop->condition);
+
+	if (BoolLiteralNodePtr literal = condition.cast<BoolLiteralNode>())
+	{
+	    if (!literal->value)
+		return 0;
+	}
+
+	return _lcontext.newWhileNode (loop->lineNumber,
+				       condition,
+				       specialize (loop->loopBody));
+    }
+
+    assert (false);
+    return 0;
+}
+
+
+ExprNodePtr
+Specializer::specializeExpr (const ExprNodePtr &node)
+{
+    //
+    // Each copied node gets the type information that the parser
+    // computed for the original node; after its operands have been
+    // specialized, the node is folded with evaluate().
+    //
+
+    if (BinaryOpNodePtr binOp = node.cast<BinaryOpNode>())
+    {
+	ExprNodePtr leftOperand = specializeExpr (binOp->leftOperand);
+
+	if (binOp->op == TK_AND || binOp->op == TK_OR)
+	{
+	    BoolLiteralNodePtr left = leftOperand.cast<BoolLiteralNode>();
+
+	    if (left && left->value == (binOp->op == TK_OR))
+	    {
+		//
+		// false && x is false; true || x is true.
+		// x is never evaluated.
+		//
+
+		return _lcontext.newBoolLiteralNode (binOp->lineNumber,
+						     left->value);
+	    }
+
+	    if (left)
+	    {
+		//
+		// true && x and false || x are both equal to x.
+		//
+
+		ExprNodePtr rightOperand =
+		    specializeExpr (binOp->rightOperand);
+
+		if (rightOperand->type && binOp->type &&
+		    binOp->type->isSameTypeAs (rightOperand->type))
+		{
+		    return rightOperand;
+		}
+	    }
+	}
+
+	BinaryOpNodePtr copy =
+	    _lcontext.newBinaryOpNode (binOp->lineNumber,
+				       binOp->op,
+				       leftOperand,
+				       specializeExpr (binOp->rightOperand));
+
+	copy->type = binOp->type;
+	copy->operandType = binOp->operandType;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (UnaryOpNodePtr unOp = node.cast<UnaryOpNode>())
+    {
+	UnaryOpNodePtr copy =
+	    _lcontext.newUnaryOpNode (unOp->lineNumber,
+				      unOp->op,
+				      specializeExpr (unOp->operand));
+
+	copy->type = unOp->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (ArrayIndexNodePtr index = node.cast<ArrayIndexNode>())
+    {
+	ArrayIndexNodePtr copy =
+	    _lcontext.newArrayIndexNode (index->lineNumber,
+					 specializeExpr (index->array),
+					 specializeExpr (index->index));
+
+	copy->type = index->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (MemberNodePtr member = node.cast<MemberNode>())
+    {
+	MemberNodePtr copy =
+	    _lcontext.newMemberNode (member->lineNumber,
+				     specializeExpr (member->obj),
+				     member->member);
+
+	copy->type = member->type;
+	copy->offset = member->offset;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (SizeNodePtr size = node.cast<SizeNode>())
+    {
+	SizeNodePtr copy =
+	    _lcontext.newSizeNode (size->lineNumber,
+				   specializeExpr (size->obj));
+
+	copy->type = size->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (NameNodePtr name = node.cast<NameNode>())
+    {
+	if (name->info && name->info->addr())
+	{
+	    ConstantMap::const_iterator i =
+		_constants.find (name->info->addr().pointer());
+
+	    if (i != _constants.end())
+		return i->second;
+	}
+
+	NameNodePtr copy =
+	    _lcontext.newNameNode (name->lineNumber, name->name, name->info);
+
+	copy->type = name->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (CallNodePtr call = node.cast<CallNode>())
+    {
+	ExprNodeVector arguments;
+
+	for (int i = 0; i < (int)call->arguments.size(); ++i)
+	    arguments.push_back (specializeExpr (call->arguments[i]));
+
+	CallNodePtr copy =
+	    _lcontext.newCallNode (call->lineNumber,
+				   call->function,
+				   arguments);
+
+	copy->type = call->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    if (ValueNodePtr value = node.cast<ValueNode>())
+    {
+	ExprNodeVector elements;
+
+	for (int i = 0; i < (int)value->elements.size(); ++i)
+	    elements.push_back (specializeExpr (value->elements[i]));
+
+	ValueNodePtr copy =
+	    _lcontext.newValueNode (value->lineNumber, elements);
+
+	copy->type = value->type;
+	return copy->evaluate (_lcontext);
+    }
+
+    //
+    // Literals are never modified; they can be shared
+    // between the original and the copy.
+    //
+
+    assert (node.cast<LiteralNode>());
+    return node;
+}
+
+
+ExprNodePtr
+Specializer::newLiteralNode
+    (LContext &lcontext,
+     int lineNumber,
+     const DataTypePtr &type,
+     const char *data)
+{
+    switch (type->cDataType())
+    {
+      case BoolTypeEnum:
+	return lcontext.newBoolLiteralNode (lineNumber, *(const bool *)data);
+
+      case IntTypeEnum:
+	return lcontext.newIntLiteralNode (lineNumber, *(const int *)data);
+
+      case UIntTypeEnum:
+	return lcontext.newUIntLiteralNode
+				(lineNumber, *(const unsigned int *)data);
+
+      case HalfTypeEnum:
+	return lcontext.newHalfLiteralNode (lineNumber, *(const half *)data);
+
+      case FloatTypeEnum:
+	return lcontext.newFloatLiteralNode (lineNumber, *(const float *)data);
+
+      default:
+	return 0;
+    }
+}
+
+
+bool
+Specializer::hasSideEffects (const ExprNodePtr &expr)
+{
+    if (!expr)
+	return false;
+
+    if (BinaryOpNodePtr binOp = expr.cast<BinaryOpNode>())
+    {
+	return hasSideEffects (binOp->leftOperand) ||
+	       hasSideEffects (binOp->rightOperand);
+    }
+
+    if (UnaryOpNodePtr unOp = expr.cast<UnaryOpNode>())
+	return hasSideEffects (unOp->operand);
+
+    if (ArrayIndexNodePtr index = expr.cast<ArrayIndexNode>())
+	return hasSideEffects (index->array) || hasSideEffects (index->index);
+
+    if (MemberNodePtr member = expr.cast<MemberNode>())
+	return hasSideEffects (member->obj);
+
+    if (SizeNodePtr size = expr.cast<SizeNode>())
+	return hasSideEffects (size->obj);
+
+    if (CallNodePtr call = expr.cast<CallNode>())
+    {
+	if (callHasSideEffects (call))
+	    return true;
+
+	for (int i = 0; i < (int)call->arguments.size(); ++i)
+	    if (hasSideEffects (call->arguments[i]))
+		return true;
+
+	return false;
+    }
+
+    if (ValueNodePtr value = expr.cast<ValueNode>())
+    {
+	for (int i = 0; i < (int)value->elements.size(); ++i)
+	    if (hasSideEffects (value->elements[i]))
+		return true;
+    }
+
+    return false;
+}
+
+
+bool
+Specializer::hasSideEffects (const StatementNodePtr &statements)
+{
+    //
+    // Stores to a function's own local variables and parameters
+    // are not side effects of calling the function; only the
+    // expressions in the function's statements are checked.
+    //
+
+    for (StatementNodePtr node = statements; node; node = node->next)
+    {
+	if (VariableNodePtr var = node.cast<VariableNode>())
+	{
+	    if (hasSideEffects (var->initialValue))
+		return true;
+	}
+	else if (AssignmentNodePtr assignment = node.cast<AssignmentNode>())
+	{
+	    if (hasSideEffects (assignment->lhs) ||
+		hasSideEffects (assignment->rhs))
+	    {
+		return true;
+	    }
+	}
+	else if (ExprStatementNodePtr statement =
+		     node.cast<ExprStatementNode>())
+	{
+	    if (hasSideEffects (statement->expr))
+		return true;
+	}
+	else if (IfNodePtr ifNode = node.cast<IfNode>())
+	{
+	    if (hasSideEffects (ifNode->condition) ||
+		hasSideEffects (ifNode->truePath) ||
+		hasSideEffects (ifNode->falsePath))
+	    {
+		return true;
+	    }
+	}
+	else if (ReturnNodePtr ret = node.cast<ReturnNode>())
+	{
+	    if (hasSideEffects (ret->returnedValue))
+		return true;
+	}
+	else if (WhileNodePtr loop = node.cast<WhileNode>())
+	{
+	    if (hasSideEffects (loop->condition) ||
+		hasSideEffects (loop->loopBody))
+	    {
+		return true;
+	    }
+	}
+    }
+
+    return false;
+}
+
+
+bool
+Specializer::callHasSideEffects (const CallNodePtr &call)
+{
+    //
+    // CTL functions have no global state; a call can only
+    // affect its output arguments, or print or abort.
+    //
+
+    const SymbolInfoPtr &info = call->function->info;
+    FunctionTypePtr fType = info->type().cast<FunctionType>();
+    const ParamVector &parameters = fType->parameters();
+
+    for (int i = 0; i < (int)parameters.size(); ++i)
+	if (parameters[i].isWritable())
+	    return true;
+
+    if (isCFunction (info))
+    {
+	string name = call->function->name;
+	size_t pos = name.rfind ("::");
+
+	if (pos != string::npos)
+	    name = name.substr (pos + 2);
+
+	return name == "assert" || name.compare (0, 6, "print_") == 0;
+    }
+
+    SideEffectMap::iterator i = _sideEffects.find (info.pointer());
+
+    if (i != _sideEffects.end())
+	return i->second;
+
+    FunctionNodePtr function = functionDefinition (info);
+
+    if (!function)
+    {
+	_sideEffects[info.pointer()] = true;
+	return true;
+    }
+
+    //
+    // While the body is being checked, recursive calls are
+    // assumed to have no side effects; if the function does have
+    // side effects, they are found elsewhere in its body.
+    //
+
+    _sideEffects[info.pointer()] = false;
+
+    bool sideEffects = hasSideEffects (function->body);
+    _sideEffects[info.pointer()] = sideEffects;
+    return sideEffects;
+}
+
+
+} // namespace Ctl
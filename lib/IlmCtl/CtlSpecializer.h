@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_CTL_SPECIALIZER_H
+#define INCLUDED_CTL_SPECIALIZER_H
+
+//-----------------------------------------------------------------------------
+//
+//	class Specializer
+//
+//	A Specializer makes a copy of the syntax tree for the body of
+//	a function, with some of the function's parameters (or any other
+//	read-only variables) replaced by constants.
+//
+//	While the copy is being made, expressions that depend only on
+//	constants are folded using the same ExprNode::evaluate() machinery
+//	that the parser uses, and statements that can never be executed
+//	are dropped:
+//
+//	    - if statements whose condition is constant are replaced
+//	      by the statements on the path that is always taken,
+//
+//	    - while loops whose condition is always false are removed,
+//
+//	    - && and || expressions whose left operand is constant
+//	      are short-circuited,
+//
+//	    - statements that follow a return statement are removed.
+//
+//	Local constants whose initial value becomes a literal are
+//	themselves replaced by that literal wherever they are used.
+//
+//	After a copy has been made, eliminateDeadStores() can remove
+//	assignments to variables whose values are never used, either
+//	because the variables are local and never read, or because the
+//	caller has declared that it does not need them (for example,
+//	output parameters that the caller ignores).
+//
+//	The original syntax tree is not modified, and the copy uses
+//	the same symbols and stack frame layout as the original.
+//
+//-----------------------------------------------------------------------------
+
+#include <CtlSyntaxTree.h>
+#include <CtlType.h>
+#include <map>
+#include <set>
+
+namespace Ctl {
+
+class LContext;
+class Addr;
+typedef RcPtr<Addr> AddrPtr;
+
+
+class Specializer
+{
+  public:
+
+    Specializer (LContext &lcontext);
+    virtual ~Specializer ();
+
+    //-----------------------------------------------------------
+    // bindConstant(a,v) causes every reference to the variable
+    // whose address is a to be replaced by the literal value v.
+    //-----------------------------------------------------------
+
+    void		bindConstant (const AddrPtr &addr,
+				      const ExprNodePtr &value);
+
+    //----------------------------------------------------------
+    // Make a specialized copy of a list of statements.  Returns
+    // 0 if none of the statements can ever be executed.
+    //----------------------------------------------------------
+
+    StatementNodePtr	specialize (const StatementNodePtr &statements);
+
+    //-------------------------------------------------------------
+    // discardStores(a) declares that the value of the variable
+    // whose address is a is not needed after the function returns.
+    //
+    // eliminateDeadStores(s) removes assignments to local variables
+    // and to variables passed to discardStores() if the assigned
+    // values are never read, along with the computations that only
+    // feed those assignments.  Expressions with side effects (calls
+    // to print and assert functions, to functions with output
+    // parameters, and to CTL functions that make such calls) are
+    // always kept.  The list s is modified in place; it must have
+    // been returned by specialize().  Returns the new head of the
+    // list.
+    //-------------------------------------------------------------
+
+    void		discardStores (const AddrPtr &addr);
+
+    StatementNodePtr	eliminateDeadStores (const StatementNodePtr &statements);
+
+    //-------------------------------------------------------------
+    // Create a literal node for a value of type bool, int,
+    // unsigned int, half or float, stored in memory at address
+    // data.  Returns 0 if values of the given type cannot be
+    // represented as literals.
+    //-------------------------------------------------------------
+
+    static ExprNodePtr	newLiteralNode (LContext &lcontext,
+					int lineNumber,
+					const DataTypePtr &type,
+					const char *data);
+
+  protected:
+
+    //-------------------------------------------------------------
+    // Finding calls with side effects
+    //
+    // isCFunction(i) returns true if the function described by i
+    // is written in C++.  Except for assert() and the print
+    // functions, such functions have no side effects.
+    //
+    // functionDefinition(i) returns the syntax tree of the CTL
+    // function described by i, or 0 if it is not available.  A
+    // call to a CTL function has side effects if the function's
+    // body does, or if its syntax tree is not available.
+    //
+    // The default implementations return false and 0.
+    //-------------------------------------------------------------
+
+    virtual bool		isCFunction (const SymbolInfoPtr &info) const;
+
+    virtual FunctionNodePtr	functionDefinition
+				    (const SymbolInfoPtr &info) const;
+
+  private:
+
+    StatementNodePtr	specializeStatement (const StatementNodePtr &node);
+    ExprNodePtr		specializeExpr (const ExprNodePtr &node);
+
+    typedef std::map <const Addr *, ExprNodePtr> ConstantMap;
+    typedef std::set <const Addr *> AddrSet;
+    typedef std::map <const SymbolInfo *, bool> SideEffectMap;
+
+    StatementNodePtr	removeDeadStores (const StatementNodePtr &statements,
+					  const AddrSet &candidates,
+					  const AddrSet &reads,
+					  bool &changed);
+
+    bool		hasSideEffects (const ExprNodePtr &expr);
+    bool		hasSideEffects (const StatementNodePtr &statements);
+    bool		callHasSideEffects (const CallNodePtr &call);
+
+    LContext &		_lcontext;
+    ConstantMap		_constants;
+    AddrSet		_discarded;
+    SideEffectMap	_sideEffects;
+};
+
+
+} // namespace Ctl
+
+#endif
@@ -0,0 +1,331 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+//-----------------------------------------------------------------------------
+//
+//	class BakedLut
+//
+//-----------------------------------------------------------------------------
+
+#include <CtlBakedLut.h>
+#include <CtlLookupTable.h>
+#include <ImathFun.h>
+#include <ImathRandom.h>
+#include <Iex.h>
+#include <limits>
+#include <cmath>
+
+using namespace Imath;
+using namespace Iex;
+using namespace std;
+
+namespace Ctl {
+namespace {
+
+inline float
+sampleError (float exact, float approx)
+{
+    float err = fabs (exact - approx);
+
+    if (err == err)
+	return err;
+
+    //
+    // One or both values are NaN, or both are the same
+    // infinity.  Only the latter two cases are a match.
+    //
+
+    if (exact != exact && approx != approx)
+	return 0;
+
+    if (exact == approx)
+	return 0;
+
+    return numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+
+LutSource::~LutSource ()
+{
+    // empty
+}
+
+
+BakedLut::BakedLut
+    (Type type,
+     int size,
+     Shaper shaper,
+     float domainMin,
+     float domainMax)
+:
+    _type (type),
+    _size (size),
+    _shaper (shaper),
+    _domainMin (domainMin),
+    _domainMax (domainMax),
+    _maxError (0),
+    _meanError (0)
+{
+    if (size < 2)
+	THROW (ArgExc, "A baked lookup table needs at least 2 "
+		       "entries per dimension (size is " << size << ").");
+
+    if (!(domainMin < domainMax))
+	THROW (ArgExc, "Invalid domain [" << domainMin << ", " <<
+		       domainMax << "] for baked lookup table.");
+
+    if (shaper == SHAPER_LOG2)
+    {
+	if (!(domainMin > 0))
+	    THROW (ArgExc, "The lower end of the domain of a baked lookup "
+			   "table with a log2 shaper must be greater than 0 "
+			   "(it is " << domainMin << ").");
+
+	_shapeMin = log2f (domainMin);
+	_shapeScale = 1 / (log2f (domainMax) - _shapeMin);
+    }
+    else
+    {
+	_shapeMin = domainMin;
+	_shapeScale = 1 / (domainMax - domainMin);
+    }
+}
+
+
+float
+BakedLut::shape (float x) const
+{
+    x = clamp (x, _domainMin, _domainMax);
+
+    if (_shaper == SHAPER_LOG2)
+	return (log2f (x) - _shapeMin) * _shapeScale;
+    else
+	return (x - _shapeMin) * _shapeScale;
+}
+
+
+float
+BakedLut::unshape (float s) const
+{
+    if (s <= 0)
+	return _domainMin;
+
+    if (s >= 1)
+	return _domainMax;
+
+    if (_shaper == SHAPER_LOG2)
+	return exp2f (_shapeMin + s / _shapeScale);
+    else
+	return _shapeMin + s / _shapeScale;
+}
+
+
+void
+BakedLut::gridInputs (vector<float> &in) const
+{
+    vector<float> values (_size);
+
+    for (int i = 0; i < _size; ++i)
+	values[i] = unshape (float (i) / (_size - 1));
+
+    if (_type == LUT_1D)
+    {
+	//
+	// Sample along the neutral axis.
+	//
+
+	in.resize (_size * 3);
+
+	for (int i = 0; i < _size; ++i)
+	    in[3 * i] = in[3 * i + 1] = in[3 * i + 2] = values[i];
+    }
+    else
+    {
+	//
+	// Entry t[i][j][k] is at (i * size + j) * size + k,
+	// see lookup3D().
+	//
+
+	in.resize (_size * _size * _size * 3);
+	float *p = &in[0];
+
+	for (int i = 0; i < _size; ++i)
+	    for (int j = 0; j < _size; ++j)
+		for (int k = 0; k < _size; ++k)
+		{
+		    *p++ = values[i];
+		    *p++ = values[j];
+		    *p++ = values[k];
+		}
+    }
+}
+
+
+void
+BakedLut::bake (LutSource &source)
+{
+    vector<float> in;
+    gridInputs (in);
+
+    size_t n = in.size() / 3;
+    vector<float> out (in.size());
+    source.evaluate (n, &in[0], &out[0]);
+
+    if (_type == LUT_1D)
+    {
+	_table1D.resize (_size * 3);
+
+	for (int c = 0; c < 3; ++c)
+	    for (int i = 0; i < _size; ++i)
+		_table1D[c * _size + i] = out[3 * i + c];
+    }
+    else
+    {
+	_table3D.resize (n);
+
+	for (size_t i = 0; i < n; ++i)
+	    _table3D[i] = V3f (out[3 * i], out[3 * i + 1], out[3 * i + 2]);
+    }
+}
+
+
+void
+BakedLut::validate (LutSource &source, size_t numSamples, unsigned long seed)
+{
+    _maxError = 0;
+    _meanError = 0;
+
+    if (numSamples == 0)
+	return;
+
+    Rand32 rand (seed);
+    vector<float> in (numSamples * 3);
+
+    for (size_t i = 0; i < in.size(); ++i)
+	in[i] = unshape (rand.nextf (0, 1));
+
+    vector<float> exact (in.size());
+    source.evaluate (numSamples, &in[0], &exact[0]);
+
+    vector<float> approx (in.size());
+    apply (numSamples, &in[0], 3, &approx[0], 3);
+
+    double sum = 0;
+
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+	float err = sampleError (exact[i], approx[i]);
+	_maxError = max (_maxError, err);
+	sum += err;
+    }
+
+    _meanError = sum / in.size();
+}
+
+
+void
+BakedLut::apply
+    (size_t n,
+     const float in[],
+     size_t inStride,
+     float out[],
+     size_t outStride) const
+{
+    if (_type == LUT_1D)
+    {
+	if (_table1D.empty())
+	    THROW (LogicExc, "Cannot apply a lookup table that "
+			     "has not been baked.");
+
+	const float *r = &_table1D[0];
+	const float *g = r + _size;
+	const float *b = g + _size;
+
+	for (size_t i = 0; i < n; ++i, in += inStride, out += outStride)
+	{
+	    float sr = shape (in[0]);
+	    float sg = shape (in[1]);
+	    float sb = shape (in[2]);
+
+	    out[0] = lookup1D (r, _size, 0, 1, sr);
+	    out[1] = lookup1D (g, _size, 0, 1, sg);
+	    out[2] = lookup1D (b, _size, 0, 1, sb);
+	}
+    }
+    else
+    {
+	if (_table3D.empty())
+	    THROW (LogicExc, "Cannot apply a lookup table that "
+			     "has not been baked.");
+
+	const V3i size (_size, _size, _size);
+	const V3f pMin (0, 0, 0);
+	const V3f pMax (1, 1, 1);
+
+	for (size_t i = 0; i < n; ++i, in += inStride, out += outStride)
+	{
+	    V3f p (shape (in[0]), shape (in[1]), shape (in[2]));
+	    V3f q = lookup3D (&_table3D[0], size, pMin, pMax, p);
+
+	    out[0] = q.x;
+	    out[1] = q.y;
+	    out[2] = q.z;
+	}
+    }
+}
+
+} // namespace Ctl
@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_CTL_BAKED_LUT_H
+#define INCLUDED_CTL_BAKED_LUT_H
+
+//-----------------------------------------------------------------------------
+//
+//	class BakedLut -- a lookup table that approximates an arbitrary
+//	RGB to RGB transform, for example a chain of CTL functions.
+//
+//	When the input of a transform is restricted to a small domain,
+//	such as the code values of a display-referred 10-bit image,
+//	sampling the transform onto a grid once and then interpolating
+//	in the grid is much faster than running the transform for
+//	every pixel.
+//
+//	A BakedLut is either a set of three 1D tables, one per channel,
+//	or a 3D table.  The 1D tables are sampled along the neutral axis
+//	(r == g == b), so they are only an approximation of transforms
+//	where every output channel depends on the corresponding input
+//	channel alone.  The 3D table handles arbitrary transforms, at
+//	the cost of more samples and of trilinear interpolation.
+//
+//	Before a value is looked up, it is mapped through a shaper
+//	function that converts the domain [domainMin, domainMax] to
+//	[0, 1]:
+//
+//	    SHAPER_LINEAR	(x - domainMin) / (domainMax - domainMin)
+//
+//	    SHAPER_LOG2		(log2(x) - log2(domainMin)) /
+//				(log2(domainMax) - log2(domainMin)),
+//				for scene-linear input; domainMin must be
+//				greater than 0.
+//
+//	Input values outside the domain are clamped.
+//
+//	Since the table is only an approximation, validate() compares
+//	the table against the original transform, on a set of random
+//	input values within the domain.  It is up to the caller to
+//	decide whether the resulting maximum and mean errors are small
+//	enough to use the table.
+//
+//-----------------------------------------------------------------------------
+
+#include <ImathVec.h>
+#include <vector>
+#include <stddef.h>
+
+namespace Ctl {
+
+class LutSource
+{
+  public:
+
+    virtual ~LutSource ();
+
+    //---------------------------------------------------------
+    // Evaluate the transform for n RGB triples.  in[3*i+c]
+    // and out[3*i+c] are channel c of the i-th triple.
+    //---------------------------------------------------------
+
+    virtual void	evaluate (size_t n,
+				  const float in[/*3*n*/],
+				  float out[/*3*n*/]) = 0;
+};
+
+
+class BakedLut
+{
+  public:
+
+    enum Type
+    {
+	LUT_1D,
+	LUT_3D
+    };
+
+    enum Shaper
+    {
+	SHAPER_LINEAR,
+	SHAPER_LOG2
+    };
+
+    //-------------------------------------------------------------
+    // Constructor -- creates an empty table with size entries per
+    // dimension.  Throws Iex::ArgExc if the size or the domain are
+    // not valid.
+    //-------------------------------------------------------------
+
+    BakedLut (Type type,
+	      int size,
+	      Shaper shaper = SHAPER_LINEAR,
+	      float domainMin = 0,
+	      float domainMax = 1);
+
+    Type		type () const		{return _type;}
+    int			size () const		{return _size;}
+    Shaper		shaper () const		{return _shaper;}
+    float		domainMin () const	{return _domainMin;}
+    float		domainMax () const	{return _domainMax;}
+
+    //-------------------------------------------------------------
+    // Fill the table by evaluating source at the grid points.
+    //-------------------------------------------------------------
+
+    void		bake (LutSource &source);
+
+    //-------------------------------------------------------------
+    // Evaluate source and the table at numSamples random input
+    // values within the domain, and record the maximum and mean
+    // absolute difference between the two, over all channels.
+    // The random values depend only on seed.
+    //-------------------------------------------------------------
+
+    void		validate (LutSource &source,
+				  size_t numSamples,
+				  unsigned long seed = 0);
+
+    float		maxError () const	{return _maxError;}
+    float		meanError () const	{return _meanError;}
+
+    //-------------------------------------------------------------
+    // Look up n RGB triples in the table.  Consecutive triples
+    // are inStride and outStride floats apart.  If inStride
+    // equals outStride, in and out may be the same buffer.
+    //-------------------------------------------------------------
+
+    void		apply (size_t n,
+			       const float in[],
+			       size_t inStride,
+			       float out[],
+			       size_t outStride) const;
+
+  private:
+
+    float		shape (float x) const;
+    float		unshape (float s) const;
+
+    void		gridInputs (std::vector<float> &in) const;
+
+    Type		_type;
+    int			_size;
+    Shaper		_shaper;
+    float		_domainMin;
+    float		_domainMax;
+    float		_shapeMin;
+    float		_shapeScale;
+    std::vector<float>	_table1D;	// _size entries per channel
+    std::vector<Imath::V3f> _table3D;	// _size^3 entries
+    float		_maxError;
+    float		_meanError;
+};
+
+} // namespace Ctl
+
+#endif
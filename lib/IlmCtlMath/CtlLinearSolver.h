@@ -66,6 +66,7 @@
 #define INCLUDED_CTL_LINEAR_SOLVER_H
 
 #include <IexMacros.h>
+#include <IexBaseExc.h>
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -99,6 +100,59 @@ struct NullLinearOperator
     void apply(x_iterator x_first, x_iterator x_last,
                y_iterator y_first, y_iterator y_last) const
     { assert(0 && "Attempt to use NullLinearOperator::apply()."); }
+
+    template<typename x_iterator, typename y_iterator>
+    void apply(size_t numVectors,
+               x_iterator x_first, x_iterator x_last,
+               y_iterator y_first, y_iterator y_last) const
+    { assert(0 && "Attempt to use NullLinearOperator::apply()."); }
+};
+
+//---------------------------------------------------------------------
+// OPERATOR: JacobiPreconditioner
+// MODEL OF: LinearOperator
+//
+// JacobiPreconditioner is the diagonal matrix M = inverse(diag(A)),
+// which makes CG converge faster for matrices A whose diagonal
+// elements vary a lot in size.  Where the diagonal is zero, M is
+// one.  To precondition LSS, build M from the diagonal of A' A;
+// for a CRSOperator, see CRSOperator::normalDiagonal().
+//---------------------------------------------------------------------
+template<typename T>
+struct JacobiPreconditioner
+{
+    std::vector<T> invDiag;
+
+    template<typename d_iterator>
+    JacobiPreconditioner(d_iterator d_first, d_iterator d_last)
+	: invDiag(d_first, d_last)
+    {
+	for (size_t i = 0; i < invDiag.size(); ++i)
+	    invDiag[i] = invDiag[i] != T(0)? T(1) / invDiag[i]: T(1);
+    }
+
+    size_t numRows()    const { return invDiag.size(); }
+    size_t numColumns() const { return invDiag.size(); }
+
+    template<typename x_iterator, typename y_iterator>
+    void apply(x_iterator x_first, x_iterator x_last,
+               y_iterator y_first, y_iterator y_last) const
+    {
+	apply(1, x_first, x_last, y_first, y_last);
+    }
+
+    template<typename x_iterator, typename y_iterator>
+    void apply(size_t numVectors,
+               x_iterator x_first, x_iterator x_last,
+               y_iterator y_first, y_iterator y_last) const
+    {
+	DBGASSERT(std::distance(x_first, x_last) ==
+		  invDiag.size() * numVectors);
+
+	for (size_t i = 0; i < invDiag.size(); ++i)
+	    for (size_t j = 0; j < numVectors; ++j, ++x_first, ++y_first)
+		*y_first = *x_first * invDiag[i];
+    }
 };
 
 //---------------------------------------------------------------------
@@ -121,6 +175,13 @@ struct NullLinearOperator
 //
 // Postconditions
 //     * T returns a measure of the accuracy of the solution
+//
+// A solver may also solve for several right-hand sides at once.
+// The numVectors vectors of b and of x are then interleaved, so that
+// element i of vector j is at position i * numVectors + j, and the
+// ranges are numVectors times longer.  The Operator must provide
+// the matching apply(numVectors, ...), and the result is the least
+// accurate of the solutions.
 //     
 //---------------------------------------------------------------------
 template<typename T, typename Operator>
@@ -131,6 +192,11 @@ struct LinearSolver
     template<typename b_iterator, typename x_iterator>
     T operator () (b_iterator b_first, b_iterator b_last,
                    x_iterator x_first, x_iterator x_last) const;
+
+    template<typename b_iterator, typename x_iterator>
+    T operator () (size_t numVectors,
+                   b_iterator b_first, b_iterator b_last,
+                   x_iterator x_first, x_iterator x_last) const;
 };
 
 //---------------------------------------------------------------------
@@ -171,6 +237,12 @@ struct LinearSolver
 // routine returns the L2 norm of the residual when the tolerance is
 // reached or after the maximum number of iterations has been
 // performed, whichever comes first.  
+//
+// With several right-hand sides, every vector goes through exactly
+// the iterations it would go through alone, and stops when it
+// reaches the tolerance; only the applications of A and M are
+// shared.  The solutions are therefore the same as those of
+// separate solves.
 // 
 //---------------------------------------------------------------------
 template<typename T, typename Operator, 
@@ -190,8 +262,15 @@ struct CG
     T operator () (b_iterator b_first, b_iterator b_last,
                    x_iterator x_first, x_iterator x_last) const;
 
+    template<typename b_iterator, typename x_iterator>
+    T operator () (size_t numVectors,
+                   b_iterator b_first, b_iterator b_last,
+                   x_iterator x_first, x_iterator x_last) const;
+
   private:
 
+    void checkArguments(size_t numVectors, size_t bSize, size_t xSize) const;
+
     template<typename b_iterator, typename x_iterator>
     T cg(b_iterator b_first, b_iterator b_last,
          x_iterator x_first, x_iterator x_last) const;
@@ -200,8 +279,37 @@ struct CG
     T cgp(b_iterator b_first, b_iterator b_last,
           x_iterator x_first, x_iterator x_last) const;
 
+    template<typename b_iterator, typename x_iterator>
+    T cg(size_t numVectors,
+         b_iterator b_first, b_iterator b_last,
+         x_iterator x_first, x_iterator x_last) const;
+
+    template<typename b_iterator, typename x_iterator>
+    T cgp(size_t numVectors,
+          b_iterator b_first, b_iterator b_last,
+          x_iterator x_first, x_iterator x_last) const;
+
     T dot(const std::vector<T> & x, const std::vector<T> & y) const;
 
+    // Computes dots[j] = x[j] . y[j] for interleaved vectors
+    void dot(const std::vector<T> & x, const std::vector<T> & y,
+             std::vector<T> & dots) const;
+
+    // Computes z[j] = alpha[j] * x[j] + y[j] for interleaved
+    // vectors, for the vectors j that are still active
+    template<typename iterator>
+    void saxpy(const std::vector<T> & alpha,
+               const std::vector<char> & active,
+               const std::vector<T> &x,
+               iterator y_first, iterator y_last,
+               iterator z_first, iterator z_last) const;
+
+    // Copies the vectors j for which active[j] is true from x to y
+    template<typename i_iterator, typename o_iterator>
+    void copyActive(const std::vector<char> & active,
+                    i_iterator x_first, i_iterator x_last,
+                    o_iterator y_first) const;
+
     // Computes z = x - y
     template<typename iterator>
     void sub(iterator x_first, iterator x_last,
@@ -248,6 +356,16 @@ struct LSSOperator
 	A.apply(x_first, x_last, aux.begin(), aux.end());
 	A.applyT(aux.begin(), aux.end(), y_first, y_last);
     }
+
+    template<typename i_iterator, typename o_iterator>
+    void apply(size_t numVectors,
+	       i_iterator x_first, i_iterator x_last,
+	       o_iterator y_first, o_iterator y_last) const
+    {
+	aux.resize(A.numRows() * numVectors);
+	A.apply(numVectors, x_first, x_last, aux.begin(), aux.end());
+	A.applyT(numVectors, aux.begin(), aux.end(), y_first, y_last);
+    }
 };
 
 
@@ -318,6 +436,16 @@ struct LSS
 	return solver(c.begin(), c.end(), x_first, x_last);
     }
 
+    template<typename b_iterator, typename x_iterator>
+    T operator () (size_t numVectors,
+                   b_iterator b_first, b_iterator b_last,
+                   x_iterator x_first, x_iterator x_last) const
+    {
+	std::vector<T> c(op().A.numColumns() * numVectors);
+	op().A.applyT(numVectors, b_first, b_last, c.begin(), c.end());
+	return solver(numVectors, c.begin(), c.end(), x_first, x_last);
+    }
+
   protected:
 
     // Computes c = A' b
@@ -371,6 +499,39 @@ template<typename b_iterator, typename x_iterator>
 inline T CG<T, Operator, Preconditioner>::
 operator () (b_iterator b_first, b_iterator b_last,
 	     x_iterator x_first, x_iterator x_last) const
+{
+    checkArguments(1, std::distance(b_first, b_last),
+		   std::distance(x_first, x_last));
+
+    if (! M)
+	return cg(b_first, b_last, x_first, x_last);
+    else
+	return cgp(b_first, b_last, x_first, x_last);
+}
+
+template<typename T, typename Operator, typename Preconditioner>
+template<typename b_iterator, typename x_iterator>
+inline T CG<T, Operator, Preconditioner>::
+operator () (size_t numVectors,
+	     b_iterator b_first, b_iterator b_last,
+	     x_iterator x_first, x_iterator x_last) const
+{
+    ASSERT(numVectors > 0, Iex::ArgExc,
+	   "Ctl::CG() requires that "
+	   "numVectors > 0.");
+
+    checkArguments(numVectors, std::distance(b_first, b_last),
+		   std::distance(x_first, x_last));
+
+    if (! M)
+	return cg(numVectors, b_first, b_last, x_first, x_last);
+    else
+	return cgp(numVectors, b_first, b_last, x_first, x_last);
+}
+
+template<typename T, typename Operator, typename Preconditioner>
+void CG<T, Operator, Preconditioner>::
+checkArguments(size_t numVectors, size_t bSize, size_t xSize) const
 {
     ASSERT(op().numRows() > 0, Iex::ArgExc,
 	   "Ctl::CG() requires that "
@@ -384,17 +545,12 @@ operator () (b_iterator b_first, b_iterator b_last,
     ASSERT(!M || M->numColumns() == op().numColumns(), Iex::ArgExc,
 	   "Ctl::CG() requires that "
 	   "M->numColumns() == A.numColumns().");
-    ASSERT(std::distance(b_first, b_last) == (int)op().numRows(), Iex::ArgExc,
+    ASSERT(bSize == op().numRows() * numVectors, Iex::ArgExc,
 	   "Ctl::CG() requires that "
-	   "distance(b_first, b_last) == A.numRows().");
-    ASSERT(std::distance(x_first, x_last) == (int)op().numColumns(), Iex::ArgExc,
+	   "distance(b_first, b_last) == A.numRows() * numVectors.");
+    ASSERT(xSize == op().numColumns() * numVectors, Iex::ArgExc,
 	   "Ctl::CG() requires that "
-	   "distance(x_first, x_last) == A.numColumns().");
-
-    if (! M)
-	return cg(b_first, b_last, x_first, x_last);
-    else
-	return cgp(b_first, b_last, x_first, x_last);
+	   "distance(x_first, x_last) == A.numColumns() * numVectors.");
 }
 
 template<typename T, typename Operator, typename Preconditioner>
@@ -517,6 +673,200 @@ cgp(b_iterator b_first, b_iterator b_last,
     return deltaBest;
 }
 
+//
+// The versions of cg() and cgp() for several right-hand sides repeat
+// the steps above, with one alpha, beta and delta per vector.  A
+// vector that has reached the tolerance is frozen: its x and its best
+// estimate are no longer updated.
+//
+
+template<typename T, typename Operator, typename Preconditioner>
+template<typename b_iterator, typename x_iterator>
+T CG<T, Operator, Preconditioner>::
+cg(size_t numVectors,
+   b_iterator b_first, b_iterator b_last,
+   x_iterator x_first, x_iterator x_last) const
+{
+    size_t k = numVectors;
+    size_t n = op().numColumns() * k;
+    std::vector<T> d(n), q(n), r(n), t(n), xx(n);
+    std::vector<T> alpha(k), beta(k), deltaNew(k), deltaBest(k), dq(k);
+    std::vector<char> active(k);
+
+    std::copy(x_first, x_last, xx.begin());   
+
+    A.apply(k, x_first, x_last, t.begin(), t.end()); // t = A * x
+    sub(b_first, b_last, t, r);                      // r = b - t;
+    std::copy(r.begin(), r.end(), d.begin());        // d = r
+
+    dot(r, r, deltaNew);
+
+    size_t numActive = 0;
+    for (size_t j = 0; j < k; ++j)
+    {
+	deltaBest[j] = sqrt(deltaNew[j]);
+	active[j] = sqrt(deltaBest[j]) > tolerance;
+	numActive += active[j];
+    }
+
+    for (unsigned i = 0; i < maxNumIterations && numActive > 0; ++i)
+    {
+	A.apply(k, d.begin(), d.end(), q.begin(), q.end()); // q = A * d
+
+	dot(d, q, dq);
+	for (size_t j = 0; j < k; ++j)
+	    alpha[j] = deltaNew[j] / dq[j];
+
+	// x += d * alpha;
+	saxpy(alpha, active, d, x_first, x_last, x_first, x_last);
+
+	if (0 == i % 50)
+	{
+	    A.apply(k, x_first, x_last, t.begin(), t.end()); // t = A * x
+	    sub(b_first, b_last, t, r);                      // r = b - t;
+	}
+	else
+	{
+	    // r -= q * alpha;
+	    for (size_t j = 0; j < k; ++j)
+		alpha[j] = -alpha[j];
+
+	    saxpy(alpha, active, q, r.begin(), r.end(), r.begin(), r.end());
+	}
+
+	std::vector<T> deltaOld(deltaNew);
+	dot(r, r, deltaNew);
+
+	for (size_t j = 0; j < k; ++j)
+	    beta[j] = deltaNew[j] / deltaOld[j];
+
+	// d = d * beta + r;
+	saxpy(beta, active, d, r.begin(), r.end(), d.begin(), d.end());
+
+	std::vector<char> improved(k);
+	for (size_t j = 0; j < k; ++j)
+	{
+	    if (active[j] && deltaNew[j] < deltaBest[j])
+	    {
+		deltaBest[j] = deltaNew[j];
+		improved[j] = true;
+	    }
+	}
+
+	copyActive(improved, x_first, x_last, xx.begin());
+
+	for (size_t j = 0; j < k; ++j)
+	{
+	    if (active[j] && !(sqrt(deltaBest[j]) > tolerance))
+	    {
+		active[j] = false;
+		--numActive;
+	    }
+	}
+    }
+
+    std::copy(xx.begin(), xx.end(), x_first);
+    return *std::max_element(deltaBest.begin(), deltaBest.end());
+}
+
+template<typename T, typename Operator, typename Preconditioner>	
+template<typename b_iterator, typename x_iterator>
+T CG<T, Operator, Preconditioner>::
+cgp(size_t numVectors,
+    b_iterator b_first, b_iterator b_last,
+    x_iterator x_first, x_iterator x_last) const
+{
+    assert(M);
+
+    size_t k = numVectors;
+    size_t n = op().numColumns() * k;
+    std::vector<T> d(n), q(n), r(n), s(n), t(n), xx(n);
+    std::vector<T> alpha(k), beta(k), deltaNew(k), deltaBest(k), delta0(k);
+    std::vector<T> thetaNew(k), dq(k);
+    std::vector<char> active(k);
+
+    std::copy(x_first, x_last, xx.begin()); 
+    
+    A.apply(k, x_first, x_last, t.begin(), t.end());        // t = A * x
+    sub(b_first, b_last, t, r);                           // r = b - t
+    M->apply(k, r.begin(), r.end(), d.begin(), d.end());  // d = M * r
+
+    dot(r, r, deltaNew);
+    dot(r, d, thetaNew);
+
+    size_t numActive = 0;
+    for (size_t j = 0; j < k; ++j)
+    {
+	deltaBest[j] = deltaNew[j];
+	delta0[j] = tolerance * deltaNew[j];
+	active[j] = deltaBest[j] > delta0[j];
+	numActive += active[j];
+    }
+    
+    for (unsigned i = 0; i < maxNumIterations && numActive > 0; ++i)
+    {
+	A.apply(k, d.begin(), d.end(), q.begin(), q.end()); // q = A * d
+
+	dot(d, q, dq);
+	for (size_t j = 0; j < k; ++j)
+	    alpha[j] = thetaNew[j] / dq[j];
+
+	// x += d * alpha;
+	saxpy(alpha, active, d, x_first, x_last, x_first, x_last);
+
+	if (0 == i % 50)
+	{
+	    A.apply(k, x_first, x_last, t.begin(), t.end()); // t = A * x
+	    sub(b_first, b_last, t, r);                      // r = b - t;
+	}
+	else
+	{
+	    // r -= q * alpha;
+	    for (size_t j = 0; j < k; ++j)
+		alpha[j] = -alpha[j];
+
+	    saxpy(alpha, active, q, r.begin(), r.end(), r.begin(), r.end());
+	}
+	
+	M->apply(k, r.begin(), r.end(), s.begin(), s.end()); // s = M * r
+	    
+	std::vector<T> thetaOld(thetaNew);
+	dot(r, s, thetaNew);
+
+	for (size_t j = 0; j < k; ++j)
+	    beta[j] = thetaNew[j] / thetaOld[j];
+
+	// d = d * beta + s;
+	saxpy(beta, active, d, s.begin(), s.end(), d.begin(), d.end());
+
+	dot(r, r, deltaNew);
+
+	std::vector<char> improved(k);
+	for (size_t j = 0; j < k; ++j)
+	{
+	    if (active[j] && deltaNew[j] < deltaBest[j])
+	    {
+		deltaBest[j] = deltaNew[j];
+		improved[j] = true;
+	    }
+	}
+
+	copyActive(improved, x_first, x_last, xx.begin());
+
+	for (size_t j = 0; j < k; ++j)
+	{
+	    if (active[j] && !(deltaBest[j] > delta0[j]))
+	    {
+		active[j] = false;
+		--numActive;
+	    }
+	}
+    }
+
+    std::copy(xx.begin(), xx.end(), x_first);
+    return *std::max_element(deltaBest.begin(), deltaBest.end());
+}
+
 template<typename T, typename Operator, typename Preconditioner>
 inline T CG<T, Operator, Preconditioner>::
 dot(const std::vector<T> & x, const std::vector<T> & y) const
@@ -526,6 +876,22 @@ dot(const std::vector<T> & x, const std::vector<T> & y) const
     return std::inner_product(x.begin(), x.end(), y.begin(), T(0));
 }
 
+template<typename T, typename Operator, typename Preconditioner>
+inline void CG<T, Operator, Preconditioner>::
+dot(const std::vector<T> & x, const std::vector<T> & y,
+    std::vector<T> & dots) const
+{
+    DBGASSERT(x.size() == y.size());
+    DBGASSERT(x.size() % dots.size() == 0);
+
+    size_t k = dots.size();
+    std::fill(dots.begin(), dots.end(), T(0));
+
+    for (size_t i = 0; i < x.size(); i += k)
+	for (size_t j = 0; j < k; ++j)
+	    dots[j] = dots[j] + x[i + j] * y[i + j];
+}
+
 template<typename T, typename Operator, typename Preconditioner>
 template<typename iterator>	 
 inline void CG<T, Operator, Preconditioner>::
@@ -566,6 +932,57 @@ saxpy(T alpha, const std::vector<T> & x,
     }
 }
 
+template<typename T, typename Operator, typename Preconditioner>
+template<typename iterator>	 
+inline void CG<T, Operator, Preconditioner>::
+saxpy(const std::vector<T> & alpha,
+      const std::vector<char> & active,
+      const std::vector<T> & x,
+      iterator y_first, iterator y_last,
+      iterator z_first, iterator z_last) const
+{
+    DBGASSERT(distance(y_first, y_last) == x.size());
+    DBGASSERT(distance(z_first, z_last) == x.size());
+
+    size_t k = alpha.size();
+    typedef typename std::iterator_traits<iterator>::value_type YValue;
+    YValue y;
+    for (size_t i = 0; i < x.size(); i += k)
+    {
+	for (size_t j = 0; j < k; ++j, ++y_first, ++z_first)
+	{
+	    if (! active[j])
+		continue;
+
+	    y = *y_first; // this is needed in case y_first == z_first
+	    *z_first = x[i + j];
+	    *z_first *= alpha[j];
+	    *z_first += y;
+	}
+    }
+}
+
+template<typename T, typename Operator, typename Preconditioner>
+template<typename i_iterator, typename o_iterator>	 
+inline void CG<T, Operator, Preconditioner>::
+copyActive(const std::vector<char> & active,
+	   i_iterator x_first, i_iterator x_last,
+	   o_iterator y_first) const
+{
+    size_t k = active.size();
+    if (std::find(active.begin(), active.end(), true) == active.end())
+	return;
+
+    for (size_t j = 0; x_first < x_last; ++x_first, ++y_first)
+    {
+	if (active[j])
+	    *y_first = *x_first;
+
+	if (++j == k)
+	    j = 0;
+    }
+}
+
 //
 // LSS
 //
@@ -60,6 +60,12 @@
 
 #include <CtlLookupTable.h>
 #include <ImathFun.h>
+#include <vector>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+    #define CTL_LOOKUP_X86 1
+    #include <immintrin.h>
+#endif
 
 using namespace Imath;
 
@@ -104,19 +110,17 @@ indicesAndWeights (float r, int iMax, int &i, int &i1, float &u, float &u1)
     u1 = 1 - u;
 }
 
-} // namespace
-
 
-float
-lookup1D
+inline float
+lookupLinear
     (const float table[],
-     int size,
+     int iMax,
      float pMin,
      float pMax,
+     float pRange,
      float p)
 {
-    int iMax = size - 1;
-    float r = (clamp (p, pMin, pMax) - pMin) / (pMax - pMin) * iMax;
+    float r = (clamp (p, pMin, pMax) - pMin) / pRange * iMax;
 
     int i, i1;
     float u, u1;
@@ -126,19 +130,59 @@ lookup1D
 }
 
 
-float
-lookupCubic1D
+inline void
+tangents (const float table[], int size, int i, float &m0, float &m1)
+{
+    //
+    // Tangents at the ends of segment i of the table.  The table
+    // has at least 3 entries, so the segment touches at most one
+    // end of the table.
+    //
+
+    float dy = (table[i+1] - table[i]);
+
+    if (i <= 0)
+    {
+	m1 = (dy + (table[i+2] - table[i+1])) * 0.5f;
+	m0 = (3 * dy - m1) * 0.5f;
+    }
+    else if (i >= size - 2)
+    {
+	m0 = (dy + (table[i] - table[i-1])) * 0.5f;
+	m1 = (3 * dy - m0) * 0.5f;
+    }
+    else
+    {
+	m0 = (dy + (table[i] - table[i-1])) * 0.5f;
+	m1 = (dy + (table[i+2] - table[i+1])) * 0.5f;
+    }
+}
+
+
+inline float
+hermite (float y0, float m0, float y1, float m1, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return y0 * (2 * t3 - 3 * t2 + 1) +
+           m0 * (t3 - 2 * t2 + t) +
+	   y1 * (-2 * t3 + 3 * t2) +
+	   m1 * (t3 - t2);
+}
+
+
+inline float
+lookupCubic
     (const float table[],
      int size,
      float pMin,
      float pMax,
+     float pRange,
      float p)
 {
-    if (size < 3)
-	return lookup1D (table, size, pMin, pMax, p);
-
     int iMax = size - 1;
-    float r = (clamp (p, pMin, pMax) - pMin) / (pMax - pMin) * iMax;
+    float r = (clamp (p, pMin, pMax) - pMin) / pRange * iMax;
     int i;
 
     if (r >= 0 && r < iMax)
@@ -166,29 +210,341 @@ lookupCubic1D
 	return table[0];
     }
 
-    float dy = (table[i+1] - table[i]);
     float m0, m1;
+    tangents (table, size, i, m0, m1);
 
-    if (i > 0)
-	m0 = (dy + (table[i] - table[i-1])) * 0.5f;
+    return hermite (table[i], m0, table[i+1], m1, r - i);
+}
 
-    if (i < size - 2)
-	m1 = (dy + (table[i+2] - table[i+1])) * 0.5f;
 
-    if (i <= 0)
-	m0 = (3 * dy - m1) * 0.5f;
+inline float
+lookupSegments
+    (const float table[],
+     const float segments[],
+     int iMax,
+     float pMin,
+     float pMax,
+     float pRange,
+     float p)
+{
+    //
+    // Like lookupCubic(), but with the table entries and tangents
+    // of segment i stored in segments[4*i] to segments[4*i+3].
+    //
 
-    if (i >= size - 2)
-	m1 = (3 * dy - m0) * 0.5f;
+    float r = (clamp (p, pMin, pMax) - pMin) / pRange * iMax;
 
-    float t = r - i;
-    float t2 = t * t;
-    float t3 = t2 * t;
+    if (r >= 0 && r < iMax)
+    {
+	int i = int (r);
+	const float *s = segments + 4 * i;
+	return hermite (s[0], s[1], s[2], s[3], r - i);
+    }
+    else if (r >= iMax)
+    {
+	return table[iMax];
+    }
+    else
+    {
+	return table[0];
+    }
+}
 
-    return table[i] * (2 * t3 - 3 * t2 + 1) +
-           m0 * (t3 - 2 * t2 + t) +
-	   table[i+1] * (-2 * t3 + 3 * t2) +
-	   m1 * (t3 - t2);
+
+#if defined (CTL_LOOKUP_X86)
+
+bool
+haveAvx2 ()
+{
+    static const bool avx2 = (__builtin_cpu_init(),
+			      __builtin_cpu_supports ("avx2"));
+    return avx2;
+}
+
+
+__attribute__ ((target ("avx2")))
+inline __m256
+tableCoordinates
+    (__m256 p,
+     __m256 pMin,
+     __m256 pMax,
+     __m256 pRange,
+     __m256 fMax)
+{
+    //
+    // (clamp (p, pMin, pMax) - pMin) / pRange * iMax, eight at a time;
+    // NaNs are passed through, like clamp() does.
+    //
+
+    __m256 c = _mm256_blendv_ps (p, pMax, _mm256_cmp_ps (p, pMax, _CMP_GT_OQ));
+    c = _mm256_blendv_ps (c, pMin, _mm256_cmp_ps (p, pMin, _CMP_LT_OQ));
+
+    return _mm256_mul_ps (_mm256_div_ps (_mm256_sub_ps (c, pMin), pRange), fMax);
+}
+
+
+__attribute__ ((target ("avx2")))
+size_t
+lookupLinearAvx2
+    (const float table[],
+     int iMax,
+     float pMin,
+     float pMax,
+     float pRange,
+     size_t n,
+     const float p[],
+     float q[])
+{
+    //
+    // Linear lookups, eight at a time, with the same arithmetic as
+    // lookupLinear().  Returns the number of samples looked up.
+    //
+
+    const __m256 vMin = _mm256_set1_ps (pMin);
+    const __m256 vMax = _mm256_set1_ps (pMax);
+    const __m256 vRange = _mm256_set1_ps (pRange);
+    const __m256 fMax = _mm256_set1_ps (float (iMax));
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps (1.0f);
+    const __m256i iMaxV = _mm256_set1_epi32 (iMax);
+    const __m256i oneI = _mm256_set1_epi32 (1);
+    size_t k = 0;
+
+    for (; k + 8 <= n; k += 8)
+    {
+	__m256 r = tableCoordinates (_mm256_loadu_ps (p + k),
+				     vMin, vMax, vRange, fMax);
+
+	__m256i inside = _mm256_castps_si256
+			     (_mm256_and_ps (_mm256_cmp_ps (r, zero, _CMP_GE_OQ),
+					     _mm256_cmp_ps (r, fMax, _CMP_LT_OQ)));
+
+	__m256i above = _mm256_castps_si256
+			    (_mm256_cmp_ps (r, fMax, _CMP_GE_OQ));
+
+	__m256i ir = _mm256_cvttps_epi32 (r);
+	__m256i i = _mm256_blendv_epi8 (_mm256_and_si256 (iMaxV, above),
+					ir, inside);
+	__m256i i1 = _mm256_add_epi32 (i, _mm256_and_si256 (oneI, inside));
+
+	__m256 u = _mm256_blendv_ps (one,
+				     _mm256_sub_ps (r, _mm256_cvtepi32_ps (ir)),
+				     _mm256_castsi256_ps (inside));
+	__m256 u1 = _mm256_sub_ps (one, u);
+
+	__m256 a = _mm256_i32gather_ps (table, i, 4);
+	__m256 b = _mm256_i32gather_ps (table, i1, 4);
+
+	_mm256_storeu_ps (q + k, _mm256_add_ps (_mm256_mul_ps (a, u1),
+						_mm256_mul_ps (b, u)));
+    }
+
+    _mm256_zeroupper();
+    return k;
+}
+
+
+__attribute__ ((target ("avx2")))
+size_t
+lookupSegmentsAvx2
+    (const float table[],
+     const float segments[],
+     int iMax,
+     float pMin,
+     float pMax,
+     float pRange,
+     size_t n,
+     const float p[],
+     float q[])
+{
+    //
+    // Cubic lookups, eight at a time, with the same arithmetic as
+    // lookupSegments().  Returns the number of samples looked up.
+    //
+
+    const __m256 vMin = _mm256_set1_ps (pMin);
+    const __m256 vMax = _mm256_set1_ps (pMax);
+    const __m256 vRange = _mm256_set1_ps (pRange);
+    const __m256 fMax = _mm256_set1_ps (float (iMax));
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps (1.0f);
+    const __m256 two = _mm256_set1_ps (2.0f);
+    const __m256 three = _mm256_set1_ps (3.0f);
+    const __m256 minusTwo = _mm256_set1_ps (-2.0f);
+    const __m256 first = _mm256_set1_ps (table[0]);
+    const __m256 last = _mm256_set1_ps (table[iMax]);
+    size_t k = 0;
+
+    for (; k + 8 <= n; k += 8)
+    {
+	__m256 r = tableCoordinates (_mm256_loadu_ps (p + k),
+				     vMin, vMax, vRange, fMax);
+
+	__m256 inside = _mm256_and_ps (_mm256_cmp_ps (r, zero, _CMP_GE_OQ),
+				       _mm256_cmp_ps (r, fMax, _CMP_LT_OQ));
+
+	__m256 above = _mm256_cmp_ps (r, fMax, _CMP_GE_OQ);
+
+	//
+	// Samples outside the table look up segment 0; their
+	// results are replaced by the first or last table entry.
+	//
+
+	__m256i i = _mm256_and_si256 (_mm256_cvttps_epi32 (r),
+				      _mm256_castps_si256 (inside));
+	__m256i s = _mm256_slli_epi32 (i, 2);
+
+	__m256 y0 = _mm256_i32gather_ps (segments,     s, 4);
+	__m256 m0 = _mm256_i32gather_ps (segments + 1, s, 4);
+	__m256 y1 = _mm256_i32gather_ps (segments + 2, s, 4);
+	__m256 m1 = _mm256_i32gather_ps (segments + 3, s, 4);
+
+	__m256 t = _mm256_sub_ps (r, _mm256_cvtepi32_ps (i));
+	__m256 t2 = _mm256_mul_ps (t, t);
+	__m256 t3 = _mm256_mul_ps (t2, t);
+
+	__m256 h0 = _mm256_add_ps (_mm256_sub_ps (_mm256_mul_ps (two, t3),
+						  _mm256_mul_ps (three, t2)),
+				   one);
+	__m256 h1 = _mm256_add_ps (_mm256_sub_ps (t3, _mm256_mul_ps (two, t2)),
+				   t);
+	__m256 h2 = _mm256_add_ps (_mm256_mul_ps (minusTwo, t3),
+				   _mm256_mul_ps (three, t2));
+	__m256 h3 = _mm256_sub_ps (t3, t2);
+
+	__m256 v = _mm256_add_ps (_mm256_add_ps (_mm256_add_ps
+						     (_mm256_mul_ps (y0, h0),
+						      _mm256_mul_ps (m0, h1)),
+						 _mm256_mul_ps (y1, h2)),
+				  _mm256_mul_ps (m1, h3));
+
+	v = _mm256_blendv_ps (_mm256_blendv_ps (first, last, above),
+			      v, inside);
+
+	_mm256_storeu_ps (q + k, v);
+    }
+
+    _mm256_zeroupper();
+    return k;
+}
+
+#endif
+
+} // namespace
+
+
+float
+lookup1D
+    (const float table[],
+     int size,
+     float pMin,
+     float pMax,
+     float p)
+{
+    return lookupLinear (table, size - 1, pMin, pMax, pMax - pMin, p);
+}
+
+
+float
+lookupCubic1D
+    (const float table[],
+     int size,
+     float pMin,
+     float pMax,
+     float p)
+{
+    if (size < 3)
+	return lookup1D (table, size, pMin, pMax, p);
+
+    return lookupCubic (table, size, pMin, pMax, pMax - pMin, p);
+}
+
+
+void
+lookup1D
+    (const float table[],
+     int size,
+     float pMin,
+     float pMax,
+     size_t n,
+     const float p[],
+     float q[])
+{
+    int iMax = size - 1;
+    float pRange = pMax - pMin;
+    size_t k = 0;
+
+#if defined (CTL_LOOKUP_X86)
+
+    if (haveAvx2())
+	k = lookupLinearAvx2 (table, iMax, pMin, pMax, pRange, n, p, q);
+
+#endif
+
+    for (; k < n; ++k)
+	q[k] = lookupLinear (table, iMax, pMin, pMax, pRange, p[k]);
+}
+
+
+void
+lookupCubic1D
+    (const float table[],
+     int size,
+     float pMin,
+     float pMax,
+     size_t n,
+     const float p[],
+     float q[])
+{
+    if (size < 3)
+    {
+	lookup1D (table, size, pMin, pMax, n, p, q);
+	return;
+    }
+
+    int iMax = size - 1;
+    float pRange = pMax - pMin;
+
+    if (size_t (iMax) > 2 * n)
+    {
+	//
+	// Few samples in a large table; computing the tangents of
+	// every segment would cost more than the lookups themselves.
+	//
+
+	for (size_t k = 0; k < n; ++k)
+	    q[k] = lookupCubic (table, size, pMin, pMax, pRange, p[k]);
+
+	return;
+    }
+
+    std::vector<float> segments (4 * iMax);
+
+    for (int i = 0; i < iMax; ++i)
+    {
+	float *s = &segments[4 * i];
+	s[0] = table[i];
+	s[2] = table[i+1];
+	tangents (table, size, i, s[1], s[3]);
+    }
+
+    size_t k = 0;
+
+#if defined (CTL_LOOKUP_X86)
+
+    if (haveAvx2())
+    {
+	k = lookupSegmentsAvx2 (table, &segments[0], iMax,
+				pMin, pMax, pRange, n, p, q);
+    }
+
+#endif
+
+    for (; k < n; ++k)
+    {
+	q[k] = lookupSegments (table, &segments[0], iMax,
+			       pMin, pMax, pRange, p[k]);
+    }
 }
 
 
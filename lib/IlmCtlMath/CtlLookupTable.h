@@ -69,6 +69,23 @@
 //
 //		lookup1D(t,s,pMin,pMax,p) returns f(clamp(p,pMin,pMax)).
 //
+//	lookupCubic1D(t,s,pMin,pMax,p)
+//
+//		Like lookup1D(t,s,pMin,pMax,p), except with piecewise
+//		cubic rather than linear interpolation of the table
+//		entries.
+//
+//	lookup1D(t,s,pMin,pMax,n,p,q)
+//	lookupCubic1D(t,s,pMin,pMax,n,p,q)
+//
+//		Batch versions of the above: for i in [0, n[, q[i] is
+//		set to the lookup of p[i].  The table's scale and, for
+//		cubic interpolation, the tangents of its segments are
+//		computed once per call rather than once per sample, and
+//		the lookups are done eight at a time where the processor
+//		supports it.  The results are identical to those of the
+//		single-sample versions.
+//
 //	lookup3D(t,s,pMin,pMax,p)
 //
 //		Lookup table t, which contains s.x by s.y by s.z
@@ -105,6 +122,7 @@
 //-----------------------------------------------------------------------------
 
 #include <ImathVec.h>
+#include <cstddef>
 
 namespace Ctl {
 
@@ -121,6 +139,22 @@ float	 	lookupCubic1D (const float table[],
 			       float pMax,
 			       float p);
 
+void		lookup1D (const float table[],
+			  int size,
+			  float pMin,
+			  float pMax,
+			  size_t n,
+			  const float p[],
+			  float q[]);
+
+void		lookupCubic1D (const float table[],
+			       int size,
+			       float pMin,
+			       float pMax,
+			       size_t n,
+			       const float p[],
+			       float q[]);
+
 Imath::V3f	lookup3D (const Imath::V3f table[],
 			  const Imath::V3i &size,
 			  const Imath::V3f &pMin,
@@ -0,0 +1,592 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------
+//
+//	class PointTree
+//
+//----------------------------------------------------------------------
+
+#include <CtlPointTree.h>
+#include <ImathLimits.h>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+using namespace std;
+using namespace Imath;
+
+namespace Ctl {
+namespace {
+
+struct IndexComparator
+{
+    int
+    operator() (const size_t &a, const size_t &b)
+    {
+	return points[a][dimension] < points[b][dimension];
+    }
+
+    size_t dimension;
+    const V3f *points;
+};
+
+
+class CompareDistance
+{
+  private:
+
+    V3f		_center;
+    const V3f*	_points;
+
+  public:
+
+    CompareDistance (const V3f &center, const V3f *points)
+    {
+	_center = center;
+	_points = points;
+    }
+
+    bool
+    operator() (size_t a, size_t b)
+    {
+	double al = (_points[a] - _center).length2();
+	double bl = (_points[b] - _center).length2();
+
+	volatile double delta = fabs (al - bl);
+	const double eps = 2.0 * limits<double>::epsilon();
+
+	//
+	// Impose strict weak ordering... if the lengths are the same,
+	// arbitrarily pick the one with the smallest index.
+	//
+
+	if (delta < eps)
+	    return a < b;
+	else
+	    return al < bl;
+    }
+};
+
+
+//
+// Where intersect() puts the indices of the points it finds.
+//
+
+struct VectorSink
+{
+    VectorSink (vector <size_t> &indices): _indices (indices) {}
+
+    void	operator() (size_t index) {_indices.push_back (index);}
+
+    vector <size_t> &	_indices;
+};
+
+
+struct BufferSink
+{
+    BufferSink (size_t indices[], size_t maxIndices):
+	_indices (indices), _maxIndices (maxIndices), _count (0) {}
+
+    void
+    operator() (size_t index)
+    {
+	if (_count < _maxIndices)
+	    _indices[_count] = index;
+
+	_count++;
+    }
+
+    size_t *	_indices;
+    size_t	_maxIndices;
+    size_t	_count;
+};
+
+} // namespace
+
+
+PointTree::PointTree
+    (const V3f *points,
+     size_t numPoints,
+     size_t leafSize,
+     size_t maxDepth)
+:
+    _numPoints (numPoints),
+    _points (points),
+    _leafSize (leafSize),
+    _maxDepth (maxDepth),
+    _depth (0)
+{
+    rebuild();
+}
+
+
+PointTree::~PointTree()
+{
+    // empty
+}
+
+
+void
+PointTree::rebuild()
+{
+    assert (_numPoints > 0);
+    assert (&_points[0] != 0);
+
+    //
+    //	Compute bbox
+    //
+
+    vector <size_t> indexArray (_numPoints);
+    _bbox.makeEmpty();
+
+    for (size_t i = _numPoints; i--;)
+    {
+	_bbox.extendBy (_points[i]);
+	indexArray[i] = i;
+    }
+
+    _nodes.clear();
+    _nodes.reserve (2 * _numPoints / max (_leafSize, size_t (1)) + 1);
+    _depth = 0;
+
+    split (_bbox.majorAxis(), 0, _bbox, &indexArray[0], 0, _numPoints);
+
+    //
+    // Copy the points into the leaves' order.
+    //
+
+    _x.resize (_numPoints);
+    _y.resize (_numPoints);
+    _z.resize (_numPoints);
+    _index.swap (indexArray);
+
+    for (size_t i = 0; i < _numPoints; i++)
+    {
+	const V3f &p = _points[_index[i]];
+	_x[i] = p.x;
+	_y[i] = p.y;
+	_z[i] = p.z;
+    }
+}
+
+
+size_t
+PointTree::split
+    (size_t dimension,
+     size_t depth,
+     const Box3f &box,
+     size_t *array,
+     size_t begin,
+     size_t end)
+{
+    if (_depth < depth)
+	_depth = depth;
+
+    size_t node = _nodes.size();
+    _nodes.push_back (Node());
+    _nodes[node]._begin = begin;
+    _nodes[node]._end = end;
+    _nodes[node]._right = 0;
+    _nodes[node]._midValue = 0;
+    _nodes[node]._dimension = dimension;
+    _nodes[node]._leaf = false;
+    _nodes[node]._hasLeft = false;
+    _nodes[node]._hasRight = false;
+
+    size_t arraySize = end - begin;
+
+    if (arraySize <= _leafSize || depth == _maxDepth)
+    {
+	_nodes[node]._leaf = true;
+	return node;
+    }
+
+    //
+    //	The existing memory is sorted so that all the indexes on
+    //	one side of the splitting plane are contiguous.
+    //	The two remaining groups will be sent to the next
+    //	split box.
+    //
+    //	Median split
+    //
+
+    IndexComparator ic;
+    ic.dimension = dimension;
+    ic.points    = _points;
+
+    size_t *midElement = array + begin + arraySize / 2;
+    std::nth_element (array + begin, midElement, array + end, ic);
+    float midValue = _points[*midElement][dimension];
+    _nodes[node]._midValue = midValue;
+
+    size_t leftArraySize  = arraySize / 2;
+    size_t rightArraySize = arraySize - leftArraySize;
+
+    //
+    //	Remaining points are split according to the major axis
+    //	of the bounding boxes.  The left child is stored right
+    //	after its parent.
+    //
+
+    if (leftArraySize)
+    {
+	Box3f leftBox (box);
+	leftBox.max[dimension] = midValue;
+	_nodes[node]._hasLeft = true;
+
+	split (leftBox.majorAxis(),
+	       depth + 1,
+	       leftBox,
+	       array,
+	       begin,
+	       begin + leftArraySize);
+    }
+
+    if (rightArraySize)
+    {
+	Box3f rightBox (box);
+	rightBox.min[dimension] = midValue;
+	_nodes[node]._hasRight = true;
+
+	size_t right = split (rightBox.majorAxis(),
+			      depth + 1,
+			      rightBox,
+			      array,
+			      begin + leftArraySize,
+			      end);
+
+	_nodes[node]._right = right;
+    }
+
+    return node;
+}
+
+
+void
+PointTree::intersect
+    (const V3f &point,
+     double radius,
+     vector <size_t> &indices) const
+{
+    indices.clear();
+    VectorSink sink (indices);
+    intersect (point, radius, sink);
+}
+
+
+size_t
+PointTree::intersect
+    (const V3f &point,
+     double radius,
+     size_t indices[],
+     size_t maxIndices) const
+{
+    BufferSink sink (indices, maxIndices);
+    intersect (point, radius, sink);
+    return sink._count;
+}
+
+
+size_t
+PointTree::intersect
+    (size_t numQueries,
+     const V3f points[],
+     double radius,
+     size_t offsets[],
+     size_t indices[],
+     size_t maxIndices) const
+{
+    size_t total = 0;
+    offsets[0] = 0;
+
+    for (size_t q = 0; q < numQueries; q++)
+    {
+	size_t stored = min (total, maxIndices);
+
+	total += intersect (points[q],
+			    radius,
+			    indices + stored,
+			    maxIndices - stored);
+
+	offsets[q + 1] = total;
+    }
+
+    return total;
+}
+
+
+template <class Sink>
+void
+PointTree::intersect
+    (const V3f &point,
+     double radius,
+     Sink &sink) const
+{
+    //
+    // A subtree can only hold points within the radius if the point
+    // is in the subtree's box, grown by the radius.  The root's box
+    // is tested here; after that, a child's box differs from its
+    // parent's only along the parent's splitting axis, so only that
+    // axis needs to be tested.
+    //
+
+    float r = radius;
+
+    if (!_nodes[0]._leaf)
+    {
+	V3f rvec (r);
+	Box3f box (_bbox.min - rvec, _bbox.max + rvec);
+
+	if (!box.intersects (point))
+	    return;
+    }
+
+    intersect (0, point, r, radius * radius, sink);
+}
+
+
+template <class Sink>
+void
+PointTree::intersect
+    (size_t node,
+     const V3f &point,
+     float radius,
+     double radius2,
+     Sink &sink) const
+{
+    const Node &n = _nodes[node];
+
+    if (n._leaf)
+    {
+	const float *x = &_x[0];
+	const float *y = &_y[0];
+	const float *z = &_z[0];
+
+	for (size_t i = n._begin; i < n._end; i++)
+	{
+	    float dx = x[i] - point.x;
+	    float dy = y[i] - point.y;
+	    float dz = z[i] - point.z;
+
+	    if (dx * dx + dy * dy + dz * dz < radius2)
+		sink (_index[i]);
+	}
+    }
+    else
+    {
+	float p = point[n._dimension];
+
+	if (n._hasLeft && p <= n._midValue + radius)
+	    intersect (node + 1, point, radius, radius2, sink);
+
+	if (n._hasRight && p >= n._midValue - radius)
+	    intersect (n._right, point, radius, radius2, sink);
+    }
+}
+
+
+void
+PointTree::nearestPoints
+    (const V3f &center,
+     size_t numPoints,
+     vector <size_t> &pointIndices) const
+{
+    pointIndices.resize (0);
+
+    if (_nodes.empty() || numPoints == 0)
+	return;
+
+    if (_numPoints < numPoints)
+    {
+	//
+	// Special case -- the tree contains less than numPoints points.
+	//
+
+	for (size_t i = 0; i < _numPoints; i++)
+	    pointIndices.push_back (i);
+
+	return;
+    }
+
+    //
+    // Find a subtree that contains the center and at least numPoints
+    // points.  Based on the volume of the subtree's bounding box,
+    // make an "educated guess" for a search radius.
+    //
+
+    size_t node = 0;
+    Box3f bbox = _bbox;
+
+    while (!_nodes[node]._leaf)
+    {
+	const Node &n = _nodes[node];
+
+	Box3f leftBbox (bbox);
+	leftBbox.max[n._dimension] = n._midValue;
+
+	Box3f rightBbox (bbox);
+	rightBbox.min[n._dimension] = n._midValue;
+
+	if (n._hasLeft &&
+	    leftBbox.intersects (center) &&
+	    _nodes[node + 1]._end - _nodes[node + 1]._begin >= numPoints)
+	{
+	    node = node + 1;
+	    bbox = leftBbox;
+	}
+	else if (n._hasRight &&
+		 rightBbox.intersects (center) &&
+		 _nodes[n._right]._end - _nodes[n._right]._begin >= numPoints)
+	{
+	    node = n._right;
+	    bbox = rightBbox;
+	}
+	else
+	{
+	    break;
+	}
+    }
+
+    double nodeVolume = boxVolume (bbox);
+    double searchVolume = 2 * nodeVolume * numPoints /
+			  (_nodes[node]._end - _nodes[node]._begin);
+    double searchRadius = radiusOfSphereWithVolume (searchVolume);
+
+    //
+    // Find all points within the search radius.
+    // If we find less than numPoints points, increase
+    // the search radius (double the search volume).
+    //
+
+    intersect (center, searchRadius, pointIndices);
+
+    while (pointIndices.size() < numPoints)
+    {
+	searchRadius = radiusOfSphereWithTwiceVolume (searchRadius);
+	intersect (center, searchRadius, pointIndices);
+    }
+
+    //
+    // Vector pointIndices now contains at least numPoints points,
+    // and probably not too many more.  Partially sort the points
+    // so that the points closest to the center are in the vector's
+    // first numPoints positions.  Then truncate the vector.
+    //
+
+    std::nth_element (pointIndices.begin(),
+		      pointIndices.begin() + (numPoints - 1),
+		      pointIndices.end(),
+		      CompareDistance (center, _points));
+
+    pointIndices.resize (numPoints);
+}
+
+
+void
+PointTree::nearestPoints
+    (size_t numQueries,
+     const V3f centers[],
+     size_t numPoints,
+     size_t indices[]) const
+{
+    //
+    // One vector holds the candidates of all the queries.
+    //
+
+    vector <size_t> pointIndices;
+
+    for (size_t q = 0; q < numQueries; q++)
+    {
+	nearestPoints (centers[q], numPoints, pointIndices);
+	copy (pointIndices.begin(), pointIndices.end(), indices + q * numPoints);
+    }
+}
+
+
+double
+PointTree::boxVolume (const Box3f &box)
+{
+    double volume = 1;
+
+    for (size_t i = 0; i < 3; ++i)
+    	if (box.max[i] - box.min[i] > 0)
+	    volume *= box.max[i] - box.min[i];
+
+    return volume;
+}
+
+
+inline double
+PointTree::radiusOfSphereWithVolume (double volume)
+{
+    #ifdef _WIN32
+	if (volume <= 0)
+	    return 0;
+	else
+	    return (double) pow (0.238732 * volume, 1.0 / 3.0);
+    #else
+	return (double) cbrt (0.238732 * volume);
+    #endif
+}                          // 3/(4*pi)
+
+
+inline double
+PointTree::radiusOfSphereWithTwiceVolume (double radius)
+{
+    return (double) (1.25992 * radius);
+}                 // cbrt(2)
+
+
+} // namespace Ctl
@@ -0,0 +1,441 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------
+//
+//	class RbfGridCache
+//
+//----------------------------------------------------------------------------
+
+#include <CtlRbfGridCache.h>
+#include <CtlRbfInterpolator.h>
+#include <IlmThreadMutex.h>
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace Imath;
+using namespace IlmThread;
+
+namespace Ctl {
+namespace {
+
+//
+// The first bytes of a cache file; the digit is the version
+// of the file format, and is also changed when the fit that
+// produces the grids changes their values.
+//
+
+const char fileMagic[8] = {'C', 'T', 'L', 'G', 'R', 'I', 'D', '3'};
+
+
+struct Entry
+{
+    unsigned long long	hash;
+    vector <char>	key;
+    vector <V3f>	grid;
+};
+
+
+struct CacheData
+{
+    Mutex		mutex;
+    list <Entry *>	entries;	// most recently used first
+    size_t		memory;
+    size_t		maxMemory;
+    string		directory;
+    RbfGridCache::Stats	stats;
+
+    CacheData ();
+   ~CacheData ();
+};
+
+
+CacheData::CacheData (): memory (0), maxMemory (64 * 1024 * 1024)
+{
+    const char *env = getenv ("CTL_GRID_CACHE");
+
+    if (env)
+	directory = env;
+
+    stats.memoryHits = 0;
+    stats.diskHits = 0;
+    stats.misses = 0;
+}
+
+
+CacheData::~CacheData ()
+{
+    for (list <Entry *>::iterator i = entries.begin(); i != entries.end(); ++i)
+	delete *i;
+}
+
+
+CacheData &
+cacheData ()
+{
+    static CacheData data;
+    return data;
+}
+
+
+size_t
+entrySize (const Entry *entry)
+{
+    return entry->key.size() + entry->grid.size() * sizeof (V3f);
+}
+
+
+//
+// Drops the entries used least recently until the
+// entries take no more than data.maxMemory bytes.
+//
+
+void
+trim (CacheData &data)
+{
+    while (data.memory > data.maxMemory)
+    {
+	Entry *entry = data.entries.back();
+	data.entries.pop_back();
+	data.memory -= entrySize (entry);
+	delete entry;
+    }
+}
+
+
+void
+append (vector <char> &key, const void *bytes, size_t size)
+{
+    key.insert (key.end(), (const char *) bytes, (const char *) bytes + size);
+}
+
+
+//
+// 64-bit FNV-1a
+//
+
+unsigned long long
+hashBytes (const vector <char> &bytes)
+{
+    unsigned long long h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+	h ^= (unsigned char) bytes[i];
+	h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+
+string
+fileName (const string &directory, unsigned long long hash)
+{
+    char name[32];
+    snprintf (name, sizeof (name), "/rbfgrid-%016llx.bin", hash);
+    return directory + name;
+}
+
+
+//
+// Reads the grid for key from a cache file.  Returns false if
+// there is no such file, or if it holds a grid for other data.
+//
+
+bool
+readFile (const string &name, const vector <char> &key, vector <V3f> &grid)
+{
+    FILE *file = fopen (name.c_str(), "rb");
+
+    if (!file)
+	return false;
+
+    char magic[sizeof (fileMagic)];
+    unsigned long long sizes[2];
+    vector <char> fileKey (key.size());
+
+    bool ok = fread (magic, sizeof (magic), 1, file) == 1 &&
+	      !memcmp (magic, fileMagic, sizeof (magic)) &&
+	      fread (sizes, sizeof (sizes), 1, file) == 1 &&
+	      sizes[0] == key.size() &&
+	      sizes[1] == grid.size() &&
+	      fread (&fileKey[0], fileKey.size(), 1, file) == 1 &&
+	      fileKey == key &&
+	      fread (&grid[0], sizeof (V3f), grid.size(), file) == grid.size();
+
+    fclose (file);
+    return ok;
+}
+
+
+//
+// Saves a grid.  The file is written under a temporary name and
+// then renamed, so that another process never reads half a file.
+// Errors are ignored; the grid is simply not cached.
+//
+
+void
+writeFile (const string &name, const vector <char> &key, const vector <V3f> &grid)
+{
+    char suffix[32];
+    snprintf (suffix, sizeof (suffix), ".%d.tmp", (int) getpid());
+    string tmpName = name + suffix;
+
+    FILE *file = fopen (tmpName.c_str(), "wb");
+
+    if (!file)
+	return;
+
+    unsigned long long sizes[2] = {key.size(), grid.size()};
+
+    bool ok = fwrite (fileMagic, sizeof (fileMagic), 1, file) == 1 &&
+	      fwrite (sizes, sizeof (sizes), 1, file) == 1 &&
+	      fwrite (&key[0], key.size(), 1, file) == 1 &&
+	      fwrite (&grid[0], sizeof (V3f), grid.size(), file) == grid.size();
+
+    ok = (fclose (file) == 0) && ok;
+
+    if (!ok || rename (tmpName.c_str(), name.c_str()) != 0)
+	remove (tmpName.c_str());
+}
+
+} // namespace
+
+
+void
+RbfGridCache::valueGrid
+    (size_t n,
+     const V3f p[/*n*/][2],
+     const V3f &pMin,
+     const V3f &pMax,
+     const V3i &gridSize,
+     V3f grid[])
+{
+    if (gridSize.x <= 0 || gridSize.y <= 0 || gridSize.z <= 0)
+	return;
+
+    size_t numNodes = size_t (gridSize.x) * gridSize.y * gridSize.z;
+
+    //
+    // The key holds everything the grid depends on.
+    //
+
+    Entry *entry = new Entry;
+    unsigned long long count = n;
+
+    append (entry->key, &count, sizeof (count));
+    append (entry->key, p, n * sizeof (p[0]));
+    append (entry->key, &pMin, sizeof (pMin));
+    append (entry->key, &pMax, sizeof (pMax));
+    append (entry->key, &gridSize, sizeof (gridSize));
+    entry->hash = hashBytes (entry->key);
+
+    CacheData &data = cacheData();
+    string directory;
+
+    {
+	Lock lock (data.mutex);
+
+	for (list <Entry *>::iterator i = data.entries.begin();
+	     i != data.entries.end();
+	     ++i)
+	{
+	    if ((*i)->hash == entry->hash && (*i)->key == entry->key)
+	    {
+		copy ((*i)->grid.begin(), (*i)->grid.end(), grid);
+		data.entries.splice (data.entries.begin(), data.entries, i);
+		data.stats.memoryHits++;
+		delete entry;
+		return;
+	    }
+	}
+
+	directory = data.directory;
+    }
+
+    entry->grid.resize (numNodes);
+    string name;
+    bool fromFile = false;
+
+    try
+    {
+	if (!directory.empty())
+	{
+	    name = fileName (directory, entry->hash);
+	    fromFile = readFile (name, entry->key, entry->grid);
+	}
+
+	if (!fromFile)
+	{
+	    RbfInterpolator interp (n, p);
+	    interp.valueGrid (pMin, pMax, gridSize, &entry->grid[0]);
+
+	    if (!name.empty())
+		writeFile (name, entry->key, entry->grid);
+	}
+    }
+    catch (...)
+    {
+	delete entry;
+	throw;
+    }
+
+    copy (entry->grid.begin(), entry->grid.end(), grid);
+
+    Lock lock (data.mutex);
+
+    if (fromFile)
+	data.stats.diskHits++;
+    else
+	data.stats.misses++;
+
+    if (entrySize (entry) > data.maxMemory)
+    {
+	delete entry;
+	return;
+    }
+
+    data.entries.push_front (entry);
+    data.memory += entrySize (entry);
+    trim (data);
+}
+
+
+RbfGridCache::Stats
+RbfGridCache::stats ()
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    return data.stats;
+}
+
+
+void
+RbfGridCache::resetStats ()
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    data.stats.memoryHits = 0;
+    data.stats.diskHits = 0;
+    data.stats.misses = 0;
+}
+
+
+string
+RbfGridCache::directory ()
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    return data.directory;
+}
+
+
+void
+RbfGridCache::setDirectory (const string &dir)
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    data.directory = dir;
+}
+
+
+size_t
+RbfGridCache::maxMemory ()
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    return data.maxMemory;
+}
+
+
+void
+RbfGridCache::setMaxMemory (size_t bytes)
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+    data.maxMemory = bytes;
+    trim (data);
+}
+
+
+void
+RbfGridCache::clear ()
+{
+    CacheData &data = cacheData();
+    Lock lock (data.mutex);
+
+    for (list <Entry *>::iterator i = data.entries.begin();
+	 i != data.entries.end();
+	 ++i)
+    {
+	delete *i;
+    }
+
+    data.entries.clear();
+    data.memory = 0;
+}
+
+} // namespace Ctl
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef INCLUDED_CTL_RBF_GRID_CACHE_H
+#define INCLUDED_CTL_RBF_GRID_CACHE_H
+
+//-----------------------------------------------------------------------------
+//
+//	class RbfGridCache -- remembers the grids computed from scattered
+//	3D data by RbfInterpolator::valueGrid().
+//
+//	Building an RbfInterpolator solves a sparse linear system for
+//	every sample, and evaluating it on a fine grid takes much longer
+//	still.  CTL scripts that turn measured data into a grid with
+//	scatteredDataToGrid3D() usually pass the same data every time
+//	they run, so the grids are kept, keyed by a hash of the data, the
+//	extent and the size of the grid.
+//
+//	The grids are kept in memory, up to a total of maxMemory() bytes,
+//	dropping the ones used least recently.  If a directory is set,
+//	each new grid is also saved there, and grids that are not in
+//	memory are looked for there, so they survive from one run of a
+//	program to the next.  The directory defaults to the value of the
+//	environment variable CTL_GRID_CACHE; without it, no files are read
+//	or written.
+//
+//	The data of a cached grid are compared with the data passed in,
+//	not just their hashes, and a file that cannot be read or does not
+//	match is ignored, so a stale or damaged cache can cost time but
+//	not change a result.
+//
+//	All functions are thread safe.
+//
+//-----------------------------------------------------------------------------
+
+#include <ImathVec.h>
+#include <string>
+#include <stddef.h>
+
+namespace Ctl {
+
+class RbfGridCache
+{
+  public:
+
+    //---------------------------------------------------------------
+    // Stores in grid the values of an RbfInterpolator made from
+    // the n pairs p, at the nodes of the grid given by pMin, pMax
+    // and gridSize (see RbfInterpolator::valueGrid()), taking them
+    // from the cache if they have been computed before.
+    //---------------------------------------------------------------
+
+    static void		valueGrid (size_t n,
+				   const Imath::V3f p[/*n*/][2],
+				   const Imath::V3f &pMin,
+				   const Imath::V3f &pMax,
+				   const Imath::V3i &gridSize,
+				   Imath::V3f grid[]);
+
+    //---------------------------------------------------------------
+    // Counters: calls that found their grid in memory, calls that
+    // read it from the cache directory, and calls that computed it.
+    //---------------------------------------------------------------
+
+    struct Stats
+    {
+	size_t		memoryHits;
+	size_t		diskHits;
+	size_t		misses;
+    };
+
+    static Stats	stats ();
+    static void		resetStats ();
+
+    //---------------------------------------------------------------
+    // Cache settings.  An empty directory turns the cache files off.
+    // clear() forgets the grids held in memory (but does not remove
+    // any files).
+    //---------------------------------------------------------------
+
+    static std::string	directory ();
+    static void		setDirectory (const std::string &dir);
+
+    static size_t	maxMemory ();
+    static void		setMaxMemory (size_t bytes);
+
+    static void		clear ();
+};
+
+} // namespace Ctl
+
+#endif
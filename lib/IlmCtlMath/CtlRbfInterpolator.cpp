@@ -62,9 +62,13 @@
 #include <CtlPointTree.h>
 #include <CtlSparseMatrix.h>
 #include <CtlLinearSolver.h>
+#include <CtlSparseLDLT.h>
+#include <IlmThreadPool.h>
+#include <algorithm>
 
 using namespace std;
 using namespace Imath;
+using namespace IlmThread;
 
 //#define DEBUG_RBF
 
@@ -133,9 +137,6 @@ RbfInterpolator::RbfInterpolator (size_t n, const Imath::V3f p[/*n*/][2]):
 	_samplePts[s] = p[s][0];
 
     std::vector<double> b(3*_numSamples);
-    std::vector<double> bX(_numSamples);
-    std::vector<double> bY(_numSamples);
-    std::vector<double> bZ(_numSamples);
     std::vector<double> valSparse;
     std::vector<size_t> colInd;
     std::vector<size_t> rowPts;
@@ -203,16 +204,19 @@ RbfInterpolator::RbfInterpolator (size_t n, const Imath::V3f p[/*n*/][2]):
 
     // Compute spread for each kernel
     size_t numNeighbor = 4;
+    size_t numFound = std::min (numNeighbor, _numSamples);
+    std::vector <size_t> nearest (_numSamples * numNeighbor);
+
+    _pointTree->nearestPoints (_numSamples, &_samplePts[0], numNeighbor,
+			       &nearest[0]);
 
     _maxSigma = .0;    
     for ( size_t i = 0; i < _numSamples; i++) 
     {	
-	std::vector <size_t> indices;
-
-	_pointTree->nearestPoints (_samplePts[i], numNeighbor, indices);
+	const size_t *indices = &nearest[i * numNeighbor];
 	
 	double sum = .0;
-	for (size_t n = 0; n < indices.size(); n++)
+	for (size_t n = 0; n < numFound; n++)
 	{
 	    size_t nidx = indices[n];
 	    double delta[3];
@@ -247,16 +251,43 @@ RbfInterpolator::RbfInterpolator (size_t n, const Imath::V3f p[/*n*/][2]):
     
     rowPts.push_back(0);	    
 
+    // The neighbours of the samples are found a block of samples
+    // at a time, into buffers that are reused.
+    const size_t blockSize = 256;
+    std::vector <size_t> offsets (blockSize + 1);
+    std::vector <size_t> neighbors (blockSize * 32);
+    size_t firstInBlock = 0;
+
     endRow = 0;
     for ( size_t s = 0; s < _numSamples; s++)
     {
-	std::vector <size_t> indices;
+	if (s % blockSize == 0)
+	{
+	    size_t count = std::min (blockSize, _numSamples - s);
+	    size_t total = _pointTree->intersect (count, &_samplePts[s],
+						  2.*_maxSigma, &offsets[0],
+						  &neighbors[0],
+						  neighbors.size());
+
+	    if (total > neighbors.size())
+	    {
+		neighbors.resize (total);
+		_pointTree->intersect (count, &_samplePts[s], 2.*_maxSigma,
+				       &offsets[0], &neighbors[0],
+				       neighbors.size());
+	    }
+
+	    firstInBlock = s;
+	}
+
+	const size_t *indices = &neighbors[offsets[s - firstInBlock]];
+	size_t numIndices = offsets[s - firstInBlock + 1] -
+			    offsets[s - firstInBlock];
 	
 	Imath::V3f center = _samplePts[s];
-	_pointTree->intersect(center, 2.*_maxSigma, indices);
 		
 	size_t nonZero = 0;
-	for (size_t n = 0; n < indices.size(); n++)
+	for (size_t n = 0; n < numIndices; n++)
 	{
 	    size_t nidx = indices[n];
 	    double dist = (center - _samplePts[nidx]).length();
@@ -270,10 +301,11 @@ RbfInterpolator::RbfInterpolator (size_t n, const Imath::V3f p[/*n*/][2]):
 	    }
 	}
 
-	// fit data minus estimated affine function
-	bX[s] = p[s][1][0] - (_affine[0]*p[s][0][0] + _affine[1]*p[s][0][1] + _affine[2]*p[s][0][2] + _affine[3]);
-	bY[s] = p[s][1][1] - (_affine[4]*p[s][0][0] + _affine[5]*p[s][0][1] + _affine[6]*p[s][0][2] + _affine[7]);
-	bZ[s] = p[s][1][2] - (_affine[8]*p[s][0][0] + _affine[9]*p[s][0][1] + _affine[10]*p[s][0][2] + _affine[11]);
+	// fit data minus estimated affine function; the X, Y and Z
+	// right-hand sides are interleaved, like the lambdas
+	b[3*s+0] = p[s][1][0] - (_affine[0]*p[s][0][0] + _affine[1]*p[s][0][1] + _affine[2]*p[s][0][2] + _affine[3]);
+	b[3*s+1] = p[s][1][1] - (_affine[4]*p[s][0][0] + _affine[5]*p[s][0][1] + _affine[6]*p[s][0][2] + _affine[7]);
+	b[3*s+2] = p[s][1][2] - (_affine[8]*p[s][0][0] + _affine[9]*p[s][0][1] + _affine[10]*p[s][0][2] + _affine[11]);
 	
 	endRow += nonZero;
 	
@@ -282,55 +314,99 @@ RbfInterpolator::RbfInterpolator (size_t n, const Imath::V3f p[/*n*/][2]):
     }
 
     CRSOperator<double> OMA(valSparse, colInd, rowPts, _numSamples);
-    
-    LSSCG<double, CRSOperator<double> > lss(OMA);
 
-    std::vector<double> solX(_numSamples, 0.0);
-    std::vector<double> solY(_numSamples, 0.0);
-    std::vector<double> solZ(_numSamples, 0.0);
-    
-    lss.solver.maxNumIterations = 30*_numSamples;
-    lss.solver.tolerance = 1.e-7;
-    
-#ifndef DEBUG_RBF
-    lss(bX.begin(), bX.end(), solX.begin(), solX.end());
-    lss(bY.begin(), bY.end(), solY.begin(), solY.end());
-    lss(bZ.begin(), bZ.end(), solZ.begin(), solZ.end());        
-#else
-    std::vector<double> s(_numSamples);
-    double tolX = lss(bX.begin(), bX.end(), solX.begin(), solX.end());
-    double tolY = lss(bY.begin(), bY.end(), solY.begin(), solY.end());
-    double tolZ = lss(bZ.begin(), bZ.end(), solZ.begin(), solZ.end());    
+    //
+    // The three systems share the matrix, so they are solved together,
+    // which traverses the matrix once per iteration instead of three
+    // times.  Large matrices are applied in parallel, in a pool of our
+    // own, since we may be running in a task of the global pool.
+    //
+
+    int numThreads = ThreadPool::globalThreadPool().numThreads();
+    ThreadPool pool (numThreads > 1? numThreads: 0);
+    OMA.threadPool = &pool;
     
-    std::cout << "bX\n";
-    copy(bX.begin(), bX.end(), ostream_iterator<double>(std::cout, " "));
-    cout << "\nsX\n";
-    OMA.apply(solX.begin(), solX.end(), s.begin(), s.end());    
-    copy(s.begin(), s.end(), ostream_iterator<double>(cout, " "));
-
-    std::cout << "\n\nbY\n";
-    copy(bY.begin(), bY.end(), ostream_iterator<double>(std::cout, " "));
-    cout << "\nsY\n";
-    OMA.apply(solY.begin(), solY.end(), s.begin(), s.end());    
-    copy(s.begin(), s.end(), ostream_iterator<double>(cout, " "));
-
-    std::cout << "\n\nbZ\n";
-    copy(bZ.begin(), bZ.end(), ostream_iterator<double>(std::cout, " "));
-    cout << "\nsZ\n";
-    OMA.apply(solZ.begin(), solZ.end(), s.begin(), s.end());    
-    copy(s.begin(), s.end(), ostream_iterator<double>(cout, " "));
-
-
-    std::cout << "\n\nTolerance " << tolX << " " << tolY << " " << tolZ <<
-    std::endl;
-#endif
+    fill(_lambdas.begin(), _lambdas.end(), 0.0);
+
+    //
+    // Systems that are small enough are solved directly, by factoring
+    // A' A: that is exact, and on clustered samples, where CG needs
+    // many iterations, also faster.  As the number of samples grows,
+    // the factor fills in faster than CG slows down.  Measured with
+    // 1000 to 20000 samples, the factorization takes about as long as
+    // CG when it needs 4000 to 8000 operations per nonzero element of
+    // A; on uniformly spread samples, the break-even point is closer
+    // to 4000 (5000 samples need about 5500 and are left to CG).
+    // Above 8192 samples, ordering A' A only to then choose CG would
+    // cost too much, so CG is used right away.
+    //
+
+    bool solved = false;
+
+    if (_numSamples <= 8192)
+    {
+	LSSLDLT<double> direct(OMA);
 
-    for (size_t s = 0; s < _numSamples; s++) 
+	if (direct.solver.numFactorOperations() <= 4000. * OMA.val.size())
+	{
+	    try
+	    {
+		direct(3, b.begin(), b.end(), _lambdas.begin(), _lambdas.end());
+		solved = true;
+	    }
+	    catch (const Iex::MathExc &)
+	    {
+		//
+		// A' A is singular to working precision, for example,
+		// when some samples almost coincide but their values
+		// differ.  The exact solution would then have huge
+		// weights that cancel each other; CG still finds a
+		// least-squares fit with moderate weights.
+		//
+	    }
+	}
+    }
+
+    if (!solved)
+    {
+	//
+	// The sizes of the kernels, and with them the norms of the
+	// columns of the matrix, vary a lot when the samples are
+	// clustered; scaling the normal equations by their diagonal
+	// (Jacobi preconditioning) then saves most of the iterations.
+	// The preconditioned solver stops when the squared residual
+	// has dropped by the tolerance.
+	//
+
+	std::vector<double> diag(_numSamples);
+	OMA.normalDiagonal(diag.begin(), diag.end());
+	JacobiPreconditioner<double> jacobi(diag.begin(), diag.end());
+
+	LSSCG<double, CRSOperator<double>, JacobiPreconditioner<double> >
+	    lss(OMA, &jacobi);
+
+	lss.solver.maxNumIterations = 30*_numSamples;
+	lss.solver.tolerance = 1.e-18;
+
+	lss(3, b.begin(), b.end(), _lambdas.begin(), _lambdas.end());
+    }
+
+#ifdef DEBUG_RBF
+    std::vector<double> s(3*_numSamples);
+    OMA.apply(3, _lambdas.begin(), _lambdas.end(), s.begin(), s.end());
+
+    for (size_t c = 0; c < 3; c++)
     {
-	_lambdas[3*s+0] = solX[s];
-	_lambdas[3*s+1] = solY[s];
-	_lambdas[3*s+2] = solZ[s];
+	std::cout << "\n\nb" << "XYZ"[c] << "\n";
+	for (size_t i = 0; i < _numSamples; i++)
+	    std::cout << b[3*i+c] << " ";
+	std::cout << "\ns" << "XYZ"[c] << "\n";
+	for (size_t i = 0; i < _numSamples; i++)
+	    std::cout << s[3*i+c] << " ";
     }
+
+    std::cout << "\n\nSolved " << (solved? "directly": "by CG") << std::endl;
+#endif
 }
 
 
@@ -344,6 +420,15 @@ Imath::V3f
 RbfInterpolator::value (const Imath::V3f &x) const
 {
     std::vector <size_t> indices;
+    return value (x, indices);
+}
+
+
+Imath::V3f
+RbfInterpolator::value
+    (const Imath::V3f &x,
+     std::vector <size_t> &indices) const
+{
     _pointTree->intersect(x, 2.*_maxSigma, indices);
     
     double sumX = .0;
@@ -395,4 +480,157 @@ RbfInterpolator::gradient (const Imath::V3f &x) const
     return Imath::V3f(sumX, sumY, sumZ);
 }
 
+
+namespace {
+
+//
+// Evaluates the rows of grid nodes (i,j) from firstRow to
+// firstRow + numRows - 1, where row i * gridSize.y + j holds
+// the nodes (i,j,0) to (i,j,gridSize.z-1).
+//
+
+void
+valueRows
+    (const RbfInterpolator &interp,
+     const V3f &pMin,
+     const V3f &pMax,
+     const V3i &gridSize,
+     V3f grid[],
+     size_t firstRow,
+     size_t numRows)
+{
+    std::vector <size_t> indices;
+    float s, t;
+    V3f p;
+
+    for (size_t row = firstRow; row < firstRow + numRows; ++row)
+    {
+	int i = row / gridSize.y;
+	int j = row % gridSize.y;
+
+	s = float (i) / float (gridSize.x - 1);
+	t = 1 - s;
+	p.x = pMin.x * t + pMax.x * s;
+
+	s = float (j) / float (gridSize.y - 1);
+	t = 1 - s;
+	p.y = pMin.y * t + pMax.y * s;
+
+	for (int k = 0; k < gridSize.z; ++k)
+	{
+	    s = float (k) / float (gridSize.z - 1);
+	    t = 1 - s;
+	    p.z = pMin.z * t + pMax.z * s;
+
+	    grid[row * gridSize.z + k] = interp.value (p, indices);
+	}
+    }
+}
+
+
+class GridTask: public Task
+{
+  public:
+
+    GridTask (TaskGroup *group,
+	      const RbfInterpolator &interp,
+	      const V3f &pMin,
+	      const V3f &pMax,
+	      const V3i &gridSize,
+	      V3f grid[],
+	      size_t firstRow,
+	      size_t numRows);
+
+    virtual void	execute ();
+
+  private:
+
+    const RbfInterpolator &	_interp;
+    V3f				_pMin;
+    V3f				_pMax;
+    V3i				_gridSize;
+    V3f *			_grid;
+    size_t			_firstRow;
+    size_t			_numRows;
+};
+
+
+GridTask::GridTask
+    (TaskGroup *group,
+     const RbfInterpolator &interp,
+     const V3f &pMin,
+     const V3f &pMax,
+     const V3i &gridSize,
+     V3f grid[],
+     size_t firstRow,
+     size_t numRows)
+:
+    Task (group),
+    _interp (interp),
+    _pMin (pMin),
+    _pMax (pMax),
+    _gridSize (gridSize),
+    _grid (grid),
+    _firstRow (firstRow),
+    _numRows (numRows)
+{
+    // empty
+}
+
+
+void
+GridTask::execute ()
+{
+    valueRows (_interp, _pMin, _pMax, _gridSize, _grid, _firstRow, _numRows);
+}
+
+} // namespace
+
+
+void
+RbfInterpolator::valueGrid
+    (const Imath::V3f &pMin,
+     const Imath::V3f &pMax,
+     const Imath::V3i &gridSize,
+     Imath::V3f grid[]) const
+{
+    if (gridSize.x <= 0 || gridSize.y <= 0 || gridSize.z <= 0)
+	return;
+
+    size_t numRows = size_t (gridSize.x) * gridSize.y;
+    int numThreads = ThreadPool::globalThreadPool().numThreads();
+
+    //
+    // Small grids are not worth starting threads for.
+    //
+
+    if (numThreads < 2 || numRows * gridSize.z < 4096)
+    {
+	valueRows (*this, pMin, pMax, gridSize, grid, 0, numRows);
+	return;
+    }
+
+    //
+    // The density of the samples, and so the cost of a node, varies
+    // across the grid; several tasks per thread keep the threads busy
+    // until the end.
+    //
+
+    size_t numTasks = std::min (numRows, size_t (numThreads) * 8);
+    ThreadPool pool (numThreads);
+
+    {
+	TaskGroup group;
+
+	for (size_t task = 0; task < numTasks; ++task)
+	{
+	    size_t firstRow = numRows * task / numTasks;
+	    size_t endRow = numRows * (task + 1) / numTasks;
+
+	    pool.addTask (new GridTask (&group, *this, pMin, pMax, gridSize,
+					grid, firstRow, endRow - firstRow));
+	}
+    }
+}
+
 } // namespace Ctl
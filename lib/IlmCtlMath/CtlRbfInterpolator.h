@@ -102,11 +102,36 @@ class RbfInterpolator
     // from being exactly equal to p[i][1].)
     //
     // gradient(x) returns the gradient of g(x).
+    //
+    // value(x,indices) is the same as value(x), but uses indices
+    // to find the samples near x, so that evaluating g at many
+    // points with the same vector does not allocate memory for
+    // each of them.
     //---------------------------------------------------------------
 
     Imath::V3f  value (const Imath::V3f &x) const;
+    Imath::V3f  value (const Imath::V3f &x,
+                       std::vector <size_t> &indices) const;
     Imath::V3f  gradient (const Imath::V3f &x) const;
 
+    //---------------------------------------------------------------
+    // Evaluation on a grid:
+    //
+    // valueGrid(pMin,pMax,gridSize,grid) evaluates g at the nodes of
+    // a regular grid that spans the box from pMin to pMax, and stores
+    // the results in grid[(i * gridSize.y + j) * gridSize.z + k].
+    // The nodes are spread across as many threads as there are in
+    // IlmThread's global thread pool (a private pool is used, so that
+    // this may be called from a task in the global pool).  Each node
+    // is evaluated the same way by any thread, so the results do not
+    // depend on the number of threads.
+    //---------------------------------------------------------------
+
+    void	valueGrid (const Imath::V3f &pMin,
+			   const Imath::V3f &pMax,
+			   const Imath::V3i &gridSize,
+			   Imath::V3f grid[]) const;
+
 
   private:    
         
@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------
+//
+//	Approximate minimum degree ordering for SparseLDLT
+//
+//----------------------------------------------------------------------
+
+#include <CtlSparseLDLT.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace Ctl {
+namespace {
+
+void
+insertDegree
+    (size_t i,
+     size_t d,
+     vector <size_t> &head,
+     vector <size_t> &next,
+     vector <size_t> &prev)
+{
+    size_t none = head.size();
+
+    next[i] = head[d];
+    prev[i] = none;
+
+    if (head[d] != none)
+	prev[head[d]] = i;
+
+    head[d] = i;
+}
+
+
+void
+removeDegree
+    (size_t i,
+     size_t d,
+     vector <size_t> &head,
+     vector <size_t> &next,
+     vector <size_t> &prev)
+{
+    size_t none = head.size();
+
+    if (prev[i] != none)
+	next[prev[i]] = next[i];
+    else
+	head[d] = next[i];
+
+    if (next[i] != none)
+	prev[next[i]] = prev[i];
+}
+
+} // namespace
+
+
+void
+approximateMinimumDegree
+    (size_t n,
+     const size_t rowPtr[],
+     const size_t colInd[],
+     size_t perm[])
+{
+    //
+    // The elimination is simulated on a quotient graph: eliminating
+    // variable p turns it into an element, whose variables are the
+    // neighbours of p, instead of connecting all of them to each
+    // other.  For each variable i we keep
+    //
+    //	adj[i]		the variables adjacent to i that are not
+    //			covered by an element of i,
+    //	elements[i]	the elements adjacent to i,
+    //
+    // and for each element e, vars[e], its variables.  Every step
+    // eliminates the variable with the smallest approximate external
+    // degree, an upper bound on the number of variables that would
+    // become its neighbours, which is much cheaper to keep up to date
+    // than the exact degree.  Supervariable detection is omitted.
+    //
+
+    vector < vector <size_t> > adj (n);
+    vector < vector <size_t> > elements (n);
+    vector < vector <size_t> > vars (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	for (size_t k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+	{
+	    size_t j = colInd[k];
+
+	    if (j != i)
+	    {
+		adj[i].push_back (j);
+		adj[j].push_back (i);
+	    }
+	}
+    }
+
+    //
+    // The variables are kept in doubly linked lists, one per degree.
+    //
+
+    const size_t none = n;
+    vector <size_t> degree (n);
+    vector <size_t> head (n, none);
+    vector <size_t> next (n);
+    vector <size_t> prev (n);
+    size_t minDegree = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	sort (adj[i].begin(), adj[i].end());
+	adj[i].erase (unique (adj[i].begin(), adj[i].end()), adj[i].end());
+	degree[i] = adj[i].size();
+	insertDegree (i, degree[i], head, next, prev);
+    }
+
+    vector <size_t> mark (n, none);	// variables: in vars[p] at step k
+    vector <size_t> wStep (n, none);	// elements: w[e] set at step k
+    vector <size_t> w (n);		// elements: size of vars[e] - vars[p]
+    vector <char> absorbed (n, false);
+    vector <char> eliminated (n, false);
+
+    for (size_t k = 0; k < n; ++k)
+    {
+	while (head[minDegree] == none)
+	    ++minDegree;
+
+	size_t p = head[minDegree];
+	removeDegree (p, degree[p], head, next, prev);
+
+	perm[k] = p;
+	eliminated[p] = true;
+	mark[p] = k;
+
+	//
+	// The variables of the new element p are the neighbours of
+	// p, and the variables of the elements of p, which p absorbs.
+	//
+
+	vector <size_t> &lp = vars[p];
+
+	for (size_t a = 0; a < adj[p].size(); ++a)
+	{
+	    size_t j = adj[p][a];
+
+	    if (mark[j] != k)
+	    {
+		mark[j] = k;
+		lp.push_back (j);
+	    }
+	}
+
+	for (size_t a = 0; a < elements[p].size(); ++a)
+	{
+	    size_t e = elements[p][a];
+
+	    if (absorbed[e])
+		continue;
+
+	    for (size_t b = 0; b < vars[e].size(); ++b)
+	    {
+		size_t j = vars[e][b];
+
+		if (!eliminated[j] && mark[j] != k)
+		{
+		    mark[j] = k;
+		    lp.push_back (j);
+		}
+	    }
+
+	    absorbed[e] = true;
+	    vector <size_t>().swap (vars[e]);
+	}
+
+	vector <size_t>().swap (adj[p]);
+	vector <size_t>().swap (elements[p]);
+
+	//
+	// For the other elements of the variables of p, find how many
+	// of their variables are not variables of p.  Elements that
+	// have none left are absorbed by p.
+	//
+
+	for (size_t a = 0; a < lp.size(); ++a)
+	{
+	    const vector <size_t> &ei = elements[lp[a]];
+
+	    for (size_t b = 0; b < ei.size(); ++b)
+	    {
+		size_t e = ei[b];
+
+		if (absorbed[e])
+		    continue;
+
+		if (wStep[e] != k)
+		{
+		    wStep[e] = k;
+		    w[e] = vars[e].size();
+		}
+
+		--w[e];
+	    }
+	}
+
+	//
+	// Update the variables of p: drop the neighbours and elements
+	// now covered by p, add p to their elements, and bound their
+	// degrees.
+	//
+
+	size_t numLeft = n - k - 1;	// at least lp.size()
+
+	for (size_t a = 0; a < lp.size(); ++a)
+	{
+	    size_t i = lp[a];
+	    vector <size_t> &ai = adj[i];
+	    vector <size_t> &ei = elements[i];
+
+	    size_t na = 0;
+
+	    for (size_t b = 0; b < ai.size(); ++b)
+	    {
+		if (mark[ai[b]] != k)
+		    ai[na++] = ai[b];
+	    }
+
+	    ai.resize (na);
+
+	    size_t d = na + lp.size() - 1;
+	    size_t ne = 0;
+
+	    for (size_t b = 0; b < ei.size(); ++b)
+	    {
+		size_t e = ei[b];
+
+		if (absorbed[e])
+		    continue;
+
+		if (w[e] == 0)
+		{
+		    absorbed[e] = true;
+		    vector <size_t>().swap (vars[e]);
+		    continue;
+		}
+
+		d += w[e];
+		ei[ne++] = e;
+	    }
+
+	    ei.resize (ne);
+	    ei.push_back (p);
+
+	    d = min (d, degree[i] + lp.size() - 1);
+	    d = min (d, numLeft - 1);
+
+	    removeDegree (i, degree[i], head, next, prev);
+	    degree[i] = d;
+	    insertDegree (i, d, head, next, prev);
+	    minDegree = min (minDegree, d);
+	}
+    }
+}
+
+} // namespace Ctl
@@ -0,0 +1,435 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------
+//
+//	Direct solution of sparse symmetric linear systems by
+//	LDL' factorization, following T. A. Davis, "Algorithm 849:
+//	A Concise Sparse Cholesky Factorization Package", and
+//	P. R. Amestoy, T. A. Davis and I. S. Duff, "An Approximate
+//	Minimum Degree Ordering Algorithm".
+//
+//---------------------------------------------------------------------
+
+#ifndef INCLUDED_CTL_SPARSE_LDLT_H
+#define INCLUDED_CTL_SPARSE_LDLT_H
+
+#include <CtlSparseMatrix.h>
+#include <CtlLinearSolver.h>
+#include <IexMacros.h>
+#include <IexBaseExc.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+namespace Ctl {
+
+//---------------------------------------------------------------------
+// Computes a fill-reducing ordering of the rows and columns of a
+// symmetric n x n matrix, given the pattern of its nonzero elements
+// in Compressed Row Storage (see CRSOperator).  On return, perm[k]
+// is the k-th row and column of the reordered matrix.  The diagonal
+// and any asymmetry of the pattern are ignored.
+//---------------------------------------------------------------------
+
+void approximateMinimumDegree (size_t n,
+			       const size_t rowPtr[/*n+1*/],
+			       const size_t colInd[],
+			       size_t perm[/*n*/]);
+
+//---------------------------------------------------------------------
+// FUNCTOR: SparseLDLT
+// MODEL OF: LinearSolver
+//
+// SparseLDLT solves linear systems of the form A x = b, with A
+// square, symmetric and non-singular, by factoring P A P' = L D L',
+// where P is the approximate minimum degree ordering of A, L is
+// unit lower triangular and D is diagonal.
+//
+// Requirements on types:
+//     * T must be a floating point type.
+//     * Operator must be CRSOperator<U> or LSSOperator<T, CRSOperator<U> >;
+//       the latter stands for A' A, which is formed explicitly.
+//     * b_iterator must be a model of Input Iterator.
+//     * x_iterator must be a model of Random Access Iterator.
+//
+// Preconditions:
+//     * A.numRows() == A.numColumns().
+//     * The pattern of A is symmetric.
+//     * distance(b_first, b_last) == A.numRows() * numVectors
+//     * distance(x_first, x_last) == A.numColumns() * numVectors
+//
+// The constructor orders and analyzes A, after which the number of
+// nonzero elements of L, and the number of multiply-adds needed to
+// compute them, are known; factor() computes L and D.  That
+// is the expensive part, and the solves that follow reuse them.  If
+// factor() has not been called, the first solve calls it.  factor()
+// throws an Iex::MathExc if A is singular to working precision, that
+// is, if a pivot is not larger in magnitude than the machine epsilon
+// of T times the largest diagonal element of A.  The solution of such
+// a system would be dominated by rounding errors.
+//
+// Unlike an iterative solver, SparseLDLT ignores the initial contents
+// of [x_first, x_last).  It returns the squared L2 norm of the
+// residual, b - A x, of the least accurate solution.
+//---------------------------------------------------------------------
+template<typename T, typename Operator = CRSOperator<T> >
+struct SparseLDLT
+{
+    const Operator & A;
+
+    SparseLDLT(const Operator & a, const NullLinearOperator * m = 0);
+
+    const Operator & op() const { return A; }
+
+    size_t numFactorNonzeros() const  { return _Lp.back(); }
+    double numFactorOperations() const { return _numOperations; }
+
+    void factor() const;
+
+    template<typename b_iterator, typename x_iterator>
+    T operator () (b_iterator b_first, b_iterator b_last,
+                   x_iterator x_first, x_iterator x_last) const
+    {
+	return (*this)(1, b_first, b_last, x_first, x_last);
+    }
+
+    template<typename b_iterator, typename x_iterator>
+    T operator () (size_t numVectors,
+                   b_iterator b_first, b_iterator b_last,
+                   x_iterator x_first, x_iterator x_last) const;
+
+  private:
+
+    template<typename U>
+    static CRSOperator<T> matrix(const CRSOperator<U> & a)
+    {
+	return CRSOperator<T>(a);
+    }
+
+    template<typename U>
+    static CRSOperator<T> matrix(const LSSOperator<T, CRSOperator<U> > & a)
+    {
+	return CRSOperator<T>(a.At.product(a.A));
+    }
+
+    CRSOperator<T>		_M;
+    std::vector<size_t>		_perm;
+    std::vector<size_t>		_permInv;
+    std::vector<size_t>		_parent;
+    std::vector<size_t>		_Lp;
+    mutable std::vector<size_t>	_Li;
+    mutable std::vector<T>	_Lx;
+    mutable std::vector<T>	_D;
+    double			_numOperations;
+    mutable bool		_factored;
+};
+
+//---------------------------------------------------------------------
+// FUNCTOR: LSSLDLT
+// MODEL OF: LinearSolver
+// 
+// LSSLDLT is an LSS that uses SparseLDLT as the Solver, on the
+// explicitly formed normal equations A' A x = A' b.
+//---------------------------------------------------------------------
+template<typename T, typename Operator = CRSOperator<T> >
+struct LSSLDLT : public LSS<T, Operator,
+			    SparseLDLT<T, LSSOperator<T, Operator> > >
+{
+    typedef LSS<T, Operator,
+		SparseLDLT<T, LSSOperator<T, Operator> > > parent;
+
+    LSSLDLT(const Operator & a)
+	: parent(a)
+    {}
+};
+
+
+//---------------
+// Implementation
+//---------------
+
+template<typename T, typename Operator>
+SparseLDLT<T, Operator>::
+SparseLDLT(const Operator & a, const NullLinearOperator *)
+    : A(a),
+      _M(matrix(a)),
+      _numOperations(0),
+      _factored(false)
+{
+    size_t n = _M.numRows();
+
+    ASSERT(n == _M.numColumns(), Iex::ArgExc,
+	   "Ctl::SparseLDLT() requires that "
+	   "A.numRows() == A.numColumns().");
+
+    _perm.resize(n);
+    _permInv.resize(n);
+
+    if (n > 0)
+	approximateMinimumDegree(n, &_M.row_ptr[0], &_M.col_ind[0], &_perm[0]);
+
+    for (size_t k = 0; k < n; ++k)
+	_permInv[_perm[k]] = k;
+
+    //
+    // Find the elimination tree and the number of nonzero elements
+    // in each column of L.  Row k of L is the set of nodes reached
+    // by walking up the tree from the nonzero elements of row k of
+    // P A P' to the left of the diagonal.
+    //
+
+    const size_t none = n;
+    std::vector<size_t> flag(n);
+    std::vector<size_t> count(n, 0);
+    _parent.assign(n, none);
+
+    for (size_t k = 0; k < n; ++k)
+    {
+	flag[k] = k;
+	size_t kk = _perm[k];
+
+	for (size_t p = _M.row_ptr[kk]; p < _M.row_ptr[kk + 1]; ++p)
+	{
+	    for (size_t i = _permInv[_M.col_ind[p]];
+		 i < k && flag[i] != k;
+		 i = _parent[i])
+	    {
+		if (_parent[i] == none)
+		    _parent[i] = k;
+
+		++count[i];
+		flag[i] = k;
+	    }
+	}
+    }
+
+    _Lp.resize(n + 1);
+    _Lp[0] = 0;
+
+    for (size_t k = 0; k < n; ++k)
+    {
+	_Lp[k + 1] = _Lp[k] + count[k];
+	_numOperations += double(count[k]) * double(count[k] + 1);
+    }
+}
+
+template<typename T, typename Operator>
+void SparseLDLT<T, Operator>::
+factor() const
+{
+    if (_factored)
+	return;
+
+    //
+    // Compute L and D one row at a time: row k of L solves a lower
+    // triangular system whose pattern is found in the elimination
+    // tree, and the columns of L grow by one element per row.
+    //
+
+    size_t n = _M.numRows();
+    std::vector<T> y(n, T(0));
+    std::vector<size_t> pattern(n), flag(n), count(n);
+
+    _Li.resize(numFactorNonzeros());
+    _Lx.resize(numFactorNonzeros());
+    _D.resize(n);
+
+    T maxDiagonal = T(0);
+
+    for (size_t i = 0; i < n; ++i)
+	for (size_t p = _M.row_ptr[i]; p < _M.row_ptr[i + 1]; ++p)
+	    if (_M.col_ind[p] == i)
+		maxDiagonal = std::max(maxDiagonal, std::abs(_M.val[p]));
+
+    const T minPivot = std::numeric_limits<T>::epsilon() * maxDiagonal;
+
+    for (size_t k = 0; k < n; ++k)
+    {
+	size_t top = n;
+	flag[k] = k;
+	count[k] = 0;
+	size_t kk = _perm[k];
+
+	for (size_t p = _M.row_ptr[kk]; p < _M.row_ptr[kk + 1]; ++p)
+	{
+	    size_t i = _permInv[_M.col_ind[p]];
+
+	    if (i > k)
+		continue;
+
+	    y[i] += _M.val[p];
+
+	    size_t len = 0;
+
+	    for (; flag[i] != k; i = _parent[i])
+	    {
+		pattern[len++] = i;
+		flag[i] = k;
+	    }
+
+	    while (len > 0)
+		pattern[--top] = pattern[--len];
+	}
+
+	_D[k] = y[k];
+	y[k] = T(0);
+
+	for (; top < n; ++top)
+	{
+	    size_t i = pattern[top];
+	    T yi = y[i];
+	    y[i] = T(0);
+
+	    size_t pEnd = _Lp[i] + count[i];
+
+	    for (size_t p = _Lp[i]; p < pEnd; ++p)
+		y[_Li[p]] -= _Lx[p] * yi;
+
+	    T lki = yi / _D[i];
+	    _D[k] -= lki * yi;
+	    _Li[pEnd] = k;
+	    _Lx[pEnd] = lki;
+	    ++count[i];
+	}
+
+	if (!(std::abs(_D[k]) > minPivot))
+	{
+	    THROW(Iex::MathExc,
+		  "Ctl::SparseLDLT::factor() cannot factor a "
+		  "singular matrix.");
+	}
+    }
+
+    _factored = true;
+}
+
+template<typename T, typename Operator>
+template<typename b_iterator, typename x_iterator>
+T SparseLDLT<T, Operator>::
+operator () (size_t numVectors,
+	     b_iterator b_first, b_iterator b_last,
+	     x_iterator x_first, x_iterator x_last) const
+{
+    size_t n = _M.numRows();
+    size_t k = numVectors;
+
+    ASSERT(numVectors > 0, Iex::ArgExc,
+	   "Ctl::SparseLDLT() requires that "
+	   "numVectors > 0.");
+    ASSERT(size_t(std::distance(b_first, b_last)) == n * k, Iex::ArgExc,
+	   "Ctl::SparseLDLT() requires that "
+	   "distance(b_first, b_last) == A.numRows() * numVectors.");
+    ASSERT(size_t(std::distance(x_first, x_last)) == n * k, Iex::ArgExc,
+	   "Ctl::SparseLDLT() requires that "
+	   "distance(x_first, x_last) == A.numColumns() * numVectors.");
+
+    factor();
+
+    std::vector<T> b(b_first, b_last);
+    std::vector<T> y(n * k);
+
+    // y = P b
+    for (size_t i = 0; i < n; ++i)
+	for (size_t j = 0; j < k; ++j)
+	    y[i * k + j] = b[_perm[i] * k + j];
+
+    // y = inverse(L) y
+    for (size_t i = 0; i < n; ++i)
+	for (size_t p = _Lp[i]; p < _Lp[i + 1]; ++p)
+	    for (size_t j = 0; j < k; ++j)
+		y[_Li[p] * k + j] -= _Lx[p] * y[i * k + j];
+
+    // y = inverse(D) y
+    for (size_t i = 0; i < n; ++i)
+	for (size_t j = 0; j < k; ++j)
+	    y[i * k + j] /= _D[i];
+
+    // y = inverse(L') y
+    for (size_t i = n; i-- > 0;)
+	for (size_t p = _Lp[i]; p < _Lp[i + 1]; ++p)
+	    for (size_t j = 0; j < k; ++j)
+		y[i * k + j] -= _Lx[p] * y[_Li[p] * k + j];
+
+    // x = P' y
+    for (size_t i = 0; i < n; ++i)
+	for (size_t j = 0; j < k; ++j)
+	    *(x_first + _perm[i] * k + j) = y[i * k + j];
+
+    //
+    // Measure the residuals, as CG does.
+    //
+
+    std::vector<T> t(n * k);
+    op().apply(k, x_first, x_last, t.begin(), t.end());
+
+    std::vector<T> residual(k, T(0));
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	for (size_t j = 0; j < k; ++j)
+	{
+	    T r = b[i * k + j] - t[i * k + j];
+	    residual[j] += r * r;
+	}
+    }
+
+    return *std::max_element(residual.begin(), residual.end());
+}
+
+} // namespace Ctl
+
+#endif
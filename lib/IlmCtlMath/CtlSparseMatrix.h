@@ -64,7 +64,9 @@
 //
 //--------------------------------------------------------------------------
 
+#include <CtlLinearSolver.h>
 #include <IexBaseExc.h>
+#include <IlmThreadPool.h>
 #include <algorithm>
 #include <iterator>
 #include <vector>
@@ -72,6 +74,9 @@
 
 namespace Ctl {
 
+template<typename T, typename xit, typename yit>
+class CRSApplyTask;
+
 //---------------------------------------------------------------------
 // 
 // OPERATOR: CRSOperator
@@ -94,6 +99,15 @@ namespace Ctl {
 //      row_ptr[i] <= k <= row_ptr[i+1]. As a special case, if the
 //      i-th row of M does not have nonzero elements, then
 //      row_ptr[i] == -1. Further, row_ptr[m] == nnz.
+//
+// apply() and applyT() also accept a number of vectors, stored
+// interleaved as described for LinearSolver; the matrix is then
+// traversed once for all of them.
+//
+// If threadPool is not null, apply() divides the rows of large
+// matrices among the threads of the pool.  Each row is still summed
+// by a single thread in the order of col_ind, so the results do not
+// depend on the number of threads.
 // 
 //---------------------------------------------------------------------
 
@@ -104,6 +118,7 @@ struct CRSOperator
     std::vector<size_t> col_ind;
     std::vector<size_t> row_ptr;
     size_t N;
+    IlmThread::ThreadPool * threadPool;
 
     //---------------------------------------------------------
     // LinearTransposableOperator methods.
@@ -117,10 +132,36 @@ struct CRSOperator
     template<typename xit, typename yit>
     void applyT(xit xi, xit xe, yit yi, yit ye) const;
 
+    template<typename xit, typename yit>
+    void apply(size_t numVectors, xit xi, xit xe, yit yi, yit ye) const;
+
+    template<typename xit, typename yit>
+    void applyT(size_t numVectors, xit xi, xit xe, yit yi, yit ye) const;
+
+    //---------------------------------------------------------
+    // The transposed matrix, with the elements of each of its
+    // rows in increasing column order.
+    //---------------------------------------------------------
+    CRSOperator<T> transpose() const;
+
+    //---------------------------------------------------------
+    // The product M B, with the elements of each of its rows
+    // in increasing column order.
+    //---------------------------------------------------------
+    template<typename U>
+    CRSOperator<T> product(const CRSOperator<U> & b) const;
+
+    //---------------------------------------------------------
+    // The diagonal of M' M, that is, the squared L2 norms of
+    // the columns of M.
+    //---------------------------------------------------------
+    template<typename yit>
+    void normalDiagonal(yit yi, yit ye) const;
+
     //---------------------------------------------------------
     // Default constructor and destructor.
     //---------------------------------------------------------
-    CRSOperator() : N(0u) {}
+    CRSOperator() : N(0u), threadPool(0) {}
     ~CRSOperator() {}
 
     //---------------------------------------------------------
@@ -141,6 +182,62 @@ struct CRSOperator
     template<typename U>
     CRSOperator<T> & operator = (const CRSOperator<U> & o);
 
+  private:
+
+    template<typename U, typename xit, typename yit>
+    friend class CRSApplyTask;
+
+    // Computes rows [firstRow, endRow) of y = M x
+    template<typename xit, typename yit>
+    void applyRows(size_t firstRow, size_t endRow, size_t numVectors,
+		   xit xi, yit yi) const;
+
+    // Computes vectors [first, first + W) of those rows, W <= 4
+    template<size_t W, typename xit, typename yit>
+    void applyRows(size_t firstRow, size_t endRow, size_t numVectors,
+		   size_t first, xit xi, yit yi) const;
+};
+
+
+//---------------------------------------------------------------------
+// FUNCTOR: LSSOperator
+// MODEL OF: LinearOperator
+//
+// For a CRSOperator, LSSOperator keeps a transposed copy of A, so
+// that A' (A x) is computed row by row, like A x, instead of
+// scattering the products into y.  The sums are formed in the same
+// order either way.
+//---------------------------------------------------------------------
+template<typename T, typename U>
+struct LSSOperator<T, CRSOperator<U> >
+{
+    const CRSOperator<U> & A;
+    mutable CRSOperator<U> At;
+    mutable std::vector<T> aux;
+
+    LSSOperator(const CRSOperator<U> & a) : A(a), At(a.transpose()) {}
+
+    size_t numRows()    const { return A.numColumns(); }
+    size_t numColumns() const { return numRows();      }
+
+    template<typename i_iterator, typename o_iterator>
+    void apply(i_iterator x_first, i_iterator x_last,
+	       o_iterator y_first, o_iterator y_last) const
+    {
+	apply(1, x_first, x_last, y_first, y_last);
+    }
+
+    template<typename i_iterator, typename o_iterator>
+    void apply(size_t numVectors,
+	       i_iterator x_first, i_iterator x_last,
+	       o_iterator y_first, o_iterator y_last) const
+    {
+	aux.resize(A.numRows() * numVectors);
+	A.apply(numVectors, x_first, x_last, aux.begin(), aux.end());
+
+	At.threadPool = A.threadPool;
+	At.apply(numVectors, aux.begin(), aux.end(), y_first, y_last);
+    }
 };
 
 
@@ -157,6 +254,43 @@ struct CRSOperator
 #else
 #   define DBGASSERT(x) 
 #endif
+
+template<typename T, typename xit, typename yit>
+class CRSApplyTask: public IlmThread::Task
+{
+  public:
+
+    CRSApplyTask (IlmThread::TaskGroup *group,
+		  const CRSOperator<T> &op,
+		  size_t firstRow,
+		  size_t endRow,
+		  size_t numVectors,
+		  xit xi,
+		  yit yi)
+    :
+	IlmThread::Task (group),
+	_op (op),
+	_firstRow (firstRow),
+	_endRow (endRow),
+	_numVectors (numVectors),
+	_xi (xi),
+	_yi (yi)
+    {}
+
+    virtual void execute ()
+    {
+	_op.applyRows (_firstRow, _endRow, _numVectors, _xi, _yi);
+    }
+
+  private:
+
+    const CRSOperator<T> &	_op;
+    size_t			_firstRow;
+    size_t			_endRow;
+    size_t			_numVectors;
+    xit				_xi;
+    yit				_yi;
+};
 	
 template<typename T>
 template<typename U>
@@ -168,7 +302,8 @@ CRSOperator(const std::vector<U> & v,
     : val(v.begin(), v.end()),
       col_ind(c),
       row_ptr(r),
-      N(n)
+      N(n),
+      threadPool(0)
 {
     assert(! row_ptr.empty());
     assert(val.size() == col_ind.size());
@@ -180,9 +315,10 @@ template<typename U>
 CRSOperator<T>::
 CRSOperator(const CRSOperator<U> & o)
     : val(o.val.begin(), o.val.end()),
-      col_ind(o.col_in),
+      col_ind(o.col_ind),
       row_ptr(o.row_ptr),
-      N(o.N)
+      N(o.N),
+      threadPool(o.threadPool)
 {}
 
 template<typename T>
@@ -192,9 +328,10 @@ operator = (const CRSOperator<U> & o)
 {
     val.resize(o.val.size());
     std::copy(o.val.begin(), o.val.end(), val.begin());
-    col_ind = o.col.ind;
+    col_ind = o.col_ind;
     row_ptr = o.row_ptr;
     N = o.N;
+    threadPool = o.threadPool;
     return *this;
 }
 
@@ -204,31 +341,132 @@ template<typename xit, typename yit>
 void CRSOperator<T>::
 apply(xit xi, xit xe, yit yi, yit ye) const
 {
-    DBGASSERT(std::distance(xi, xe) == numColumns());
-    DBGASSERT(std::distance(yi, ye) == numRows());
-	
+    apply(1, xi, xe, yi, ye);
+}
+
+template<typename T>
+template<typename xit, typename yit>
+void CRSOperator<T>::
+apply(size_t numVectors, xit xi, xit xe, yit yi, yit ye) const
+{
+    DBGASSERT(std::distance(xi, xe) == numColumns() * numVectors);
+    DBGASSERT(std::distance(yi, ye) == numRows() * numVectors);
+
+    //
+    // Below about 32k multiply-adds, starting the
+    // tasks costs more than it saves.
+    //
+
+    size_t m = numRows();
+    int numThreads = threadPool? threadPool->numThreads(): 0;
+
+    if (numThreads < 2 || val.size() * numVectors < 32768)
+    {
+	applyRows(0, m, numVectors, xi, yi);
+	return;
+    }
+
+    //
+    // Split the rows into tasks with about the same
+    // number of nonzero elements each.
+    //
+
+    size_t numTasks = size_t(numThreads) * 4;
+    IlmThread::TaskGroup group;
+    size_t firstRow = 0;
+
+    for (size_t task = 1; task <= numTasks && firstRow < m; ++task)
+    {
+	size_t endRow = m;
+
+	if (task < numTasks)
+	{
+	    endRow = std::lower_bound(row_ptr.begin() + firstRow,
+				      row_ptr.end() - 1,
+				      val.size() * task / numTasks) -
+		     row_ptr.begin();
+	}
+
+	if (endRow > firstRow)
+	{
+	    threadPool->addTask(new CRSApplyTask<T, xit, yit>
+				(&group, *this, firstRow, endRow,
+				 numVectors, xi, yi));
+	}
+
+	firstRow = endRow;
+    }
+}
+
+template<typename T>
+template<typename xit, typename yit>
+void CRSOperator<T>::
+applyRows(size_t firstRow, size_t endRow, size_t numVectors,
+	  xit xi, yit yi) const
+{
+    //
+    // The vectors are interleaved, so for each element of the
+    // matrix the products with up to four vectors are formed
+    // from contiguous elements of x, with the sums held in
+    // registers.  The compiler can vectorize these.
+    //
+
+    size_t first = 0;
+
+    for (; first + 4 <= numVectors; first += 4)
+	applyRows<4>(firstRow, endRow, numVectors, first, xi, yi);
+
+    switch (numVectors - first)
+    {
+      case 3:
+	applyRows<3>(firstRow, endRow, numVectors, first, xi, yi);
+	break;
+
+      case 2:
+	applyRows<2>(firstRow, endRow, numVectors, first, xi, yi);
+	break;
+
+      case 1:
+	applyRows<1>(firstRow, endRow, numVectors, first, xi, yi);
+	break;
+    }
+}
+
+template<typename T>
+template<size_t W, typename xit, typename yit>
+void CRSOperator<T>::
+applyRows(size_t firstRow, size_t endRow, size_t numVectors,
+	  size_t first, xit xi, yit yi) const
+{
     typedef typename std::iterator_traits<yit>::value_type YValue;
-    typename std::vector<T>::const_iterator vi = val.begin();
-    typename std::vector<size_t>::const_iterator ci, ce;
-    typename std::vector<size_t>::const_iterator ri, re = row_ptr.end() -1;
-	
-    for (ri = row_ptr.begin(); ri < re; ++ri, ++yi)
+
+    xi += first;
+    yi += first;
+
+    for (size_t r = firstRow; r < endRow; ++r)
     {
-        *yi = YValue(0);
-        
-//        if (*ri < 0)
-//            continue;
-        
-        ce = ri + 1;
-//        while (*ce < 0 && ce <= re)
-//            ++ce;
-        
-        ce = col_ind.begin() + *ce;
-        DBGASSERT(ce <= col_ind.end());
-        
-        for (ci = col_ind.begin() + *ri; ci < ce; ++ci, ++vi) {
-            *yi += (*vi) * (*(xi + *ci));
-        }
+	YValue y0 = YValue(0);
+	YValue y1 = YValue(0);
+	YValue y2 = YValue(0);
+	YValue y3 = YValue(0);
+
+	for (size_t k = row_ptr[r]; k < row_ptr[r + 1]; ++k)
+	{
+	    T v = val[k];
+	    xit x = xi + col_ind[k] * numVectors;
+
+	    y0 += v * x[0];
+	    if (W > 1) y1 += v * x[1];
+	    if (W > 2) y2 += v * x[2];
+	    if (W > 3) y3 += v * x[3];
+	}
+
+	yit y = yi + r * numVectors;
+
+	y[0] = y0;
+	if (W > 1) y[1] = y1;
+	if (W > 2) y[2] = y2;
+	if (W > 3) y[3] = y3;
     }
 }
 
@@ -272,6 +510,145 @@ applyT(xit xi, xit xe, yit yi, yit ye) const
     }
 }
 
+template<typename T>
+template<typename xit, typename yit>
+void CRSOperator<T>::
+applyT(size_t numVectors, xit xi, xit xe, yit yi, yit ye) const
+{
+    DBGASSERT(std::distance(xi, xe) == numRows() * numVectors);
+    DBGASSERT(std::distance(yi, ye) == numColumns() * numVectors);
+
+    typedef typename std::iterator_traits<yit>::value_type YValue;
+
+    std::fill(yi, yi + numColumns() * numVectors, YValue(0));
+
+    for (size_t r = 0; r < numRows(); ++r)
+    {
+	xit x = xi + r * numVectors;
+
+	for (size_t k = row_ptr[r]; k < row_ptr[r + 1]; ++k)
+	{
+	    T v = val[k];
+	    yit y = yi + col_ind[k] * numVectors;
+
+	    for (size_t j = 0; j < numVectors; ++j)
+		y[j] += v * x[j];
+	}
+    }
+}
+
+template<typename T>
+CRSOperator<T> CRSOperator<T>::
+transpose() const
+{
+    CRSOperator<T> t;
+    t.N = numRows();
+    t.threadPool = threadPool;
+    t.val.resize(val.size());
+    t.col_ind.resize(col_ind.size());
+    t.row_ptr.assign(N + 1, 0);
+
+    for (size_t k = 0; k < col_ind.size(); ++k)
+	++t.row_ptr[col_ind[k] + 1];
+
+    for (size_t c = 0; c < N; ++c)
+	t.row_ptr[c + 1] += t.row_ptr[c];
+
+    //
+    // Visiting the rows in order leaves the elements of
+    // each row of t sorted by column.
+    //
+
+    std::vector<size_t> next(t.row_ptr.begin(), t.row_ptr.end() - 1);
+
+    for (size_t r = 0; r < numRows(); ++r)
+    {
+	for (size_t k = row_ptr[r]; k < row_ptr[r + 1]; ++k)
+	{
+	    size_t i = next[col_ind[k]]++;
+	    t.val[i] = val[k];
+	    t.col_ind[i] = r;
+	}
+    }
+
+    return t;
+}
+
+template<typename T>
+template<typename U>
+CRSOperator<T> CRSOperator<T>::
+product(const CRSOperator<U> & b) const
+{
+    assert(numColumns() == b.numRows());
+
+    CRSOperator<T> p;
+    p.N = b.numColumns();
+    p.threadPool = threadPool;
+    p.row_ptr.push_back(0);
+
+    //
+    // Each row of the product is accumulated in a dense row,
+    // following F. G. Gustavson, "Two Fast Algorithms for Sparse
+    // Matrices: Multiplication and Permuted Transposition".
+    //
+
+    std::vector<T> row(p.N);
+    std::vector<size_t> mark(p.N, numRows());
+    std::vector<size_t> pattern;
+
+    for (size_t r = 0; r < numRows(); ++r)
+    {
+	pattern.clear();
+
+	for (size_t k = row_ptr[r]; k < row_ptr[r + 1]; ++k)
+	{
+	    T v = val[k];
+	    size_t c = col_ind[k];
+
+	    for (size_t kb = b.row_ptr[c]; kb < b.row_ptr[c + 1]; ++kb)
+	    {
+		size_t j = b.col_ind[kb];
+
+		if (mark[j] != r)
+		{
+		    mark[j] = r;
+		    row[j] = T(0);
+		    pattern.push_back(j);
+		}
+
+		row[j] += v * b.val[kb];
+	    }
+	}
+
+	std::sort(pattern.begin(), pattern.end());
+
+	for (size_t i = 0; i < pattern.size(); ++i)
+	{
+	    p.col_ind.push_back(pattern[i]);
+	    p.val.push_back(row[pattern[i]]);
+	}
+
+	p.row_ptr.push_back(p.val.size());
+    }
+
+    return p;
+}
+
+template<typename T>
+template<typename yit>
+void CRSOperator<T>::
+normalDiagonal(yit yi, yit ye) const
+{
+    DBGASSERT(std::distance(yi, ye) == numColumns());
+
+    typedef typename std::iterator_traits<yit>::value_type YValue;
+
+    std::fill(yi, ye, YValue(0));
+
+    for (size_t k = 0; k < val.size(); ++k)
+	*(yi + col_ind[k]) += val[k] * val[k];
+}
+
 } // namespace Ctl
 
 #undef DBGASSERT
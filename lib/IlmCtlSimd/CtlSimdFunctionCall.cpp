@@ -145,10 +145,42 @@ SimdFunctionCall::callFunction (size_t numSamples)
 {
     StackFrame stackFrame (_xcontext);
 
-    _xcontext.run (numSamples, _entryPoint);
+    //
+    // Arguments bound to the application's buffers with bindBuffer()
+    // must have room for all of the samples.
+    //
 
+    for (size_t i = 0; i <= numInputArgs() + numOutputArgs(); ++i)
     {
-	const SimdFunctionArgPtr arg = returnValue();
+	const SimdFunctionArgPtr arg =
+	    (i < numInputArgs()?  inputArg (i):
+	     i < numInputArgs() + numOutputArgs()?
+				  outputArg (i - numInputArgs()):
+				  returnValue()).cast<SimdFunctionArg>();
+
+	if (arg->hasBuffer() && arg->bufferSamples() < numSamples)
+	{
+	    releaseBuffers (numSamples, false);
+
+	    THROW (ArgExc, "Cannot call CTL function " << name() << " "
+		   "for " << numSamples << " samples, the buffer bound "
+		   "to argument " << arg->name() << " holds only " <<
+		   arg->bufferSamples() << " samples.");
+	}
+    }
+
+    try
+    {
+	_xcontext.run (numSamples, _entryPoint);
+    }
+    catch (...)
+    {
+	releaseBuffers (numSamples, false);
+	throw;
+    }
+
+    {
+	const SimdFunctionArgPtr arg = returnValue().cast<SimdFunctionArg>();
 
 	if (arg->isVarying() && !arg->reg()->isVarying())
 	{
@@ -156,6 +188,8 @@ SimdFunctionCall::callFunction (size_t numSamples)
 	}
 	else if (!arg->isVarying() && arg->reg()->isVarying())
 	{
+	    releaseBuffers (numSamples, false);
+
 	    THROW (TypeExc,
 		   "The return type of CTL function " <<
 		   arg->func()->name() << " is uniform, "
@@ -165,7 +199,7 @@ SimdFunctionCall::callFunction (size_t numSamples)
 
     for (size_t i = 0; i < numOutputArgs(); ++i)
     {
-	const SimdFunctionArgPtr arg = outputArg (i);
+	const SimdFunctionArgPtr arg = outputArg (i).cast<SimdFunctionArg>();
 
 	if (arg->isVarying() && !arg->reg()->isVarying())
 	{
@@ -173,12 +207,32 @@ SimdFunctionCall::callFunction (size_t numSamples)
 	}
 	else if (!arg->isVarying() && arg->reg()->isVarying())
 	{
+	    releaseBuffers (numSamples, false);
+
 	    THROW (TypeExc,
 		   "Output parameter " << arg->name() << " of CTL "
 		   "function " << arg->func()->name() << " is uniform, "
 		   "but the function returned a varying value.");
 	}
     }
+
+    releaseBuffers (numSamples, true);
+}
+
+
+void
+SimdFunctionCall::releaseBuffers (size_t numSamples, bool copyOutputs)
+{
+    for (size_t i = 0; i < numInputArgs(); ++i)
+	inputArg (i).cast<SimdFunctionArg>()->releaseBuffer (numSamples,
+							     false);
+
+    for (size_t i = 0; i < numOutputArgs(); ++i)
+	outputArg (i).cast<SimdFunctionArg>()->releaseBuffer (numSamples,
+							      copyOutputs);
+
+    returnValue().cast<SimdFunctionArg>()->releaseBuffer (numSamples,
+							  copyOutputs);
 }
 
 
@@ -191,7 +245,9 @@ SimdFunctionArg::SimdFunctionArg
 :
     FunctionArg (name, func, type, varying),
     _reg (reg),
-    _defaultReg (0)
+    _defaultReg (0),
+    _buffer (0),
+    _bufferSamples (0)
 {
     // Find the register associated with the parameter default value
     string staticName = func->name() + "$" + name;
@@ -200,7 +256,7 @@ SimdFunctionArg::SimdFunctionArg
     SymbolInfoPtr info = sfunc->symbols().lookupSymbol( staticName );
     if( info )
     {
-	_defaultReg = &SimdDataAddrPtr(info->addr())->reg(*sfunc->xContext());
+	_defaultReg = &info->addr().cast<SimdDataAddr>()->reg(*sfunc->xContext());
     }
 }
 
@@ -229,6 +285,10 @@ void
 SimdFunctionArg::setDefaultValue ()
 {
     assert(_reg);
+
+    // The default value goes into the argument's own register.
+    releaseBuffer (0, false);
+
     if( _defaultReg )
     {
         // note: default values are never varying
@@ -254,6 +314,63 @@ SimdFunctionArg::setVarying(bool varying)
     FunctionArg::setVarying(_reg->isVarying());
 }
 
+bool
+SimdFunctionArg::bindBufferInternal
+    (char *base,
+     CDataType_e baseType,
+     size_t stride,
+     size_t count)
+{
+    assert(_reg);
+
+    //
+    // The instructions expect the samples of a varying register to
+    // follow each other, elementSize() bytes apart, so only buffers
+    // with exactly that layout can be used in place.
+    //
+
+    if (_buffer ||
+	!isVarying() ||
+	!_reg->isVarying() ||
+	_reg->isReference() ||
+	type()->cDataType() != baseType ||
+	stride != _reg->elementSize() ||
+	count == 0)
+    {
+	return false;
+    }
+
+    _reg->bind (base);
+    _buffer = base;
+    _bufferSamples = count;
+    return true;
+}
+
+
+void
+SimdFunctionArg::releaseBuffer (size_t numSamples, bool copyValues)
+{
+    if (!_buffer)
+	return;
+
+    if (_reg->isBound())
+    {
+	_reg->unbind();
+    }
+    else if (copyValues)
+    {
+	for (size_t i = 0; i < numSamples; ++i)
+	{
+	    memcpy (_buffer + i * _reg->elementSize(),
+		    (*_reg)[i],
+		    _reg->elementSize());
+	}
+    }
+
+    _buffer = 0;
+    _bufferSamples = 0;
+}
+
 size_t SimdFunctionArg::elements(void) const {
 	// reason for casting here is that _func is private to FunctionArg
 	// the public function func() returns a const FunctionCall*
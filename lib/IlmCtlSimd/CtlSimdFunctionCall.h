@@ -91,6 +91,10 @@ class SimdFunctionCall: public FunctionCall
     virtual SymbolTable &	symbols()	{return _symbols;}
 
   private:
+
+    void			releaseBuffers (size_t numSamples,
+						bool copyOutputs);
+
     SimdXContext	_xcontext;
     const SimdInst *	_entryPoint;
     SymbolTable &	_symbols;
@@ -119,10 +123,30 @@ class SimdFunctionArg: public FunctionArg
 
     SimdReg *	        reg () {return _reg;}
 
+    //------------------------------------------------------------
+    // The buffer bound with bindBuffer(), if any.  releaseBuffer()
+    // ends the binding at the end of a call; if copyValues is true
+    // and the register stopped using the buffer during the call,
+    // the first numSamples values are copied into the buffer.
+    //------------------------------------------------------------
+
+    bool		hasBuffer () const {return _buffer != 0;}
+    size_t		bufferSamples () const {return _bufferSamples;}
+    void		releaseBuffer (size_t numSamples, bool copyValues);
+
+  protected:
+
+    virtual bool	bindBufferInternal (char *base,
+					    CDataType_e baseType,
+					    size_t stride,
+					    size_t count);
+
   private:
 
     SimdReg		*_reg;
     SimdReg             *_defaultReg;
+    char		*_buffer;
+    size_t		_bufferSamples;
 };
 
 typedef RcPtr <SimdFunctionCall> SimdFunctionCallPtr;
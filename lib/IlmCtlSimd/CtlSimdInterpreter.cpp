@@ -81,6 +81,8 @@ struct SimdInterpreter::Data
     Mutex		mutex;
     unsigned long	maxInstCount;
     unsigned long	abortCount;
+    bool		lazyCodeGeneration;
+    bool		functionSpecialization;
 };
 
 
@@ -90,6 +92,8 @@ SimdInterpreter::SimdInterpreter():
 {
     _data->maxInstCount = 10000000;
     _data->abortCount = 0;
+    _data->lazyCodeGeneration = false;
+    _data->functionSpecialization = false;
 
     //
     // Create a dummy LContext and load the CTL standard library
@@ -147,6 +151,38 @@ SimdInterpreter::maxInstCount()
 }
 
 
+void
+SimdInterpreter::setLazyCodeGeneration (bool lazy)
+{
+    Lock lock (_data->mutex);
+    _data->lazyCodeGeneration = lazy;
+}
+
+
+bool
+SimdInterpreter::lazyCodeGeneration () const
+{
+    Lock lock (_data->mutex);
+    return _data->lazyCodeGeneration;
+}
+
+
+void
+SimdInterpreter::setFunctionSpecialization (bool specialize)
+{
+    Lock lock (_data->mutex);
+    _data->functionSpecialization = specialize;
+}
+
+
+bool
+SimdInterpreter::functionSpecialization () const
+{
+    Lock lock (_data->mutex);
+    return _data->functionSpecialization;
+}
+
+
 Module *
 SimdInterpreter::newModule
     (const string &moduleName,
@@ -163,11 +199,57 @@ SimdInterpreter::newFunctionCallInternal
 {
     assert(info);
 
+    if (!info->addr())
+    {
+	//
+	// Code generation for the function was deferred;
+	// generate its code now.
+	//
+
+	SimdModule *module = const_cast <SimdModule *>
+	    (static_cast <const SimdModule *> (info->module()));
+
+	module->generateDeferredFunction (info, symtab());
+    }
+
     return new SimdFunctionCall
 	(*this, functionName, info->type(), info->addr(), symtab());
 }
 
 
+FunctionCallPtr
+SimdInterpreter::specializeFunctionCallInternal
+    (const SymbolInfoPtr info,
+     const string& functionName,
+     const vector<TypeStoragePtr> &uniforms,
+     const vector<bool> &liveParameters)
+{
+    assert(info);
+
+    SimdModule *module = const_cast <SimdModule *>
+	(static_cast <const SimdModule *> (info->module()));
+
+    SymbolInfoPtr specializedInfo;
+
+    if (module)
+	specializedInfo = module->specializeFunction
+			    (info, uniforms, liveParameters, symtab());
+
+    //
+    // Functions that are not defined in a CTL module,
+    // for example, functions implemented in C++, cannot
+    // be specialized.
+    //
+
+    if (!specializedInfo)
+	return newFunctionCallInternal (info, functionName);
+
+    return new SimdFunctionCall
+	(*this, functionName, specializedInfo->type(),
+	 specializedInfo->addr(), symtab());
+}
+
+
 LContext *
 SimdInterpreter::newLContext
     (istream &file,
@@ -83,12 +83,51 @@ class SimdInterpreter: public Interpreter
     unsigned long		abortCount();
     unsigned long		maxInstCount();
 
+    //---------------------------------------------------------------
+    // Lazy code generation
+    //
+    // If lazy code generation is enabled, modules loaded afterwards
+    // are parsed and type-checked as usual, but code for a function
+    // is generated only when the function is first referenced, either
+    // by newFunctionCall() or by a call from another CTL function.
+    // This reduces load time and memory use for large modules of
+    // which only a few functions are actually used.
+    //
+    // Lazy code generation is disabled by default.
+    //---------------------------------------------------------------
+
+    void			setLazyCodeGeneration (bool lazy);
+    bool			lazyCodeGeneration () const;
+
+    //-------------------------------------------------------------
+    // Function specialization
+    //
+    // Specializing a function (see specializeFunctionCall()) needs
+    // the function's syntax tree.  If function specialization is
+    // enabled, modules loaded afterwards keep the syntax trees of
+    // all their functions for as long as the modules exist.  If it
+    // is disabled, syntax trees are released once code for their
+    // functions has been generated, and specializeFunctionCall()
+    // returns the same function call as newFunctionCall().
+    //
+    // Function specialization is disabled by default.
+    //-------------------------------------------------------------
+
+    void			setFunctionSpecialization (bool specialize);
+    bool			functionSpecialization () const;
+
   private:
 
     virtual FunctionCallPtr	newFunctionCallInternal 
                                     (const SymbolInfoPtr info,
                                      const std::string &functionName);
 
+    virtual FunctionCallPtr	specializeFunctionCallInternal
+				    (const SymbolInfoPtr info,
+				     const std::string &functionName,
+				     const std::vector<TypeStoragePtr> &uniforms,
+				     const std::vector<bool> &liveParameters);
+
     virtual Module *		newModule
 				    (const std::string &moduleName,
 				     const std::string &fileName);
@@ -115,8 +115,22 @@ SimdLContext::fixCalls ()
 	 i != _fixCallsList.end();
 	 ++i)
     {
-	SimdInstAddrPtr addr = i->info->addr();
-	assert (addr->inst());
+	if (!i->info->addr())
+	{
+	    //
+	    // The called function was type-checked, but code generation
+	    // for it was deferred (see SimdModuleNode::generateCode()).
+	    // Generate its code now, in the module where it was declared.
+	    //
+
+	    SimdModule *module = const_cast <SimdModule *>
+		(static_cast <const SimdModule *> (i->info->module()));
+
+	    module->generateDeferredFunction (i->info, symtab());
+	}
+
+	SimdInstAddrPtr addr = i->info->addr().cast<SimdInstAddr>();
+	assert (addr && addr->inst());
 
 	i->inst->setCallPath (addr->inst());
 	debug ("\tcall inst = " << i->inst << ", call path = " << addr->inst());
@@ -174,13 +188,16 @@ SimdLContext::newStackFrame ()
 {
     _nextParameterAddr = -1;
     _locals.clear();
+    _parameterAddrs.clear();
 }
 
 
 AddrPtr
 SimdLContext::parameterAddr (const DataTypePtr &parameterType)
 {
-    return new SimdDataAddr (_nextParameterAddr--);
+    AddrPtr addr = new SimdDataAddr (_nextParameterAddr--);
+    _parameterAddrs.push_back (addr);
+    return addr;
 }
 
 
@@ -216,7 +233,8 @@ SimdLContext::newFunctionNode
      const SymbolInfoPtr &info,
      const StatementNodePtr &body) const
 {
-    return new SimdFunctionNode (lineNumber, name, info, body, _locals);
+    return new SimdFunctionNode (lineNumber, name, info, body,
+				 _locals, _parameterAddrs);
 }
 
 
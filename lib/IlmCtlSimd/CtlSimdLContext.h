@@ -263,6 +263,7 @@ class SimdLContext: public LContext
     FixCallsList	_fixCallsList;
 
     std::vector<DataTypePtr> _locals;
+    std::vector<AddrPtr> _parameterAddrs;
 };
 
 
@@ -59,13 +59,76 @@
 //-----------------------------------------------------------------------------
 
 #include <CtlSimdModule.h>
+#include <CtlSimdInterpreter.h>
+#include <CtlSimdLContext.h>
+#include <CtlSimdSyntaxTree.h>
+#include <CtlSpecializer.h>
 #include <CtlSimdReg.h>
 #include <CtlSimdInst.h>
 #include <CtlSimdAddr.h>
+#include <CtlSymbolTable.h>
+#include <CtlExc.h>
+#include <Iex.h>
+#include <sstream>
 
 using namespace std;
+using namespace Iex;
+
+#if 0
+    #include <iostream>
+    #define debug(x) (cout << x << endl)
+#else
+    #define debug(x)
+#endif
 
 namespace Ctl {
+namespace {
+
+class SimdSpecializer: public Specializer
+{
+  public:
+
+    SimdSpecializer (LContext &lcontext): Specializer (lcontext) {}
+
+  protected:
+
+    virtual bool		isCFunction (const SymbolInfoPtr &info) const;
+
+    virtual FunctionNodePtr	functionDefinition
+				    (const SymbolInfoPtr &info) const;
+};
+
+
+bool
+SimdSpecializer::isCFunction (const SymbolInfoPtr &info) const
+{
+    return info->addr().cast<SimdCFuncAddr>();
+}
+
+
+FunctionNodePtr
+SimdSpecializer::functionDefinition (const SymbolInfoPtr &info) const
+{
+    //
+    // The function may be defined in another module.  C++ functions
+    // are excluded first; the module they were declared in, for
+    // example, the temporary module in which SimdInterpreter's
+    // constructor declares the standard library, may be gone.
+    //
+
+    if (isCFunction (info))
+	return 0;
+
+    const SimdModule *module =
+	dynamic_cast <const SimdModule *> (info->module());
+
+    if (!module)
+	return 0;
+
+    return module->findFunction (info);
+}
+
+} // namespace
 
 
 SimdModule::SimdModule
@@ -75,7 +138,8 @@ SimdModule::SimdModule
 :
     Module (name, fileName),
     _interpreter (interpreter),
-    _firstInitInst(0)
+    _firstInitInst(0),
+    _keepFunctions (interpreter.functionSpecialization())
 {
     // empty
 }
@@ -124,4 +188,185 @@ SimdModule::runInitCode ()
 }
 
 
+bool
+SimdModule::lazyCodeGeneration () const
+{
+    return _interpreter.lazyCodeGeneration();
+}
+
+
+void
+SimdModule::addFunction (const FunctionNodePtr &function)
+{
+    _functions[function->info.pointer()] = function;
+}
+
+
+FunctionNodePtr
+SimdModule::findFunction (const SymbolInfoPtr &info) const
+{
+    FunctionMap::const_iterator i = _functions.find (info.pointer());
+
+    if (i == _functions.end())
+	return 0;
+
+    return i->second;
+}
+
+
+bool
+SimdModule::generateDeferredFunction
+    (const SymbolInfoPtr &info,
+     SymbolTable &symtab)
+{
+    FunctionMap::iterator i = _functions.find (info.pointer());
+
+    //
+    // Recursive calls are resolved by fixCalls() below, after
+    // the function's address has been set, so they do not
+    // cause the function's code to be generated twice.
+    //
+
+    if (i == _functions.end() || info->addr())
+	return false;
+
+    FunctionNodePtr function = i->second;
+
+    //
+    // Unless the function may be specialized later, its syntax
+    // tree is no longer needed once its code has been generated.
+    //
+
+    if (!_keepFunctions)
+	_functions.erase (i);
+
+    debug ("generating deferred code for function " << function->name);
+
+    stringstream file;
+    SimdLContext lcontext (file, this, symtab);
+
+    function->generateCode (lcontext);
+    lcontext.fixCalls();
+
+    if (lcontext.numErrors() > 0)
+    {
+	lcontext.printDeclaredErrors();
+	THROW (LoadModuleExc,
+	       "Failed to generate code for CTL function \"" <<
+	       function->name << "\" in module \"" << name() << "\".");
+    }
+
+    return true;
+}
+
+
+SymbolInfoPtr
+SimdModule::specializeFunction
+    (const SymbolInfoPtr &info,
+     const std::vector<TypeStoragePtr> &uniforms,
+     const std::vector<bool> &live,
+     SymbolTable &symtab)
+{
+    FunctionMap::iterator i = _functions.find (info.pointer());
+
+    if (i == _functions.end())
+	return 0;
+
+    SimdFunctionNodePtr function = i->second;
+
+    //
+    // The cache key consists of the function's symbol info, the
+    // raw bytes of the bound values and the set of live outputs.
+    //
+
+    string key ((const char *) &i->first, sizeof (i->first));
+
+    for (size_t j = 0; j < uniforms.size(); ++j)
+    {
+	if (!uniforms[j])
+	    continue;
+
+	key.append ((const char *) &j, sizeof (j));
+
+	key.append (uniforms[j]->data(),
+		    uniforms[j]->type()->objectSize());
+    }
+
+    for (size_t j = 0; j < live.size(); ++j)
+	key.push_back (live[j]? 'l': 'd');
+
+    SpecializationMap::iterator k = _specializations.find (key);
+
+    if (k != _specializations.end())
+	return k->second;
+
+    debug ("specializing function " << function->name);
+
+    stringstream file;
+    SimdLContext lcontext (file, this, symtab);
+    SimdSpecializer specializer (lcontext);
+
+    for (size_t j = 0; j < uniforms.size(); ++j)
+    {
+	if (!uniforms[j])
+	    continue;
+
+	if (j >= function->_parameterAddrs.size())
+	    THROW (ArgExc, "Cannot bind parameter " << j << " of CTL "
+			   "function " << function->name << ".");
+
+	ExprNodePtr value =
+	    Specializer::newLiteralNode (lcontext,
+					 function->lineNumber,
+					 uniforms[j]->type(),
+					 uniforms[j]->data());
+
+	//
+	// Only scalar values can be substituted for parameters;
+	// parameters of other types are left unbound.
+	//
+
+	if (!value)
+	    continue;
+
+	specializer.bindConstant (function->_parameterAddrs[j], value);
+    }
+
+    for (size_t j = 0; j < live.size(); ++j)
+    {
+	if (!live[j] && j < function->_parameterAddrs.size())
+	    specializer.discardStores (function->_parameterAddrs[j]);
+    }
+
+    StatementNodePtr body =
+	specializer.eliminateDeadStores
+	    (specializer.specialize (function->body));
+
+    SymbolInfoPtr specializedInfo = new SymbolInfo (this, RWA_WRITE);
+    specializedInfo->setType (info->type());
+
+    SimdFunctionNodePtr specialized =
+	new SimdFunctionNode (function->lineNumber,
+			      function->name,
+			      specializedInfo,
+			      body,
+			      function->_locals,
+			      function->_parameterAddrs);
+
+    specialized->generateCode (lcontext);
+    lcontext.fixCalls();
+
+    if (lcontext.numErrors() > 0)
+    {
+	lcontext.printDeclaredErrors();
+	THROW (LoadModuleExc,
+	       "Failed to specialize CTL function \"" <<
+	       function->name << "\" in module \"" << name() << "\".");
+    }
+
+    _specializations[key] = specializedInfo;
+    return specializedInfo;
+}
+
+
 } // namespace Ctl
@@ -63,13 +63,19 @@
 //-----------------------------------------------------------------------------
 
 #include <CtlModule.h>
+#include <CtlSyntaxTree.h>
+#include <CtlTypeStorage.h>
 #include <vector>
+#include <map>
 
 namespace Ctl {
 
 class SimdReg;
 class SimdInst;
 class SimdInterpreter;
+class SymbolInfo;
+class SymbolTable;
+typedef RcPtr <SymbolInfo> SymbolInfoPtr;
 
 
 class SimdModule: public Module
@@ -89,12 +95,75 @@ class SimdModule: public Module
 
     virtual void	runInitCode ();
 
+    //---------------------------------------------------------------
+    // Lazy code generation
+    //
+    // lazyCodeGeneration() returns true if the interpreter that owns
+    // this module generates code for functions only when they are
+    // first referenced.
+    //
+    // keepsFunctions() returns true if function specialization was
+    // enabled in the interpreter when this module was created; the
+    // module then keeps the syntax trees of its functions for as
+    // long as it exists.
+    //
+    // addFunction(f) records the syntax tree for a type-checked
+    // function.  Unless keepsFunctions() is true, the syntax tree
+    // is released once code for the function has been generated.
+    //
+    // findFunction(info) returns the recorded syntax tree for the
+    // function described by info, or 0 if there is none.
+    //
+    // generateDeferredFunction(info,symtab) generates code for the
+    // function described by info, as well as for any functions it
+    // calls whose code has not been generated yet.  Returns false
+    // if the function's code has already been generated, or if the
+    // function is not defined in this module.
+    //---------------------------------------------------------------
+
+    bool		lazyCodeGeneration () const;
+    bool		keepsFunctions () const	{return _keepFunctions;}
+    void		addFunction (const FunctionNodePtr &function);
+    FunctionNodePtr	findFunction (const SymbolInfoPtr &info) const;
+
+    bool		generateDeferredFunction (const SymbolInfoPtr &info,
+						  SymbolTable &symtab);
+
+    //---------------------------------------------------------------
+    // Specialization
+    //
+    // specializeFunction(info,uniforms,live,symtab) generates code
+    // for a copy of the function described by info where parameter
+    // i is replaced with the constant uniforms[i] (uniforms[i] must
+    // have the same type as the parameter), unless uniforms[i] is 0
+    // or not of a scalar type.  If live[i] is false, the copy does
+    // not compute the value of output parameter i.  Returns a symbol
+    // info object whose address points to the copy.  Copies are
+    // cached; specializing the same function with the same values
+    // twice returns the same object.
+    //
+    // Returns 0 if the function is not defined in this module, or
+    // if the module does not keep its functions' syntax trees.
+    //---------------------------------------------------------------
+
+    SymbolInfoPtr	specializeFunction
+			    (const SymbolInfoPtr &info,
+			     const std::vector<TypeStoragePtr> &uniforms,
+			     const std::vector<bool> &live,
+			     SymbolTable &symtab);
+
   private:
 
+    typedef std::map <const SymbolInfo *, FunctionNodePtr> FunctionMap;
+    typedef std::map <std::string, SymbolInfoPtr> SpecializationMap;
+
     SimdInterpreter &		_interpreter;
     std::vector <SimdInst *>	_code;
     std::vector <SimdReg *>	_staticData;
     const SimdInst *		_firstInitInst;
+    bool			_keepFunctions;
+    FunctionMap			_functions;
+    SpecializationMap		_specializations;
 };
 
 
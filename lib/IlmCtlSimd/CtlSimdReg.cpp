@@ -60,6 +60,7 @@
 
 #include <CtlSimdReg.h>
 #include <sstream>
+#include <assert.h>
 
 
 
@@ -88,7 +89,8 @@ SimdReg::SimdReg (bool varying, size_t elementSize)
   _oVarying(false),
   _offsets(zeroOffset),
   _data (new char [ varying ? MAX_REG_SIZE * _eSize : _eSize]),
-  _ref(0)
+  _ref(0),
+  _ownData(0)
 {
 }
 
@@ -107,7 +109,8 @@ SimdReg::SimdReg
 	 _oVarying(indReg.isVarying() || r._oVarying),
 	 _offsets(new size_t [_oVarying ? MAX_REG_SIZE : 1]),
 	 _data(transferData && r._data ? r._data : 0),
-         _ref(transferData && r._data ? this : (r._ref ? r._ref : &r))
+         _ref(transferData && r._data ? this : (r._ref ? r._ref : &r)),
+	 _ownData(0)
 {
     if( _oVarying )
     {
@@ -172,7 +175,8 @@ SimdReg::SimdReg
 	 _oVarying(r._oVarying),
 	 _offsets(new size_t [_oVarying ? MAX_REG_SIZE : 1]),
 	 _data(transferData && r._data ? r._data : 0),
-         _ref(transferData && r._data ? this : (r._ref ? r._ref : &r))
+         _ref(transferData && r._data ? this : (r._ref ? r._ref : &r)),
+	 _ownData(0)
 {
     if( _oVarying )
     {
@@ -205,7 +209,45 @@ SimdReg::~SimdReg ()
     if( _offsets != zeroOffset)
 	delete [] _offsets;
 
-    delete [] _data;
+    freeData();
+}
+
+
+void
+SimdReg::freeData ()
+{
+    if (_ownData)
+    {
+	delete [] _ownData;
+	_ownData = 0;
+    }
+    else
+    {
+	delete [] _data;
+    }
+
+    _data = 0;
+}
+
+
+void
+SimdReg::bind (char *data)
+{
+    assert (!_ref && _varying && !_ownData);
+
+    _ownData = _data;
+    _data = data;
+}
+
+
+void
+SimdReg::unbind ()
+{
+    if (_ownData)
+    {
+	_data = _ownData;
+	_ownData = 0;
+    }
 }
 
 
@@ -227,7 +269,7 @@ SimdReg::reference(SimdReg &r,
     }
     _oVarying = r._oVarying;
 
-    delete [] _data;
+    freeData();
 
     //
     // If we are tranfering the ownership, and the original is not a reference
@@ -273,7 +315,7 @@ SimdReg::setVarying (bool varying)
 	    memcpy (data, _data, _eSize);
 	}
 
-	delete [] _data;
+	freeData();
  	_data = data;
 	_varying = varying;
     }
@@ -290,7 +332,7 @@ SimdReg::setVaryingDiscardData (bool varying)
     else if (varying != _varying)
     {
         char *data = new char [varying? MAX_REG_SIZE * _eSize: _eSize];
-	delete [] _data;
+	freeData();
  	_data = data;
 	_varying = varying;
     }
@@ -143,6 +143,18 @@ class SimdReg
     void		setVarying (bool varying);
     void		setVaryingDiscardData (bool varying);
     bool                isVarying () const { return _varying || _oVarying; }
+
+    //
+    // bind() makes a varying value register use a buffer owned by
+    // the caller in place of its own data, until unbind() is called.
+    // The buffer must hold as many elements as the instructions that
+    // use the register process.  Changing whether the register is
+    // varying ends the binding; the register's values are then in
+    // its own data.
+    //
+    void		bind (char *data);
+    void		unbind ();
+    bool		isBound () const { return _ownData != 0; }
     size_t              elementSize () const { return _eSize; }
     bool		isReference () const {return _ref != 0;}
 
@@ -210,8 +222,12 @@ class SimdReg
     size_t*             _offsets;      // indexed offsets into a _data block
     char*               _data;
     SimdReg*            _ref;          // If a reference, points to original
+    char*               _ownData;      // If bound, the register's own data
 
   private:
+
+    void		freeData ();
+
     static size_t *zeroOffset;  // for reference registers,_offsets = zeroOffset
 };
 
@@ -65,7 +65,7 @@
 #include <CtlSimdStdLibrary.h>
 #include <CtlSimdStdTypes.h>
 #include <CtlSimdCFunc.h>
-#include <CtlRbfInterpolator.h>
+#include <CtlRbfGridCache.h>
 #include <ImathFun.h>
 #include <cassert>
 
@@ -83,33 +83,7 @@ scatteredDataToGrid3D (int dataSize,
 		       const V3i &gridSize,
 		       V3f grid[])
 {
-    RbfInterpolator interp (dataSize, data);
-
-    float s, t;
-    V3f p;
-
-    for (int i = 0; i < gridSize.x; ++i)
-    {
-        s = float (i) / float (gridSize.x - 1);
-        t = 1 - s;
-        p.x = pMin.x * t + pMax.x * s;
-        
-        for (int j = 0; j < gridSize.y; ++j)
-        {
-            s = float (j) / float (gridSize.y - 1);
-            t = 1 - s;
-            p.y = pMin.y * t + pMax.y * s;
-            
-            for (int k = 0; k < gridSize.z; ++k)
-            {
-                s = float (k) / float (gridSize.z - 1);
-                t = 1 - s;
-                p.z = pMin.z * t + pMax.z * s;
-                
-                grid[(i * gridSize.y + j) * gridSize.z + k] = interp.value (p);
-            }
-        }
-    }
+    RbfGridCache::valueGrid (dataSize, data, pMin, pMax, gridSize, grid);
 }
 
 
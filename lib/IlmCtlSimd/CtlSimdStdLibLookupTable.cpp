@@ -78,12 +78,16 @@ namespace {
 
 typedef float (*Lookup1DFunc) (const float[], int, float, float, float);
 
+typedef void (*Lookup1DBatchFunc) (const float[], int, float, float,
+				   size_t, const float[], float[]);
+
 
 void
 simdDoLookup1D
     (const SimdBoolMask &mask,
      SimdXContext &xcontext,
-     Lookup1DFunc func)
+     Lookup1DFunc func,
+     Lookup1DBatchFunc batchFunc)
 {
     //
     // float func (float table[], float pMin, float pMax, float p)
@@ -106,26 +110,55 @@ simdDoLookup1D
     {
 	returnValue.setVarying (true);
 
-	if (!mask.isVarying() &&
-	    !table.isVarying() &&
+	if (!table.isVarying() &&
 	    !pMin.isVarying() &&
 	    !pMax.isVarying())
 	{
 	    //
 	    // Fast path -- only p is varying, everything else is uniform.
+	    // The lookups are done in batches; samples that are not
+	    // contiguous in p and returnValue, or that are masked off,
+	    // are gathered into and scattered from local buffers.
 	    //
 
 	    float *table0 = (float *)(table[0]);
 	    float pMin0 = *(float *)(pMin[0]);
 	    float pMax0 = *(float *)(pMax[0]);
+	    int n = xcontext.regSize();
 
-	    for (int i = xcontext.regSize(); --i >= 0;)
+	    if (!mask.isVarying() &&
+		!p.isReference() &&
+		!returnValue.isReference() &&
+		p.elementSize() == sizeof (float) &&
+		returnValue.elementSize() == sizeof (float))
 	    {
-		*(float *)(returnValue[i]) = func (table0,
-						   s,
-						   pMin0,
-						   pMax0,
-						   *(float *)(p[i]));
+		batchFunc (table0, s, pMin0, pMax0, n,
+			   (const float *)(p[0]), (float *)(returnValue[0]));
+		return;
+	    }
+
+	    const int BATCH_SIZE = 256;
+	    float pBatch[BATCH_SIZE];
+	    float qBatch[BATCH_SIZE];
+	    int index[BATCH_SIZE];
+
+	    for (int i = 0; i < n;)
+	    {
+		int m = 0;
+
+		for (; i < n && m < BATCH_SIZE; ++i)
+		{
+		    if (mask[i])
+		    {
+			index[m] = i;
+			pBatch[m++] = *(float *)(p[i]);
+		    }
+		}
+
+		batchFunc (table0, s, pMin0, pMax0, m, pBatch, qBatch);
+
+		for (int j = 0; j < m; ++j)
+		    *(float *)(returnValue[index[j]]) = qBatch[j];
 	    }
 	}
 	else
@@ -163,7 +196,7 @@ simdLookup1D (const SimdBoolMask &mask, SimdXContext &xcontext)
     // float lookup1D (float table[], float pMin, float pMax, float p)
     //
 
-    simdDoLookup1D (mask, xcontext, lookup1D);
+    simdDoLookup1D (mask, xcontext, lookup1D, lookup1D);
 }
 
 
@@ -174,7 +207,7 @@ simdLookupCubic1D (const SimdBoolMask &mask, SimdXContext &xcontext)
     // float lookupCubic1D (float table[], float pMin, float pMax, float p)
     //
 
-    simdDoLookup1D (mask, xcontext, lookupCubic1D);
+    simdDoLookup1D (mask, xcontext, lookupCubic1D, lookupCubic1D);
 }
 
 
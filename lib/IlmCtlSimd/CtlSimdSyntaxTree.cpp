@@ -166,21 +166,43 @@ SimdModuleNode::generateCode (LContext &lcontext)
     }
 
     //
-    // Generate code for functions.
+    // Generate code for functions.  In lazy mode, code generation
+    // for each function is deferred until the function is called
+    // from another function, or until a FunctionCall object for it
+    // is created (see SimdModule::generateDeferredFunction()).
+    // If the module keeps its functions' syntax trees so that they
+    // can be specialized later, it records every function, too.
+    // Recorded functions are unlinked from the function list so
+    // that each syntax tree can be freed on its own.
     //
 
+    SimdModule *module = slcontext.simdModule();
     FunctionNodePtr function = functions;
+    bool lazy = module->lazyCodeGeneration();
+    bool keep = module->keepsFunctions();
 
     while (function)
     {
-	function->generateCode (lcontext);
-	function = function->next;
+	FunctionNodePtr next = function->next;
+
+	if (lazy || keep)
+	{
+	    function->next = 0;
+	    module->addFunction (function);
+	}
+
+	if (!lazy)
+	    function->generateCode (lcontext);
+
+	function = next;
     }
 
     //
     // Fixup function call instructions whose callPath was
     // not known when the instructions were generated (see
-    // SimdCallNode::generateCode().
+    // SimdCallNode::generateCode().  In lazy mode this also
+    // generates code for functions called by the module's
+    // initialization code.
     // 
 
     slcontext.fixCalls();
@@ -192,9 +214,11 @@ SimdFunctionNode::SimdFunctionNode
      const std::string &name,
      const SymbolInfoPtr &info,
      const StatementNodePtr &body,
-     const std::vector<DataTypePtr> locals)
+     const std::vector<DataTypePtr> locals,
+     const std::vector<AddrPtr> &parameterAddrs)
 :
-    FunctionNode (lineNumber, name, info, body)
+    FunctionNode (lineNumber, name, info, body),
+    _parameterAddrs (parameterAddrs)
 {
     _locals = locals;
 
@@ -267,6 +291,20 @@ SimdFunctionNode::generateCode (LContext &lcontext)
     SimdInst *firstBodyInst = 
 	generateCodeForPath (body, slcontext, &path, &_locals);
 
+    if (!firstBodyInst)
+    {
+	//
+	// The function body is empty.  Calls to the function must
+	// still have a non-null call path; output an instruction
+	// that does nothing of consequence.
+	//
+
+	slcontext.newPath();
+	slcontext.addInst (new SimdFileNameInst(lcontext.fileName(),
+						lineNumber));
+	firstBodyInst = slcontext.currentPath().firstInst;
+    }
+
     info->setAddr (new SimdInstAddr (firstBodyInst));
     debug_only (if (firstBodyInst) firstBodyInst->printPath (1));
 }
@@ -72,12 +72,18 @@ class SimdLContext;
 class DataType;
 typedef RcPtr<DataType> DataTypePtr;
 
+class Addr;
+typedef RcPtr<Addr> AddrPtr;
+
 class SimdArrayType;
 typedef RcPtr<SimdArrayType> SimdArrayTypePtr;
 
 class SimdValueNode;
 typedef RcPtr<SimdValueNode> SimdValueNodePtr;
 
+struct SimdFunctionNode;
+typedef RcPtr<SimdFunctionNode> SimdFunctionNodePtr;
+
 struct SimdModuleNode: public ModuleNode
 {
     SimdModuleNode (int lineNumber,
@@ -94,13 +100,21 @@ struct SimdFunctionNode: public FunctionNode
 		      const std::string &name,
 		      const SymbolInfoPtr &info,
 		      const StatementNodePtr &body,
-		      const std::vector<DataTypePtr> locals);
+		      const std::vector<DataTypePtr> locals,
+		      const std::vector<AddrPtr> &parameterAddrs);
 
     virtual void        generateESizeCode(SimdLContext &slcontext, 
 					  SimdArrayTypePtr arrayType);
 
     virtual void	generateCode (LContext &lcontext);
     std::vector<DataTypePtr> _locals;
+
+    //
+    // Frame-pointer relative addresses of the function's
+    // parameters, in declaration order.
+    //
+
+    std::vector<AddrPtr> _parameterAddrs;
 };
 
 
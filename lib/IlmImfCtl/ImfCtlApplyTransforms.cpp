@@ -98,6 +98,26 @@ namespace {
 typedef vector <FunctionCallPtr> FunctionList;
 
 
+FrameBuffer::ConstIterator
+findOutputSlice (const FrameBuffer &outFb, const string &name)
+{
+    //
+    // Output argument xOut goes to slice xOut, or else to slice x.
+    //
+
+    FrameBuffer::ConstIterator outSlice = outFb.find (name.c_str());
+
+    if (outSlice == outFb.end() &&
+	name.size() > 3 &&
+	name.substr (name.size() - 3) == "Out")
+    {
+	outSlice = outFb.find (name.substr(0, name.size() - 3).c_str());
+    }
+
+    return outSlice;
+}
+
+
 void
 callFunctions
     (const FunctionList &funcs,
@@ -128,9 +148,12 @@ callFunctions
 	debug ("\tfunction " << func->name());
 
 	//
-	// Provide input argument values.
+	// Provide input argument values.  The slices that the
+	// inputs use in place are remembered in boundInSlices.
 	//
 
+	vector<Slice> boundInSlices;
+
 	for (size_t j = 0; j < func->numInputArgs(); ++j)
 	{
 	    FunctionArgPtr arg = func->inputArg (j);
@@ -160,7 +183,9 @@ callFunctions
 		    {
 			debug ("\t\t\tusing previous output arg");
 
-			copyFunctionArg (numSamples, previousArg, arg);
+			if (!bindFunctionArg (numSamples, previousArg, arg))
+			    copyFunctionArg (numSamples, previousArg, arg);
+
 			continue;
 		    }
 		}
@@ -172,11 +197,23 @@ callFunctions
 		{
 		    debug ("\t\t\tusing input frame buffer");
 
-		    copyFunctionArg (transformWindow,
-				     firstSample,
-				     numSamples,
-				     inSlice.slice(),
-				     arg);
+		    if (bindFunctionArg (transformWindow,
+					 firstSample,
+					 numSamples,
+					 inSlice.slice(),
+					 arg))
+		    {
+			boundInSlices.push_back (inSlice.slice());
+		    }
+		    else
+		    {
+			copyFunctionArg (transformWindow,
+					 firstSample,
+					 numSamples,
+					 inSlice.slice(),
+					 arg);
+		    }
+
 		    continue;
 		}
 
@@ -260,6 +297,55 @@ callFunctions
 	    }
 	}
 
+	//
+	// The last function can store varying output values directly
+	// in the output frame buffer (the values of the other functions
+	// are needed by the function after them), unless the output
+	// slice shares memory with an input slice that is used in
+	// place, for example, when inFb and outFb point to the same
+	// pixels.  The function might then overwrite input values
+	// before it reads them.
+	//
+
+	vector<bool> bound (func->numOutputArgs(), false);
+
+	if (i == funcs.size() - 1)
+	{
+	    for (size_t j = 0; j < func->numOutputArgs(); ++j)
+	    {
+		FunctionArgPtr arg = func->outputArg (j);
+
+		if (!arg->isVarying())
+		    continue;
+
+		FrameBuffer::ConstIterator outSlice =
+		    findOutputSlice (outFb, arg->name());
+
+		if (outSlice == outFb.end())
+		    continue;
+
+		bool overlap = false;
+
+		for (size_t k = 0; k < boundInSlices.size() && !overlap; ++k)
+		{
+		    overlap = slicesOverlap (transformWindow,
+					     firstSample,
+					     numSamples,
+					     outSlice.slice(),
+					     boundInSlices[k]);
+		}
+
+		if (!overlap)
+		{
+		    bound[j] = bindFunctionArg (transformWindow,
+						firstSample,
+						numSamples,
+						outSlice.slice(),
+						arg);
+		}
+	    }
+	}
+
 	//
 	// Call the function
 	//
@@ -281,17 +367,15 @@ callFunctions
 		// Varying output value
 		//
 		
-		FrameBuffer::ConstIterator outSlice =
-		    outFb.find (arg->name().c_str());
-
-		if (outSlice == outFb.end() &&
-		    arg->name().size() > 3 &&
-		    arg->name().substr (arg->name().size() - 3) == "Out")
+		if (bound[j])
 		{
-		    outSlice = outFb.find
-			(arg->name().substr(0, arg->name().size() - 3).c_str());
+		    debug ("\t\t\tstored in output frame buffer\n");
+		    continue;
 		}
 
+		FrameBuffer::ConstIterator outSlice =
+		    findOutputSlice (outFb, arg->name());
+
 		if (outSlice != outFb.end())
 		{
 		    debug ("\t\t\tcopying to output frame buffer\n");
@@ -425,6 +509,103 @@ CallFunctionsTask::execute()
 	for (size_t i = 0; i < _transformNames.size(); ++i)
 	    funcs.push_back (_interpreter.newFunctionCall (_transformNames[i]));
 
+	//
+	// Specialize the functions:
+	//
+	// Uniform input arguments whose values come from inHeader or
+	// envHeader are the same for every sample; they are bound to
+	// those values.
+	//
+	// Output arguments that callFunctions() does not copy to outFb,
+	// outHeader or to an input argument of the next function are
+	// never read; the computations that produce them are skipped.
+	//
+
+	for (size_t i = 0; i < funcs.size(); ++i)
+	{
+	    FunctionCallPtr func = funcs[i];
+	    vector <TypeStoragePtr> uniforms;
+
+	    for (size_t j = 0; j < func->numInputArgs(); ++j)
+	    {
+		FunctionArgPtr arg = func->inputArg (j);
+
+		if (arg->isVarying())
+		    continue;
+
+		//
+		// Values from the previous function's output arguments
+		// take precedence over header attributes; see
+		// callFunctions().
+		//
+
+		if (i > 0 &&
+		    (funcs[i - 1]->findOutputArg (arg->name()) ||
+		     funcs[i - 1]->findOutputArg (arg->name() + "Out")))
+		{
+		    continue;
+		}
+
+		Header::ConstIterator attr =
+		    _inHeader.find (arg->name().c_str());
+
+		if (attr == _inHeader.end())
+		{
+		    attr = _envHeader.find (arg->name().c_str());
+
+		    if (attr == _envHeader.end())
+			continue;
+		}
+
+		copyFunctionArg (attr.attribute(), arg);
+		uniforms.push_back (arg);
+	    }
+
+	    vector <string> liveOutputs;
+
+	    for (size_t j = 0; j < func->numOutputArgs(); ++j)
+	    {
+		const string &name = func->outputArg(j)->name();
+
+		string shortName = name;
+
+		if (name.size() > 3 && name.substr (name.size() - 3) == "Out")
+		    shortName = name.substr (0, name.size() - 3);
+
+		bool live =
+		    _outFb.find (name.c_str()) != _outFb.end() ||
+		    _outFb.find (shortName.c_str()) != _outFb.end() ||
+		    _outHeader.find (name.c_str()) != _outHeader.end() ||
+		    _outHeader.find (shortName.c_str()) != _outHeader.end();
+
+		if (!live && i + 1 < funcs.size())
+		{
+		    //
+		    // The next function looks for an output argument
+		    // called x or xOut for each of its input arguments x.
+		    //
+
+		    live = funcs[i + 1]->findInputArg (name) ||
+			   funcs[i + 1]->findInputArg (shortName);
+		}
+
+		if (live)
+		    liveOutputs.push_back (name);
+	    }
+
+	    //
+	    // Specialize the function only if that can save work;
+	    // otherwise keep the plain function call.
+	    //
+
+	    if (!uniforms.empty() ||
+		liveOutputs.size() < func->numOutputArgs())
+	    {
+		funcs[i] = _interpreter.specializeFunctionCall
+				(_transformNames[i], uniforms, liveOutputs);
+	    }
+	}
+
 	//
 	// Repeatedly call the transform functions, breaking the
 	// varying data into packets of at most maxSamples samples.
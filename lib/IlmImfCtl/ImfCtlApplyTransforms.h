@@ -155,8 +155,9 @@
 //		    error (throw Iex::ArgExc)
 //
 //	In all cases, the type of the value used must match the type of the
-//	input parameter.  A type mismatch is an error; applyTransforms()
-//	throws an Iex::TypeExc.
+//	input parameter, except that HALF and FLOAT frame buffer slices are
+//	converted to half or float input parameters.  A type mismatch is an
+//	error; applyTransforms() throws an Iex::TypeExc.
 //
 //	After the CTL function returns, the value of each output parameters,
 //	with name n, may be copied into outHeader or outFb, in addition to
@@ -181,8 +182,9 @@
 //		    copy the value into the outHeader attribute
 //
 //	The type of the output parameter must match the type of the frame
-//	buffer slice or header attribute.  A type mismatch is an error;
-//	applyTransforms() throws an Iex::TypeExc.
+//	buffer slice or header attribute, except that half and float output
+//	parameters are converted to HALF or FLOAT frame buffer slices.  A
+//	type mismatch is an error; applyTransforms() throws an Iex::TypeExc.
 //
 //	applyTransforms() does not add attributes to outHeader or slices
 //	to the outFb.  Only existing attributes or slices are used.
@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+//-----------------------------------------------------------------------------
+//
+//	Replacing a series of CTL functions with a lookup table.
+//
+//-----------------------------------------------------------------------------
+
+#include <ImfCtlBakeTransforms.h>
+#include <ImfHeader.h>
+#include <ImfFrameBuffer.h>
+#include <CtlInterpreter.h>
+#include <half.h>
+#include <Iex.h>
+#include <string.h>
+#include <memory>
+
+using namespace std;
+using namespace Iex;
+using namespace Imath;
+using namespace Imf;
+using namespace Ctl;
+
+namespace ImfCtl {
+namespace {
+
+const char *channelNames[3] = {"R", "G", "B"};
+
+
+class TransformsSource: public LutSource
+{
+  public:
+
+    TransformsSource (Interpreter &interpreter,
+		      const StringList &transformNames,
+		      const Header &envHeader,
+		      const Header &inHeader)
+    :
+	_interpreter (interpreter),
+	_transformNames (transformNames),
+	_envHeader (envHeader),
+	_inHeader (inHeader)
+    {
+	// empty
+    }
+
+    virtual void	evaluate (size_t n, const float in[], float out[]);
+
+  private:
+
+    Interpreter &	_interpreter;
+    const StringList &	_transformNames;
+    const Header &	_envHeader;
+    const Header &	_inHeader;
+};
+
+
+void
+TransformsSource::evaluate (size_t n, const float in[], float out[])
+{
+    //
+    // The samples form a single row of pixels, with
+    // interleaved "R", "G" and "B" slices.
+    //
+
+    Box2i window (V2i (0, 0), V2i (n - 1, 0));
+    FrameBuffer inFb;
+    FrameBuffer outFb;
+
+    for (int c = 0; c < 3; ++c)
+    {
+	inFb.insert (channelNames[c],
+		     Slice (FLOAT,
+			    (char *) (in + c),
+			    3 * sizeof (float),
+			    3 * sizeof (float) * n));
+
+	outFb.insert (channelNames[c],
+		      Slice (FLOAT,
+			     (char *) (out + c),
+			     3 * sizeof (float),
+			     3 * sizeof (float) * n));
+    }
+
+    memset (out, 0, 3 * sizeof (float) * n);
+
+    Header outHeader;
+
+    applyTransforms (_interpreter,
+		     _transformNames,
+		     window,
+		     _envHeader,
+		     _inHeader,
+		     inFb,
+		     outHeader,
+		     outFb);
+}
+
+
+const Slice &
+rgbSlice (const FrameBuffer &fb, int c)
+{
+    const Slice *slice = fb.findSlice (channelNames[c]);
+
+    if (slice == 0)
+	THROW (ArgExc, "Cannot apply a baked lookup table to a frame "
+		       "buffer without a \"" << channelNames[c] << "\" "
+		       "slice.");
+
+    if (slice->xSampling != 1 || slice->ySampling != 1)
+	THROW (NoImplExc, "Frame buffer slices used with baked lookup "
+			  "tables must have x and y sampling rate 1.");
+
+    if (slice->type != HALF && slice->type != FLOAT)
+	THROW (TypeExc, "Frame buffer slices used with baked lookup "
+			"tables must be of type HALF or FLOAT.");
+
+    return *slice;
+}
+
+} // namespace
+
+
+BakedLut *
+bakeTransforms
+    (Interpreter &interpreter,
+     const StringList &transformNames,
+     const Header &envHeader,
+     const Header &inHeader,
+     BakedLut::Type type,
+     int size,
+     BakedLut::Shaper shaper,
+     float domainMin,
+     float domainMax,
+     size_t numValidationSamples)
+{
+#if __cplusplus >= 201103L
+    std::unique_ptr<BakedLut> lut (new BakedLut (type, size, shaper,
+						 domainMin, domainMax));
+#else
+    std::auto_ptr<BakedLut> lut (new BakedLut (type, size, shaper,
+					       domainMin, domainMax));
+#endif
+
+    TransformsSource source (interpreter, transformNames, envHeader, inHeader);
+    lut->bake (source);
+    lut->validate (source, numValidationSamples);
+
+    return lut.release();
+}
+
+
+void
+applyBakedLut
+    (const BakedLut &lut,
+     const Box2i &transformWindow,
+     const FrameBuffer &inFb,
+     const FrameBuffer &outFb)
+{
+    const Slice *src[3];
+    const Slice *dst[3];
+
+    for (int c = 0; c < 3; ++c)
+    {
+	src[c] = &rgbSlice (inFb, c);
+	dst[c] = &rgbSlice (outFb, c);
+    }
+
+    //
+    // Process one row at a time: gather the row into an
+    // interleaved buffer, look it up, and scatter the results.
+    //
+
+    long w = transformWindow.max.x - transformWindow.min.x + 1;
+    vector<float> row (3 * w);
+
+    for (int y = transformWindow.min.y; y <= transformWindow.max.y; ++y)
+    {
+	for (int c = 0; c < 3; ++c)
+	{
+	    const Slice &s = *src[c];
+	    char *base = s.base + y * s.yStride;
+
+	    if (s.type == HALF)
+	    {
+		for (long i = 0, x = transformWindow.min.x; i < w; ++i, ++x)
+		    row[3 * i + c] = *(half *)(base + x * s.xStride);
+	    }
+	    else
+	    {
+		for (long i = 0, x = transformWindow.min.x; i < w; ++i, ++x)
+		    row[3 * i + c] = *(float *)(base + x * s.xStride);
+	    }
+	}
+
+	lut.apply (w, &row[0], 3, &row[0], 3);
+
+	for (int c = 0; c < 3; ++c)
+	{
+	    const Slice &s = *dst[c];
+	    char *base = s.base + y * s.yStride;
+
+	    if (s.type == HALF)
+	    {
+		for (long i = 0, x = transformWindow.min.x; i < w; ++i, ++x)
+		    *(half *)(base + x * s.xStride) = row[3 * i + c];
+	    }
+	    else
+	    {
+		for (long i = 0, x = transformWindow.min.x; i < w; ++i, ++x)
+		    *(float *)(base + x * s.xStride) = row[3 * i + c];
+	    }
+	}
+    }
+}
+
+} // namespace ImfCtl
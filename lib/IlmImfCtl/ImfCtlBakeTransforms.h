@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_IMF_CTL_BAKE_TRANSFORMS_H
+#define INCLUDED_IMF_CTL_BAKE_TRANSFORMS_H
+
+//-----------------------------------------------------------------------------
+//
+//	Replacing a series of CTL functions with a lookup table.
+//
+//	Function bakeTransforms() samples the CTL functions listed in
+//	transformNames onto the grid of a Ctl::BakedLut (see
+//	CtlBakedLut.h), and validates the resulting table against the
+//	CTL functions.  The functions are called the same way as by
+//	applyTransforms() (see ImfCtlApplyTransforms.h), with input
+//	frame buffer slices "R", "G" and "B", and output frame buffer
+//	slices "R", "G" and "B".  Uniform input parameters come from
+//	inHeader and envHeader.
+//
+//	The caller owns the returned table.  If the table's maxError()
+//	is acceptable, applyBakedLut() can be used instead of
+//	applyTransforms() for every frame buffer with the same
+//	inHeader and envHeader.
+//
+//	Function applyBakedLut() looks up the pixels in the "R", "G"
+//	and "B" slices of inFb in the table, and stores the results
+//	in the "R", "G" and "B" slices of outFb.  The slices may be
+//	of type HALF or FLOAT, and inFb and outFb may share slices.
+//
+//-----------------------------------------------------------------------------
+
+#include <ImfCtlApplyTransforms.h>
+#include <CtlBakedLut.h>
+
+namespace ImfCtl
+{
+    Ctl::BakedLut *
+    bakeTransforms
+	(Ctl::Interpreter &interpreter,
+	 const StringList &transformNames,
+	 const Imf::Header &envHeader,
+	 const Imf::Header &inHeader,
+	 Ctl::BakedLut::Type type,
+	 int size,
+	 Ctl::BakedLut::Shaper shaper = Ctl::BakedLut::SHAPER_LINEAR,
+	 float domainMin = 0,
+	 float domainMax = 1,
+	 size_t numValidationSamples = 10000);
+
+    void
+    applyBakedLut
+	(const Ctl::BakedLut &lut,
+	 const Imath::Box2i &transformWindow,
+	 const Imf::FrameBuffer &inFb,
+	 const Imf::FrameBuffer &outFb);
+}
+
+#endif
@@ -70,9 +70,16 @@
 #include <ImfVecAttribute.h>
 #include <ImathFun.h>
 #include <Iex.h>
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+    #define IMFCTL_COPY_X86 1
+    #include <immintrin.h>
+#endif
+
 using namespace Imath;
 using namespace Imf;
 using namespace Ctl;
@@ -180,98 +187,386 @@ throwSliceSampling ()
 	   "CTL function calls must have x and y sampling rate 1.");
 }
 
-} // namespace
 
+//
+// Row spans.  The samples of a varying CTL function argument are
+// contiguous, and the samples in one row of a frame buffer slice
+// are xStride bytes apart.  The copy functions above hand each row
+// of the transform window to copySamples(), which uses memcpy() if
+// both sides are contiguous, AVX2 gathers to collect interleaved
+// float samples, and the F16C instructions to convert between half
+// and float if the slice and the argument differ in type.
+//
 
-void
-copyFunctionArg
-    (const Box2i transformWindow,
-     size_t firstSample,
-     size_t numSamples,
-     const Slice &src,
-     const FunctionArgPtr &dst)
+PixelType
+argPixelType (const FunctionArgPtr &arg)
 {
-    assert (dst->isVarying());
+    if (arg->type().cast<HalfType>())
+	return HALF;
 
-    if (src.xSampling != 1 || src.ySampling != 1)
-	throwSliceSampling();
+    if (arg->type().cast<FloatType>())
+	return Imf::FLOAT;
+
+    if (arg->type().cast<UIntType>())
+	return Imf::UINT;
+
+    return Imf::NUM_PIXELTYPES;
+}
 
-    long w = transformWindow.max.x - transformWindow.min.x + 1;
-    long x = transformWindow.min.x + modp (firstSample, w);
-    long y = transformWindow.min.y + divp (firstSample, w);
-    char *dstData = (dst->data());
-    size_t dstStride = dst->type()->alignedObjectSize();
 
-    switch (src.type)
+const char *
+pixelTypeName (PixelType type)
+{
+    switch (type)
     {
       case HALF:
+	return "HALF";
 
-	if (!dst->type().cast<HalfType>())
-	    throwSrcSliceTypeMismatch ("HALF", dst);
+      case Imf::FLOAT:
+	return "FLOAT";
 
-	for (size_t i = 0; i < numSamples; ++i)
-	{
-	    *(half *)dstData =
-		*(half *)(src.base + x * src.xStride + y * src.yStride);
+      case Imf::UINT:
+	return "UINT";
 
-	    dstData += dstStride;
-	    x += 1;
+      default:
+	return "unknown";
+    }
+}
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
+
+bool
+canCopySamples (PixelType srcType, PixelType dstType)
+{
+    if (srcType == Imf::NUM_PIXELTYPES || dstType == Imf::NUM_PIXELTYPES)
+	return false;
+
+    //
+    // Half and float samples are converted; unsigned
+    // integers are only copied to unsigned integers.
+    //
+
+    return srcType == dstType ||
+	   (srcType != Imf::UINT && dstType != Imf::UINT);
+}
+
+
+size_t
+sampleSize (PixelType type)
+{
+    return type == HALF? sizeof (half): sizeof (float);
+}
+
+
+template <class S, class D>
+void
+copySamples
+    (const char *src,
+     size_t srcStride,
+     char *dst,
+     size_t dstStride,
+     size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+	*(D *)dst = D (*(const S *)src);
+	src += srcStride;
+	dst += dstStride;
+    }
+}
+
+
+#if defined (IMFCTL_COPY_X86)
+
+bool
+haveAvx2 ()
+{
+    static const bool avx2 = (__builtin_cpu_init(),
+			      __builtin_cpu_supports ("avx2"));
+    return avx2;
+}
+
+
+bool
+haveF16c ()
+{
+    static const bool f16c = (__builtin_cpu_init(),
+			      __builtin_cpu_supports ("avx") &&
+			      __builtin_cpu_supports ("f16c"));
+    return f16c;
+}
+
+
+__attribute__ ((target ("avx2")))
+size_t
+gatherFloats
+    (const char *src,
+     size_t srcStride,
+     char *dst,
+     size_t n)
+{
+    //
+    // Interleaved float samples -> contiguous float samples,
+    // eight at a time.  Returns the number of samples copied.
+    //
+
+    if (srcStride > INT_MAX / 8)
+	return 0;
+
+    int s = int (srcStride);
+    const __m256i index = _mm256_setr_epi32 (0, s, 2*s, 3*s,
+					     4*s, 5*s, 6*s, 7*s);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+	__m256 v = _mm256_i32gather_ps ((const float *) src, index, 1);
+	_mm256_storeu_ps ((float *) dst, v);
+	src += 8 * srcStride;
+	dst += 8 * sizeof (float);
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+
+__attribute__ ((target ("avx,f16c")))
+size_t
+halfToFloat
+    (const char *src,
+     size_t srcStride,
+     char *dst,
+     size_t dstStride,
+     size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+	__m128i h;
+
+	if (srcStride == sizeof (half))
+	{
+	    h = _mm_loadu_si128 ((const __m128i *) src);
 	}
+	else
+	{
+	    const char *p = src;
+	    unsigned short b[8];
 
-	break;
+	    for (int j = 0; j < 8; ++j, p += srcStride)
+		b[j] = ((const half *) p)->bits();
 
-	  case Imf::FLOAT:
+	    h = _mm_loadu_si128 ((const __m128i *) b);
+	}
 
-	if (!dst->type().cast<FloatType>())
-	    throwSrcSliceTypeMismatch ("FLOAT", dst);
+	__m256 f = _mm256_cvtph_ps (h);
 
-	for (size_t i = 0; i < numSamples; ++i)
+	if (dstStride == sizeof (float))
 	{
-	    *(float *)dstData =
-		*(float *)(src.base + x * src.xStride + y * src.yStride);
+	    _mm256_storeu_ps ((float *) dst, f);
+	}
+	else
+	{
+	    float b[8];
+	    _mm256_storeu_ps (b, f);
 
-	    dstData += dstStride;
-	    x += 1;
+	    for (int j = 0; j < 8; ++j)
+		*(float *)(dst + j * dstStride) = b[j];
+	}
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
+	src += 8 * srcStride;
+	dst += 8 * dstStride;
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+
+__attribute__ ((target ("avx,f16c")))
+size_t
+floatToHalf
+    (const char *src,
+     size_t srcStride,
+     char *dst,
+     size_t dstStride,
+     size_t n)
+{
+    //
+    // Rounds to the nearest half, ties to even, like half (float).
+    //
+
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+	__m256 f;
+
+	if (srcStride == sizeof (float))
+	{
+	    f = _mm256_loadu_ps ((const float *) src);
 	}
+	else
+	{
+	    float b[8];
 
-	break;
+	    for (int j = 0; j < 8; ++j)
+		b[j] = *(const float *)(src + j * srcStride);
 
-	  case Imf::UINT:
+	    f = _mm256_loadu_ps (b);
+	}
 
-	if (!dst->type().cast<UIntType>())
-	    throwSrcSliceTypeMismatch ("UINT", dst);
+	__m128i h = _mm256_cvtps_ph (f, _MM_FROUND_TO_NEAREST_INT);
 
-	for (size_t i = 0; i < numSamples; ++i)
+	if (dstStride == sizeof (half))
 	{
-	    *(unsigned int *)dstData =
-		*(unsigned int *)(src.base + x * src.xStride + y * src.yStride);
+	    _mm_storeu_si128 ((__m128i *) dst, h);
+	}
+	else
+	{
+	    unsigned short b[8];
+	    _mm_storeu_si128 ((__m128i *) b, h);
+
+	    for (int j = 0; j < 8; ++j)
+		((half *)(dst + j * dstStride))->setBits (b[j]);
+	}
 
-	    dstData += dstStride;
-	    x += 1;
+	src += 8 * srcStride;
+	dst += 8 * dstStride;
+    }
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#endif
+
+
+void
+copySamples
+    (const char *src,
+     size_t srcStride,
+     PixelType srcType,
+     char *dst,
+     size_t dstStride,
+     PixelType dstType,
+     size_t n)
+{
+    if (srcType == dstType)
+    {
+	size_t size = srcType == Imf::UINT? sizeof (unsigned int):
+					    sampleSize (srcType);
+
+	if (srcStride == size && dstStride == size)
+	{
+	    memcpy (dst, src, n * size);
+	    return;
 	}
+    }
+
+#if defined (IMFCTL_COPY_X86)
+
+    size_t i = 0;
+
+    if (srcType == Imf::FLOAT && dstType == Imf::FLOAT &&
+	dstStride == sizeof (float) && haveAvx2())
+    {
+	i = gatherFloats (src, srcStride, dst, n);
+    }
+    else if (srcType == HALF && dstType == Imf::FLOAT && haveF16c())
+    {
+	i = halfToFloat (src, srcStride, dst, dstStride, n);
+    }
+    else if (srcType == Imf::FLOAT && dstType == HALF && haveF16c())
+    {
+	i = floatToHalf (src, srcStride, dst, dstStride, n);
+    }
+
+    src += i * srcStride;
+    dst += i * dstStride;
+    n -= i;
+
+#endif
+
+    switch (srcType)
+    {
+      case HALF:
+
+	if (dstType == HALF)
+	    copySamples<half, half> (src, srcStride, dst, dstStride, n);
+	else
+	    copySamples<half, float> (src, srcStride, dst, dstStride, n);
 
 	break;
 
-	  case Imf::NUM_PIXELTYPES:
+      case Imf::FLOAT:
+
+	if (dstType == HALF)
+	    copySamples<float, half> (src, srcStride, dst, dstStride, n);
+	else
+	    copySamples<float, float> (src, srcStride, dst, dstStride, n);
+
+	break;
+
+      case Imf::UINT:
+
+	copySamples<unsigned int, unsigned int>
+	    (src, srcStride, dst, dstStride, n);
+
 	break;
+
+      default:
+	break;
+    }
+}
+
+} // namespace
+
+
+void
+copyFunctionArg
+    (const Box2i transformWindow,
+     size_t firstSample,
+     size_t numSamples,
+     const Slice &src,
+     const FunctionArgPtr &dst)
+{
+    assert (dst->isVarying());
+
+    if (src.xSampling != 1 || src.ySampling != 1)
+	throwSliceSampling();
+
+    if (src.type == Imf::NUM_PIXELTYPES)
+	return;
+
+    PixelType dstType = argPixelType (dst);
+
+    if (!canCopySamples (src.type, dstType))
+	throwSrcSliceTypeMismatch (pixelTypeName (src.type), dst);
+
+    long w = transformWindow.max.x - transformWindow.min.x + 1;
+    long x = transformWindow.min.x + modp (firstSample, w);
+    long y = transformWindow.min.y + divp (firstSample, w);
+    char *dstData = (dst->data());
+    size_t dstStride = dst->type()->alignedObjectSize();
+
+    while (numSamples > 0)
+    {
+	size_t n = min (numSamples, size_t (transformWindow.max.x - x + 1));
+
+	copySamples (src.base + x * src.xStride + y * src.yStride,
+		     src.xStride,
+		     src.type,
+		     dstData,
+		     dstStride,
+		     dstType,
+		     n);
+
+	dstData += n * dstStride;
+	numSamples -= n;
+	x = transformWindow.min.x;
+	y += 1;
     }
 }
 
@@ -289,83 +584,174 @@ copyFunctionArg
     if (dst.xSampling != 1 || dst.ySampling != 1)
 	throwSliceSampling();
 
+    if (dst.type == Imf::NUM_PIXELTYPES)
+	return;
+
+    PixelType srcType = argPixelType (src);
+
+    if (!canCopySamples (srcType, dst.type))
+	throwDstSliceTypeMismatch (src, pixelTypeName (dst.type));
+
     long w = transformWindow.max.x - transformWindow.min.x + 1;
     long x = transformWindow.min.x + modp (firstSample, w);
     long y = transformWindow.min.y + divp (firstSample, w);
     const char *srcData = (src->data());
     size_t srcStride = src->type()->alignedObjectSize();
 
-    switch (dst.type)
+    while (numSamples > 0)
     {
-      case HALF:
+	size_t n = min (numSamples, size_t (transformWindow.max.x - x + 1));
+
+	copySamples (srcData,
+		     srcStride,
+		     srcType,
+		     dst.base + x * dst.xStride + y * dst.yStride,
+		     dst.xStride,
+		     dst.type,
+		     n);
+
+	srcData += n * srcStride;
+	numSamples -= n;
+	x = transformWindow.min.x;
+	y += 1;
+    }
+}
 
-	if (!src->type().cast<HalfType>())
-	    throwDstSliceTypeMismatch (src, "HALF");
 
-	for (size_t i = 0; i < numSamples; ++i)
-	{
-	    *(half *)(dst.base + x * dst.xStride + y * dst.yStride) =
-		*(half *)srcData;
+bool
+bindFunctionArg
+    (size_t numSamples,
+     const FunctionArgPtr &src,
+     const FunctionArgPtr &dst)
+{
+    if (!src->isVarying() ||
+	!dst->isVarying() ||
+	!src->type()->isSameTypeAs (dst->type()))
+    {
+	return false;
+    }
 
-	    srcData += srcStride;
-	    x += 1;
+    size_t stride = src->type()->alignedObjectSize();
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
-	}
+    if (src->type().cast<HalfType>())
+	return dst->bindBuffer ((half *) src->data(), stride, numSamples);
 
-	break;
+    if (src->type().cast<FloatType>())
+	return dst->bindBuffer ((float *) src->data(), stride, numSamples);
 
-	  case Imf::FLOAT:
+    return false;
+}
 
-	if (!src->type().cast<FloatType>())
-	    throwDstSliceTypeMismatch (src, "FLOAT");
 
-	for (size_t i = 0; i < numSamples; ++i)
-	{
-	    *(float *)(dst.base + x * dst.xStride + y * dst.yStride) =
-		*(float *)srcData;
+bool
+bindFunctionArg
+    (const Box2i transformWindow,
+     size_t firstSample,
+     size_t numSamples,
+     const Slice &slice,
+     const FunctionArgPtr &arg)
+{
+    if (slice.xSampling != 1 || slice.ySampling != 1 || numSamples == 0)
+	return false;
 
-	    srcData += srcStride;
-	    x += 1;
+    //
+    // The samples must be in a single row of the transform window.
+    //
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
-	}
+    long w = transformWindow.max.x - transformWindow.min.x + 1;
+    long x = transformWindow.min.x + modp (firstSample, w);
+    long y = transformWindow.min.y + divp (firstSample, w);
 
-	break;
+    if (x + (long) numSamples - 1 > transformWindow.max.x)
+	return false;
 
-	  case Imf::UINT:
+    char *base = slice.base + x * slice.xStride + y * slice.yStride;
 
-	if (!src->type().cast<UIntType>())
-	    throwDstSliceTypeMismatch (src, "UINT");
+    switch (slice.type)
+    {
+      case HALF:
 
-	for (size_t i = 0; i < numSamples; ++i)
-	{
-	    *(unsigned int *)(dst.base + x * dst.xStride + y * dst.yStride) =
-		*(unsigned int *)srcData;
+	return arg->bindBuffer ((half *) base, slice.xStride, numSamples);
 
-	    srcData += srcStride;
-	    x += 1;
+      case Imf::FLOAT:
 
-	    if (x > transformWindow.max.x)
-	    {
-		y += 1;
-		x = transformWindow.min.x;
-	    }
-	}
+	return arg->bindBuffer ((float *) base, slice.xStride, numSamples);
 
-	break;
+      default:
 
-	  case Imf::NUM_PIXELTYPES:
-	break;
+	return false;
+    }
+}
+
+
+namespace {
+
+void
+sampleRange
+    (const Box2i transformWindow,
+     size_t firstSample,
+     size_t numSamples,
+     const Slice &slice,
+     const char *&begin,
+     const char *&end)
+{
+    //
+    // Find the lowest and the highest address of the
+    // samples, which may be spread over several rows.
+    //
+
+    long w = transformWindow.max.x - transformWindow.min.x + 1;
+    long x = transformWindow.min.x + modp (firstSample, w);
+    long y = transformWindow.min.y + divp (firstSample, w);
+
+    long lastSample = firstSample + numSamples - 1;
+    long lastX = transformWindow.min.x + modp (lastSample, w);
+    long lastY = transformWindow.min.y + divp (lastSample, w);
+
+    if (lastY > y)
+    {
+	x = transformWindow.min.x;
+	lastX = transformWindow.max.x;
     }
+
+    const char *p[4] =
+    {
+	slice.base + x * slice.xStride + y * slice.yStride,
+	slice.base + lastX * slice.xStride + y * slice.yStride,
+	slice.base + x * slice.xStride + lastY * slice.yStride,
+	slice.base + lastX * slice.xStride + lastY * slice.yStride
+    };
+
+    begin = end = p[0];
+
+    for (int i = 1; i < 4; ++i)
+    {
+	begin = min (begin, p[i]);
+	end = max (end, p[i]);
+    }
+
+    end += sampleSize (slice.type);
+}
+
+} // namespace
+
+
+bool
+slicesOverlap
+    (const Box2i transformWindow,
+     size_t firstSample,
+     size_t numSamples,
+     const Slice &a,
+     const Slice &b)
+{
+    if (numSamples == 0)
+	return false;
+
+    const char *aBegin, *aEnd, *bBegin, *bEnd;
+    sampleRange (transformWindow, firstSample, numSamples, a, aBegin, aEnd);
+    sampleRange (transformWindow, firstSample, numSamples, b, bBegin, bEnd);
+
+    return aBegin < bEnd && bBegin < aEnd;
 }
 
 
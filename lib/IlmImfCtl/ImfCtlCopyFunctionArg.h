@@ -80,6 +80,10 @@ void copyFunctionArg (size_t numSamples,
 //
 // Frame buffer slice <-> varying FunctionArg
 //
+// The samples are copied one row of the transform window at a time.
+// HALF and FLOAT slices are converted to and from half and float
+// arguments; any other type mismatch throws an Iex::TypeExc.
+//
 
 void copyFunctionArg (const Imath::Box2i transformWindow,
 		      size_t firstSample,
@@ -93,6 +97,38 @@ void copyFunctionArg (const Imath::Box2i transformWindow,
 		      const Ctl::FunctionArgPtr &src,
 		      const Imf::Slice &dst);
 
+//
+// Frame buffer slice or varying FunctionArg -> varying FunctionArg,
+// without copying: the values are used in place during the next call
+// of dst's function (see Ctl::FunctionArg::bindBuffer()).  Returns
+// false if the layout of the values does not allow that; they must
+// then be copied with copyFunctionArg().
+//
+
+bool bindFunctionArg (size_t numSamples,
+		      const Ctl::FunctionArgPtr &src,
+		      const Ctl::FunctionArgPtr &dst);
+
+bool bindFunctionArg (const Imath::Box2i transformWindow,
+		      size_t firstSample,
+		      size_t numSamples,
+		      const Imf::Slice &slice,
+		      const Ctl::FunctionArgPtr &arg);
+
+//
+// Returns true if the samples firstSample through
+// firstSample + numSamples - 1 of slices a and b
+// share memory.  Before an output argument is bound
+// to a slice, the caller must check that the slice
+// does not overlap an input bound to another slice.
+//
+
+bool slicesOverlap (const Imath::Box2i transformWindow,
+		    size_t firstSample,
+		    size_t numSamples,
+		    const Imf::Slice &a,
+		    const Imf::Slice &b);
+
 //
 // Attribute <-> uniform FunctionArg
 //
@@ -81,6 +81,8 @@ namespace ctl {
 // class methods to keep the dpx header down to a sane size...
 namespace dpxi {
 struct rwinfo;
+struct strip_reader_state;
+struct strip_writer_state;
 };
 
 struct dpx {
@@ -402,6 +404,44 @@ struct dpx {
 		void read(std::istream *io, uint8_t element, fb<uint64_t> *buffer,
 		          float64_t scale=0.0, intmode_e mode=normal);
 
+		// Reads an element of the named local file (whose header has
+		// already been read with read(std::istream *) above) through a
+		// memory mapping, decoding it a row at a time straight into the
+		// buffer. This avoids the intermediate copies of the stream
+		// read. Returns FALSE, leaving the buffer untouched, if the file
+		// can not be mapped or the element is in a layout only the
+		// stream read handles; the caller should then use read(...).
+		bool read_mapped(const char *filename, uint8_t element,
+		                 fb<float32_t> *buffer, float64_t scale=0.0);
+
+		// Decodes an element of a mapped local file a strip of rows at a
+		// time, for callers that never want the whole element in memory.
+		// The rows come out exactly as read_mapped(...) would produce them.
+		class strip_reader {
+			public:
+				strip_reader();
+				~strip_reader();
+
+				// Returns FALSE in the same cases as read_mapped(...).
+				bool open(const dpx *header, const char *filename,
+				          uint8_t element, float64_t scale=0.0);
+
+				uint32_t width(void) const;
+				uint32_t height(void) const;
+				uint32_t depth(void) const;
+
+				// Decodes 'rows' rows starting at 'first_row' into the
+				// buffer, which is initialised to hold them.
+				void read(uint32_t first_row, uint32_t rows,
+				          fb<float32_t> *buffer);
+
+			private:
+				strip_reader(const strip_reader &);
+				strip_reader &operator=(const strip_reader &);
+
+				dpxi::strip_reader_state *_state;
+		};
+
 		//
 		// If not filled out ahead of time (i.e. have 'null' values associated
 		// with them), then the following fields will be set based on
@@ -473,10 +513,22 @@ struct dpx {
 		// Like all of the read(...) methods, this will rewind the osream
 		// to the point it was at when the write(...) method was called.
 		//
+		// Float buffers written to integer samples of up to 16 bits can
+		// be dithered: a threshold in (-0.5, 0.5) code values, taken from
+		// a mask tiled over the image, is added to each sample before it
+		// is rounded, so that smooth gradients do not band at low bit
+		// depths. All of the samples of a pixel get the same threshold.
+		enum dither_e {
+			no_dither=0,
+			ordered_dither=1,   // 8x8 Bayer matrix
+			blue_noise_dither=2 // 64x64 void-and-cluster mask
+		};
+
 		void write(std::ostream *o, uint8_t element,
 		           const fb<half> &buffer, float64_t scale=0.0);
 		void write(std::ostream *o, uint8_t element,
-		           const fb<float32_t> &buffer, float64_t scale=0.0);
+		           const fb<float32_t> &buffer, float64_t scale=0.0,
+		           dither_e dither=no_dither);
 		void write(std::ostream *o, uint8_t element,
 		           const fb<float64_t> &buffer, float64_t scale=0.0);
 		void write(std::ostream *o, uint8_t element,
@@ -492,6 +544,37 @@ struct dpx {
 		           const fb<uint64_t> &buffer, float64_t scale=0.0,
 		           intmode_e mode=normal);
 
+		// Writes a float element a strip of rows at a time. The element
+		// is laid out (and the header fields filled in) exactly as
+		// write(o, element, fb<float32_t>) would do for a buffer of the
+		// same size, and the bytes written are the same.
+		class strip_writer {
+			public:
+				strip_writer();
+				~strip_writer();
+
+				// Returns FALSE, leaving the header and stream untouched,
+				// if the element's packing can only be written from a
+				// whole image; the caller should then use write(...).
+				bool open(dpx *header, std::ostream *o, uint8_t element,
+				          uint32_t width, uint32_t height, uint32_t depth,
+				          float64_t scale=0.0, dither_e dither=no_dither);
+
+				// Writes the next rows of the image (top to bottom); the
+				// buffer must be as wide and deep as given to open().
+				void write(const fb<float32_t> &buffer);
+
+				// Rewinds the stream to where it was when open() was
+				// called, so the header can be written.
+				void close(void);
+
+			private:
+				strip_writer(const strip_writer &);
+				strip_writer &operator=(const strip_writer &);
+
+				dpxi::strip_writer_state *_state;
+		};
+
 		// Can perform pretty much perform every imaginable conversion
 		// between two types. While there are a number of functions, they
 		// all eventually call the same method at the base of things, and
@@ -610,6 +693,18 @@ struct dpx {
 		static void convert(O *o, uint8_t osb, const I *i, uint8_t isb,
 		                    float64_t scale, uint64_t count);
 
+		// Converts one row of 'width' pixels of 'depth' samples like
+		// convert(o, osb, i, scale, width*depth), with the thresholds of
+		// the dither mask (see dither_e above) added before rounding.
+		// 'row' is the number of the row in the image, so that strips
+		// converted separately line up.
+		static void dither(uint8_t *o, uint8_t osb, const float32_t *i,
+		                   float64_t scale, uint32_t width, uint32_t depth,
+		                   uint32_t row, dither_e mode);
+		static void dither(uint16_t *o, uint8_t osb, const float32_t *i,
+		                   float64_t scale, uint32_t width, uint32_t depth,
+		                   uint32_t row, dither_e mode);
+
 
 		// Some static methods to take de-enumerate some of the
 		// header values.
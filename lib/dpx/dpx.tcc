@@ -661,45 +661,80 @@ template <class O, class I>
 void _convertfblut(O *out, uint8_t osb, const I *in, uint8_t isb,
                    float64_t scale, uint64_t count);
 
+// Vectorised versions of the conversions between float32_t and 8 or 16 bit
+// integers (dpx_convert.cc). They give exactly the same results as the
+// functions above. They return FALSE without doing anything for other
+// conversions, or if the CPU can't run them.
 template <class O, class I>
-void _convertlut(O *o, uint8_t osb, const I *in, uint8_t isb,
-                 float64_t scale, uint64_t count) {
+bool convert_simd(O *out, uint8_t osb, const I *in, uint8_t isb,
+                  float64_t scale, uint64_t count) {
+	return FALSE;
+}
+
+bool convert_simd(uint8_t *out, uint8_t osb, const float32_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count);
+bool convert_simd(uint16_t *out, uint8_t osb, const float32_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count);
+bool convert_simd(float32_t *out, uint8_t osb, const uint8_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count);
+bool convert_simd(float32_t *out, uint8_t osb, const uint16_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count);
+
+// The lookup tables for 8 and 16 bit inputs are built once for each
+// conversion and then shared (dpx_convert.cc). 'tag' identifies the
+// input and output types, 'build' makes a new table. Tables are never
+// freed; once the cache is full NULL is returned and the caller builds
+// (and frees) its own.
+typedef void *(*lut_builder)(uint8_t osb, uint8_t isb, float64_t scale);
+
+const void *cached_lut(const void *tag, uint8_t osb, uint8_t isb,
+                       float64_t scale, lut_builder build);
+
+// The thresholds of a dither mask (dpx_dither.cc), in 'size' rows of
+// 'size' values. Built on first use and then shared.
+const float64_t *dither_mask(dpx::dither_e mode, uint32_t *size);
+
+template <class O, class I>
+struct lut_tag {
+	static const char tag;
+};
+
+template <class O, class I>
+const char lut_tag<O, I>::tag=0;
+
+template <class O>
+void fill_lut(O *lut, uint8_t osb, uint8_t isb, float64_t scale,
+              const uint8_t &) {
 	convert_fn fn;
-	O lut[1<<16];
 	uint32_t u;
 
 	fn=find_convert_fn<O, uint32_t>(osb, isb, scale);
-	for(u=0; u<(1<<16); u++) {
+	for(u=0; u<(1<<8); u++) {
 		fn(lut+u, osb, &u, isb, scale);	
 	}
-	for(u=0; u<count; u++) {
-		*(o++)=lut[*(in++)];
-	}
 }
 
 template <class O>
-void convertlut(O *o, uint8_t osb, const uint8_t *in, uint8_t isb,
-                float64_t scale, uint64_t count) {
-	_convertlut<O, uint8_t>(o, osb, in, isb, scale, count);
-}
+void fill_lut(O *lut, uint8_t osb, uint8_t isb, float64_t scale,
+              const uint16_t &) {
+	convert_fn fn;
+	uint32_t u;
 
-template <class O>
-void convertlut(O *o, uint8_t osb, const uint16_t *in, uint8_t isb,
-                float64_t scale, uint64_t count) {
-	_convertlut<O, uint16_t>(o, osb, in, isb, scale, count);
+	fn=find_convert_fn<O, uint32_t>(osb, isb, scale);
+	for(u=0; u<(1<<16); u++) {
+		fn(lut+u, osb, &u, isb, scale);	
+	}
 }
 
 template <class O>
-void convertlut(O *o, uint8_t osb, const float16_t *in, uint8_t isb,
-                float64_t scale, uint64_t count) {
+void fill_lut(O *lut, uint8_t osb, uint8_t isb, float64_t scale,
+              const float16_t &) {
 	convert_fn fn;
-	O lut[1<<16];
-	uint64_t u;
-	uint16_t b;
+	uint32_t u;
 	half h;
 
 	fn=find_convert_fn<O, half>(osb, isb, scale);
-	for(u=0; u<((1<<16)-1); u++) {
+	for(u=0; u<(1<<16); u++) {
 		h.setBits(u);
 		// Just running everything as-is for right now...
 		if(h.isNan()) {
@@ -712,12 +747,65 @@ void convertlut(O *o, uint8_t osb, const float16_t *in, uint8_t isb,
 			fn(lut+u, osb, &h, isb, scale);
 		}
 	}
+}
+
+template <class O, class I>
+void *new_lut(uint8_t osb, uint8_t isb, float64_t scale) {
+	O *lut;
+
+	lut=new O[1<<(sizeof(I)*8)];
+	fill_lut(lut, osb, isb, scale, I());
+	return lut;
+}
+
+inline uint16_t lut_index(const uint8_t &v) {
+	return v;
+}
+
+inline uint16_t lut_index(const uint16_t &v) {
+	return v;
+}
 
+inline uint16_t lut_index(const float16_t &v) {
+	return v.bits();
+}
+
+template <class O, class I>
+void _convertlut(O *o, uint8_t osb, const I *in, uint8_t isb,
+                 float64_t scale, uint64_t count) {
+	const O *lut;
+	O *own;
+	uint64_t u;
+
+	own=NULL;
+	lut=(const O *)cached_lut(&lut_tag<O, I>::tag, osb, isb, scale,
+	                          new_lut<O, I>);
+	if(lut==NULL) {
+		own=(O *)new_lut<O, I>(osb, isb, scale);
+		lut=own;
+	}
 	for(u=0; u<count; u++) {
-		b=in->bits();
-		*o=lut[b];
-		in++; o++;
+		*(o++)=lut[lut_index(*(in++))];
 	}
+	delete [] own;
+}
+
+template <class O>
+void convertlut(O *o, uint8_t osb, const uint8_t *in, uint8_t isb,
+                float64_t scale, uint64_t count) {
+	_convertlut<O, uint8_t>(o, osb, in, isb, scale, count);
+}
+
+template <class O>
+void convertlut(O *o, uint8_t osb, const uint16_t *in, uint8_t isb,
+                float64_t scale, uint64_t count) {
+	_convertlut<O, uint16_t>(o, osb, in, isb, scale, count);
+}
+
+template <class O>
+void convertlut(O *o, uint8_t osb, const float16_t *in, uint8_t isb,
+                float64_t scale, uint64_t count) {
+	_convertlut<O, float16_t>(o, osb, in, isb, scale, count);
 }
 
 template <class O, class I>
@@ -733,6 +821,9 @@ void convert(O *o, uint8_t osb, const I *in, uint8_t isb, float64_t scale,
 	convert_fn fn;
 	uint64_t u;
 
+	if(convert_simd(o, osb, in, isb, scale, count)) {
+		return;
+	}
 	if(sizeof(I)<=2) {
 		convertlut(o, osb, in, isb, scale, count);
 	} else {
@@ -0,0 +1,337 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#include <dpx.hh>
+#include "dpx_bits.hh"
+#include "dpx_pack.hh"
+#include <IlmThreadMutex.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DPX_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ctl {
+namespace dpxi {
+
+//
+// Lookup table cache.
+//
+
+namespace {
+
+struct lut_entry {
+	const void *tag;
+	uint8_t osb;
+	uint8_t isb;
+	float64_t scale;
+	const void *lut;
+};
+
+// There are only ever a handful of distinct conversions in a process (one
+// or two per file format and scale), so a small table is plenty.
+const int max_luts=32;
+
+IlmThread::Mutex lut_mutex;
+lut_entry luts[max_luts];
+int num_luts=0;
+
+}
+
+const void *cached_lut(const void *tag, uint8_t osb, uint8_t isb,
+                       float64_t scale, lut_builder build) {
+	IlmThread::Lock lock(lut_mutex);
+	int u;
+
+	for(u=0; u<num_luts; u++) {
+		if(luts[u].tag==tag && luts[u].osb==osb && luts[u].isb==isb &&
+		   luts[u].scale==scale) {
+			return luts[u].lut;
+		}
+	}
+	if(num_luts==max_luts) {
+		return NULL;
+	}
+
+	// Built with the lock held so that threads converting strips of
+	// the same image wait for the one table rather than each building
+	// their own.
+	luts[num_luts].tag=tag;
+	luts[num_luts].osb=osb;
+	luts[num_luts].isb=isb;
+	luts[num_luts].scale=scale;
+	luts[num_luts].lut=build(osb, isb, scale);
+	num_luts++;
+	return luts[num_luts-1].lut;
+}
+
+//
+// Vectorised conversions. The floating point math is done in double
+// precision, as in ftu_one() and friends, so the results match exactly:
+// products of a float and an integer of up to 16 bits are exact, and
+// the double to integer conversion rounds to nearest even like llrint().
+//
+
+namespace {
+
+enum scale_mode_e {
+	scale_zero=0,
+	scale_one,
+	scale_other
+};
+
+scale_mode_e scale_mode(float64_t scale) {
+	if(scale==0.0) {
+		return scale_zero;
+	} else if(scale==1.0) {
+		return scale_one;
+	}
+	return scale_other;
+}
+
+// Finishes off the samples the vector loops leave behind.
+template <class O, class I>
+void convert_tail(O *out, uint8_t osb, const I *in, uint8_t isb,
+                  float64_t scale, uint64_t count) {
+	convert_fn fn;
+	uint64_t u;
+
+	if(count==0) {
+		return;
+	}
+	fn=find_convert_fn<O, I>(osb, isb, scale);
+	for(u=0; u<count; u++) {
+		fn(out+u, osb, in+u, isb, scale);
+	}
+}
+
+bool have_avx2(void) {
+	return pack_isa_supported()>=pack_avx2;
+}
+
+#if defined(DPX_CONVERT_X86)
+
+// Four floats to four integers in [0, fmax], following ftu_zero(),
+// ftu_one() and ftu(). NaNs come out as 0x80000000 like llrint(), which
+// truncates to 0.
+__attribute__((target("avx2")))
+inline __m128i avx2_ftu4(__m128 x, scale_mode_e mode, __m256d fmax,
+                         __m256d scale) {
+	const __m256d zero=_mm256_setzero_pd();
+	__m256d d, limit;
+
+	d=_mm256_cvtps_pd(x);
+	if(mode==scale_zero) {
+		limit=_mm256_set1_pd(1.0);
+	} else {
+		if(mode==scale_other) {
+			// ftu() rounds the scaled value back to the input type.
+			d=_mm256_cvtps_pd(_mm256_cvtpd_ps(_mm256_mul_pd(d, scale)));
+		}
+		limit=fmax;
+	}
+
+	__m256d neg=_mm256_cmp_pd(d, zero, _CMP_LT_OQ);
+	__m256d big=_mm256_cmp_pd(d, limit, _CMP_GT_OQ);
+
+	if(mode==scale_zero) {
+		d=_mm256_mul_pd(d, fmax);
+	}
+	d=_mm256_blendv_pd(d, zero, neg);
+	d=_mm256_blendv_pd(d, fmax, big);
+	return _mm256_cvtpd_epi32(d);
+}
+
+__attribute__((target("avx2")))
+void avx2_ftu16(uint16_t *out, uint8_t osb, const float32_t *in,
+                float64_t scale, uint64_t count) {
+	const scale_mode_e mode=scale_mode(scale);
+	const __m256d fmax=_mm256_set1_pd((float64_t)max_int_for_bits[osb]);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+		__m128i lo=avx2_ftu4(_mm256_castps256_ps128(x), mode, fmax, s);
+		__m128i hi=avx2_ftu4(_mm256_extractf128_ps(x, 1), mode, fmax, s);
+
+		_mm_storeu_si128((__m128i *)(out+u), _mm_packus_epi32(lo, hi));
+	}
+	convert_tail(out+u, osb, in+u, 32, scale, count-u);
+}
+
+__attribute__((target("avx2")))
+void avx2_ftu8(uint8_t *out, uint8_t osb, const float32_t *in,
+               float64_t scale, uint64_t count) {
+	const scale_mode_e mode=scale_mode(scale);
+	const __m256d fmax=_mm256_set1_pd((float64_t)max_int_for_bits[osb]);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+		__m128i lo=avx2_ftu4(_mm256_castps256_ps128(x), mode, fmax, s);
+		__m128i hi=avx2_ftu4(_mm256_extractf128_ps(x, 1), mode, fmax, s);
+		__m128i w=_mm_packus_epi32(lo, hi);
+
+		_mm_storel_epi64((__m128i *)(out+u), _mm_packus_epi16(w, w));
+	}
+	convert_tail(out+u, osb, in+u, 32, scale, count-u);
+}
+
+// Eight integers to eight floats, following utf_zero(), utf_one() and
+// utf(). Like those, values above the significant bits are not clipped.
+__attribute__((target("avx2")))
+inline __m256 avx2_utf8(__m256i v, scale_mode_e mode, __m256d fmax,
+                        __m256d scale) {
+	__m256d lo, hi;
+
+	if(mode==scale_one) {
+		return _mm256_cvtepi32_ps(v);
+	}
+	lo=_mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+	hi=_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+	if(mode==scale_zero) {
+		lo=_mm256_div_pd(lo, fmax);
+		hi=_mm256_div_pd(hi, fmax);
+	} else {
+		lo=_mm256_mul_pd(lo, scale);
+		hi=_mm256_mul_pd(hi, scale);
+	}
+	return _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+}
+
+__attribute__((target("avx2")))
+void avx2_u16tf(float32_t *out, const uint16_t *in, uint8_t isb,
+                float64_t scale, uint64_t count) {
+	const scale_mode_e mode=scale_mode(scale);
+	const __m256d fmax=_mm256_set1_pd((float64_t)max_int_for_bits[isb]);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256i v=_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in+u)));
+
+		_mm256_storeu_ps(out+u, avx2_utf8(v, mode, fmax, s));
+	}
+	convert_tail(out+u, 32, in+u, isb, scale, count-u);
+}
+
+__attribute__((target("avx2")))
+void avx2_u8tf(float32_t *out, const uint8_t *in, uint8_t isb,
+               float64_t scale, uint64_t count) {
+	const scale_mode_e mode=scale_mode(scale);
+	const __m256d fmax=_mm256_set1_pd((float64_t)max_int_for_bits[isb]);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u;
+
+	for(u=0; u+8<=count; u+=8) {
+		__m256i v=_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in+u)));
+
+		_mm256_storeu_ps(out+u, avx2_utf8(v, mode, fmax, s));
+	}
+	convert_tail(out+u, 32, in+u, isb, scale, count-u);
+}
+
+#endif
+
+}
+
+bool convert_simd(uint16_t *out, uint8_t osb, const float32_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count) {
+#if defined(DPX_CONVERT_X86)
+	if(osb>=1 && osb<=16 && have_avx2()) {
+		avx2_ftu16(out, osb, in, scale, count);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+bool convert_simd(uint8_t *out, uint8_t osb, const float32_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count) {
+#if defined(DPX_CONVERT_X86)
+	if(osb>=1 && osb<=8 && have_avx2()) {
+		avx2_ftu8(out, osb, in, scale, count);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+bool convert_simd(float32_t *out, uint8_t osb, const uint16_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count) {
+#if defined(DPX_CONVERT_X86)
+	if(isb>=1 && isb<=16 && have_avx2()) {
+		avx2_u16tf(out, in, isb, scale, count);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+bool convert_simd(float32_t *out, uint8_t osb, const uint8_t *in,
+                  uint8_t isb, float64_t scale, uint64_t count) {
+#if defined(DPX_CONVERT_X86)
+	if(isb>=1 && isb<=8 && have_avx2()) {
+		avx2_u8tf(out, in, isb, scale, count);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+}
+}
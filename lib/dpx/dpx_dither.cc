@@ -0,0 +1,470 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#include <dpx.hh>
+#include "dpx_bits.hh"
+#include "dpx_pack.hh"
+#include <IlmThreadMutex.h>
+#include <math.h>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DPX_DITHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ctl {
+namespace dpxi {
+
+//
+// Dither masks. Each holds the ranks 0..size*size-1 once, turned into
+// thresholds spread evenly over (-0.5, 0.5).
+//
+
+namespace {
+
+const uint32_t bayer_size=8;
+const uint32_t blue_noise_size=64;
+
+IlmThread::Mutex mask_mutex;
+float64_t *bayer_mask=NULL;
+float64_t *blue_noise_mask=NULL;
+
+float64_t *thresholds(const std::vector<uint32_t> &rank) {
+	float64_t *mask;
+	size_t u;
+
+	mask=new float64_t[rank.size()];
+	for(u=0; u<rank.size(); u++) {
+		mask[u]=(rank[u]+0.5)/rank.size()-0.5;
+	}
+	return mask;
+}
+
+// The usual recursive construction: each step replaces every rank r of
+// the smaller matrix with the 2x2 block 4r, 4r+2 / 4r+3, 4r+1.
+float64_t *make_bayer(void) {
+	std::vector<uint32_t> rank(bayer_size*bayer_size, 0);
+	uint32_t n, x, y, r;
+
+	for(n=1; n<bayer_size; n=n*2) {
+		for(y=0; y<n; y++) {
+			for(x=0; x<n; x++) {
+				r=rank[y*bayer_size+x];
+				rank[y*bayer_size+x]=4*r;
+				rank[y*bayer_size+x+n]=4*r+2;
+				rank[(y+n)*bayer_size+x]=4*r+3;
+				rank[(y+n)*bayer_size+x+n]=4*r+1;
+			}
+		}
+	}
+	return thresholds(rank);
+}
+
+// Ulichney's void-and-cluster method. The energy of a cell is the sum of
+// a gaussian (on the torus, so the mask tiles) centred on each set cell;
+// the tightest cluster is the set cell with the most energy and the
+// largest void the empty cell with the least.
+class void_and_cluster {
+	public:
+		void_and_cluster(uint32_t size, float64_t sigma) :
+			size(size), kernel(size*size), set(size*size, FALSE),
+			energy(size*size, 0.0) {
+			uint32_t x, y, dx, dy;
+
+			for(y=0; y<size; y++) {
+				for(x=0; x<size; x++) {
+					dx= x<size-x ? x : size-x;
+					dy= y<size-y ? y : size-y;
+					kernel[y*size+x]=exp(-(float64_t)(dx*dx+dy*dy)/
+					                     (2.0*sigma*sigma));
+				}
+			}
+		}
+
+		void toggle(uint32_t cell) {
+			const uint32_t cx=cell%size;
+			const uint32_t cy=cell/size;
+			const float64_t sign= set[cell] ? -1.0 : 1.0;
+			uint32_t x, y;
+
+			set[cell]=!set[cell];
+			for(y=0; y<size; y++) {
+				for(x=0; x<size; x++) {
+					energy[((cy+y)%size)*size+(cx+x)%size]+=
+						sign*kernel[y*size+x];
+				}
+			}
+		}
+
+		uint32_t tightest_cluster(void) const {
+			uint32_t best=0;
+			uint32_t u;
+
+			while(!set[best]) {
+				best++;
+			}
+			for(u=best+1; u<set.size(); u++) {
+				if(set[u] && energy[u]>energy[best]) {
+					best=u;
+				}
+			}
+			return best;
+		}
+
+		uint32_t largest_void(void) const {
+			uint32_t best=0;
+			uint32_t u;
+
+			while(set[best]) {
+				best++;
+			}
+			for(u=best+1; u<set.size(); u++) {
+				if(!set[u] && energy[u]<energy[best]) {
+					best=u;
+				}
+			}
+			return best;
+		}
+
+		uint32_t size;
+		std::vector<float64_t> kernel;
+		std::vector<bool> set;
+		std::vector<float64_t> energy;
+};
+
+float64_t *make_blue_noise(void) {
+	const uint32_t cells=blue_noise_size*blue_noise_size;
+	std::vector<uint32_t> rank(cells, 0);
+	void_and_cluster prototype(blue_noise_size, 1.5);
+	void_and_cluster pattern(blue_noise_size, 1.5);
+	uint32_t ones, cell, hole, u;
+	uint32_t seed=1;
+
+	// A tenth of the cells, picked with a fixed LCG so the mask is the
+	// same in every run...
+	for(ones=0; ones<cells/10; ) {
+		seed=seed*1664525+1013904223;
+		cell=(seed>>8)%cells;
+		if(!prototype.set[cell]) {
+			prototype.toggle(cell);
+			ones++;
+		}
+	}
+
+	// ...spread out by moving the tightest cluster to the largest void
+	// until that puts it back where it was.
+	for(u=0; u<cells; u++) {
+		cell=prototype.tightest_cluster();
+		prototype.toggle(cell);
+		hole=prototype.largest_void();
+		prototype.toggle(hole);
+		if(hole==cell) {
+			break;
+		}
+	}
+
+	// The prototype's cells get the ranks below 'ones', taken out
+	// tightest cluster first; the rest are filled in largest void
+	// first.
+	pattern=prototype;
+	for(u=ones; u>0; u--) {
+		cell=pattern.tightest_cluster();
+		pattern.toggle(cell);
+		rank[cell]=u-1;
+	}
+	pattern=prototype;
+	for(u=ones; u<cells; u++) {
+		cell=pattern.largest_void();
+		pattern.toggle(cell);
+		rank[cell]=u;
+	}
+	return thresholds(rank);
+}
+
+}
+
+const float64_t *dither_mask(dpx::dither_e mode, uint32_t *size) {
+	IlmThread::Lock lock(mask_mutex);
+
+	if(mode==dpx::blue_noise_dither) {
+		if(blue_noise_mask==NULL) {
+			blue_noise_mask=make_blue_noise();
+		}
+		*size=blue_noise_size;
+		return blue_noise_mask;
+	}
+	if(bayer_mask==NULL) {
+		bayer_mask=make_bayer();
+	}
+	*size=bayer_size;
+	return bayer_mask;
+}
+
+//
+// Dithered float to integer conversion. Like the vectorised conversions in
+// dpx_convert.cc the math is done in double precision, so the vector and
+// scalar versions agree exactly.
+//
+
+namespace {
+
+enum dither_scale_e {
+	dither_scale_zero=0, // [0, 1] to [0, max]
+	dither_scale_one,    // as is
+	dither_scale_other   // times the scale
+};
+
+dither_scale_e dither_scale(float64_t scale) {
+	if(scale==0.0) {
+		return dither_scale_zero;
+	} else if(scale==1.0) {
+		return dither_scale_one;
+	}
+	return dither_scale_other;
+}
+
+template <class O>
+inline O dither_one(float32_t in, float64_t threshold, dither_scale_e mode,
+                    float64_t fmax, float64_t scale) {
+	float64_t d=in;
+
+	if(mode==dither_scale_zero) {
+		d=d*fmax;
+	} else if(mode==dither_scale_other) {
+		d=(float32_t)(d*scale);
+	}
+	d=d+threshold;
+	if(!(d>=0.0)) {
+		return 0;
+	} else if(d>fmax) {
+		d=fmax;
+	}
+	return (O)lrint(d);
+}
+
+#if defined(DPX_DITHER_X86)
+
+bool have_avx2(void) {
+	return pack_isa_supported()>=pack_avx2;
+}
+
+__attribute__((target("avx2")))
+inline __m128i avx2_dither4(__m128 x, __m256d threshold, dither_scale_e mode,
+                            __m256d fmax, __m256d scale) {
+	const __m256d zero=_mm256_setzero_pd();
+	__m256d d=_mm256_cvtps_pd(x);
+
+	if(mode==dither_scale_zero) {
+		d=_mm256_mul_pd(d, fmax);
+	} else if(mode==dither_scale_other) {
+		d=_mm256_cvtps_pd(_mm256_cvtpd_ps(_mm256_mul_pd(d, scale)));
+	}
+	d=_mm256_add_pd(d, threshold);
+
+	// NaNs fail both compares and come out of the conversion as
+	// 0x80000000, which the unsigned saturating packs turn into 0.
+	d=_mm256_blendv_pd(d, zero, _mm256_cmp_pd(d, zero, _CMP_LT_OQ));
+	d=_mm256_blendv_pd(d, fmax, _mm256_cmp_pd(d, fmax, _CMP_GT_OQ));
+	return _mm256_cvtpd_epi32(d);
+}
+
+// Both of these do the samples eight at a time, with the thresholds from
+// 'pattern' (which repeats every 'period' samples and has 8 more after
+// that), and return how many they did.
+
+__attribute__((target("avx2")))
+uint64_t avx2_dither16(uint16_t *out, const float32_t *in,
+                       const float64_t *pattern, uint64_t period,
+                       dither_scale_e mode, float64_t fmax, float64_t scale,
+                       uint64_t count) {
+	const __m256d m=_mm256_set1_pd(fmax);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u, p;
+
+	for(u=0, p=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+		__m128i lo=avx2_dither4(_mm256_castps256_ps128(x),
+		                        _mm256_loadu_pd(pattern+p), mode, m, s);
+		__m128i hi=avx2_dither4(_mm256_extractf128_ps(x, 1),
+		                        _mm256_loadu_pd(pattern+p+4), mode, m, s);
+
+		_mm_storeu_si128((__m128i *)(out+u), _mm_packus_epi32(lo, hi));
+		p=p+8;
+		if(p>=period) {
+			p=p-period;
+		}
+	}
+	_mm256_zeroupper();
+	return u;
+}
+
+__attribute__((target("avx2")))
+uint64_t avx2_dither8(uint8_t *out, const float32_t *in,
+                      const float64_t *pattern, uint64_t period,
+                      dither_scale_e mode, float64_t fmax, float64_t scale,
+                      uint64_t count) {
+	const __m256d m=_mm256_set1_pd(fmax);
+	const __m256d s=_mm256_set1_pd(scale);
+	uint64_t u, p;
+
+	for(u=0, p=0; u+8<=count; u+=8) {
+		__m256 x=_mm256_loadu_ps(in+u);
+		__m128i lo=avx2_dither4(_mm256_castps256_ps128(x),
+		                        _mm256_loadu_pd(pattern+p), mode, m, s);
+		__m128i hi=avx2_dither4(_mm256_extractf128_ps(x, 1),
+		                        _mm256_loadu_pd(pattern+p+4), mode, m, s);
+		__m128i w=_mm_packus_epi32(lo, hi);
+
+		_mm_storel_epi64((__m128i *)(out+u), _mm_packus_epi16(w, w));
+		p=p+8;
+		if(p>=period) {
+			p=p-period;
+		}
+	}
+	_mm256_zeroupper();
+	return u;
+}
+
+uint64_t dither_simd(uint16_t *out, const float32_t *in,
+                     const float64_t *pattern, uint64_t period,
+                     dither_scale_e mode, float64_t fmax, float64_t scale,
+                     uint64_t count) {
+	if(!have_avx2()) {
+		return 0;
+	}
+	return avx2_dither16(out, in, pattern, period, mode, fmax, scale, count);
+}
+
+uint64_t dither_simd(uint8_t *out, const float32_t *in,
+                     const float64_t *pattern, uint64_t period,
+                     dither_scale_e mode, float64_t fmax, float64_t scale,
+                     uint64_t count) {
+	if(!have_avx2()) {
+		return 0;
+	}
+	return avx2_dither8(out, in, pattern, period, mode, fmax, scale, count);
+}
+
+#else
+
+template <class O>
+uint64_t dither_simd(O *out, const float32_t *in, const float64_t *pattern,
+                     uint64_t period, dither_scale_e mode, float64_t fmax,
+                     float64_t scale, uint64_t count) {
+	return 0;
+}
+
+#endif
+
+template <class O>
+void dither_row(O *out, uint8_t osb, const float32_t *in, float64_t scale,
+                uint32_t width, uint32_t depth, uint32_t row,
+                dpx::dither_e dither) {
+	const uint64_t count=(uint64_t)width*depth;
+	const dither_scale_e mode=dither_scale(scale);
+	std::vector<float64_t> pattern;
+	const float64_t *mask;
+	float64_t fmax;
+	uint32_t size;
+	uint64_t period;
+	uint64_t u, p;
+
+	if(osb==0 || osb>sizeof(O)*8) {
+		osb=sizeof(O)*8;
+	}
+	if(dither==dpx::no_dither || depth==0) {
+		dpx::convert(out, osb, in, scale, count);
+		return;
+	}
+
+	// The thresholds for one repeat of the mask along the row, spread
+	// out to the samples of each pixel.
+	mask=dither_mask(dither, &size);
+	mask=mask+(row%size)*size;
+	period=(uint64_t)size*depth;
+	pattern.resize(period+8);
+	for(p=0; p<pattern.size(); p++) {
+		pattern[p]=mask[(p/depth)%size];
+	}
+
+	fmax=(float64_t)max_int_for_bits[osb];
+	u=dither_simd(out, in, &pattern[0], period, mode, fmax, scale, count);
+	for(p=u%period; u<count; u++) {
+		out[u]=dither_one<O>(in[u], pattern[p], mode, fmax, scale);
+		p++;
+		if(p==period) {
+			p=0;
+		}
+	}
+}
+
+}
+
+}
+
+void dpx::dither(uint8_t *o, uint8_t osb, const float32_t *i,
+                 float64_t scale, uint32_t width, uint32_t depth,
+                 uint32_t row, dither_e mode) {
+	dpxi::dither_row(o, osb, i, scale, width, depth, row, mode);
+}
+
+void dpx::dither(uint16_t *o, uint8_t osb, const float32_t *i,
+                 float64_t scale, uint32_t width, uint32_t depth,
+                 uint32_t row, dither_e mode) {
+	dpxi::dither_row(o, osb, i, scale, width, depth, row, mode);
+}
+
+}
@@ -0,0 +1,885 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#include <dpx.hh>
+#include "dpx_raw.hh"
+#include "dpx_pack.hh"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DPX_PACK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ctl {
+namespace dpxi {
+
+namespace {
+
+inline uint32_t load32(const uint8_t *p, bool swap) {
+	uint32_t w;
+
+	memcpy(&w, p, sizeof(w));
+	if(swap) {
+		swap32(&w);
+	}
+	return w;
+}
+
+inline uint16_t load16(const uint8_t *p, bool swap) {
+	uint16_t w;
+
+	memcpy(&w, p, sizeof(w));
+	if(swap) {
+		swap16(&w);
+	}
+	return w;
+}
+
+inline void store32(uint8_t *p, uint32_t w, bool swap) {
+	if(swap) {
+		swap32(&w);
+	}
+	memcpy(p, &w, sizeof(w));
+}
+
+inline void store16(uint8_t *p, uint16_t w, bool swap) {
+	if(swap) {
+		swap16(&w);
+	}
+	memcpy(p, &w, sizeof(w));
+}
+
+//
+// Scalar kernels. These are also used for the ends of rows that are too
+// short for the vector kernels.
+//
+
+// Method A leaves the two padding bits at the bottom of the word, method B
+// at the top.
+template <bool B>
+void unpack_10(uint16_t *out, const uint8_t *in, uint64_t samples,
+               bool swap) {
+	const int sh=B ? 0 : 2;
+	uint64_t u;
+	uint32_t t;
+
+	for(u=0; u+3<=samples; u+=3) {
+		t=load32(in, swap);
+		out[0]=(t>>(20+sh))&0x3ff;
+		out[1]=(t>>(10+sh))&0x3ff;
+		out[2]=(t>>sh)&0x3ff;
+		in=in+4;
+		out=out+3;
+	}
+	if(u<samples) {
+		t=load32(in, swap);
+		out[0]=(t>>(20+sh))&0x3ff;
+		if(u+1<samples) {
+			out[1]=(t>>(10+sh))&0x3ff;
+		}
+	}
+}
+
+template <bool B>
+void pack_10(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	const int sh=B ? 0 : 2;
+	uint64_t u;
+	uint32_t t;
+
+	for(u=0; u+3<=samples; u+=3) {
+		t=((uint32_t)(in[0]&0x3ff))<<(20+sh);
+		t=t|(((uint32_t)(in[1]&0x3ff))<<(10+sh));
+		t=t|(((uint32_t)(in[2]&0x3ff))<<sh);
+		store32(out, t, swap);
+		in=in+3;
+		out=out+4;
+	}
+	if(u<samples) {
+		t=((uint32_t)(in[0]&0x3ff))<<(20+sh);
+		if(u+1<samples) {
+			t=t|(((uint32_t)(in[1]&0x3ff))<<(10+sh));
+		}
+		store32(out, t, swap);
+	}
+}
+
+template <bool B>
+void unpack_12(uint16_t *out, const uint8_t *in, uint64_t samples,
+               bool swap) {
+	uint64_t u;
+	uint16_t t;
+
+	for(u=0; u<samples; u++) {
+		t=load16(in, swap);
+		out[u]=B ? (t&0xfff) : (t>>4);
+		in=in+2;
+	}
+}
+
+template <bool B>
+void pack_12(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	uint64_t u;
+	uint16_t t;
+
+	for(u=0; u<samples; u++) {
+		t=in[u]&0xfff;
+		store16(out, B ? t : (uint16_t)(t<<4), swap);
+		out=out+2;
+	}
+}
+
+// Four samples make up 48 bits in three words.
+void unpack_12_filled(uint16_t *out, const uint8_t *in, uint64_t samples,
+                      bool swap) {
+	uint64_t u, v, words;
+
+	for(u=0; u+4<=samples; u+=4) {
+		v=load16(in, swap);
+		v=(v<<16)|load16(in+2, swap);
+		v=(v<<16)|load16(in+4, swap);
+		out[0]=(v>>36)&0xfff;
+		out[1]=(v>>24)&0xfff;
+		out[2]=(v>>12)&0xfff;
+		out[3]=v&0xfff;
+		in=in+6;
+		out=out+4;
+	}
+	if(u<samples) {
+		words=((samples-u)*12+15)/16;
+		v=load16(in, swap);
+		v=(v<<16)|(words>1 ? load16(in+2, swap) : 0);
+		v=(v<<16)|(words>2 ? load16(in+4, swap) : 0);
+		out[0]=(v>>36)&0xfff;
+		if(u+1<samples) {
+			out[1]=(v>>24)&0xfff;
+		}
+		if(u+2<samples) {
+			out[2]=(v>>12)&0xfff;
+		}
+	}
+}
+
+void pack_12_filled(uint8_t *out, const uint16_t *in, uint64_t samples,
+                    bool swap) {
+	uint64_t u, v, words;
+
+	for(u=0; u+4<=samples; u+=4) {
+		v=((uint64_t)(in[0]&0xfff))<<36;
+		v=v|(((uint64_t)(in[1]&0xfff))<<24);
+		v=v|(((uint64_t)(in[2]&0xfff))<<12);
+		v=v|(in[3]&0xfff);
+		store16(out, v>>32, swap);
+		store16(out+2, v>>16, swap);
+		store16(out+4, v, swap);
+		in=in+4;
+		out=out+6;
+	}
+	if(u<samples) {
+		words=((samples-u)*12+15)/16;
+		v=((uint64_t)(in[0]&0xfff))<<36;
+		if(u+1<samples) {
+			v=v|(((uint64_t)(in[1]&0xfff))<<24);
+		}
+		if(u+2<samples) {
+			v=v|(((uint64_t)(in[2]&0xfff))<<12);
+		}
+		store16(out, v>>32, swap);
+		if(words>1) {
+			store16(out+2, v>>16, swap);
+		}
+		if(words>2) {
+			store16(out+4, v, swap);
+		}
+	}
+}
+
+void unpack_10_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                 bool swap) {
+	unpack_10<false>(out, in, samples, swap);
+}
+
+void unpack_10_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                 bool swap) {
+	unpack_10<true>(out, in, samples, swap);
+}
+
+void pack_10_a(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	pack_10<false>(out, in, samples, swap);
+}
+
+void pack_10_b(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	pack_10<true>(out, in, samples, swap);
+}
+
+void unpack_12_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                 bool swap) {
+	unpack_12<false>(out, in, samples, swap);
+}
+
+void unpack_12_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                 bool swap) {
+	unpack_12<true>(out, in, samples, swap);
+}
+
+void pack_12_a(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	pack_12<false>(out, in, samples, swap);
+}
+
+void pack_12_b(uint8_t *out, const uint16_t *in, uint64_t samples, bool swap) {
+	pack_12<true>(out, in, samples, swap);
+}
+
+#if defined(DPX_PACK_X86)
+
+//
+// SSSE3 kernels. The byte swap is folded into a byte shuffle (which is the
+// identity for files in the native byte order).
+//
+
+__attribute__((target("ssse3")))
+inline __m128i ssse3_swap32_mask(bool swap) {
+	return swap ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+	            : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i ssse3_swap16_mask(bool swap) {
+	return swap ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+	            : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+// Shuffle that gathers the two bytes holding each of 8 filled 12 bit samples
+// into a 16 bit lane. Samples 0 and 2 of every group of four are then in
+// the top 12 bits of their lane, samples 1 and 3 in the bottom 12 bits.
+// 'base' is the offset of the first byte of the second group.
+__attribute__((target("ssse3")))
+inline __m128i ssse3_filled_mask(bool swap, int base) {
+	uint8_t mask[16];
+	int g, o, lo, hi;
+
+	for(g=0; g<2; g++) {
+		o=g*base;
+		// lo and hi are the offsets of the low and high byte of a word
+		lo=swap ? 1 : 0;
+		hi=swap ? 0 : 1;
+		mask[8*g+0]=o+lo;       mask[8*g+1]=o+hi;
+		mask[8*g+2]=o+2+hi;     mask[8*g+3]=o+lo;
+		mask[8*g+4]=o+4+hi;     mask[8*g+5]=o+2+lo;
+		mask[8*g+6]=o+4+lo;     mask[8*g+7]=o+4+hi;
+	}
+	return _mm_loadu_si128((const __m128i *)mask);
+}
+
+template <bool B>
+__attribute__((target("ssse3")))
+void ssse3_unpack_10(uint16_t *out, const uint8_t *in, uint64_t samples,
+                     bool swap) {
+	const int sh=B ? 0 : 2;
+	const __m128i swap_mask=ssse3_swap32_mask(swap);
+	const __m128i mask=_mm_set1_epi32(0x3ff);
+	// From the packed [a0 a1 a2 a3 b0 b1 b2 b3] and [c0 c1 c2 c3 ...]
+	// to [a0 b0 c0 a1 b1 c1 a2 b2] and [c2 a3 b3 c3].
+	const __m128i ab_lo=_mm_setr_epi8(0, 1, 8, 9, -1, -1, 2, 3, 10, 11, -1, -1, 4, 5, 12, 13);
+	const __m128i c_lo=_mm_setr_epi8(-1, -1, -1, -1, 0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1);
+	const __m128i ab_hi=_mm_setr_epi8(-1, -1, 6, 7, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i c_hi=_mm_setr_epi8(4, 5, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+	uint64_t u;
+
+	for(u=0; u+12<=samples; u+=12) {
+		__m128i t=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)in), swap_mask);
+		__m128i a=_mm_and_si128(_mm_srli_epi32(t, 20+sh), mask);
+		__m128i b=_mm_and_si128(_mm_srli_epi32(t, 10+sh), mask);
+		__m128i c=_mm_and_si128(_mm_srli_epi32(t, sh), mask);
+		__m128i ab=_mm_packs_epi32(a, b);
+		__m128i cc=_mm_packs_epi32(c, c);
+
+		_mm_storeu_si128((__m128i *)out,
+		                 _mm_or_si128(_mm_shuffle_epi8(ab, ab_lo),
+		                              _mm_shuffle_epi8(cc, c_lo)));
+		_mm_storel_epi64((__m128i *)(out+8),
+		                 _mm_or_si128(_mm_shuffle_epi8(ab, ab_hi),
+		                              _mm_shuffle_epi8(cc, c_hi)));
+		in=in+16;
+		out=out+12;
+	}
+	unpack_10<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("ssse3")))
+void ssse3_pack_10(uint8_t *out, const uint16_t *in, uint64_t samples,
+                   bool swap) {
+	const int sh=B ? 0 : 2;
+	const __m128i swap_mask=ssse3_swap32_mask(swap);
+	const __m128i mask=_mm_set1_epi32(0x3ff);
+	// Zero extend samples 3i, 3i+1 and 3i+2 of [s0 ... s7] and [s8 ... s11]
+	// into the 32 bit lanes of x, y and z.
+	const __m128i x_lo=_mm_setr_epi8(0, 1, -1, -1, 6, 7, -1, -1, 12, 13, -1, -1, -1, -1, -1, -1);
+	const __m128i x_hi=_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, -1, -1);
+	const __m128i y_lo=_mm_setr_epi8(2, 3, -1, -1, 8, 9, -1, -1, 14, 15, -1, -1, -1, -1, -1, -1);
+	const __m128i y_hi=_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, -1, -1);
+	const __m128i z_lo=_mm_setr_epi8(4, 5, -1, -1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i z_hi=_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 0, 1, -1, -1, 6, 7, -1, -1);
+	uint64_t u;
+
+	for(u=0; u+12<=samples; u+=12) {
+		__m128i lo=_mm_loadu_si128((const __m128i *)in);
+		__m128i hi=_mm_loadl_epi64((const __m128i *)(in+8));
+		__m128i x=_mm_or_si128(_mm_shuffle_epi8(lo, x_lo), _mm_shuffle_epi8(hi, x_hi));
+		__m128i y=_mm_or_si128(_mm_shuffle_epi8(lo, y_lo), _mm_shuffle_epi8(hi, y_hi));
+		__m128i z=_mm_or_si128(_mm_shuffle_epi8(lo, z_lo), _mm_shuffle_epi8(hi, z_hi));
+		__m128i t;
+
+		t=_mm_slli_epi32(_mm_and_si128(x, mask), 20+sh);
+		t=_mm_or_si128(t, _mm_slli_epi32(_mm_and_si128(y, mask), 10+sh));
+		t=_mm_or_si128(t, _mm_slli_epi32(_mm_and_si128(z, mask), sh));
+		_mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(t, swap_mask));
+		in=in+12;
+		out=out+16;
+	}
+	pack_10<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("ssse3")))
+void ssse3_unpack_12(uint16_t *out, const uint8_t *in, uint64_t samples,
+                     bool swap) {
+	const __m128i swap_mask=ssse3_swap16_mask(swap);
+	const __m128i mask=_mm_set1_epi16(0xfff);
+	uint64_t u;
+
+	for(u=0; u+8<=samples; u+=8) {
+		__m128i t=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)in), swap_mask);
+
+		t=B ? _mm_and_si128(t, mask) : _mm_srli_epi16(t, 4);
+		_mm_storeu_si128((__m128i *)out, t);
+		in=in+16;
+		out=out+8;
+	}
+	unpack_12<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("ssse3")))
+void ssse3_pack_12(uint8_t *out, const uint16_t *in, uint64_t samples,
+                   bool swap) {
+	const __m128i swap_mask=ssse3_swap16_mask(swap);
+	const __m128i mask=_mm_set1_epi16(0xfff);
+	uint64_t u;
+
+	for(u=0; u+8<=samples; u+=8) {
+		__m128i t=_mm_and_si128(_mm_loadu_si128((const __m128i *)in), mask);
+
+		if(!B) {
+			t=_mm_slli_epi16(t, 4);
+		}
+		_mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(t, swap_mask));
+		in=in+8;
+		out=out+16;
+	}
+	pack_12<B>(out, in, samples-u, swap);
+}
+
+__attribute__((target("ssse3")))
+void ssse3_unpack_12_filled(uint16_t *out, const uint8_t *in,
+                            uint64_t samples, bool swap) {
+	const __m128i gather=ssse3_filled_mask(swap, 6);
+	const __m128i even=_mm_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+	const __m128i odd=_mm_setr_epi16(0, 0xfff, 0, 0xfff, 0, 0xfff, 0, 0xfff);
+	uint64_t u, bytes;
+
+	// Each group of 8 samples takes 12 bytes, but 16 are loaded.
+	bytes=packed_row_bytes(packed_12_filled, samples);
+	for(u=0; u+8<=samples && (u/8)*12+16<=bytes; u+=8) {
+		__m128i t=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)in), gather);
+
+		t=_mm_or_si128(_mm_and_si128(_mm_srli_epi16(t, 4), even),
+		               _mm_and_si128(t, odd));
+		_mm_storeu_si128((__m128i *)out, t);
+		in=in+12;
+		out=out+8;
+	}
+	unpack_12_filled(out, in, samples-u, swap);
+}
+
+__attribute__((target("ssse3")))
+void ssse3_pack_12_filled(uint8_t *out, const uint16_t *in,
+                          uint64_t samples, bool swap) {
+	// Each 64 bit lane holds four samples, which are moved to the bottom
+	// 48 bits (s0 at the top), and the three words are then picked out
+	// in file order.
+	const __m128i scatter=swap
+		? _mm_setr_epi8(5, 4, 3, 2, 1, 0, 13, 12, 11, 10, 9, 8, -1, -1, -1, -1)
+		: _mm_setr_epi8(4, 5, 2, 3, 0, 1, 12, 13, 10, 11, 8, 9, -1, -1, -1, -1);
+	const __m128i mask=_mm_set1_epi16(0xfff);
+	const __m128i m0=_mm_set1_epi64x(0xfffLL);
+	const __m128i m1=_mm_set1_epi64x(0xfffLL<<16);
+	const __m128i m2=_mm_set1_epi64x(0xfffLL<<32);
+	uint64_t u;
+	uint32_t tail;
+
+	for(u=0; u+8<=samples; u+=8) {
+		__m128i x=_mm_and_si128(_mm_loadu_si128((const __m128i *)in), mask);
+		__m128i v;
+
+		v=_mm_slli_epi64(_mm_and_si128(x, m0), 36);
+		v=_mm_or_si128(v, _mm_slli_epi64(_mm_and_si128(x, m1), 8));
+		v=_mm_or_si128(v, _mm_srli_epi64(_mm_and_si128(x, m2), 20));
+		v=_mm_or_si128(v, _mm_srli_epi64(x, 48));
+		v=_mm_shuffle_epi8(v, scatter);
+		_mm_storel_epi64((__m128i *)out, v);
+		tail=_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+		memcpy(out+8, &tail, sizeof(tail));
+		in=in+8;
+		out=out+12;
+	}
+	pack_12_filled(out, in, samples-u, swap);
+}
+
+void ssse3_unpack_10_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                       bool swap) {
+	ssse3_unpack_10<false>(out, in, samples, swap);
+}
+
+void ssse3_unpack_10_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                       bool swap) {
+	ssse3_unpack_10<true>(out, in, samples, swap);
+}
+
+void ssse3_pack_10_a(uint8_t *out, const uint16_t *in, uint64_t samples,
+                     bool swap) {
+	ssse3_pack_10<false>(out, in, samples, swap);
+}
+
+void ssse3_pack_10_b(uint8_t *out, const uint16_t *in, uint64_t samples,
+                     bool swap) {
+	ssse3_pack_10<true>(out, in, samples, swap);
+}
+
+void ssse3_unpack_12_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                       bool swap) {
+	ssse3_unpack_12<false>(out, in, samples, swap);
+}
+
+void ssse3_unpack_12_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                       bool swap) {
+	ssse3_unpack_12<true>(out, in, samples, swap);
+}
+
+void ssse3_pack_12_a(uint8_t *out, const uint16_t *in, uint64_t samples,
+                     bool swap) {
+	ssse3_pack_12<false>(out, in, samples, swap);
+}
+
+void ssse3_pack_12_b(uint8_t *out, const uint16_t *in, uint64_t samples,
+                     bool swap) {
+	ssse3_pack_12<true>(out, in, samples, swap);
+}
+
+//
+// AVX2 kernels.
+//
+// The remainder of each row goes to the SSSE3 kernels, which are not VEX
+// encoded, so the upper halves of the ymm registers are cleared first;
+// otherwise every SSE instruction that runs after the kernel (here and in
+// the caller) pays for the AVX to SSE transition.
+//
+
+__attribute__((target("avx2")))
+inline __m256i avx2_swap32_mask(bool swap) {
+	return swap ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+	                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+	            : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	                               0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+__attribute__((target("avx2")))
+inline __m256i avx2_swap16_mask(bool swap) {
+	return swap ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+	                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+	            : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	                               0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+// Eight words make 24 samples. Sample j comes from word j/3, shifted right
+// by 20, 10 or 0 bits (plus the padding) for j%3 == 0, 1 or 2.
+template <bool B>
+__attribute__((target("avx2")))
+void avx2_unpack_10(uint16_t *out, const uint8_t *in, uint64_t samples,
+                    bool swap) {
+	const int sh=B ? 0 : 2;
+	const __m256i swap_mask=avx2_swap32_mask(swap);
+	const __m256i mask=_mm256_set1_epi32(0x3ff);
+	const __m256i word0=_mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+	const __m256i word1=_mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+	const __m256i word2=_mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+	const __m256i shift0=_mm256_add_epi32(_mm256_setr_epi32(20, 10, 0, 20, 10, 0, 20, 10), _mm256_set1_epi32(sh));
+	const __m256i shift1=_mm256_add_epi32(_mm256_setr_epi32(0, 20, 10, 0, 20, 10, 0, 20), _mm256_set1_epi32(sh));
+	const __m256i shift2=_mm256_add_epi32(_mm256_setr_epi32(10, 0, 20, 10, 0, 20, 10, 0), _mm256_set1_epi32(sh));
+	uint64_t u;
+
+	for(u=0; u+24<=samples; u+=24) {
+		__m256i t=_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)in), swap_mask);
+		__m256i v0=_mm256_and_si256(_mm256_srlv_epi32(_mm256_permutevar8x32_epi32(t, word0), shift0), mask);
+		__m256i v1=_mm256_and_si256(_mm256_srlv_epi32(_mm256_permutevar8x32_epi32(t, word1), shift1), mask);
+		__m256i v2=_mm256_and_si256(_mm256_srlv_epi32(_mm256_permutevar8x32_epi32(t, word2), shift2), mask);
+
+		// packus works within 128 bit lanes, put the quadwords back in order.
+		_mm256_storeu_si256((__m256i *)out,
+		                    _mm256_permute4x64_epi64(_mm256_packus_epi32(v0, v1), 0xd8));
+		_mm_storeu_si128((__m128i *)(out+16),
+		                 _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(v2, v2), 0xd8)));
+		in=in+32;
+		out=out+24;
+	}
+	_mm256_zeroupper();
+	ssse3_unpack_10<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("avx2")))
+void avx2_pack_10(uint8_t *out, const uint16_t *in, uint64_t samples,
+                  bool swap) {
+	const int sh=B ? 0 : 2;
+	const __m256i swap_mask=avx2_swap32_mask(swap);
+	const __m256i mask=_mm256_set1_epi32(0x3ff);
+	// Lane i of x, y and z is sample 3i, 3i+1 and 3i+2, gathered from the
+	// three groups of eight samples.
+	const __m256i x0=_mm256_setr_epi32(0, 3, 6, 0, 0, 0, 0, 0);
+	const __m256i x1=_mm256_setr_epi32(0, 0, 0, 1, 4, 7, 0, 0);
+	const __m256i x2=_mm256_setr_epi32(0, 0, 0, 0, 0, 0, 2, 5);
+	const __m256i y0=_mm256_setr_epi32(1, 4, 7, 0, 0, 0, 0, 0);
+	const __m256i y1=_mm256_setr_epi32(0, 0, 0, 2, 5, 0, 0, 0);
+	const __m256i y2=_mm256_setr_epi32(0, 0, 0, 0, 0, 0, 3, 6);
+	const __m256i z0=_mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0);
+	const __m256i z1=_mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0);
+	const __m256i z2=_mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7);
+	uint64_t u;
+
+	for(u=0; u+24<=samples; u+=24) {
+		__m256i a0=_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)in));
+		__m256i a1=_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in+8)));
+		__m256i a2=_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in+16)));
+		__m256i x, y, z, t;
+
+		x=_mm256_blend_epi32(_mm256_permutevar8x32_epi32(a0, x0), _mm256_permutevar8x32_epi32(a1, x1), 0x38);
+		x=_mm256_blend_epi32(x, _mm256_permutevar8x32_epi32(a2, x2), 0xc0);
+		y=_mm256_blend_epi32(_mm256_permutevar8x32_epi32(a0, y0), _mm256_permutevar8x32_epi32(a1, y1), 0x18);
+		y=_mm256_blend_epi32(y, _mm256_permutevar8x32_epi32(a2, y2), 0xe0);
+		z=_mm256_blend_epi32(_mm256_permutevar8x32_epi32(a0, z0), _mm256_permutevar8x32_epi32(a1, z1), 0x1c);
+		z=_mm256_blend_epi32(z, _mm256_permutevar8x32_epi32(a2, z2), 0xe0);
+
+		t=_mm256_slli_epi32(_mm256_and_si256(x, mask), 20+sh);
+		t=_mm256_or_si256(t, _mm256_slli_epi32(_mm256_and_si256(y, mask), 10+sh));
+		t=_mm256_or_si256(t, _mm256_slli_epi32(_mm256_and_si256(z, mask), sh));
+		_mm256_storeu_si256((__m256i *)out, _mm256_shuffle_epi8(t, swap_mask));
+		in=in+24;
+		out=out+32;
+	}
+	_mm256_zeroupper();
+	ssse3_pack_10<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("avx2")))
+void avx2_unpack_12(uint16_t *out, const uint8_t *in, uint64_t samples,
+                    bool swap) {
+	const __m256i swap_mask=avx2_swap16_mask(swap);
+	const __m256i mask=_mm256_set1_epi16(0xfff);
+	uint64_t u;
+
+	for(u=0; u+16<=samples; u+=16) {
+		__m256i t=_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)in), swap_mask);
+
+		t=B ? _mm256_and_si256(t, mask) : _mm256_srli_epi16(t, 4);
+		_mm256_storeu_si256((__m256i *)out, t);
+		in=in+32;
+		out=out+16;
+	}
+	_mm256_zeroupper();
+	ssse3_unpack_12<B>(out, in, samples-u, swap);
+}
+
+template <bool B>
+__attribute__((target("avx2")))
+void avx2_pack_12(uint8_t *out, const uint16_t *in, uint64_t samples,
+                  bool swap) {
+	const __m256i swap_mask=avx2_swap16_mask(swap);
+	const __m256i mask=_mm256_set1_epi16(0xfff);
+	uint64_t u;
+
+	for(u=0; u+16<=samples; u+=16) {
+		__m256i t=_mm256_and_si256(_mm256_loadu_si256((const __m256i *)in), mask);
+
+		if(!B) {
+			t=_mm256_slli_epi16(t, 4);
+		}
+		_mm256_storeu_si256((__m256i *)out, _mm256_shuffle_epi8(t, swap_mask));
+		in=in+16;
+		out=out+32;
+	}
+	_mm256_zeroupper();
+	ssse3_pack_12<B>(out, in, samples-u, swap);
+}
+
+// Same as the SSSE3 version, with the upper lane loaded from 12 bytes on so
+// that each lane holds two groups of four samples.
+__attribute__((target("avx2")))
+void avx2_unpack_12_filled(uint16_t *out, const uint8_t *in,
+                           uint64_t samples, bool swap) {
+	const __m128i gather128=ssse3_filled_mask(swap, 6);
+	const __m256i gather=_mm256_broadcastsi128_si256(gather128);
+	const __m256i even=_mm256_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0,
+	                                     -1, 0, -1, 0, -1, 0, -1, 0);
+	const __m256i odd=_mm256_setr_epi16(0, 0xfff, 0, 0xfff, 0, 0xfff, 0, 0xfff,
+	                                    0, 0xfff, 0, 0xfff, 0, 0xfff, 0, 0xfff);
+	uint64_t u, bytes;
+
+	// Each group of 16 samples takes 24 bytes, but 28 are loaded.
+	bytes=packed_row_bytes(packed_12_filled, samples);
+	for(u=0; u+16<=samples && (u/16)*24+28<=bytes; u+=16) {
+		__m256i t=_mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+			_mm_loadu_si128((const __m128i *)(in+12)), 1);
+
+		t=_mm256_shuffle_epi8(t, gather);
+		t=_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(t, 4), even),
+		                  _mm256_and_si256(t, odd));
+		_mm256_storeu_si256((__m256i *)out, t);
+		in=in+24;
+		out=out+16;
+	}
+	_mm256_zeroupper();
+	ssse3_unpack_12_filled(out, in, samples-u, swap);
+}
+
+void avx2_unpack_10_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                      bool swap) {
+	avx2_unpack_10<false>(out, in, samples, swap);
+}
+
+void avx2_unpack_10_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                      bool swap) {
+	avx2_unpack_10<true>(out, in, samples, swap);
+}
+
+void avx2_pack_10_a(uint8_t *out, const uint16_t *in, uint64_t samples,
+                    bool swap) {
+	avx2_pack_10<false>(out, in, samples, swap);
+}
+
+void avx2_pack_10_b(uint8_t *out, const uint16_t *in, uint64_t samples,
+                    bool swap) {
+	avx2_pack_10<true>(out, in, samples, swap);
+}
+
+void avx2_unpack_12_a(uint16_t *out, const uint8_t *in, uint64_t samples,
+                      bool swap) {
+	avx2_unpack_12<false>(out, in, samples, swap);
+}
+
+void avx2_unpack_12_b(uint16_t *out, const uint8_t *in, uint64_t samples,
+                      bool swap) {
+	avx2_unpack_12<true>(out, in, samples, swap);
+}
+
+void avx2_pack_12_a(uint8_t *out, const uint16_t *in, uint64_t samples,
+                    bool swap) {
+	avx2_pack_12<false>(out, in, samples, swap);
+}
+
+void avx2_pack_12_b(uint8_t *out, const uint16_t *in, uint64_t samples,
+                    bool swap) {
+	avx2_pack_12<true>(out, in, samples, swap);
+}
+
+#endif
+
+const pack_kernels scalar_kernels={
+	{ NULL, unpack_10_a, unpack_10_b, unpack_12_a, unpack_12_b,
+	  unpack_12_filled },
+	{ NULL, pack_10_a, pack_10_b, pack_12_a, pack_12_b, pack_12_filled }
+};
+
+#if defined(DPX_PACK_X86)
+const pack_kernels ssse3_kernels={
+	{ NULL, ssse3_unpack_10_a, ssse3_unpack_10_b, ssse3_unpack_12_a,
+	  ssse3_unpack_12_b, ssse3_unpack_12_filled },
+	{ NULL, ssse3_pack_10_a, ssse3_pack_10_b, ssse3_pack_12_a,
+	  ssse3_pack_12_b, ssse3_pack_12_filled }
+};
+
+// The filled 12 bit packer does not gain from the wider registers (the
+// three words per group do not line up with the lanes), so the SSSE3 one
+// is used.
+const pack_kernels avx2_kernels={
+	{ NULL, avx2_unpack_10_a, avx2_unpack_10_b, avx2_unpack_12_a,
+	  avx2_unpack_12_b, avx2_unpack_12_filled },
+	{ NULL, avx2_pack_10_a, avx2_pack_10_b, avx2_pack_12_a,
+	  avx2_pack_12_b, ssse3_pack_12_filled }
+};
+
+pack_isa_e detect_isa(void) {
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		return pack_avx2;
+	}
+	if(__builtin_cpu_supports("ssse3")) {
+		return pack_ssse3;
+	}
+	return pack_scalar;
+}
+#endif
+
+}
+
+packed_layout_e packed_layout(uint8_t bps, uint16_t pack) {
+	if(bps==10) {
+		if(pack==1) {
+			return packed_10_a;
+		} else if(pack==2) {
+			return packed_10_b;
+		}
+	} else if(bps==12) {
+		if(pack==9) {
+			return packed_12_a;
+		} else if(pack==10) {
+			return packed_12_b;
+		} else if(pack==8) {
+			return packed_12_filled;
+		}
+	}
+	return packed_none;
+}
+
+uint64_t packed_row_bytes(packed_layout_e layout, uint64_t samples) {
+	switch(layout) {
+		case packed_10_a:
+		case packed_10_b:
+			return ((samples+2)/3)*4;
+		case packed_12_a:
+		case packed_12_b:
+			return samples*2;
+		case packed_12_filled:
+			return ((samples*12+15)/16)*2;
+		default:
+			break;
+	}
+	return 0;
+}
+
+pack_isa_e pack_isa_supported(void) {
+#if defined(DPX_PACK_X86)
+	static const pack_isa_e isa=detect_isa();
+
+	return isa;
+#else
+	return pack_scalar;
+#endif
+}
+
+const pack_kernels &kernels_for_isa(pack_isa_e isa) {
+	if(isa>pack_isa_supported()) {
+		isa=pack_isa_supported();
+	}
+#if defined(DPX_PACK_X86)
+	if(isa==pack_avx2) {
+		return avx2_kernels;
+	} else if(isa==pack_ssse3) {
+		return ssse3_kernels;
+	}
+#endif
+	return scalar_kernels;
+}
+
+const pack_kernels &best_pack_kernels(void) {
+	return kernels_for_isa(pack_isa_supported());
+}
+
+const char *pack_isa_name(pack_isa_e isa) {
+	switch(isa) {
+		case pack_scalar:
+			return "scalar";
+		case pack_ssse3:
+			return "ssse3";
+		case pack_avx2:
+			return "avx2";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+const char *packed_layout_name(packed_layout_e layout) {
+	switch(layout) {
+		case packed_10_a:
+			return "10 bit method A";
+		case packed_10_b:
+			return "10 bit method B";
+		case packed_12_a:
+			return "12 bit method A";
+		case packed_12_b:
+			return "12 bit method B";
+		case packed_12_filled:
+			return "12 bit filled";
+		default:
+			break;
+	}
+	return "none";
+}
+
+}
+}
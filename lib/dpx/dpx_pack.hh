@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#if !defined(AMPAS_CTL_DPX_PACK_INCLUDE)
+#define AMPAS_CTL_DPX_PACK_INCLUDE
+
+#include <stdint.h>
+
+namespace ctl {
+namespace dpxi {
+
+// Kernels for the packed integer layouts that make up most DPX files. They
+// convert between the raw bytes of a row as they are stored in the file
+// (so the byte swap for files of the other byte order is done in the same
+// pass) and 16 bit samples. Rows always start on a word boundary; the
+// kernels are called once per row with the number of samples in the row.
+//
+//   packed_10_a      three 10 bit samples per 32 bit word, in the top 30
+//                    bits, the first sample in the most significant bits
+//                    (packing 1, 'method A').
+//   packed_10_b      the same, in the bottom 30 bits (packing 2).
+//   packed_12_a      one 12 bit sample in the top of each 16 bit word
+//                    (packing 1 'method A', actual packing 9).
+//   packed_12_b      one 12 bit sample in the bottom of each 16 bit word
+//                    (packing 2, actual packing 10).
+//   packed_12_filled four 12 bit samples in three 16 bit words, the first
+//                    sample in the most significant bits (packing 0,
+//                    actual packing 8).
+enum packed_layout_e {
+	packed_none=0,
+	packed_10_a,
+	packed_10_b,
+	packed_12_a,
+	packed_12_b,
+	packed_12_filled,
+	packed_layout_count
+};
+
+// The instruction set the kernels are written for. The best one supported
+// by the running CPU is picked at runtime.
+enum pack_isa_e {
+	pack_scalar=0,
+	pack_ssse3,
+	pack_avx2,
+	pack_isa_count
+};
+
+typedef void (*unpack_fn)(uint16_t *out, const uint8_t *in, uint64_t samples,
+                          bool swap);
+typedef void (*pack_fn)(uint8_t *out, const uint16_t *in, uint64_t samples,
+                        bool swap);
+
+struct pack_kernels {
+	unpack_fn unpack[packed_layout_count];
+	pack_fn pack[packed_layout_count];
+};
+
+// Returns the layout for the bits per sample and the (actual) packing of
+// an element, or packed_none if there is no kernel for it.
+packed_layout_e packed_layout(uint8_t bps, uint16_t pack);
+
+// Number of bytes taken by a row of 'samples' samples in the layout.
+uint64_t packed_row_bytes(packed_layout_e layout, uint64_t samples);
+
+// The most capable instruction set supported by this CPU (and build).
+pack_isa_e pack_isa_supported(void);
+
+// Kernels for the given instruction set, or for the best supported one
+// if the requested one is not available.
+const pack_kernels &kernels_for_isa(pack_isa_e isa);
+const pack_kernels &best_pack_kernels(void);
+
+const char *pack_isa_name(pack_isa_e isa);
+const char *packed_layout_name(packed_layout_e layout);
+
+}
+}
+
+#endif
@@ -58,6 +58,11 @@
 #include <math.h>
 #include "dpx_bits.hh"
 #include "dpx_rw.hh"
+#include "dpx_pack.hh"
+#include "dpx_map.hh"
+#include "dpx_thread.hh"
+#include <string.h>
+#include <vector>
 
 namespace ctl {
 namespace dpxi {
@@ -165,37 +170,37 @@ void read(dpx::fb<O> *out, const I *in, const rwinfo &ri) {
 		if(((ri.pack&0x7)==1 || (ri.pack&0x7)==2) && ((sizeof(I)*8)%ri.bps)!=0) {
 			if(ri.bps<=8) {
 				unpack(&upfbu8, in, ri);
-				convertfb(out, sizeof(O)*8, upfbu8.ptr(), ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, upfbu8.ptr(), ri.bps, ri.scale);
 			} else if(ri.bps<=16) {
 				unpack(&upfbu16, in, ri);
-				convertfb(out, sizeof(O)*8, upfbu16.ptr(), ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, upfbu16.ptr(), ri.bps, ri.scale);
 			} else if(ri.bps<=32) {
 				unpack(&upfbu32, in, ri);
-				convertfb(out, sizeof(O)*8, upfbu32.ptr(), ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, upfbu32.ptr(), ri.bps, ri.scale);
 			} else if(ri.bps<=64) {
 				unpack(&upfbu64, in, ri);
-				convertfb(out, sizeof(O)*8, upfbu64.ptr(), ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, upfbu64.ptr(), ri.bps, ri.scale);
 			} else {
 				// XXX badness...
 			}
 		} else if((ri.pack&0x7)>=0 && (ri.pack&0x7)<=2 &&
 		          sizeof(I)*8%ri.bps==0) {
-			convertfb(out, sizeof(O)*8, in, ri.bps, ri.scale);
+			convertfb_parallel(out, sizeof(O)*8, in, ri.bps, ri.scale);
 		} else {
 			// XXX
 		}
 	} else if(ri.datatype==2) {
 		switch(ri.bps) {
 			case 16:
-				convertfb(out, sizeof(O)*8, (float16_t *)in, ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, (float16_t *)in, ri.bps, ri.scale);
 				break;
 
 			case 32:
-				convertfb(out, sizeof(O)*8, (float32_t *)in, ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, (float32_t *)in, ri.bps, ri.scale);
 				break;
 
 			case 64:
-				convertfb(out, sizeof(O)*8, (float64_t *)in, ri.bps, ri.scale);
+				convertfb_parallel(out, sizeof(O)*8, (float64_t *)in, ri.bps, ri.scale);
 				break;
 
 			default:
@@ -207,6 +212,62 @@ void read(dpx::fb<O> *out, const I *in, const rwinfo &ri) {
 	}
 }
 
+// Rows of the packed layouts all start on a word boundary, so they can be
+// unpacked independently.
+struct unpack_job : public row_job {
+	unpack_fn unpack;
+	uint16_t *out;
+	const uint8_t *in;
+	uint64_t row_samples;
+	uint64_t row_bytes;
+	bool swap;
+
+	virtual void rows(uint32_t first, uint32_t count) {
+		uint32_t y;
+
+		for(y=first; y<first+count; y++) {
+			unpack(out+y*row_samples, in+y*row_bytes, row_samples, swap);
+		}
+	}
+};
+
+// The common packed 10 and 12 bit layouts are read as raw bytes and
+// unpacked a row at a time, with the byte swap done by the unpack kernel.
+// Returns FALSE if there is no kernel for the layout.
+template <class T>
+bool read_packed(std::istream *i, dpx::fb<T> *out, const rwinfo &ri) {
+	dpx::fb<uint16_t> samples;
+	dpx::fb<uint8_t> raw;
+	packed_layout_e layout;
+	unpack_fn unpack;
+	unpack_job job;
+	uint64_t row_samples, row_bytes;
+
+	layout=packed_layout(ri.bps, ri.pack);
+	if(ri.datatype!=0 || layout==packed_none) {
+		return FALSE;
+	}
+
+	unpack=best_pack_kernels().unpack[layout];
+	row_samples=(uint64_t)ri.width*ri.channels;
+	row_bytes=packed_row_bytes(layout, row_samples);
+
+	raw.init(row_bytes*ri.height, 1, 1);
+	i->read((char *)raw.ptr(), raw.count());
+
+	samples.init(ri.width, ri.height, ri.channels);
+	job.unpack=unpack;
+	job.out=samples.ptr();
+	job.in=raw.ptr();
+	job.row_samples=row_samples;
+	job.row_bytes=row_bytes;
+	job.swap=ri.need_byteswap;
+	parallel_rows(&job, ri.height);
+
+	convertfb_parallel(out, sizeof(T)*8, samples.ptr(), ri.bps, ri.scale);
+	return TRUE;
+}
+
 // Catch-all super-transforming read.
 template <class T>
 void read(std::istream *i, dpx::fb<T> *out, const rwinfo &ri) {
@@ -216,6 +277,10 @@ void read(std::istream *i, dpx::fb<T> *out, const rwinfo &ri) {
 	dpx::fb<uint8_t>   fbu8;
 	rwinfo new_ri;
 
+	if(read_packed(i, out, ri)) {
+		return;
+	}
+
 	// ri.datatype==0 unsigned integer
 	// ri.datatype==1 signed integer (unsupported)
 	// ri.datatype==2 floating point
@@ -282,8 +347,245 @@ void read(std::istream *i, uint8_t element, dpx::fb<T> *buffer,
 	i->seekg(start);
 }
 
+// Decodes rows of an element held in memory (i.e. a mapped file) straight
+// into a float buffer. Each row is unpacked and byte swapped into a small
+// scratch row, then scaled through a lookup table, so the element is only
+// walked through once and never copied as a whole.
+struct row_decoder {
+	enum kind_e {
+		unsupported=0,
+		packed,
+		words8,
+		words16,
+		float32
+	};
+
+	kind_e kind;
+	unpack_fn unpack;
+	uint64_t row_samples;
+	uint64_t row_bytes;
+	bool swap;
+	float64_t scale;
+	std::vector<float32_t> lut;
+
+	// Returns FALSE for layouts that are left to the stream reader.
+	bool init(const rwinfo &ri) {
+		packed_layout_e layout;
+		convert_fn fn;
+		uint32_t u;
+
+		kind=unsupported;
+		row_samples=(uint64_t)ri.width*ri.channels;
+		swap=ri.need_byteswap;
+		scale=ri.scale;
+
+		layout=packed_layout(ri.bps, ri.pack);
+		if(ri.datatype==0 && layout!=packed_none) {
+			kind=packed;
+			unpack=best_pack_kernels().unpack[layout];
+			row_bytes=packed_row_bytes(layout, row_samples);
+		} else if(ri.datatype==0 && ri.bps==8 && ri.bytes_per_swap==1) {
+			kind=words8;
+			row_bytes=row_samples;
+		} else if(ri.datatype==0 && ri.bps==16 && ri.bytes_per_swap==2) {
+			kind=words16;
+			row_bytes=row_samples*2;
+		} else if(ri.datatype==2 && ri.bps==32 && ri.bytes_per_swap==4) {
+			kind=float32;
+			row_bytes=row_samples*4;
+		} else {
+			return FALSE;
+		}
+
+		// The same conversion the stream reader does through convertfb,
+		// for every code value.
+		if(kind!=float32) {
+			lut.resize(1<<ri.bps);
+			fn=find_convert_fn<float32_t, uint32_t>(32, ri.bps, ri.scale);
+			for(u=0; u<lut.size(); u++) {
+				fn(&(lut[u]), 32, &u, ri.bps, ri.scale);
+			}
+		}
+		return TRUE;
+	}
+
+	// 'in' and 'out' point at the first row to decode.
+	void decode(float32_t *out, const uint8_t *in, uint32_t rows) const {
+		std::vector<uint16_t> scratch;
+		const float32_t *l;
+		uint64_t u;
+		uint32_t y;
+		uint16_t w16;
+		float32_t f;
+
+		if(kind==packed) {
+			scratch.resize(row_samples);
+		}
+		l=lut.empty() ? NULL : &(lut[0]);
+
+		for(y=0; y<rows; y++) {
+			switch(kind) {
+				case packed:
+					unpack(&(scratch[0]), in, row_samples, swap);
+					for(u=0; u<row_samples; u++) {
+						out[u]=l[scratch[u]];
+					}
+					break;
+
+				case words8:
+					for(u=0; u<row_samples; u++) {
+						out[u]=l[in[u]];
+					}
+					break;
+
+				case words16:
+					for(u=0; u<row_samples; u++) {
+						memcpy(&w16, in+2*u, 2);
+						if(swap) {
+							swap16(&w16);
+						}
+						out[u]=l[w16];
+					}
+					break;
+
+				case float32:
+					for(u=0; u<row_samples; u++) {
+						memcpy(&f, in+4*u, 4);
+						if(swap) {
+							swap32(&f);
+						}
+						out[u]=(scale==0.0 || scale==1.0) ? f : f*scale;
+					}
+					break;
+
+				default:
+					break;
+			}
+			in=in+row_bytes;
+			out=out+row_samples;
+		}
+	}
+};
+
+struct decode_job : public row_job {
+	const row_decoder *decoder;
+	float32_t *out;
+	const uint8_t *in;
+
+	virtual void rows(uint32_t first, uint32_t count) {
+		decoder->decode(out+first*decoder->row_samples,
+		                in+first*decoder->row_bytes, count);
+	}
+};
+
+// Returns FALSE if the element does not fit in the 'size' bytes of data.
+bool element_in_bounds(uint64_t size, const row_decoder &decoder,
+                       const rwinfo &ri) {
+	// Truncated files are left to the stream reader.
+	return ri.offset_to_data<=size &&
+	       decoder.row_bytes*ri.height<=size-ri.offset_to_data;
+}
+
+bool read_mapped(const uint8_t *data, uint64_t size,
+                 dpx::fb<float32_t> *buffer, const rwinfo &ri) {
+	row_decoder decoder;
+	decode_job job;
+
+	if(!decoder.init(ri) || !element_in_bounds(size, decoder, ri)) {
+		return FALSE;
+	}
+
+	buffer->init(ri.width, ri.height, ri.channels);
+	job.decoder=&decoder;
+	job.out=buffer->ptr();
+	job.in=data+ri.offset_to_data;
+	parallel_rows(&job, ri.height);
+	return TRUE;
+}
+
+struct strip_reader_state {
+	mapped_file file;
+	row_decoder decoder;
+	const uint8_t *data;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
 };
 
+};
+
+bool dpx::read_mapped(const char *filename, uint8_t e,
+                      fb<float32_t> *buffer, float64_t scale) {
+	dpxi::rwinfo ri(this, e, scale, normal, FALSE);
+	dpxi::mapped_file file;
+
+	if(!file.open(filename)) {
+		return FALSE;
+	}
+	return dpxi::read_mapped(file.data(), file.size(), buffer, ri);
+}
+
+dpx::strip_reader::strip_reader() {
+	_state=NULL;
+}
+
+dpx::strip_reader::~strip_reader() {
+	delete _state;
+}
+
+bool dpx::strip_reader::open(const dpx *header, const char *filename,
+                             uint8_t e, float64_t scale) {
+	dpxi::rwinfo ri(header, e, scale, normal, FALSE);
+	dpxi::strip_reader_state *state;
+
+	delete _state;
+	_state=NULL;
+
+	state=new dpxi::strip_reader_state;
+	if(!state->file.open(filename) || !state->decoder.init(ri) ||
+	   !dpxi::element_in_bounds(state->file.size(), state->decoder, ri)) {
+		delete state;
+		return FALSE;
+	}
+
+	state->data=state->file.data()+ri.offset_to_data;
+	state->width=ri.width;
+	state->height=ri.height;
+	state->depth=ri.channels;
+	_state=state;
+	return TRUE;
+}
+
+uint32_t dpx::strip_reader::width(void) const {
+	return _state==NULL ? 0 : _state->width;
+}
+
+uint32_t dpx::strip_reader::height(void) const {
+	return _state==NULL ? 0 : _state->height;
+}
+
+uint32_t dpx::strip_reader::depth(void) const {
+	return _state==NULL ? 0 : _state->depth;
+}
+
+void dpx::strip_reader::read(uint32_t first_row, uint32_t rows,
+                             fb<float32_t> *buffer) {
+	dpxi::decode_job job;
+
+	if(_state==NULL || first_row>=_state->height) {
+		throw outofrange();
+	}
+	if(rows>_state->height-first_row) {
+		rows=_state->height-first_row;
+	}
+
+	buffer->init(_state->width, rows, _state->depth);
+	job.decoder=&(_state->decoder);
+	job.out=buffer->ptr();
+	job.in=_state->data+first_row*_state->decoder.row_bytes;
+	dpxi::parallel_rows(&job, rows);
+}
+
 void dpx::read(std::istream *i, uint8_t e,
                fb<float16_t> *buffer, float64_t scale) {
 	dpxi::rwinfo ri(this, e, scale, normal, FALSE);
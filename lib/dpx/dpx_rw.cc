@@ -65,6 +65,7 @@ rwinfo::rwinfo() {
 
 rwinfo::rwinfo(const dpx *that, uint8_t e, float64_t _scale,
                dpx::intmode_e _mode, bool is_integer) {
+	clear();
 	set(that, e, _scale, _mode, is_integer);
 }
 
@@ -83,6 +84,7 @@ void rwinfo::clear(void) {
 	scale=0;
 	need_byteswap=0;
 	mode=dpx::normal;
+	dither=dpx::no_dither;
 }
 
 void rwinfo::set(const dpx *that, uint8_t e, float64_t _scale,
@@ -183,8 +185,13 @@ uint64_t rwinfo::words_for_raw(uint8_t swap_boundary) const {
 	uint32_t samples_per_word;
 	uint64_t samples;
 
-	samples_per_word=(swap_boundary*8)/bps;
 	samples=channels*width;
+	if((pack&0x7)==0 && ((swap_boundary*8)%bps)!=0) {
+		// Filled: samples run across word boundaries, only the rows
+		// start on a new word.
+		return ((samples*bps+swap_boundary*8-1)/(swap_boundary*8))*height;
+	}
+	samples_per_word=(swap_boundary*8)/bps;
 	return ((samples+samples_per_word-1)/samples_per_word)*height;
 }
 
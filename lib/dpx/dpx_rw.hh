@@ -99,6 +99,7 @@ struct rwinfo {
 	float64_t scale;
 	bool need_byteswap;
 	dpx::intmode_e mode;
+	dpx::dither_e dither; // set by the float writes, not by set()
 
 	// If writing into type 'T', given the bps, width, and height
 	// how many words of type 'T' will be needed to actually store
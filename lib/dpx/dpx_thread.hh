@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#if !defined(AMPAS_CTL_DPX_THREAD_INCLUDE)
+#define AMPAS_CTL_DPX_THREAD_INCLUDE
+
+#include <dpx.hh>
+
+namespace ctl {
+namespace dpxi {
+
+// Some work on an image that can be done on any range of rows
+// independently of the others (e.g. unpacking rows that start on a word
+// boundary, or converting samples).
+struct row_job {
+	virtual ~row_job();
+	virtual void rows(uint32_t first, uint32_t count)=0;
+};
+
+// Splits rows [0, height) into one strip per thread of the IlmThread
+// global thread pool and runs job->rows() on each, returning once all of
+// them are done. Runs everything in the calling thread if the pool has no
+// threads or there are fewer than 'min_rows' rows per strip.
+void parallel_rows(row_job *job, uint32_t height, uint32_t min_rows=16);
+
+template <class O, class I>
+struct convert_job : public row_job {
+	O *out;
+	uint8_t osb;
+	const I *in;
+	uint8_t isb;
+	float64_t scale;
+	uint64_t row_samples;
+
+	virtual void rows(uint32_t first, uint32_t count) {
+		convert(out+first*row_samples, osb, in+first*row_samples, isb, scale,
+		        count*row_samples);
+	}
+};
+
+// Same as convertfb, split up by rows across the thread pool.
+template <class O, class I>
+void convertfb_parallel(dpx::fb<O> *out, uint8_t osb, const I *in,
+                        uint8_t isb, float64_t scale) {
+	convert_job<O, I> job;
+
+	job.out=out->ptr();
+	job.osb=osb;
+	job.in=in;
+	job.isb=isb;
+	job.scale=scale;
+	job.row_samples=(uint64_t)out->width()*out->depth();
+	parallel_rows(&job, out->height());
+}
+
+template <class O>
+struct dither_job : public row_job {
+	O *out;
+	uint8_t osb;
+	const float32_t *in;
+	float64_t scale;
+	uint32_t width;
+	uint32_t depth;
+	uint32_t first_row;
+	dpx::dither_e mode;
+
+	virtual void rows(uint32_t first, uint32_t count) {
+		const uint64_t row_samples=(uint64_t)width*depth;
+		uint32_t y;
+
+		for(y=first; y<first+count; y++) {
+			dpx::dither(out+y*row_samples, osb, in+y*row_samples, scale,
+			            width, depth, first_row+y, mode);
+		}
+	}
+};
+
+// Same as convertfb_parallel, with dithering; 'first_row' is the number in
+// the image of the first row of the buffer.
+template <class O>
+void ditherfb_parallel(dpx::fb<O> *out, uint8_t osb, const float32_t *in,
+                       float64_t scale, uint32_t first_row,
+                       dpx::dither_e mode) {
+	dither_job<O> job;
+
+	job.out=out->ptr();
+	job.osb=osb;
+	job.in=in;
+	job.scale=scale;
+	job.width=out->width();
+	job.depth=out->depth();
+	job.first_row=first_row;
+	job.mode=mode;
+	parallel_rows(&job, out->height());
+}
+
+}
+}
+
+#endif
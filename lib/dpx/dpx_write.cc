@@ -60,6 +60,8 @@
 #include <math.h>
 #include "dpx_bits.hh"
 #include "dpx_rw.hh"
+#include "dpx_pack.hh"
+#include "dpx_thread.hh"
 
 namespace ctl {
 namespace dpxi {
@@ -145,6 +147,62 @@ void pack(dpx::fb<O> *out, const dpx::fb<I> &in, const rwinfo &ri) {
 	}
 }
 
+// The common packed 10 and 12 bit layouts are packed a row at a time (rows
+// are spread across the thread pool), with the byte swap done by the pack
+// kernel. Only 16 bit buffers are handled;
+// returns FALSE if the layout or buffer type has no kernel.
+template <class T>
+bool write_packed(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
+	return FALSE;
+}
+
+struct pack_job : public row_job {
+	pack_fn pack;
+	uint8_t *out;
+	const uint16_t *in;
+	uint64_t row_samples;
+	uint64_t row_bytes;
+	bool swap;
+
+	virtual void rows(uint32_t first, uint32_t count) {
+		uint32_t y;
+
+		for(y=first; y<first+count; y++) {
+			pack(out+y*row_bytes, in+y*row_samples, row_samples, swap);
+		}
+	}
+};
+
+bool write_packed(std::ostream *o, const dpx::fb<uint16_t> &buf,
+                  const rwinfo &wi) {
+	dpx::fb<uint8_t> raw;
+	packed_layout_e layout;
+	pack_fn pack;
+	pack_job job;
+	uint64_t row_samples, row_bytes;
+
+	layout=packed_layout(wi.bps, wi.pack);
+	if(wi.datatype!=0 || layout==packed_none) {
+		return FALSE;
+	}
+
+	pack=best_pack_kernels().pack[layout];
+	row_samples=(uint64_t)buf.width()*buf.depth();
+	row_bytes=packed_row_bytes(layout, row_samples);
+
+	raw.init(row_bytes*buf.height(), 1, 1);
+	job.pack=pack;
+	job.out=raw.ptr();
+	job.in=buf.ptr();
+	job.row_samples=row_samples;
+	job.row_bytes=row_bytes;
+	job.swap=wi.need_byteswap;
+	parallel_rows(&job, buf.height());
+
+	o->write((const char *)raw.ptr(), raw.count());
+	return TRUE;
+}
+
 template <class T>
 void write_fb(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	dpx::fb<uint64_t>    fbu64;
@@ -152,6 +210,10 @@ void write_fb(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	dpx::fb<uint16_t>    fbu16;
 	dpx::fb<uint8_t>     fbu8;
 		
+	if(write_packed(o, buf, wi)) {
+		return;
+	}
+
 	if(wi.pack<8) {
 		if(wi.bps==32) {
 			write_ptr(o, buf.ptr(), buf.count(), wi.need_byteswap);
@@ -193,6 +255,24 @@ void write_fb(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	}
 }
 
+// Converts the samples of a buffer to be written as integers of up to 16
+// bits. Only float buffers are dithered.
+template <class O, class I>
+void quantisefb(dpx::fb<O> *out, const I *in, const rwinfo &wi,
+                uint32_t first_row) {
+	convertfb_parallel(out, wi.bps, in, sizeof(I)*8, wi.scale);
+}
+
+template <class O>
+void quantisefb(dpx::fb<O> *out, const float32_t *in, const rwinfo &wi,
+                uint32_t first_row) {
+	if(wi.dither==dpx::no_dither) {
+		convertfb_parallel(out, wi.bps, in, 32, wi.scale);
+	} else {
+		ditherfb_parallel(out, wi.bps, in, wi.scale, first_row, wi.dither);
+	}
+}
+
 template <class T>
 void write(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	dpx::fb<uint64_t>    fbu64;
@@ -206,19 +286,19 @@ void write(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	if(wi.datatype==0) {
 		if(wi.bps<=8) {
 			fbu8.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbu8, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			quantisefb(&fbu8, buf.ptr(), wi, 0);
 			write_fb(o, fbu8, wi);
 		} else if(wi.bps<=16) {
 			fbu16.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbu16, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			quantisefb(&fbu16, buf.ptr(), wi, 0);
 			write_fb(o, fbu16, wi);
 		} else if(wi.bps<=32) {
 			fbu32.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbu32, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			convertfb_parallel(&fbu32, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
 			write_fb(o, fbu32, wi);
 		} else if(wi.bps<=64) {
 			fbu64.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbu64, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			convertfb_parallel(&fbu64, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
 			write_fb(o, fbu64, wi);
 		} else {
 			// XXX
@@ -226,19 +306,19 @@ void write(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 	} else if(wi.datatype==2) {
 		if(wi.bps==16) {
 			fbf16.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbf16, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			convertfb_parallel(&fbf16, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
 			if(wi.pack>=8 && wi.pack<=10) {
 				write_ptr(o, fbf64.ptr(), fbf64.count(), wi.need_byteswap);
 			}
 		} else if(wi.bps==32) {
 			fbf32.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbf32, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			convertfb_parallel(&fbf32, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
 			if(/*wi.pack>=0 &&*/ wi.pack<=2) {
 				write_ptr(o, fbf32.ptr(), fbf32.count(), wi.need_byteswap);
 			}
 		} else if(wi.bps==64) {
 			fbf64.init(buf.width(), buf.height(), buf.depth());
-			convertfb(&fbf64, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
+			convertfb_parallel(&fbf64, wi.bps, buf.ptr(), sizeof(T)*8, wi.scale);
 			if(wi.pack>=24 && wi.pack<=26) {
 				write_ptr(o, fbf64.ptr(), fbf64.count(), wi.need_byteswap);
 			}
@@ -252,7 +332,8 @@ void write(std::ostream *o, const dpx::fb<T> &buf, const rwinfo &wi) {
 
 template <class T>
 void write(std::ostream *o, dpx *h, uint8_t element, const dpx::fb<T> &buffer,
-           float64_t scale, dpx::intmode_e mode) {
+           float64_t scale, dpx::intmode_e mode,
+           dpx::dither_e dither=dpx::no_dither) {
 	std::ostream::pos_type start;
 	rwinfo wi;
 
@@ -267,6 +348,7 @@ void write(std::ostream *o, dpx *h, uint8_t element, const dpx::fb<T> &buffer,
 	}
 
 	wi.set(h, element, scale, mode, FALSE);
+	wi.dither=dither;
 
 	if(mode==dpx::unformatted || wi.direct) {
 		rwinfo::find_home(h, element, buffer.length());
@@ -281,16 +363,173 @@ void write(std::ostream *o, dpx *h, uint8_t element, const dpx::fb<T> &buffer,
 	o->seekp(start);
 }
 
+// How the strip writer gets the rows of a float buffer onto the disk. These
+// mirror the paths write(...) and write_fb(...) take for a whole buffer;
+// the layouts that are not listed can not be written a row at a time.
+enum strip_kind_e {
+	strip_unsupported=0,
+	strip_direct,
+	strip_words8,
+	strip_words16,
+	strip_packed
+};
+
+strip_kind_e strip_kind(const rwinfo &wi) {
+	if(wi.direct) {
+		return strip_direct;
+	}
+	if(wi.datatype!=0) {
+		return strip_unsupported;
+	}
+	if(wi.bps==8 && wi.pack>=16 && wi.pack<24) {
+		return strip_words8;
+	}
+	if(wi.bps>8 && wi.bps<=16 && packed_layout(wi.bps, wi.pack)!=packed_none) {
+		return strip_packed;
+	}
+	if(wi.bps==16 && wi.pack>=8 && wi.pack<16) {
+		return strip_words16;
+	}
+	return strip_unsupported;
+}
+
+struct strip_writer_state {
+	strip_kind_e kind;
+	std::ostream *o;
+	std::ostream::pos_type start;
+	rwinfo wi;
+	uint32_t width;
+	uint32_t depth;
+	uint32_t next_row; // of the image, for the dither mask
+};
+
 };
 
+dpx::strip_writer::strip_writer() {
+	_state=NULL;
+}
+
+dpx::strip_writer::~strip_writer() {
+	delete _state;
+}
+
+bool dpx::strip_writer::open(dpx *header, std::ostream *o, uint8_t e,
+                             uint32_t width, uint32_t height, uint32_t depth,
+                             float64_t scale, dither_e dither) {
+	dpxi::strip_writer_state *state;
+	dpxi::rwinfo wi;
+	dpx probe(*header);
+	uint64_t size;
+
+	delete _state;
+	_state=NULL;
+
+	// Work out the layout on a copy of the header first, so nothing is
+	// changed if the caller has to fall back to write(...).
+	dpxi::rwinfo::write_init(o, &probe);
+	dpxi::rwinfo::validate(&probe, e, 2, 32, depth, width, height);
+	wi.set(&probe, e, scale, normal, FALSE);
+	if(dpxi::strip_kind(wi)==dpxi::strip_unsupported) {
+		return FALSE;
+	}
+
+	state=new dpxi::strip_writer_state;
+	state->o=o;
+	state->start=o->tellp();
+	state->width=width;
+	state->depth=depth;
+	state->next_row=0;
+
+	dpxi::rwinfo::write_init(o, header);
+	dpxi::rwinfo::validate(header, e, 2, 32, depth, width, height);
+	state->wi.set(header, e, scale, normal, FALSE);
+	state->wi.dither=dither;
+	state->kind=dpxi::strip_kind(state->wi);
+
+	if(state->kind==dpxi::strip_direct) {
+		size=(uint64_t)width*height*depth*sizeof(float32_t);
+	} else {
+		size=state->wi.bytes_for_raw();
+	}
+	dpxi::rwinfo::find_home(header, e, size);
+	o->seekp(state->start+
+	         ((std::streamoff)header->elements[e].offset_to_data));
+
+	_state=state;
+	return TRUE;
+}
+
+void dpx::strip_writer::write(const fb<float32_t> &buffer) {
+	const dpxi::rwinfo &wi=_state->wi;
+	fb<uint8_t> fbu8;
+	fb<uint16_t> fbu16;
+	fb<uint8_t> raw;
+	dpxi::pack_job job;
+	dpxi::packed_layout_e layout;
+
+	if(buffer.width()!=_state->width || buffer.depth()!=_state->depth) {
+		throw invalid();
+	}
+
+	switch(_state->kind) {
+		case dpxi::strip_direct:
+			dpxi::write_ptr(_state->o, buffer.ptr(), buffer.count(),
+			                wi.need_byteswap);
+			break;
+
+		case dpxi::strip_words8:
+			fbu8.init(buffer.width(), buffer.height(), buffer.depth());
+			dpxi::quantisefb(&fbu8, buffer.ptr(), wi, _state->next_row);
+			dpxi::write_ptr(_state->o, fbu8.ptr(), fbu8.count(),
+			                wi.need_byteswap);
+			break;
+
+		case dpxi::strip_words16:
+			fbu16.init(buffer.width(), buffer.height(), buffer.depth());
+			dpxi::quantisefb(&fbu16, buffer.ptr(), wi, _state->next_row);
+			dpxi::write_ptr(_state->o, fbu16.ptr(), fbu16.count(),
+			                wi.need_byteswap);
+			break;
+
+		case dpxi::strip_packed:
+			fbu16.init(buffer.width(), buffer.height(), buffer.depth());
+			dpxi::quantisefb(&fbu16, buffer.ptr(), wi, _state->next_row);
+
+			layout=dpxi::packed_layout(wi.bps, wi.pack);
+			job.pack=dpxi::best_pack_kernels().pack[layout];
+			job.row_samples=(uint64_t)buffer.width()*buffer.depth();
+			job.row_bytes=dpxi::packed_row_bytes(layout, job.row_samples);
+			raw.init(job.row_bytes*buffer.height(), 1, 1);
+			job.out=raw.ptr();
+			job.in=fbu16.ptr();
+			job.swap=wi.need_byteswap;
+			dpxi::parallel_rows(&job, buffer.height());
+
+			_state->o->write((const char *)raw.ptr(), raw.count());
+			break;
+
+		default:
+			break;
+	}
+	_state->next_row=_state->next_row+buffer.height();
+}
+
+void dpx::strip_writer::close(void) {
+	if(_state!=NULL) {
+		_state->o->seekp(_state->start);
+		delete _state;
+		_state=NULL;
+	}
+}
+
 void dpx::write(std::ostream *o, uint8_t element, const fb<half> &buffer,
                 float64_t scale) {
 	dpxi::write(o, this, element, buffer, scale, dpx::normal);
 }
 
 void dpx::write(std::ostream *o, uint8_t element, const fb<float32_t> &buffer,
-                float64_t scale) {
-	dpxi::write(o, this, element, buffer, scale, dpx::normal);
+                float64_t scale, dither_e dither) {
+	dpxi::write(o, this, element, buffer, scale, dpx::normal, dither);
 }
 
 void dpx::write(std::ostream *o, uint8_t element, const fb<float64_t> &buffer,
@@ -61,6 +61,10 @@
 #include <testVaryingReturn.h>
 #include <testVaryingLookup.h>
 #include <testExamples.h>
+#include <testLazyCodeGeneration.h>
+#include <testSpecialize.h>
+#include <testDeadOutputs.h>
+#include <testBindBuffer.h>
 
 #include <iostream>
 #include <string.h>
@@ -80,6 +84,10 @@ main (int argc, char *argv[])
     TEST (testVaryingReturn);
     TEST (testVaryingLookup);
     TEST (testHugeInit);
+    TEST (testLazyCodeGeneration);
+    TEST (testSpecialize);
+    TEST (testDeadOutputs);
+    TEST (testBindBuffer);
 
     return 0;
 }
@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+#include <CtlSimdInterpreter.h>
+#include <CtlFunctionCall.h>
+#include <Iex.h>
+#include <iostream>
+#include <exception>
+#include <assert.h>
+
+using namespace Ctl;
+using namespace std;
+
+namespace {
+
+const int n = 100;
+
+
+void
+setK (FunctionCallPtr func, float k)
+{
+    *(float *)(func->findInputArg ("k")->data()) = k;
+}
+
+} // namespace
+
+
+void
+testBindBuffer()
+{
+    cout << "Testing function arguments bound to external buffers" << endl;
+
+    try
+    {
+	SimdInterpreter interp;
+	interp.loadModule ("testBindBuffer");
+
+	FunctionCallPtr func = interp.newFunctionCall ("testBindBuffer::apply");
+	FunctionArgPtr x = func->findInputArg ("x");
+	FunctionArgPtr h = func->findInputArg ("h");
+	FunctionArgPtr k = func->findInputArg ("k");
+	FunctionArgPtr y = func->findOutputArg ("y");
+	FunctionArgPtr z = func->findOutputArg ("z");
+
+	float xIn[n];
+	half hIn[n];
+	float yOut[n];
+	half zOut[n];
+
+	for (int i = 0; i < n; i++)
+	{
+	    xIn[i] = i;
+	    hIn[i] = 0.5f * i;
+	    yOut[i] = -1;
+	    zOut[i] = -1;
+	}
+
+	//
+	// Inputs and outputs are read and written in place
+	//
+
+	setK (func, 3);
+	assert (x->bindBuffer (xIn, sizeof (float), n));
+	assert (h->bindBuffer (hIn, sizeof (half), n));
+	assert (y->bindBuffer (yOut, sizeof (float), n));
+	assert (z->bindBuffer (zOut, sizeof (half), n));
+
+	func->callFunction (n);
+
+	for (int i = 0; i < n; i++)
+	{
+	    assert (yOut[i] == 3 * i + 0.5f * i);
+	    assert (zOut[i] == hIn[i]);
+	}
+
+	//
+	// The binding ends with the call; the next call uses
+	// the arguments' own buffers again
+	//
+
+	for (int i = 0; i < n; i++)
+	{
+	    ((float *)(x->data()))[i] = 2 * i;
+	    ((half *)(h->data()))[i] = 1;
+	}
+
+	func->callFunction (n);
+
+	for (int i = 0; i < n; i++)
+	{
+	    assert (((float *)(y->data()))[i] == 6 * i + 1);
+	    assert (yOut[i] == 3 * i + 0.5f * i);
+	}
+
+	//
+	// Buffers whose type or layout differs from the
+	// argument's, and uniform arguments, are not bound
+	//
+
+	float interleaved[2 * n];
+	float kIn = 1;
+
+	assert (!x->bindBuffer (interleaved, 2 * sizeof (float), n));
+	assert (!h->bindBuffer (xIn, sizeof (float), n));
+	assert (!x->bindBuffer (hIn, sizeof (half), n));
+	assert (!k->bindBuffer (&kIn, sizeof (float), 1));
+
+	//
+	// Calls for more samples than a bound buffer holds fail
+	// and end the binding
+	//
+
+	assert (x->bindBuffer (xIn, sizeof (float), n / 2));
+
+	try
+	{
+	    func->callFunction (n);
+	    assert (false);
+	}
+	catch (const Iex::ArgExc &e)
+	{
+	    // expected
+	}
+
+	assert (x->bindBuffer (xIn, sizeof (float), n));
+	assert (h->bindBuffer (hIn, sizeof (half), n));
+	func->callFunction (n);
+
+	for (int i = 0; i < n; i++)
+	    assert (((float *)(y->data()))[i] == 3 * i + 0.5f * i);
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << endl << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok\n" << endl;
+}
@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+#include <CtlSimdInterpreter.h>
+#include <CtlFunctionCall.h>
+#include <Iex.h>
+#include <iostream>
+#include <exception>
+#include <assert.h>
+#include <string.h>
+
+using namespace Ctl;
+using namespace std;
+
+namespace {
+
+const int n = 8;
+
+
+FunctionCallPtr
+newCall (SimdInterpreter &interp, const char *liveOutputs[])
+{
+    vector<string> live;
+
+    for (int i = 0; liveOutputs[i]; i++)
+	live.push_back (liveOutputs[i]);
+
+    return interp.specializeFunctionCall ("testDeadOutputs::apply",
+					  vector<TypeStoragePtr>(),
+					  live);
+}
+
+
+void
+call (FunctionCallPtr func)
+{
+    FunctionArgPtr x = func->findInputArg ("x");
+    x->setVarying (true);
+
+    for (int i = 0; i < n; i++)
+	((float *)(x->data()))[i] = i;
+
+    func->callFunction (n);
+}
+
+
+bool
+assertionFails (FunctionCallPtr func)
+{
+    try
+    {
+	call (func);
+    }
+    catch (const Iex::BaseExc &e)
+    {
+	assert (strstr (e.what(), "CTL assertion failed"));
+	return true;
+    }
+
+    return false;
+}
+
+
+float
+output (FunctionCallPtr func, const char name[], int i)
+{
+    FunctionArgPtr arg = func->findOutputArg (name);
+    return ((float *)(arg->data()))[arg->isVarying()? i: 0];
+}
+
+} // namespace
+
+
+void
+testDeadOutputs()
+{
+    cout << "Testing dead output elimination" << endl;
+
+    try
+    {
+	SimdInterpreter interp;
+	interp.setFunctionSpecialization (true);
+	interp.loadModule ("testDeadOutputs");
+
+	//
+	// Computing all outputs exceeds the instruction limit
+	//
+
+	interp.setMaxInstCount (50000);
+
+	try
+	{
+	    call (interp.newFunctionCall ("testDeadOutputs::apply"));
+	    assert (false);
+	}
+	catch (const Iex::BaseExc &e)
+	{
+	    //
+	    // The interpreter rethrows MaxInstExc as a BaseExc
+	    // with the file name and line number prepended.
+	    //
+
+	    assert (strstr (e.what(), "Maximum CTL instruction count"));
+	}
+
+	//
+	// Computing only y and copy does not
+	//
+
+	const char *live1[] = {"y", "copy", 0};
+	FunctionCallPtr func = newCall (interp, live1);
+	call (func);
+
+	for (int i = 0; i < n; i++)
+	{
+	    assert (output (func, "y", i) == 2 * i);
+	    assert (output (func, "copy", i) == 2 * i);
+	}
+
+	const char *live2[] = {"y", 0};
+	func = newCall (interp, live2);
+	call (func);
+
+	for (int i = 0; i < n; i++)
+	    assert (output (func, "y", i) == 2 * i);
+
+	//
+	// If debug is live, it is computed
+	//
+
+	interp.setMaxInstCount (0);
+
+	const char *live3[] = {"debug", 0};
+	func = newCall (interp, live3);
+	call (func);
+
+	for (int i = 0; i < n; i++)
+	    assert (output (func, "debug", i) == 100000.0f * i + 2 * i);
+
+	//
+	// Calls to CTL functions that assert are never removed,
+	// even if their results are not used, or are used only
+	// to compute dead outputs
+	//
+
+	assert (assertionFails
+		    (interp.newFunctionCall ("testDeadOutputs::applyChecked")));
+
+	vector<string> live5;
+	live5.push_back ("y");
+
+	assert (assertionFails
+		    (interp.specializeFunctionCall
+			 ("testDeadOutputs::applyChecked",
+			  vector<TypeStoragePtr>(), live5)));
+
+	assert (assertionFails
+		    (interp.specializeFunctionCall
+			 ("testDeadOutputs::applyCheckedDead",
+			  vector<TypeStoragePtr>(), live5)));
+
+	//
+	// Only output parameters can be live
+	//
+
+	try
+	{
+	    const char *live4[] = {"x", 0};
+	    newCall (interp, live4);
+	    assert (false);
+	}
+	catch (const Iex::ArgExc &e)
+	{
+	    // expected
+	}
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << endl << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok\n" << endl;
+}
@@ -0,0 +1,280 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+#include <CtlSimdInterpreter.h>
+#include <CtlFunctionCall.h>
+#include <CtlStdType.h>
+#include <Iex.h>
+#include <iostream>
+#include <exception>
+#include <assert.h>
+
+using namespace Ctl;
+using namespace std;
+
+namespace {
+
+const int n = 16;
+
+
+float
+expected (float x, int mode, float gain, bool enabled, float &y)
+{
+    if (!enabled)
+    {
+	y = -1;
+	return x;
+    }
+
+    float r;
+
+    if (mode == 0)
+	r = x * gain;
+    else if (mode == 1)
+	r = x + gain * 2 + 0.5f;
+    else
+	r = x - gain * 2;
+
+    if (mode > 5)
+	r += mode;
+
+    y = (mode < 0 || gain > 100)? 2: (mode > 1)? 1: 0;
+    return r;
+}
+
+
+void
+check (FunctionCallPtr func, int mode, float gain, bool enabled)
+{
+    FunctionArgPtr x = func->findInputArg ("x");
+    x->setVarying (true);
+
+    for (int i = 0; i < n; i++)
+	((float *)(x->data()))[i] = i - n / 2;
+
+    func->callFunction (n);
+
+    FunctionArgPtr ret = func->returnValue();
+    FunctionArgPtr y = func->findOutputArg ("y");
+
+    for (int i = 0; i < n; i++)
+    {
+	float ey;
+	float er = expected (i - n / 2, mode, gain, enabled, ey);
+
+	assert (((float *)(ret->data()))[ret->isVarying()? i: 0] == er);
+	assert (((float *)(y->data()))[y->isVarying()? i: 0] == ey);
+    }
+}
+
+
+TypeStoragePtr
+intArg (const char name[], int value)
+{
+    TypeStoragePtr arg = new DataArg (name, new StdIntType(), 1);
+    arg->set (&value);
+    return arg;
+}
+
+
+TypeStoragePtr
+floatArg (const char name[], float value)
+{
+    TypeStoragePtr arg = new DataArg (name, new StdFloatType(), 1);
+    arg->set (&value);
+    return arg;
+}
+
+
+TypeStoragePtr
+boolArg (const char name[], bool value)
+{
+    TypeStoragePtr arg = new DataArg (name, new StdBoolType(), 1);
+    arg->set (&value);
+    return arg;
+}
+
+} // namespace
+
+
+void
+testSpecialize()
+{
+    cout << "Testing function specialization" << endl;
+
+    try
+    {
+	SimdInterpreter interp;
+	interp.setFunctionSpecialization (true);
+	interp.loadModule ("testSpecialize");
+
+	for (int mode = -1; mode <= 7; mode++)
+	{
+	    for (int enabled = 0; enabled <= 1; enabled++)
+	    {
+		const float gain = 1.5;
+
+		//
+		// All uniform parameters bound
+		//
+
+		vector<TypeStoragePtr> uniforms;
+		uniforms.push_back (intArg ("mode", mode));
+		uniforms.push_back (floatArg ("gain", gain));
+		uniforms.push_back (boolArg ("enabled", enabled));
+
+		FunctionCallPtr func =
+		    interp.specializeFunctionCall ("testSpecialize::apply",
+						   uniforms);
+
+		check (func, mode, gain, enabled);
+
+		//
+		// Specializations are cached
+		//
+
+		func = interp.specializeFunctionCall ("testSpecialize::apply",
+						      uniforms);
+
+		check (func, mode, gain, enabled);
+
+		//
+		// Some uniform parameters bound; the bound value
+		// is converted to the parameter's type
+		//
+
+		uniforms.clear();
+		uniforms.push_back (boolArg ("enabled", enabled));
+		uniforms.push_back (intArg ("gain", 200));
+
+		func = interp.specializeFunctionCall ("testSpecialize::apply",
+						      uniforms);
+
+		*(int *)(func->findInputArg ("mode")->data()) = mode;
+		check (func, mode, 200, enabled);
+	    }
+	}
+
+	//
+	// Only input parameters can be bound, and only to uniform values
+	//
+
+	vector<TypeStoragePtr> uniforms;
+	uniforms.push_back (floatArg ("y", 1));
+
+	try
+	{
+	    interp.specializeFunctionCall ("testSpecialize::apply", uniforms);
+	    assert (false);
+	}
+	catch (const Iex::ArgExc &e)
+	{
+	    // expected
+	}
+
+	uniforms.clear();
+	uniforms.push_back (new DataArg ("gain", new StdFloatType(), n));
+
+	try
+	{
+	    interp.specializeFunctionCall ("testSpecialize::apply", uniforms);
+	    assert (false);
+	}
+	catch (const Iex::ArgExc &e)
+	{
+	    // expected
+	}
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << endl << e.what() << endl;
+	assert (false);
+    }
+
+    try
+    {
+	//
+	// Without function specialization, and in lazy mode, the
+	// syntax trees are gone by the time specializeFunctionCall()
+	// is called; it returns an unspecialized function call with
+	// the bound input arguments set to the bound values.
+	//
+
+	SimdInterpreter interp;
+	interp.setLazyCodeGeneration (true);
+	interp.loadModule ("testSpecialize");
+
+	FunctionCallPtr func =
+	    interp.newFunctionCall ("testSpecialize::apply");
+
+	vector<TypeStoragePtr> uniforms;
+	uniforms.push_back (intArg ("mode", 1));
+	uniforms.push_back (floatArg ("gain", 1.5));
+	uniforms.push_back (boolArg ("enabled", true));
+
+	func = interp.specializeFunctionCall ("testSpecialize::apply",
+					      uniforms);
+
+	check (func, 1, 1.5, true);
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << endl << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok\n" << endl;
+}
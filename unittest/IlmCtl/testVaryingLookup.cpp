@@ -234,6 +234,74 @@ testLookupCubic1D (Interpreter &interp)
 }
 
 
+void
+testUniformTableLookup1D (Interpreter &interp)
+{
+    cout << "1D, linear and cubic, uniform table" << endl;
+
+    FunctionCallPtr func = interp.newFunctionCall ("uniformTableLookup1D");
+    assert (func);
+
+    FunctionArgPtr pMin = func->findInputArg ("pMin");
+    assert (pMin);
+    assert (!pMin->isVarying());
+    *(float *)(pMin->data()) = 0.0;
+
+    FunctionArgPtr pMax = func->findInputArg ("pMax");
+    assert (pMax);
+    assert (!pMax->isVarying());
+    *(float *)(pMax->data()) = 4.0;
+
+    FunctionArgPtr p = func->findInputArg ("p");
+    assert (p);
+    assert (p->isVarying());
+    char *pData = p->data();
+    size_t pSize = p->type()->alignedObjectSize();
+
+    //
+    // Enough samples for the batched lookups to take more than
+    // one batch, some of them outside the table.
+    //
+
+    size_t n = interp.maxSamples() < 1000 ? interp.maxSamples() : 1000;
+    assert (n >= 4);
+
+    for (size_t i = 0; i < n; ++i)
+	*(float *)(pData + pSize * i) = -1.0f + 6.0f * i / n;
+
+    *(float *)(pData + pSize * 0) = 1.5;
+    *(float *)(pData + pSize * 1) = 2.0;
+    *(float *)(pData + pSize * 2) = -1.0;
+    *(float *)(pData + pSize * 3) = 10.0;
+
+    func->callFunction (n);
+
+    const char *q1Data = func->findOutputArg ("q1")->data();
+    const char *qcData = func->findOutputArg ("qc")->data();
+    const char *m1Data = func->findOutputArg ("m1")->data();
+    const char *mcData = func->findOutputArg ("mc")->data();
+    size_t qSize = func->findOutputArg ("q1")->type()->alignedObjectSize();
+
+    assert (*(float *)(q1Data + qSize * 0) == 3.5);
+    assert (*(float *)(qcData + qSize * 1) == 1);
+    assert (*(float *)(q1Data + qSize * 2) == 2);
+    assert (*(float *)(qcData + qSize * 2) == 2);
+    assert (*(float *)(q1Data + qSize * 3) == 3);
+    assert (*(float *)(qcData + qSize * 3) == 3);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	float pi = *(float *)(pData + pSize * i);
+	float q1 = *(float *)(q1Data + qSize * i);
+	float qc = *(float *)(qcData + qSize * i);
+	float m1 = *(float *)(m1Data + qSize * i);
+	float mc = *(float *)(mcData + qSize * i);
+
+	assert (m1 == (pi > 1 ? q1 : -1));
+	assert (mc == (pi > 1 ? qc : -1));
+    }
+}
+
 void
 testLookup3D (Interpreter &interp)
 {
@@ -526,6 +594,7 @@ testVaryingLookup ()
 
 	testLookup1D (interp);
 	testLookupCubic1D (interp);
+	testUniformTableLookup1D (interp);
 	testLookup3D (interp);
 	testInterpolate1D (interp);
 	testInterpolateCubic1D (interp);
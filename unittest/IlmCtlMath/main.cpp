@@ -55,6 +55,11 @@
 
 #include <testGaussRec.h>
 #include <testAffineRec.h>
+#include <testBakedLut.h>
+#include <testLookupTable.h>
+#include <testPointTree.h>
+#include <testRbfGrid.h>
+#include <testSparseSolver.h>
 #include <iostream>
 #include <string.h>
 
@@ -67,8 +72,17 @@ main (int argc, char *argv[])
 
     TEST (testGaussRecSmall);
     TEST (testGaussRecLarge);
+    TEST (testGaussRecNearDuplicates);
     TEST (testAffineRecSmall);
     TEST (testAffineRecLarge);
+    TEST (testBakedLut1D);
+    TEST (testBakedLut3D);
+    TEST (testBakedLutShaper);
+    TEST (testLookupTable);
+    TEST (testPointTree);
+    TEST (testRbfGrid);
+    TEST (testRbfGridCache);
+    TEST (testSparseSolver);
 
     return 0;
 }
@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <cmath>
+#include <assert.h>
+#include <CtlBakedLut.h>
+#include <Iex.h>
+
+using namespace std;
+using namespace Ctl;
+
+namespace {
+
+class PowerSource: public LutSource
+{
+  public:
+
+    PowerSource (float power): _power (power) {}
+
+    virtual void
+    evaluate (size_t n, const float in[], float out[])
+    {
+	for (size_t i = 0; i < 3 * n; ++i)
+	    out[i] = pow (in[i], _power);
+    }
+
+  private:
+
+    float _power;
+};
+
+
+class Log2Source: public LutSource
+{
+  public:
+
+    virtual void
+    evaluate (size_t n, const float in[], float out[])
+    {
+	for (size_t i = 0; i < 3 * n; ++i)
+	    out[i] = log2 (in[i]);
+    }
+};
+
+
+//
+// Same affine transformation as in testAffineRec.cpp
+//
+
+class AffineSource: public LutSource
+{
+  public:
+
+    virtual void
+    evaluate (size_t n, const float in[], float out[])
+    {
+	for (size_t i = 0; i < n; ++i, in += 3, out += 3)
+	{
+	    out[0] = .8 * in[0] + .1 * in[1] - .1 * in[2] + .2;
+	    out[1] = .0 * in[0] + 1.1 * in[1] - .1 * in[2] + .3;
+	    out[2] = -.2 * in[0] - .1 * in[1] + .7 * in[2] - .1;
+	}
+    }
+};
+
+} // namespace
+
+
+void
+testBakedLut1D()
+{
+    cout << "Testing 1D baked lookup tables" << endl;
+
+    PowerSource power (2.2f);
+    BakedLut lut (BakedLut::LUT_1D, 1024);
+    lut.bake (power);
+    lut.validate (power, 10000);
+
+    assert (lut.maxError() < 1e-5);
+    assert (lut.meanError() <= lut.maxError());
+
+    //
+    // The table is exact at the grid points, that is, at
+    // the code values of a 10-bit image.
+    //
+
+    float in[3] = {0, 512.0f / 1023, 1};
+    float out[3];
+    lut.apply (1, in, 3, out, 3);
+
+    assert (out[0] == 0);
+    assert (fabs (out[1] - pow (in[1], 2.2f)) < 1e-6);
+    assert (out[2] == 1);
+
+    //
+    // A 1D table cannot represent a transform that mixes channels.
+    //
+
+    AffineSource affine;
+    lut.bake (affine);
+    lut.validate (affine, 10000);
+
+    assert (lut.maxError() > 0.01);
+
+    try
+    {
+	BakedLut bad (BakedLut::LUT_1D, 1);
+	assert (false);
+    }
+    catch (const Iex::ArgExc &e)
+    {
+	// expected
+    }
+
+    cout << "ok" << endl;
+}
+
+
+void
+testBakedLut3D()
+{
+    cout << "Testing 3D baked lookup tables" << endl;
+
+    //
+    // Trilinear interpolation reproduces affine transforms.
+    //
+
+    AffineSource affine;
+    BakedLut lut (BakedLut::LUT_3D, 17);
+    lut.bake (affine);
+    lut.validate (affine, 10000);
+
+    assert (lut.maxError() < 1e-5);
+
+    //
+    // Lookups in place.
+    //
+
+    float buf[6] = {0.25f, 0.5f, 0.75f, 1, 0, 0};
+    float exact[6];
+    affine.evaluate (2, buf, exact);
+    lut.apply (2, buf, 3, buf, 3);
+
+    for (int i = 0; i < 6; ++i)
+	assert (fabs (buf[i] - exact[i]) < 1e-5);
+
+    PowerSource power (2.2f);
+    lut.bake (power);
+    lut.validate (power, 10000);
+
+    assert (lut.maxError() < 1e-2);
+    assert (lut.maxError() > 0);
+
+    cout << "ok" << endl;
+}
+
+
+void
+testBakedLutShaper()
+{
+    cout << "Testing baked lookup tables with a log2 shaper" << endl;
+
+    Log2Source log2Source;
+    BakedLut lut (BakedLut::LUT_1D, 65, BakedLut::SHAPER_LOG2,
+		  1.0f / 256, 256);
+    lut.bake (log2Source);
+    lut.validate (log2Source, 10000, 7);
+
+    assert (lut.maxError() < 1e-4);
+
+    //
+    // Values outside the domain are clamped.
+    //
+
+    float in[3] = {0, 1024, 1};
+    float out[3];
+    lut.apply (1, in, 3, out, 3);
+
+    assert (fabs (out[0] + 8) < 1e-4);
+    assert (fabs (out[1] - 8) < 1e-4);
+    assert (fabs (out[2]) < 1e-4);
+
+    try
+    {
+	BakedLut bad (BakedLut::LUT_3D, 33, BakedLut::SHAPER_LOG2, 0, 1);
+	assert (false);
+    }
+    catch (const Iex::ArgExc &e)
+    {
+	// expected
+    }
+
+    cout << "ok" << endl;
+}
@@ -56,6 +56,8 @@
 #include <fstream>
 #include <iostream>
 #include <assert.h>
+#include <math.h>
+#include <algorithm>
 #include <CtlRbfInterpolator.h>
 #include <ImathVec.h>
 
@@ -148,3 +150,85 @@ testGaussRecLarge()
     cout << "ok" << endl;
 
 }
+
+void
+testGaussRecNearDuplicates()
+{
+    const int numSamples = 600;
+    cout << "Testing the reconstruction of a Gaussian function from "
+	    "samples that almost coincide." << endl;
+    cout << "With " << numSamples << " samples." << endl;
+
+    try
+    {
+	srand(113131);
+
+	//
+	// Every third sample is moved by 1e-5 from the one before it,
+	// and its value differs slightly.  No smooth function fits both,
+	// and the exact solution of the normal equations would have
+	// huge weights that overshoot between the samples.
+	//
+
+	typedef Imath::V3f V3fPair[2];
+	V3fPair *p = new V3fPair[numSamples];
+
+	for (int s = 0; s < numSamples; s++)
+	{
+	    for (int c = 0; c < 3; c++)
+	    {
+		if (s % 3 == 2)
+		{
+		    p[s][0][c] = p[s-1][0][c] + 1e-5f;
+		    p[s][1][c] = p[s-1][1][c] +
+				 0.01f * ((float) rand() / (float) RAND_MAX - .5f);
+		}
+		else
+		{
+		    p[s][0][c] = (float) rand() / (float) RAND_MAX;
+		    p[s][1][c] = exp(-p[s][0][c]*p[s][0][c]);
+		}
+	    }
+	}
+
+	Ctl::RbfInterpolator rbfItp(numSamples, p);
+
+	double maxErr = .0;
+
+	for (int s = 0; s < numSamples; s++)
+	{
+	    double err = (rbfItp.value(p[s][0]) - p[s][1]).length();
+
+	    if (err > maxErr)
+		maxErr = err;
+	}
+
+	double maxValue = .0;
+
+	for (int i = 0; i < 2000; i++)
+	{
+	    Imath::V3f x((float) rand() / (float) RAND_MAX,
+			 (float) rand() / (float) RAND_MAX,
+			 (float) rand() / (float) RAND_MAX);
+
+	    Imath::V3f v = rbfItp.value(x);
+
+	    for (int c = 0; c < 3; c++)
+		maxValue = max(maxValue, fabs(double(v[c])));
+	}
+
+	cout << "max. error " << maxErr << ", "
+		"max. value " << maxValue << endl;
+
+	assert (maxErr < 5E-3);
+	assert (maxValue < 20);
+
+	delete [] p;
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+    cout << "ok" << endl;
+}
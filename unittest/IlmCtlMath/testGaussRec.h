@@ -54,3 +54,4 @@
 
 void testGaussRecSmall();
 void testGaussRecLarge();
+void testGaussRecNearDuplicates();
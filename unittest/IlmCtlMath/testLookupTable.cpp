@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <CtlLookupTable.h>
+
+using namespace std;
+using namespace Ctl;
+
+namespace {
+
+float
+random01 ()
+{
+    return (float) rand() / (float) RAND_MAX;
+}
+
+
+bool
+sameBits (float a, float b)
+{
+    return memcmp (&a, &b, sizeof (float)) == 0;
+}
+
+
+void
+testBatch (int size, float pMin, float pMax, size_t n)
+{
+    //
+    // The batch lookups must return exactly what the
+    // single-sample lookups return, for every sample.
+    //
+
+    vector<float> table (size);
+
+    for (int i = 0; i < size; ++i)
+	table[i] = 10 * random01() - 5;
+
+    vector<float> p (n);
+    float lo = pMin < pMax ? pMin : pMax;
+    float hi = pMin < pMax ? pMax : pMin;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	switch (rand() % 8)
+	{
+	  case 0:
+	    p[i] = numeric_limits<float>::quiet_NaN();
+	    break;
+
+	  case 1:
+	    p[i] = (rand() % 2 ? 1 : -1) * numeric_limits<float>::infinity();
+	    break;
+
+	  case 2:
+	    p[i] = lo + (hi - lo) * (rand() % size) / (size > 1 ? size - 1 : 1);
+	    break;
+
+	  default:
+	    p[i] = lo - (hi - lo) * 0.25f + (hi - lo) * 1.5f * random01();
+	    break;
+	}
+    }
+
+    vector<float> q (n + 1, -1);
+    vector<float> qc (n + 1, -1);
+
+    lookup1D (&table[0], size, pMin, pMax, n, &p[0], &q[0]);
+    lookupCubic1D (&table[0], size, pMin, pMax, n, &p[0], &qc[0]);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	assert (sameBits (q[i], lookup1D (&table[0], size,
+					  pMin, pMax, p[i])));
+
+	assert (sameBits (qc[i], lookupCubic1D (&table[0], size,
+						pMin, pMax, p[i])));
+    }
+
+    assert (q[n] == -1 && qc[n] == -1);
+}
+
+} // namespace
+
+
+void
+testLookupTable ()
+{
+    cout << "Testing batch 1D table lookups" << endl;
+
+    srand (1);
+
+    static const int sizes[] = {1, 2, 3, 4, 17, 256, 5000};
+    static const size_t counts[] = {0, 1, 7, 8, 9, 100, 4096};
+
+    for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+    {
+	for (size_t j = 0; j < sizeof (counts) / sizeof (counts[0]); ++j)
+	{
+	    testBatch (sizes[i], 0, 1, counts[j]);
+	    testBatch (sizes[i], -3.5, 12.25, counts[j]);
+	    testBatch (sizes[i], 2, -2, counts[j]);
+	    testBatch (sizes[i], 1, 1, counts[j]);
+	}
+    }
+
+    cout << "ok\n" << endl;
+}
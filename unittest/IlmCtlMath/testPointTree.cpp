@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <assert.h>
+#include <CtlPointTree.h>
+#include <ImathVec.h>
+
+using namespace std;
+
+namespace {
+
+float
+random01 ()
+{
+    return (float) rand() / (float) RAND_MAX;
+}
+
+
+void
+runTestPointTree (size_t numPoints, size_t leafSize, bool clustered)
+{
+    vector <Imath::V3f> points (numPoints);
+
+    for (size_t i = 0; i < numPoints; i++)
+    {
+	points[i] = Imath::V3f (random01(), random01(), random01());
+
+	if (clustered && i % 2)
+	    points[i] = points[i] * 0.01f + Imath::V3f (0.5f, 0.25f, 0.75f);
+    }
+
+    Ctl::PointTree tree (&points[0], numPoints, leafSize);
+
+    const size_t numQueries = 200;
+    vector <Imath::V3f> queries (numQueries);
+
+    for (size_t q = 0; q < numQueries; q++)
+    {
+	if (q % 4 == 0)
+	    queries[q] = points[(q * 7919) % numPoints];
+	else
+	    queries[q] = Imath::V3f (random01(), random01(), random01()) *
+			 1.2f - Imath::V3f (0.1f);
+    }
+
+    const double radii[] = {0.0, 0.02, 0.1, 0.4, 2.0};
+
+    for (size_t r = 0; r < sizeof (radii) / sizeof (radii[0]); r++)
+    {
+	double radius = radii[r];
+	vector <size_t> offsets (numQueries + 1);
+	size_t total = tree.intersect (numQueries, &queries[0], radius,
+				       &offsets[0], 0, 0);
+
+	vector <size_t> batch (total + 1);
+	assert (tree.intersect (numQueries, &queries[0], radius,
+				&offsets[0], &batch[0], total) == total);
+
+	for (size_t q = 0; q < numQueries; q++)
+	{
+	    //
+	    // All three forms of intersect() find the same points,
+	    // in the same order, and exactly the points in the sphere.
+	    //
+
+	    vector <size_t> found;
+	    tree.intersect (queries[q], radius, found);
+
+	    vector <size_t> buffer (found.size() + 1);
+	    assert (tree.intersect (queries[q], radius, &buffer[0],
+				    buffer.size()) == found.size());
+	    assert (equal (found.begin(), found.end(), buffer.begin()));
+
+	    assert (offsets[q + 1] - offsets[q] == found.size());
+	    assert (equal (found.begin(), found.end(),
+			   batch.begin() + offsets[q]));
+
+	    vector <size_t> expected;
+
+	    for (size_t i = 0; i < numPoints; i++)
+	    {
+		Imath::V3f vec = points[i] - queries[q];
+
+		if (vec.dot (vec) < radius * radius)
+		    expected.push_back (i);
+	    }
+
+	    sort (found.begin(), found.end());
+	    assert (found == expected);
+	}
+    }
+
+    const size_t counts[] = {1, 4, 17};
+
+    for (size_t c = 0; c < sizeof (counts) / sizeof (counts[0]); c++)
+    {
+	size_t k = counts[c];
+	vector <size_t> batch (numQueries * k);
+	tree.nearestPoints (numQueries, &queries[0], k, &batch[0]);
+
+	for (size_t q = 0; q < numQueries; q++)
+	{
+	    vector <size_t> found;
+	    tree.nearestPoints (queries[q], k, found);
+	    assert (found.size() == min (k, numPoints));
+	    assert (equal (found.begin(), found.end(), batch.begin() + q * k));
+
+	    //
+	    // No point that was not found is closer than the
+	    // farthest point found.
+	    //
+
+	    float farthest = 0;
+
+	    for (size_t i = 0; i < found.size(); i++)
+		farthest = max (farthest, (points[found[i]] - queries[q]).length2());
+
+	    sort (found.begin(), found.end());
+
+	    for (size_t i = 0; i < numPoints; i++)
+	    {
+		if (!binary_search (found.begin(), found.end(), i))
+		    assert ((points[i] - queries[q]).length2() >= farthest);
+	    }
+	}
+    }
+}
+
+} // namespace
+
+
+void
+testPointTree ()
+{
+    cout << "Testing point tree queries." << endl;
+    srand (2718);
+
+    try
+    {
+	runTestPointTree (1, 8, false);
+	runTestPointTree (7, 8, false);
+	runTestPointTree (1000, 8, false);
+	runTestPointTree (1000, 1, true);
+	runTestPointTree (3000, 32, true);
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok" << endl;
+}
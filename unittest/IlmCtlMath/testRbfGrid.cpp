@@ -0,0 +1,304 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <CtlRbfInterpolator.h>
+#include <CtlRbfGridCache.h>
+#include <IlmThreadPool.h>
+#include <ImathVec.h>
+
+using namespace std;
+
+namespace {
+
+void
+runTestRbfGrid (int numSamples, const Imath::V3i &gridSize)
+{
+    srand (424242);
+
+    typedef Imath::V3f V3fPair[2];
+    V3fPair *p = new V3fPair[numSamples];
+
+    for (int s = 0; s < numSamples; s++)
+    {
+	for (int c = 0; c < 3; c++)
+	{
+	    p[s][0][c] = (float) rand() / (float) RAND_MAX;
+	    p[s][1][c] = p[s][0][c] * p[s][0][c];
+	}
+    }
+
+    Ctl::RbfInterpolator rbfItp (numSamples, p);
+
+    Imath::V3f pMin (-0.1, 0.0, 0.05);
+    Imath::V3f pMax (1.1, 1.0, 0.95);
+    size_t numNodes = size_t (gridSize.x) * gridSize.y * gridSize.z;
+
+    //
+    // The grid computed one node at a time with value().
+    //
+
+    Imath::V3f *expected = new Imath::V3f[numNodes];
+    float s, t;
+    Imath::V3f x;
+
+    for (int i = 0; i < gridSize.x; ++i)
+    {
+	s = float (i) / float (gridSize.x - 1);
+	t = 1 - s;
+	x.x = pMin.x * t + pMax.x * s;
+
+	for (int j = 0; j < gridSize.y; ++j)
+	{
+	    s = float (j) / float (gridSize.y - 1);
+	    t = 1 - s;
+	    x.y = pMin.y * t + pMax.y * s;
+
+	    for (int k = 0; k < gridSize.z; ++k)
+	    {
+		s = float (k) / float (gridSize.z - 1);
+		t = 1 - s;
+		x.z = pMin.z * t + pMax.z * s;
+
+		expected[(i * gridSize.y + j) * gridSize.z + k] =
+		    rbfItp.value (x);
+	    }
+	}
+    }
+
+    //
+    // valueGrid() must return exactly the same values,
+    // whatever the number of threads.
+    //
+
+    IlmThread::ThreadPool &pool = IlmThread::ThreadPool::globalThreadPool();
+    int numThreads = pool.numThreads();
+    static const int threads[] = {0, 1, 2, 5};
+    Imath::V3f *grid = new Imath::V3f[numNodes];
+
+    for (size_t n = 0; n < sizeof (threads) / sizeof (threads[0]); n++)
+    {
+	cout << "    " << threads[n] << " threads" << endl;
+	pool.setNumThreads (threads[n]);
+	std::fill (grid, grid + numNodes, Imath::V3f (0));
+	rbfItp.valueGrid (pMin, pMax, gridSize, grid);
+	assert (!memcmp (grid, expected, numNodes * sizeof (Imath::V3f)));
+    }
+
+    pool.setNumThreads (numThreads);
+
+    delete [] grid;
+    delete [] expected;
+    delete [] p;
+}
+
+} // namespace
+
+
+void
+testRbfGrid ()
+{
+    cout << "Testing the evaluation of an RBF interpolator on a grid." << endl;
+
+    try
+    {
+	cout << "  5x4x3 grid, 50 samples" << endl;
+	runTestRbfGrid (50, Imath::V3i (5, 4, 3));
+	cout << "  17x19x21 grid, 500 samples" << endl;
+	runTestRbfGrid (500, Imath::V3i (17, 19, 21));
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok" << endl;
+}
+
+
+namespace {
+
+void
+checkStats (size_t memoryHits, size_t diskHits, size_t misses)
+{
+    Ctl::RbfGridCache::Stats stats = Ctl::RbfGridCache::stats();
+    assert (stats.memoryHits == memoryHits);
+    assert (stats.diskHits == diskHits);
+    assert (stats.misses == misses);
+}
+
+} // namespace
+
+
+void
+testRbfGridCache ()
+{
+    cout << "Testing the cache of RBF interpolator grids." << endl;
+
+    const int numSamples = 200;
+    typedef Imath::V3f V3fPair[2];
+    V3fPair *p = new V3fPair[numSamples];
+
+    srand (5150);
+
+    for (int s = 0; s < numSamples; s++)
+    {
+	for (int c = 0; c < 3; c++)
+	{
+	    p[s][0][c] = (float) rand() / (float) RAND_MAX;
+	    p[s][1][c] = 1 - p[s][0][c];
+	}
+    }
+
+    Imath::V3f pMin (0, 0, 0);
+    Imath::V3f pMax (1, 1, 1);
+    Imath::V3i gridSize (9, 10, 11);
+    size_t numNodes = size_t (gridSize.x) * gridSize.y * gridSize.z;
+    size_t gridBytes = numNodes * sizeof (Imath::V3f);
+
+    Imath::V3f *expected = new Imath::V3f[numNodes];
+    Imath::V3f *grid = new Imath::V3f[numNodes];
+    Ctl::RbfInterpolator (numSamples, p).valueGrid (pMin, pMax, gridSize, expected);
+
+    char dir[] = "/tmp/ctlGridCacheXXXXXX";
+    assert (mkdtemp (dir) != 0);
+
+    Ctl::RbfGridCache::setDirectory ("");
+    Ctl::RbfGridCache::clear();
+    Ctl::RbfGridCache::resetStats();
+
+    cout << "  in memory" << endl;
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    assert (!memcmp (grid, expected, gridBytes));
+    checkStats (0, 0, 1);
+
+    std::fill (grid, grid + numNodes, Imath::V3f (0));
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    assert (!memcmp (grid, expected, gridBytes));
+    checkStats (1, 0, 1);
+
+    //
+    // Different data or a different grid are not hits.
+    //
+
+    p[7][1][2] += 0.25;
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    checkStats (1, 0, 2);
+    p[7][1][2] -= 0.25;
+
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, Imath::V3f (1, 1, 2),
+				  gridSize, grid);
+    checkStats (1, 0, 3);
+
+    cout << "  in files" << endl;
+    Ctl::RbfGridCache::setDirectory (dir);
+    Ctl::RbfGridCache::clear();
+    Ctl::RbfGridCache::resetStats();
+
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    checkStats (0, 0, 1);
+
+    Ctl::RbfGridCache::clear();
+    std::fill (grid, grid + numNodes, Imath::V3f (0));
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    assert (!memcmp (grid, expected, gridBytes));
+    checkStats (0, 1, 1);
+
+    //
+    // Damaged files are ignored (and replaced).
+    //
+
+    string command = string ("for f in ") + dir + "/*; do "
+		     "dd if=/dev/zero of=$f bs=1 count=8 seek=40 "
+		     "conv=notrunc 2>/dev/null; done";
+    assert (system (command.c_str()) == 0);
+
+    Ctl::RbfGridCache::clear();
+    std::fill (grid, grid + numNodes, Imath::V3f (0));
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    assert (!memcmp (grid, expected, gridBytes));
+    checkStats (0, 1, 2);
+
+    Ctl::RbfGridCache::clear();
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    checkStats (0, 2, 2);
+
+    //
+    // Grids that do not fit in memory are still saved.
+    //
+
+    cout << "  memory limit" << endl;
+    size_t maxMemory = Ctl::RbfGridCache::maxMemory();
+    Ctl::RbfGridCache::setMaxMemory (gridBytes / 2);
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    Ctl::RbfGridCache::valueGrid (numSamples, p, pMin, pMax, gridSize, grid);
+    checkStats (0, 4, 2);
+    Ctl::RbfGridCache::setMaxMemory (maxMemory);
+
+    Ctl::RbfGridCache::setDirectory ("");
+    Ctl::RbfGridCache::clear();
+    assert (system ((string ("rm -rf ") + dir).c_str()) == 0);
+
+    delete [] grid;
+    delete [] expected;
+    delete [] p;
+
+    cout << "ok" << endl;
+}
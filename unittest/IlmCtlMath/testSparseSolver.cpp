@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <CtlSparseMatrix.h>
+#include <CtlLinearSolver.h>
+#include <CtlSparseLDLT.h>
+#include <IlmThreadPool.h>
+
+using namespace std;
+using namespace Ctl;
+
+namespace {
+
+double
+random01 ()
+{
+    return (double) rand() / (double) RAND_MAX;
+}
+
+
+//
+// A random m x n matrix with about perRow elements in each row,
+// whose sizes vary over a few orders of magnitude from column to
+// column, and a diagonally dominant block that keeps it well posed.
+//
+
+CRSOperator<double>
+randomMatrix (size_t m, size_t n, size_t perRow)
+{
+    vector <double> columnScale (n);
+
+    for (size_t c = 0; c < n; c++)
+	columnScale[c] = pow (10.0, 3 * random01() - 1);
+
+    vector <double> val;
+    vector <size_t> colInd;
+    vector <size_t> rowPtr (1, 0);
+
+    for (size_t r = 0; r < m; r++)
+    {
+	vector <size_t> cols;
+	cols.push_back (r % n);
+
+	for (size_t i = 1; i < perRow; i++)
+	    cols.push_back (rand() % n);
+
+	sort (cols.begin(), cols.end());
+	cols.erase (unique (cols.begin(), cols.end()), cols.end());
+
+	for (size_t i = 0; i < cols.size(); i++)
+	{
+	    double v = (cols[i] == r % n)? 4.0: random01() - 0.5;
+	    val.push_back (v * columnScale[cols[i]]);
+	    colInd.push_back (cols[i]);
+	}
+
+	rowPtr.push_back (val.size());
+    }
+
+    return CRSOperator<double> (val, colInd, rowPtr, n);
+}
+
+
+void
+testApply (const CRSOperator<double> &A, IlmThread::ThreadPool *pool)
+{
+    //
+    // Applying the matrix to interleaved vectors, serially or in
+    // parallel, gives exactly the results of applying it to each
+    // vector alone, and so does applying the transposed matrix
+    // instead of applyT().
+    //
+
+    CRSOperator<double> At = A.transpose();
+    assert (At.numRows() == A.numColumns());
+    assert (At.numColumns() == A.numRows());
+
+    size_t m = A.numRows();
+    size_t n = A.numColumns();
+
+    for (size_t k = 1; k <= 6; k++)
+    {
+	vector <double> x (n * k), y (m * k), yt (n * k), yt2 (n * k);
+	vector <double> xm (m * k);
+
+	for (size_t i = 0; i < x.size(); i++)
+	    x[i] = random01() - 0.5;
+
+	for (size_t i = 0; i < xm.size(); i++)
+	    xm[i] = random01() - 0.5;
+
+	CRSOperator<double> B (A);
+	B.threadPool = pool;
+	B.apply (k, x.begin(), x.end(), y.begin(), y.end());
+	B.applyT (k, xm.begin(), xm.end(), yt.begin(), yt.end());
+
+	At.threadPool = pool;
+	At.apply (k, xm.begin(), xm.end(), yt2.begin(), yt2.end());
+	assert (yt == yt2);
+
+	for (size_t j = 0; j < k; j++)
+	{
+	    vector <double> xj (n), yj (m), xmj (m), ytj (n);
+
+	    for (size_t i = 0; i < n; i++)
+		xj[i] = x[i * k + j];
+
+	    for (size_t i = 0; i < m; i++)
+		xmj[i] = xm[i * k + j];
+
+	    A.apply (xj.begin(), xj.end(), yj.begin(), yj.end());
+	    A.applyT (xmj.begin(), xmj.end(), ytj.begin(), ytj.end());
+
+	    for (size_t i = 0; i < m; i++)
+		assert (y[i * k + j] == yj[i]);
+
+	    for (size_t i = 0; i < n; i++)
+		assert (yt[i * k + j] == ytj[i]);
+	}
+    }
+}
+
+
+template <class Solver>
+void
+testSolve (const Solver &lss, const CRSOperator<double> &A)
+{
+    //
+    // Solving for three right-hand sides at once gives
+    // exactly the solutions of three separate solves.
+    //
+
+    size_t m = A.numRows();
+    size_t n = A.numColumns();
+    const size_t k = 3;
+
+    vector <double> truth (n * k), b (m * k);
+
+    for (size_t i = 0; i < truth.size(); i++)
+	truth[i] = random01() - 0.5;
+
+    A.apply (k, truth.begin(), truth.end(), b.begin(), b.end());
+
+    vector <double> x (n * k, 0.0);
+    lss (k, b.begin(), b.end(), x.begin(), x.end());
+
+    for (size_t j = 0; j < k; j++)
+    {
+	vector <double> bj (m), xj (n, 0.0);
+
+	for (size_t i = 0; i < m; i++)
+	    bj[i] = b[i * k + j];
+
+	lss (bj.begin(), bj.end(), xj.begin(), xj.end());
+
+	for (size_t i = 0; i < n; i++)
+	{
+	    assert (x[i * k + j] == xj[i]);
+	    assert (fabs (xj[i] - truth[i * k + j]) < 1e-5);
+	}
+    }
+}
+
+} // namespace
+
+
+void
+testSparseSolver ()
+{
+    cout << "Testing sparse matrices and solvers." << endl;
+    srand (1414);
+
+    try
+    {
+	IlmThread::ThreadPool pool (4);
+
+	cout << "  matrix products" << endl;
+	testApply (randomMatrix (50, 20, 4), 0);
+	testApply (randomMatrix (3000, 1000, 16), 0);
+	testApply (randomMatrix (3000, 1000, 16), &pool);
+
+	cout << "  conjugate gradients" << endl;
+	CRSOperator<double> A = randomMatrix (1200, 400, 16);
+	A.threadPool = &pool;
+
+	LSSCG<double, CRSOperator<double> > lss (A);
+	lss.solver.maxNumIterations = 10000;
+	lss.solver.tolerance = 1e-7;
+	testSolve (lss, A);
+
+	cout << "  jacobi preconditioning" << endl;
+	vector <double> diag (A.numColumns());
+	A.normalDiagonal (diag.begin(), diag.end());
+	JacobiPreconditioner<double> jacobi (diag.begin(), diag.end());
+
+	LSSCG<double, CRSOperator<double>, JacobiPreconditioner<double> >
+	    lssp (A, &jacobi);
+	lssp.solver.maxNumIterations = 10000;
+	lssp.solver.tolerance = 1e-24;
+	testSolve (lssp, A);
+
+	cout << "  direct factorization" << endl;
+	LSSLDLT<double> lssd (A);
+	testSolve (lssd, A);
+
+	//
+	// A' A, formed explicitly, is the matrix that LSSLDLT factors.
+	//
+
+	CRSOperator<double> N = A.transpose().product (A);
+	SparseLDLT<double> ldlt (N);
+	assert (ldlt.numFactorNonzeros() == lssd.solver.numFactorNonzeros());
+
+	vector <double> x (N.numRows()), b (N.numRows()), y (N.numRows());
+
+	for (size_t i = 0; i < x.size(); i++)
+	    x[i] = random01() - 0.5;
+
+	N.apply (x.begin(), x.end(), b.begin(), b.end());
+	ldlt (b.begin(), b.end(), y.begin(), y.end());
+
+	for (size_t i = 0; i < x.size(); i++)
+	    assert (fabs (x[i] - y[i]) < 1e-8);
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+
+    cout << "ok" << endl;
+}
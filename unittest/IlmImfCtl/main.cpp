@@ -55,6 +55,8 @@
 
 #include <testSourceDestination.h>
 #include <testTypes.h>
+#include <testConversion.h>
+#include <testInPlace.h>
 
 #include <stdlib.h>
 #include <iostream>
@@ -70,5 +72,7 @@ main (int argc, char *argv[])
 
     TEST (testTypes);
     TEST (testSourceDestination);
+    TEST (testConversion);
+    TEST (testInPlace);
     return 0;
 }
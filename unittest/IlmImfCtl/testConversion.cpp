@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+
+#include <ImfCtlApplyTransforms.h>
+#include <CtlSimdInterpreter.h>
+#include <ImfHeader.h>
+#include <ImfFrameBuffer.h>
+#include <ImfArray.h>
+#include <ImfThreading.h>
+#include <ImathRandom.h>
+#include <iostream>
+#include <exception>
+#include <cassert>
+
+using namespace Ctl;
+using namespace Imf;
+using namespace ImfCtl;
+using namespace Imath;
+using namespace std;
+
+namespace {
+
+void
+runTest (Interpreter &interp, int numThreads)
+{
+    cout << "\tnumber of threads = " << numThreads << endl;
+
+    setGlobalThreadCount (numThreads);
+
+    Rand48 rand (numThreads);
+
+    StringList transformNames;
+    transformNames.push_back ("function4");
+
+    Header inHeader;
+    Header envHeader;
+    Header outHeader;
+
+    //
+    // Create inFb and outFb.  The input channels are interleaved,
+    // and the slice types differ from the types of the CTL function
+    // arguments, so that the samples are converted between half and
+    // float as they are copied.
+    //
+
+    Box2i tw (V2i (1110, -80), V2i (1200, 100));
+
+    size_t twWidth  = (tw.max.x - tw.min.x + 1);
+    size_t twHeight = (tw.max.y - tw.min.y + 1);
+    size_t nPixels  = twWidth * twHeight;
+    size_t baseOffset = tw.min.y * twWidth + tw.min.x;
+
+    Array <half> rgba1 (nPixels * 4);
+    Array <float> gb1 (nPixels * 2);
+
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+	rgba1[i * 4 + 0] = rand.nextf (-100, 100);
+	rgba1[i * 4 + 1] = 0;
+	rgba1[i * 4 + 2] = 0;
+	rgba1[i * 4 + 3] = 1;
+	gb1[i * 2 + 0] = rand.nextf (-100, 100);
+	gb1[i * 2 + 1] = rand.nextf (-100, 100);
+    }
+
+    FrameBuffer inFb;
+
+    inFb.insert
+	("r1", Slice (HALF,
+		      (char *)&rgba1[0] - baseOffset * 4 * sizeof (half),
+		      4 * sizeof (half),
+		      twWidth * 4 * sizeof (half)));
+
+    inFb.insert
+	("g1", Slice (Imf::FLOAT,
+		      (char *)&gb1[0] - baseOffset * 2 * sizeof (float),
+		      2 * sizeof (float),
+		      twWidth * 2 * sizeof (float)));
+
+    inFb.insert
+	("b1", Slice (Imf::FLOAT,
+		      (char *)&gb1[1] - baseOffset * 2 * sizeof (float),
+		      2 * sizeof (float),
+		      twWidth * 2 * sizeof (float)));
+
+    Array <half> r2 (nPixels);
+    Array <float> gb2 (nPixels * 2);
+
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+	r2[i] = 0;
+	gb2[i * 2 + 0] = 0;
+	gb2[i * 2 + 1] = 0;
+    }
+
+    FrameBuffer outFb;
+
+    outFb.insert
+	("r2", Slice (HALF,
+		      (char *)&r2[0] - baseOffset * sizeof (half),
+		      sizeof (half),
+		      twWidth * sizeof (half)));
+
+    outFb.insert
+	("g2", Slice (Imf::FLOAT,
+		      (char *)&gb2[0] - baseOffset * 2 * sizeof (float),
+		      2 * sizeof (float),
+		      twWidth * 2 * sizeof (float)));
+
+    outFb.insert
+	("b2", Slice (Imf::FLOAT,
+		      (char *)&gb2[1] - baseOffset * 2 * sizeof (float),
+		      2 * sizeof (float),
+		      twWidth * 2 * sizeof (float)));
+
+    //
+    // Call functions
+    //
+
+    applyTransforms (interp,
+		     transformNames,
+		     tw,
+		     envHeader,
+		     inHeader,
+		     inFb,
+		     outHeader,
+		     outFb);
+
+    //
+    // Check data in outFb.  Float to half conversions round
+    // to the nearest half, exactly like half (float).
+    //
+
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+	assert (r2[i].bits() == half (float (rgba1[i * 4]) * 3).bits());
+	assert (gb2[i * 2 + 0] == float (half (gb1[i * 2 + 0])));
+	assert (gb2[i * 2 + 1] == gb1[i * 2 + 1]);
+    }
+}
+
+
+} // namespace
+
+
+void
+testConversion ()
+{
+    try
+    {
+	cout << "Testing conversion between half and float" << endl;
+
+	SimdInterpreter interp;
+	runTest (interp, 0);
+	runTest (interp, 2);
+
+	cout << "ok\n" << endl;
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+}
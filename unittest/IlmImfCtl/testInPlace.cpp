@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+
+
+#include <ImfCtlApplyTransforms.h>
+#include <CtlSimdInterpreter.h>
+#include <ImfHeader.h>
+#include <ImfFrameBuffer.h>
+#include <ImfArray.h>
+#include <ImfThreading.h>
+#include <ImathRandom.h>
+#include <iostream>
+#include <exception>
+#include <cassert>
+
+using namespace Ctl;
+using namespace Imf;
+using namespace ImfCtl;
+using namespace Imath;
+using namespace std;
+
+namespace {
+
+void
+runTest (Interpreter &interp, int numThreads)
+{
+    cout << "\tnumber of threads = " << numThreads << endl;
+
+    setGlobalThreadCount (numThreads);
+
+    Rand48 rand (numThreads);
+
+    StringList transformNames;
+    transformNames.push_back ("function5");
+
+    Header inHeader;
+    Header envHeader;
+    Header outHeader;
+
+    //
+    // Create a frame buffer with planar slices r, g and b, and
+    // pass it as both inFb and outFb.  function5 rotates the
+    // channels, so every output slice is also an input slice
+    // that the function has not finished reading when it
+    // starts writing the output.  The rows are wide enough for
+    // some of the groups of samples that applyTransforms() passes
+    // to the function to lie within a single row, where the
+    // slices could be used in place.
+    //
+
+    Box2i tw (V2i (-100, 7), V2i (4899, 9));
+
+    size_t twWidth  = (tw.max.x - tw.min.x + 1);
+    size_t twHeight = (tw.max.y - tw.min.y + 1);
+    size_t nPixels  = twWidth * twHeight;
+    size_t baseOffset = tw.min.y * twWidth + tw.min.x;
+
+    Array <float> r (nPixels);
+    Array <float> g (nPixels);
+    Array <half> b (nPixels);
+
+    Array <float> r0 (nPixels);
+    Array <float> g0 (nPixels);
+    Array <half> b0 (nPixels);
+
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+	r[i] = r0[i] = half (rand.nextf (-100, 100));
+	g[i] = g0[i] = rand.nextf (-100, 100);
+	b[i] = b0[i] = rand.nextf (-100, 100);
+    }
+
+    FrameBuffer fb;
+
+    fb.insert
+	("r", Slice (Imf::FLOAT,
+		     (char *)&r[0] - baseOffset * sizeof (float),
+		     sizeof (float),
+		     twWidth * sizeof (float)));
+
+    fb.insert
+	("g", Slice (Imf::FLOAT,
+		     (char *)&g[0] - baseOffset * sizeof (float),
+		     sizeof (float),
+		     twWidth * sizeof (float)));
+
+    fb.insert
+	("b", Slice (HALF,
+		     (char *)&b[0] - baseOffset * sizeof (half),
+		     sizeof (half),
+		     twWidth * sizeof (half)));
+
+    //
+    // Call functions
+    //
+
+    applyTransforms (interp,
+		     transformNames,
+		     tw,
+		     envHeader,
+		     inHeader,
+		     fb,
+		     outHeader,
+		     fb);
+
+    //
+    // Check data in fb.  The r values are representable as
+    // halfs, so all three channels must match exactly.
+    //
+
+    for (size_t i = 0; i < nPixels; ++i)
+    {
+	assert (r[i] == g0[i]);
+	assert (g[i] == float (b0[i]));
+	assert (b[i].bits() == half (r0[i]).bits());
+    }
+}
+
+
+} // namespace
+
+
+void
+testInPlace ()
+{
+    try
+    {
+	cout << "Testing in-place transforms with planar slices" << endl;
+
+	SimdInterpreter interp;
+	runTest (interp, 0);
+	runTest (interp, 2);
+
+	cout << "ok\n" << endl;
+    }
+    catch (const std::exception &e)
+    {
+	cerr << "ERROR -- caught exception: " << e.what() << endl;
+	assert (false);
+    }
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+//
+// Throughput of the packed DPX kernels for each supported instruction
+// set, in GB/s of file data. Not run as part of the tests:
+//
+//     dpx_pack_bench [width [height [passes]]]
+//
+
+#include <dpx_pack.hh>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace std;
+using namespace ctl::dpxi;
+
+namespace {
+
+double
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+} // namespace
+
+
+int
+main (int argc, char *argv[])
+{
+    uint64_t width = argc > 1? strtoul (argv[1], 0, 10): 4096;
+    uint64_t height = argc > 2? strtoul (argv[2], 0, 10): 2160;
+    int passes = argc > 3? atoi (argv[3]): 5;
+    uint64_t samples = width * 3;
+
+    cout << width << "x" << height << " RGB, " << passes << " passes" << endl;
+
+    vector<uint16_t> pixels (samples * height);
+    for (size_t i = 0; i < pixels.size(); ++i)
+	pixels[i] = (i * 2654435761u) >> 20;
+
+    for (int l = packed_none + 1; l < packed_layout_count; ++l)
+    {
+	packed_layout_e layout = (packed_layout_e) l;
+	uint64_t rowBytes = packed_row_bytes (layout, samples);
+	vector<uint8_t> raw (rowBytes * height);
+	double gb = double (raw.size()) * passes / 1e9;
+
+	for (int swap = 0; swap < 2; ++swap)
+	{
+	    for (int isa = 0; isa <= pack_isa_supported(); ++isa)
+	    {
+		const pack_kernels &k = kernels_for_isa ((pack_isa_e) isa);
+		double start = now();
+
+		for (int p = 0; p < passes; ++p)
+		    for (uint64_t y = 0; y < height; ++y)
+			k.pack[layout] (&raw[y * rowBytes],
+					&pixels[y * samples], samples, swap);
+
+		double packTime = now() - start;
+		start = now();
+
+		for (int p = 0; p < passes; ++p)
+		    for (uint64_t y = 0; y < height; ++y)
+			k.unpack[layout] (&pixels[y * samples],
+					  &raw[y * rowBytes], samples, swap);
+
+		double unpackTime = now() - start;
+
+		cout << setw (16) << left << packed_layout_name (layout)
+		     << setw (8) << (swap? "swap": "native")
+		     << setw (8) << pack_isa_name ((pack_isa_e) isa)
+		     << fixed << setprecision (2) << right
+		     << "  unpack " << setw (7) << gb / unpackTime << " GB/s"
+		     << "  pack " << setw (7) << gb / packTime << " GB/s"
+		     << endl;
+	    }
+	}
+    }
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <assert.h>
+#include <string.h>
+#include <dpx.hh>
+
+using namespace std;
+using namespace ctl;
+
+namespace {
+
+const float64_t scales[] = {0.0, 1.0, 1023.0, 0.37};
+const size_t numScales = sizeof (scales) / sizeof (scales[0]);
+
+//
+// The per-sample conversion functions are the reference the vectorised
+// and table driven versions have to match bit for bit.
+//
+
+template <class O, class I>
+void
+reference (O *out, uint8_t osb, const I *in, uint8_t isb,
+	   float64_t scale, uint64_t count)
+{
+    dpxi::convert_fn fn = dpxi::find_convert_fn<O, I> (osb, isb, scale);
+
+    for (uint64_t i = 0; i < count; ++i)
+	fn (out + i, osb, in + i, isb, scale);
+}
+
+
+vector<float32_t>
+testFloats ()
+{
+    vector<float32_t> v;
+
+    //
+    // Everything from a bit below 0 to a bit above 1 in small steps,
+    // the exact halfway points between code values, and the odd
+    // values.
+    //
+
+    for (int i = -1000; i <= 70000; ++i)
+	v.push_back (i / 65536.0f);
+
+    for (int bits = 8; bits <= 16; ++bits)
+    {
+	float32_t max = (1 << bits) - 1;
+
+	for (int i = 0; i < (1 << bits); ++i)
+	{
+	    v.push_back ((i + 0.5f) / max);
+	    v.push_back (i + 0.5f);
+	    v.push_back (float32_t (i));
+	}
+    }
+
+    v.push_back (numeric_limits<float32_t>::quiet_NaN());
+    v.push_back (numeric_limits<float32_t>::infinity());
+    v.push_back (-numeric_limits<float32_t>::infinity());
+    v.push_back (-0.0f);
+    v.push_back (1e30f);
+    v.push_back (-1e30f);
+    v.push_back (numeric_limits<float32_t>::denorm_min());
+
+    //
+    // An odd length, so the scalar tails are used as well.
+    //
+
+    v.push_back (0.5f);
+    return v;
+}
+
+} // namespace
+
+
+void
+testConvertToInt()
+{
+    cout << "Testing float to integer sample conversions" << endl;
+
+    vector<float32_t> in = testFloats();
+    uint64_t n = in.size();
+
+    for (size_t s = 0; s < numScales; ++s)
+    {
+	for (int osb = 1; osb <= 16; ++osb)
+	{
+	    vector<uint16_t> a (n), b (n);
+	    reference (&a[0], osb, &in[0], 32, scales[s], n);
+	    dpxi::convert (&b[0], osb, &in[0], 32, scales[s], n);
+	    assert (a == b);
+
+	    if (osb > 8)
+		continue;
+
+	    vector<uint8_t> c (n), d (n);
+	    reference (&c[0], osb, &in[0], 32, scales[s], n);
+	    dpxi::convert (&d[0], osb, &in[0], 32, scales[s], n);
+	    assert (c == d);
+	}
+    }
+
+    cout << "ok" << endl;
+}
+
+
+void
+testConvertToFloat()
+{
+    cout << "Testing integer to float sample conversions" << endl;
+
+    vector<uint16_t> in16 (65536 + 7);
+    for (size_t i = 0; i < in16.size(); ++i)
+	in16[i] = i * 40503u;
+
+    vector<uint8_t> in8 (256 + 5);
+    for (size_t i = 0; i < in8.size(); ++i)
+	in8[i] = i * 151u;
+
+    for (size_t s = 0; s < numScales; ++s)
+    {
+	for (int isb = 1; isb <= 16; ++isb)
+	{
+	    uint64_t n = in16.size();
+	    vector<float32_t> a (n), b (n);
+	    reference (&a[0], 32, &in16[0], isb, scales[s], n);
+	    dpxi::convert (&b[0], 32, &in16[0], isb, scales[s], n);
+	    assert (!memcmp (&a[0], &b[0], n * sizeof (float32_t)));
+
+	    if (isb > 8)
+		continue;
+
+	    n = in8.size();
+	    vector<float32_t> c (n), d (n);
+	    reference (&c[0], 32, &in8[0], isb, scales[s], n);
+	    dpxi::convert (&d[0], 32, &in8[0], isb, scales[s], n);
+	    assert (!memcmp (&c[0], &d[0], n * sizeof (float32_t)));
+	}
+    }
+
+    cout << "ok" << endl;
+}
+
+
+void
+testConvertLutCache()
+{
+    cout << "Testing cached conversion lookup tables" << endl;
+
+    //
+    // 16 bit to double conversions go through a lookup table; the same
+    // conversion gets the same table, a different one does not.
+    //
+
+    const void *tag = &dpxi::lut_tag<float64_t, uint16_t>::tag;
+    const void *a = dpxi::cached_lut (tag, 64, 10, 0.0,
+				      dpxi::new_lut<float64_t, uint16_t>);
+    const void *b = dpxi::cached_lut (tag, 64, 10, 0.0,
+				      dpxi::new_lut<float64_t, uint16_t>);
+    const void *c = dpxi::cached_lut (tag, 64, 12, 0.0,
+				      dpxi::new_lut<float64_t, uint16_t>);
+    assert (a != 0 && a == b && a != c);
+
+    vector<uint16_t> in (4096);
+    for (size_t i = 0; i < in.size(); ++i)
+	in[i] = i;
+
+    vector<float64_t> x (in.size()), y (in.size());
+    reference (&x[0], 64, &in[0], 12, 0.0, in.size());
+    dpxi::convert (&y[0], 64, &in[0], 12, 0.0, in.size());
+    assert (x == y);
+    assert (y[4095] == 1.0);
+
+    cout << "ok" << endl;
+}
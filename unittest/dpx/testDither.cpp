@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <assert.h>
+#include <math.h>
+#include <dpx.hh>
+
+using namespace std;
+using namespace ctl;
+
+namespace {
+
+const float64_t scales[] = {0.0, 1.0, 1023.0, 0.37};
+const size_t numScales = sizeof (scales) / sizeof (scales[0]);
+
+const dpx::dither_e modes[] = {dpx::ordered_dither, dpx::blue_noise_dither};
+const size_t numModes = sizeof (modes) / sizeof (modes[0]);
+
+//
+// One sample done the slow way: scaled like dpx::convert(), the
+// threshold of the mask cell added, clamped and rounded.
+//
+
+uint16_t
+reference (float32_t in, uint8_t osb, float64_t scale,
+	   dpx::dither_e mode, uint32_t x, uint32_t y)
+{
+    uint32_t size;
+    const float64_t *mask = dpxi::dither_mask (mode, &size);
+    float64_t max = (1 << osb) - 1;
+    float64_t d = in;
+
+    if (scale == 0.0)
+	d = d * max;
+    else if (scale != 1.0)
+	d = float32_t (d * scale);
+
+    d = d + mask[(y % size) * size + x % size];
+
+    if (!(d >= 0.0))
+	return 0;
+
+    if (d > max)
+	d = max;
+
+    return uint16_t (lrint (d));
+}
+
+
+vector<float32_t>
+testRow (uint32_t n, float64_t scale)
+{
+    float32_t max = scale == 0.0 ? 1.0f : 65535.0f / (scale == 1.0 ? 1 : scale);
+    vector<float32_t> v (n);
+
+    for (uint32_t i = 0; i < n; ++i)
+	v[i] = max * ((i * 7919u) % 1000u) / 900.0f - max * 0.05f;
+
+    if (n > 5)
+    {
+	v[1] = numeric_limits<float32_t>::quiet_NaN();
+	v[2] = numeric_limits<float32_t>::infinity();
+	v[3] = -numeric_limits<float32_t>::infinity();
+	v[4] = -0.0f;
+    }
+
+    return v;
+}
+
+} // namespace
+
+
+void
+testDitherMasks()
+{
+    cout << "Testing dither masks" << endl;
+
+    for (size_t m = 0; m < numModes; ++m)
+    {
+	uint32_t size = 0;
+	const float64_t *mask = dpxi::dither_mask (modes[m], &size);
+	uint32_t n = size * size;
+	assert (n > 0);
+
+	//
+	// Every rank is used once, so the thresholds are evenly spaced
+	// over (-0.5, 0.5) and average to 0.
+	//
+
+	vector<bool> seen (n, false);
+	float64_t sum = 0;
+
+	for (uint32_t i = 0; i < n; ++i)
+	{
+	    float64_t r = (mask[i] + 0.5) * n - 0.5;
+	    uint32_t rank = uint32_t (lrint (r));
+
+	    assert (fabs (r - rank) < 1e-6 && rank < n && !seen[rank]);
+	    seen[rank] = true;
+	    sum += mask[i];
+	}
+
+	assert (fabs (sum) < 1e-9);
+
+	//
+	// The mask is built once.
+	//
+
+	uint32_t size2;
+	assert (dpxi::dither_mask (modes[m], &size2) == mask && size2 == size);
+    }
+
+    cout << "ok" << endl;
+}
+
+
+void
+testDitherKernels()
+{
+    cout << "Testing dithered float to integer conversions" << endl;
+
+    const uint32_t widths[] = {1, 7, 67, 130};
+    const uint32_t depths[] = {1, 3, 4};
+    const uint8_t osbs[] = {8, 10, 12, 16};
+
+    for (size_t s = 0; s < numScales; ++s)
+    for (size_t w = 0; w < sizeof (widths) / sizeof (widths[0]); ++w)
+    for (size_t d = 0; d < sizeof (depths) / sizeof (depths[0]); ++d)
+    {
+	uint32_t width = widths[w];
+	uint32_t depth = depths[d];
+	uint32_t n = width * depth;
+	vector<float32_t> in = testRow (n, scales[s]);
+
+	for (uint32_t y = 0; y < 3; ++y)
+	{
+	    uint32_t row = y * 37;
+
+	    for (size_t m = 0; m < numModes; ++m)
+	    {
+		for (size_t o = 0; o < sizeof (osbs) / sizeof (osbs[0]); ++o)
+		{
+		    vector<uint16_t> out (n);
+		    dpx::dither (&out[0], osbs[o], &in[0], scales[s],
+				 width, depth, row, modes[m]);
+
+		    for (uint32_t i = 0; i < n; ++i)
+		    {
+			assert (out[i] == reference (in[i], osbs[o], scales[s],
+						     modes[m], i / depth, row));
+		    }
+		}
+
+		vector<uint8_t> out8 (n);
+		dpx::dither (&out8[0], 8, &in[0], scales[s],
+			     width, depth, row, modes[m]);
+
+		for (uint32_t i = 0; i < n; ++i)
+		{
+		    assert (out8[i] == reference (in[i], 8, scales[s],
+						  modes[m], i / depth, row));
+		}
+	    }
+
+	    //
+	    // Without a mask it is a plain conversion.
+	    //
+
+	    vector<uint16_t> a (n), b (n);
+	    dpx::dither (&a[0], 10, &in[0], scales[s], width, depth, row,
+			 dpx::no_dither);
+	    dpx::convert (&b[0], 10, &in[0], scales[s], n);
+	    assert (a == b);
+	}
+    }
+
+    //
+    // A flat grey between two code values comes out as a mix of the
+    // two with the right average.
+    //
+
+    for (size_t m = 0; m < numModes; ++m)
+    {
+	const uint32_t size = 64;
+	vector<float32_t> in (size, 100.3f / 255.0f);
+	float64_t sum = 0;
+
+	for (uint32_t y = 0; y < size; ++y)
+	{
+	    vector<uint8_t> out (size);
+	    dpx::dither (&out[0], 8, &in[0], 0.0, size, 1, y, modes[m]);
+
+	    for (uint32_t x = 0; x < size; ++x)
+	    {
+		assert (out[x] == 100 || out[x] == 101);
+		sum += out[x];
+	    }
+	}
+
+	assert (fabs (sum / (size * size) - 100.3) < 0.01);
+    }
+
+    cout << "ok" << endl;
+}
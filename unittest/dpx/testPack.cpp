@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <assert.h>
+#include <string.h>
+#include <dpx_pack.hh>
+
+using namespace std;
+using namespace ctl::dpxi;
+
+namespace {
+
+//
+// Small deterministic generator, so that failures can be reproduced.
+//
+
+class Lcg
+{
+  public:
+
+    Lcg (uint32_t seed): _state (seed) {}
+
+    uint32_t
+    next ()
+    {
+	_state = _state * 1664525u + 1013904223u;
+	return _state >> 8;
+    }
+
+  private:
+
+    uint32_t _state;
+};
+
+
+uint16_t
+sampleMask (packed_layout_e layout)
+{
+    return (layout == packed_10_a || layout == packed_10_b)? 0x3ff: 0xfff;
+}
+
+
+//
+// Row lengths that exercise the vector loops as well as every
+// possible tail.
+//
+
+const uint64_t rowLengths[] =
+    {0, 1, 2, 3, 4, 5, 7, 8, 11, 12, 13, 16, 23, 24, 25, 31, 32, 33,
+     47, 48, 49, 95, 96, 97, 1920 * 3, 2048 * 3 + 1, 4096 * 4 + 3};
+
+const size_t numRowLengths = sizeof (rowLengths) / sizeof (rowLengths[0]);
+
+const uint8_t guard = 0xa5;
+
+} // namespace
+
+
+void
+testPackKnownValues()
+{
+    cout << "Testing packed DPX layouts against known words" << endl;
+
+    const pack_kernels &k = kernels_for_isa (pack_scalar);
+    uint16_t samples[3] = {0x3ff, 0x000, 0x155};
+    uint16_t back[3];
+    uint8_t raw[4];
+    uint32_t word;
+
+    //
+    // Method A, first sample in the top bits, two bits of padding
+    // at the bottom.
+    //
+
+    k.pack[packed_10_a] (raw, samples, 3, false);
+    memcpy (&word, raw, 4);
+    assert (word == ((0x3ffu << 22) | (0x155u << 2)));
+
+    k.unpack[packed_10_a] (back, raw, 3, false);
+    assert (!memcmp (back, samples, sizeof (samples)));
+
+    //
+    // Method B, padding at the top; swapped words are stored in the
+    // opposite byte order.
+    //
+
+    k.pack[packed_10_b] (raw, samples, 3, true);
+    uint8_t *p = (uint8_t *) &word;
+    word = (0x3ffu << 20) | 0x155u;
+    assert (raw[0] == p[3] && raw[1] == p[2] && raw[2] == p[1] && raw[3] == p[0]);
+
+    k.unpack[packed_10_b] (back, raw, 3, true);
+    assert (!memcmp (back, samples, sizeof (samples)));
+
+    //
+    // Four filled 12 bit samples 0x123, 0x456, 0x789, 0xabc are the
+    // words 0x1234, 0x5678, 0x9abc.
+    //
+
+    uint16_t filled[4] = {0x123, 0x456, 0x789, 0xabc};
+    uint16_t words[3];
+    k.pack[packed_12_filled] ((uint8_t *) words, filled, 4, false);
+    assert (words[0] == 0x1234 && words[1] == 0x5678 && words[2] == 0x9abc);
+
+    assert (packed_layout (10, 1) == packed_10_a);
+    assert (packed_layout (10, 2) == packed_10_b);
+    assert (packed_layout (12, 9) == packed_12_a);
+    assert (packed_layout (12, 10) == packed_12_b);
+    assert (packed_layout (12, 8) == packed_12_filled);
+    assert (packed_layout (10, 0) == packed_none);
+    assert (packed_layout (16, 8) == packed_none);
+
+    assert (packed_row_bytes (packed_10_a, 4) == 8);
+    assert (packed_row_bytes (packed_12_a, 3) == 6);
+    assert (packed_row_bytes (packed_12_filled, 5) == 8);
+
+    cout << "ok" << endl;
+}
+
+
+void
+testPackKernelsAgree()
+{
+    cout << "Testing vector DPX pack kernels against the scalar ones" << endl;
+
+    const pack_kernels &ref = kernels_for_isa (pack_scalar);
+    Lcg rand (17);
+
+    for (int isa = pack_scalar + 1; isa <= pack_isa_supported(); ++isa)
+    {
+	const pack_kernels &k = kernels_for_isa ((pack_isa_e) isa);
+	cout << "    " << pack_isa_name ((pack_isa_e) isa) << endl;
+
+	for (int l = packed_none + 1; l < packed_layout_count; ++l)
+	{
+	    packed_layout_e layout = (packed_layout_e) l;
+
+	    for (size_t r = 0; r < numRowLengths; ++r)
+	    {
+		uint64_t n = rowLengths[r];
+		uint64_t bytes = packed_row_bytes (layout, n);
+
+		for (int swap = 0; swap < 2; ++swap)
+		{
+		    //
+		    // Unpack random bytes, padding bits included.
+		    //
+
+		    vector<uint8_t> raw (bytes + 1);
+		    for (uint64_t i = 0; i < bytes; ++i)
+			raw[i] = rand.next();
+
+		    vector<uint16_t> a (n + 1, 0xffff);
+		    vector<uint16_t> b (n + 1, 0xffff);
+		    ref.unpack[layout] (&a[0], &raw[0], n, swap);
+		    k.unpack[layout] (&b[0], &raw[0], n, swap);
+		    assert (a == b);
+		    assert (b[n] == 0xffff);
+
+		    //
+		    // Pack random samples, bits above the sample size
+		    // included, and make sure nothing past the end of
+		    // the row is written.
+		    //
+
+		    vector<uint16_t> in (n + 1);
+		    for (uint64_t i = 0; i < n; ++i)
+			in[i] = rand.next();
+
+		    vector<uint8_t> pa (bytes + 1, guard);
+		    vector<uint8_t> pb (bytes + 1, guard);
+		    ref.pack[layout] (&pa[0], &in[0], n, swap);
+		    k.pack[layout] (&pb[0], &in[0], n, swap);
+		    assert (pa == pb);
+		    assert (pb[bytes] == guard);
+		}
+	    }
+	}
+    }
+
+    cout << "ok" << endl;
+}
+
+
+void
+testPackRoundTrip()
+{
+    cout << "Testing DPX pack and unpack round trips" << endl;
+
+    const pack_kernels &k = best_pack_kernels();
+    Lcg rand (23);
+
+    for (int l = packed_none + 1; l < packed_layout_count; ++l)
+    {
+	packed_layout_e layout = (packed_layout_e) l;
+	uint16_t mask = sampleMask (layout);
+
+	for (size_t r = 0; r < numRowLengths; ++r)
+	{
+	    uint64_t n = rowLengths[r];
+
+	    for (int swap = 0; swap < 2; ++swap)
+	    {
+		vector<uint16_t> in (n + 1);
+		for (uint64_t i = 0; i < n; ++i)
+		    in[i] = rand.next() & mask;
+
+		vector<uint8_t> raw (packed_row_bytes (layout, n) + 1);
+		vector<uint16_t> out (n + 1);
+		k.pack[layout] (&raw[0], &in[0], n, swap);
+		k.unpack[layout] (&out[0], &raw[0], n, swap);
+
+		for (uint64_t i = 0; i < n; ++i)
+		    assert (out[i] == in[i]);
+	    }
+	}
+    }
+
+    cout << "ok" << endl;
+}
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <iostream>
+#include <fstream>
+#include <assert.h>
+#include <string.h>
+#include <dpx.hh>
+
+using namespace std;
+using namespace ctl;
+
+namespace {
+
+//
+// The DPX images used by the ctlrender tests, in both byte orders and
+// all of the common bit depths.
+//
+
+const char *files[] =
+{
+    "bars_cinepaint_10.dpx",
+    "bars_nuke_8_be.dpx",
+    "bars_nuke_8_le.dpx",
+    "bars_nuke_10_be.dpx",
+    "bars_nuke_10_le.dpx",
+    "bars_nuke_12_be.dpx",
+    "bars_nuke_12_le.dpx",
+    "bars_nuke_16_be.dpx",
+    "bars_nuke_16_le.dpx",
+};
+
+const size_t numFiles = sizeof (files) / sizeof (files[0]);
+
+const float64_t scales[] = {0.0, 1.0, 100.0};
+
+} // namespace
+
+
+void
+testReadMapped()
+{
+    cout << "Testing memory mapped DPX reads" << endl;
+
+    for (size_t f = 0; f < numFiles; ++f)
+    {
+	for (int s = 0; s < 3; ++s)
+	{
+	    ifstream file (files[f]);
+	    dpx header;
+	    dpx::fb<float32_t> streamed;
+	    dpx::fb<float32_t> mapped;
+
+	    header.read (&file);
+	    header.read (&file, 0, &streamed, scales[s]);
+
+	    bool ok = header.read_mapped (files[f], 0, &mapped, scales[s]);
+	    assert (ok);
+
+	    assert (mapped.width() == streamed.width());
+	    assert (mapped.height() == streamed.height());
+	    assert (mapped.depth() == streamed.depth());
+	    assert (!memcmp (mapped.ptr(), streamed.ptr(), mapped.length()));
+	}
+    }
+
+    dpx header;
+    dpx::fb<float32_t> buffer;
+    assert (!header.read_mapped ("does_not_exist.dpx", 0, &buffer));
+
+    cout << "ok" << endl;
+}
@@ -0,0 +1,304 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013 Academy of Motion Picture Arts and Sciences 
+// ("A.M.P.A.S."). Portions contributed by others as indicated.
+// All rights reserved.
+// 
+// A worldwide, royalty-free, non-exclusive right to copy, modify, create
+// derivatives, and use, in source and binary forms, is hereby granted, 
+// subject to acceptance of this license. Performance of any of the 
+// aforementioned acts indicates acceptance to be bound by the following 
+// terms and conditions:
+//
+//  * Copies of source code, in whole or in part, must retain the 
+//    above copyright notice, this list of conditions and the 
+//    Disclaimer of Warranty.
+//
+//  * Use in binary form must retain the above copyright notice, 
+//    this list of conditions and the Disclaimer of Warranty in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  * Nothing in this license shall be deemed to grant any rights to 
+//    trademarks, copyrights, patents, trade secrets or any other 
+//    intellectual property of A.M.P.A.S. or any contributors, except 
+//    as expressly stated herein.
+//
+//  * Neither the name "A.M.P.A.S." nor the name of any other 
+//    contributors to this software may be used to endorse or promote 
+//    products derivative of or based on this software without express 
+//    prior written permission of A.M.P.A.S. or the contributors, as 
+//    appropriate.
+// 
+// This license shall be construed pursuant to the laws of the State of 
+// California, and any disputes related thereto shall be subject to the 
+// jurisdiction of the courts therein.
+//
+// Disclaimer of Warranty: THIS SOFTWARE IS PROVIDED BY A.M.P.A.S. AND 
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+// BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS 
+// FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT ARE DISCLAIMED. IN NO 
+// EVENT SHALL A.M.P.A.S., OR ANY CONTRIBUTORS OR DISTRIBUTORS, BE LIABLE 
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, RESITUTIONARY, 
+// OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+// THE POSSIBILITY OF SUCH DAMAGE.
+//
+// WITHOUT LIMITING THE GENERALITY OF THE FOREGOING, THE ACADEMY 
+// SPECIFICALLY DISCLAIMS ANY REPRESENTATIONS OR WARRANTIES WHATSOEVER 
+// RELATED TO PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS IN THE ACADEMY 
+// COLOR ENCODING SYSTEM, OR APPLICATIONS THEREOF, HELD BY PARTIES OTHER 
+// THAN A.M.P.A.S., WHETHER DISCLOSED OR UNDISCLOSED.
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <IlmThreadPool.h>
+#include <dpx.hh>
+
+using namespace std;
+using namespace ctl;
+
+namespace {
+
+const char *files[] =
+{
+    "bars_cinepaint_10.dpx",
+    "bars_nuke_8_be.dpx",
+    "bars_nuke_8_le.dpx",
+    "bars_nuke_10_be.dpx",
+    "bars_nuke_10_le.dpx",
+    "bars_nuke_12_be.dpx",
+    "bars_nuke_12_le.dpx",
+    "bars_nuke_16_be.dpx",
+    "bars_nuke_16_le.dpx",
+};
+
+const size_t numFiles = sizeof (files) / sizeof (files[0]);
+
+//
+// The images are 135 rows high, so with 2 and 5 threads the rows are
+// split between the threads, in whole images and in 64-row strips.
+//
+
+const int numThreads[] = {1, 2, 5};
+
+const size_t numNumThreads = sizeof (numThreads) / sizeof (numThreads[0]);
+
+const uint32_t stripRows[] = {64, 100000};
+
+const size_t numStripRows = sizeof (stripRows) / sizeof (stripRows[0]);
+
+void
+setNumThreads (int n)
+{
+    IlmThread::ThreadPool::globalThreadPool().setNumThreads (n);
+}
+
+template <class T>
+string
+bytes (const dpx::fb<T> &buffer)
+{
+    return string ((const char *) buffer.ptr(), buffer.length());
+}
+
+string
+readFile (const char *name)
+{
+    ifstream file (name);
+    stringstream contents;
+
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+//
+// Reads an image in every way the tests compare: from a stream,
+// memory mapped, and in strips.
+//
+
+struct Reads
+{
+    string streamed;
+    string mapped;
+    string strips[numStripRows];
+};
+
+Reads
+readAll (const char *name)
+{
+    Reads reads;
+
+    ifstream file (name);
+    dpx header;
+    dpx::fb<float32_t> streamed;
+    dpx::fb<float32_t> mapped;
+
+    header.read (&file);
+    header.read (&file, 0, &streamed, 0.0);
+    reads.streamed = bytes (streamed);
+
+    bool ok = header.read_mapped (name, 0, &mapped, 0.0);
+    assert (ok);
+    reads.mapped = bytes (mapped);
+
+    for (size_t r = 0; r < numStripRows; ++r)
+    {
+	dpx::strip_reader reader;
+	ok = reader.open (&header, name, 0, 0.0);
+	assert (ok);
+
+	for (uint32_t y = 0; y < reader.height(); y += stripRows[r])
+	{
+	    dpx::fb<float32_t> strip;
+	    reader.read (y, stripRows[r], &strip);
+	    reads.strips[r] += bytes (strip);
+	}
+    }
+
+    return reads;
+}
+
+//
+// Writes an image as a whole and in strips, and returns the files.
+//
+
+struct Writes
+{
+    string whole;
+    string strips[numStripRows];
+};
+
+Writes
+writeAll (const dpx::fb<float32_t> &image, uint8_t bps)
+{
+    Writes writes;
+
+    {
+	ofstream whole ("threads_whole.dpx");
+	dpx header;
+
+	header.elements[0].data_sign = 0;
+	header.elements[0].bits_per_sample = bps;
+	header.write (&whole, 0, image, 0.0);
+	header.write (&whole);
+    }
+
+    writes.whole = readFile ("threads_whole.dpx");
+
+    uint64_t rowSamples = (uint64_t) image.width() * image.depth();
+
+    for (size_t r = 0; r < numStripRows; ++r)
+    {
+	{
+	    ofstream strips ("threads_strips.dpx");
+	    dpx header;
+	    dpx::strip_writer writer;
+
+	    header.elements[0].data_sign = 0;
+	    header.elements[0].bits_per_sample = bps;
+	    bool ok = writer.open (&header, &strips, 0, image.width(),
+				   image.height(), image.depth(), 0.0);
+	    assert (ok);
+
+	    for (uint32_t y = 0; y < image.height(); y += stripRows[r])
+	    {
+		uint32_t rows = image.height() - y;
+		if (rows > stripRows[r])
+		    rows = stripRows[r];
+
+		dpx::fb<float32_t> strip;
+		strip.init (image.width(), rows, image.depth());
+		memcpy (strip.ptr(), image.ptr() + y * rowSamples,
+			strip.length());
+		writer.write (strip);
+	    }
+
+	    writer.close();
+	    header.write (&strips);
+	}
+
+	writes.strips[r] = readFile ("threads_strips.dpx");
+    }
+
+    return writes;
+}
+
+} // namespace
+
+
+void
+testThreadedReads()
+{
+    cout << "Testing DPX reads with several threads" << endl;
+
+    for (size_t f = 0; f < numFiles; ++f)
+    {
+	setNumThreads (0);
+	Reads expected = readAll (files[f]);
+
+	for (size_t t = 0; t < numNumThreads; ++t)
+	{
+	    setNumThreads (numThreads[t]);
+	    Reads reads = readAll (files[f]);
+
+	    assert (reads.streamed == expected.streamed);
+	    assert (reads.mapped == expected.mapped);
+
+	    for (size_t r = 0; r < numStripRows; ++r)
+		assert (reads.strips[r] == expected.strips[r]);
+	}
+    }
+
+    setNumThreads (0);
+
+    cout << "ok" << endl;
+}
+
+
+void
+testThreadedWrites()
+{
+    cout << "Testing DPX writes with several threads" << endl;
+
+    const uint8_t bps[] = {8, 10, 12, 16};
+
+    ifstream file ("bars_nuke_16_le.dpx");
+    dpx source;
+    dpx::fb<float32_t> image;
+
+    source.read (&file);
+    source.read (&file, 0, &image, 0.0);
+
+    for (int b = 0; b < 4; ++b)
+    {
+	setNumThreads (0);
+	Writes expected = writeAll (image, bps[b]);
+
+	for (size_t t = 0; t < numNumThreads; ++t)
+	{
+	    setNumThreads (numThreads[t]);
+	    Writes writes = writeAll (image, bps[b]);
+
+	    assert (writes.whole == expected.whole);
+
+	    for (size_t r = 0; r < numStripRows; ++r)
+		assert (writes.strips[r] == expected.strips[r]);
+	}
+    }
+
+    setNumThreads (0);
+
+    remove ("threads_whole.dpx");
+    remove ("threads_strips.dpx");
+
+    cout << "ok" << endl;
+}